@@ -183,6 +183,12 @@ public:
     void setPlaybackRate(qreal s);
     Q_INVOKABLE void play(const QUrl& url);
     AVPlayer *player();
+    /*!
+     * \brief metrics
+     * Runtime metrics: queue depth, bit rate, frame counts, decode/convert time, a/v sync error, audio underruns.
+     * Keys are from Statistics::Metrics::toMap(). Lock-free, can be polled by a Timer.
+     */
+    Q_INVOKABLE QVariantMap metrics() const;
 
     bool isAutoLoad() const;
     void setAutoLoad(bool autoLoad);
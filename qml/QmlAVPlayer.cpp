@@ -788,6 +788,11 @@ AVPlayer* QmlAVPlayer::player()
     return mpPlayer;
 }
 
+QVariantMap QmlAVPlayer::metrics() const
+{
+    return mpPlayer->statistics().metrics().toMap();
+}
+
 void QmlAVPlayer::play(const QUrl &url)
 {
     if (mSource == url && (playbackState() != StoppedState || m_loading))
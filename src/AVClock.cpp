@@ -19,9 +19,6 @@
     Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 ******************************************************************************/
 #include <QtAV/AVClock.h>
-#include <QtCore/QTimer>
-#include <QtCore/QTimerEvent>
-#include <QtCore/QDateTime>
 #include "utils/Logger.h"
 
 namespace QtAV {
@@ -30,19 +27,29 @@ enum {
     kPaused,
     kStopped
 };
+
+static inline qint64 elapsedUs(const QElapsedTimer& timer)
+{
+#if QT_VERSION >= QT_VERSION_CHECK(4, 8, 0)
+    return timer.nsecsElapsed()/1000LL;
+#else
+    return qint64(timer.elapsed())*1000LL;
+#endif //QT_VERSION >= QT_VERSION_CHECK(4, 8, 0)
+}
+
 AVClock::AVClock(AVClock::ClockType c, QObject *parent):
     QObject(parent)
   , auto_clock(true)
   , m_state(kStopped)
   , clock_type(c)
+  , pts_(0)
+  , pts_v(0)
+  , delay_(0)
   , mSpeed(1.0)
   , value0(0)
-  , avg_err(0)
-  , nb_restarted(0)
   , nb_sync(0)
   , sync_id(0)
 {
-    last_pts = pts_ = pts_v = delay_ = 0;
 }
 
 AVClock::AVClock(QObject *parent):
@@ -50,14 +57,14 @@ AVClock::AVClock(QObject *parent):
   , auto_clock(true)
   , m_state(kStopped)
   , clock_type(AudioClock)
+  , pts_(0)
+  , pts_v(0)
+  , delay_(0)
   , mSpeed(1.0)
   , value0(0)
-  , avg_err(0)
-  , nb_restarted(0)
   , nb_sync(0)
   , sync_id(0)
 {
-    last_pts = pts_ = pts_v = delay_ = 0;
 }
 
 void AVClock::setClockType(ClockType ct)
@@ -65,7 +72,6 @@ void AVClock::setClockType(ClockType ct)
     if (clock_type == ct)
         return;
     clock_type = ct;
-    QTimer::singleShot(0, this, SLOT(restartCorrectionTimer()));
 }
 
 AVClock::ClockType AVClock::clockType() const
@@ -80,11 +86,21 @@ bool AVClock::isActive() const
 
 void AVClock::setInitialValue(double v)
 {
-    value0 = v;
-    qDebug("Clock initial value: %f", v);
+    setInitialValueUs(qRound64(v*1000000.0));
 }
 
 double AVClock::initialValue() const
+{
+    return double(initialValueUs())*kMillionth;
+}
+
+void AVClock::setInitialValueUs(qint64 us)
+{
+    value0 = us;
+    qDebug("Clock initial value: %lld us", us);
+}
+
+qint64 AVClock::initialValueUs() const
 {
     return value0;
 }
@@ -99,17 +115,48 @@ bool AVClock::isClockAuto() const
     return auto_clock;
 }
 
+qint64 AVClock::valueUs() const
+{
+    if (clock_type == AudioClock) {
+        // TODO: audio clock need a timer too
+        // timestamp from media stream is >= value0
+        return pts_ == 0 ? value0 : pts_ + delay_;
+    } else if (clock_type == ExternalClock) {
+        return externalPtsUs() + value0;
+    } else {
+        return pts_v; // value0 is 1st video pts_v already
+    }
+}
+
+qint64 AVClock::externalPtsUs() const
+{
+    if (!timer.isValid()) //timer is paused
+        return pts_;
+    // computed from the anchor every time instead of accumulating QElapsedTimer.restart() (see github issue 46, 307 etc)
+    return pts_ + qint64(double(elapsedUs(timer))*speed());
+}
+
+void AVClock::anchor()
+{
+    if (clock_type != ExternalClock || !timer.isValid())
+        return;
+    pts_ = externalPtsUs();
+    timer.restart();
+}
+
 void AVClock::updateExternalClock(qint64 msecs)
+{
+    updateExternalClockUs(msecs*1000LL);
+}
+
+void AVClock::updateExternalClockUs(qint64 us)
 {
     if (clock_type == AudioClock)
         return;
-    qDebug("External clock change: %f ==> %f", value(), double(msecs) * kThousandth);
-    pts_ = double(msecs) * kThousandth; //can not use msec/1000.
+    qDebug("External clock change: %f ==> %f", value(), double(us) * kMillionth);
+    pts_ = us;
     if (!isPaused())
         timer.restart();
-
-    last_pts = pts_;
-    t = QDateTime::currentMSecsSinceEpoch();
     if (clockType() == VideoClock)
         pts_v = pts_;
 }
@@ -119,16 +166,14 @@ void AVClock::updateExternalClock(const AVClock &clock)
     if (clock_type != ExternalClock)
         return;
     qDebug("External clock change: %f ==> %f", value(), clock.value());
-    pts_ = clock.value();
+    pts_ = clock.valueUs();
     if (!isPaused())
         timer.restart();
-
-    last_pts = pts_;
-    t = QDateTime::currentMSecsSinceEpoch();
 }
 
 void AVClock::setSpeed(qreal speed)
 {
+    anchor(); // elapsed time before the change is in old speed
     mSpeed = speed;
 }
 
@@ -163,7 +208,6 @@ void AVClock::start()
     m_state = kRunning;
     qDebug("AVClock started!!!!!!!!");
     timer.start();
-    QTimer::singleShot(0, this, SLOT(restartCorrectionTimer()));
     Q_EMIT started();
 }
 //remember last value because we don't reset  pts_, pts_v, delay_
@@ -175,7 +219,7 @@ void AVClock::pause(bool p)
         return;
     m_state = p ? kPaused : kRunning;
     if (p) {
-        QTimer::singleShot(0, this, SLOT(stopCorrectionTimer()));
+        anchor(); // keep the time elapsed since last anchor
 #if QT_VERSION >= QT_VERSION_CHECK(4, 7, 0)
         timer.invalidate();
 #else
@@ -184,10 +228,8 @@ void AVClock::pause(bool p)
         Q_EMIT paused();
     } else {
         timer.start();
-        QTimer::singleShot(0, this, SLOT(restartCorrectionTimer()));
         Q_EMIT resumed();
     }
-    t = QDateTime::currentMSecsSinceEpoch();
     Q_EMIT paused(p);
 }
 
@@ -199,58 +241,12 @@ void AVClock::reset()
     m_state = kStopped;
     value0 = 0;
     pts_ = pts_v = delay_ = 0;
-    QTimer::singleShot(0, this, SLOT(stopCorrectionTimer()));
 #if QT_VERSION >= QT_VERSION_CHECK(4, 7, 0)
     timer.invalidate();
 #else
     timer.stop();
 #endif //QT_VERSION >= QT_VERSION_CHECK(4, 7, 0)
-    t = QDateTime::currentMSecsSinceEpoch();
     Q_EMIT resetted();
 }
 
-void AVClock::timerEvent(QTimerEvent *event)
-{
-    Q_ASSERT_X(clockType() != AudioClock, "AVClock::timerEvent", "Internal error. AudioClock can not call this");
-    if (event->timerId() != correction_schedule_timer.timerId())
-        return;
-    if (isPaused())
-        return;
-    const double delta_pts = (value() - last_pts)/speed();
-    //const double err = double(correction_timer.restart()) * kThousandth - delta_pts;
-    const qint64 now = QDateTime::currentMSecsSinceEpoch();
-    const double err = double(now - t) * kThousandth - delta_pts;
-    t = now;
-    // FIXME: avfoundation camera error is large (about -0.6s)
-    if (qAbs(err*10.0) < kCorrectionInterval || clock_type == VideoClock) {
-        avg_err += err/(nb_restarted+1);
-    }
-    //qDebug("correction timer event. error = %f, avg_err=%f, nb_restarted=%d", err, avg_err, nb_restarted);
-    last_pts = value();
-    nb_restarted = 0;
-}
-
-void AVClock::restartCorrectionTimer()
-{
-    nb_restarted = 0;
-    avg_err = 0;
-    correction_schedule_timer.stop();
-    if (clockType() == AudioClock) // TODO: for all clock type
-        return;
-    // parameters are reset. do not start correction timer if not running
-    if (m_state != kRunning)
-        return;
-    // timer is always started in AVClock::start()
-    if (!timer.isValid())
-        return;
-    t = QDateTime::currentMSecsSinceEpoch();
-    correction_schedule_timer.start(kCorrectionInterval*1000, this);
-}
-
-void AVClock::stopCorrectionTimer()
-{
-    nb_restarted = 0;
-    avg_err = 0;
-    correction_schedule_timer.stop();
-}
 } //namespace QtAV
@@ -26,6 +26,7 @@
 #include "QtAV/AVDecoder.h"
 #include "VideoThread.h"
 #include <QtCore/QTime>
+#include "utils/Trace.h"
 #include "utils/Logger.h"
 
 #define RESUME_ONCE_ON_SEEK 0
@@ -175,7 +176,12 @@ void AVDemuxThread::stepBackward()
             AVThread *avt = demux_thread->videoThread();
             avt->packetQueue()->clear(); // clear here
             if (pts <= 0) {
-                demux_thread->demuxer->seek(qint64(-pts*1000.0) - 500LL);
+                // start from the indexed key frame before current frame. otherwise 500ms earlier and hope there is a key frame
+                const qint64 cur = qint64(-pts*1000.0);
+                qint64 key = demux_thread->demuxer->keyFrameBefore(cur - 1);
+                if (key < 0)
+                    key = cur - 500LL;
+                demux_thread->demuxer->seek(key);
                 QVector<qreal> ts;
                 qreal t = -1.0;
                 while (t < -pts) {
@@ -243,6 +249,7 @@ void AVDemuxThread::seek(qint64 pos, SeekType type)
 
 void AVDemuxThread::seekInternal(qint64 pos, SeekType type)
 {
+    QTAV_TRACE("demux", "seek");
     AVThread* av[] = { audio_thread, video_thread};
     qDebug("seek to %s %lld ms (%f%%)", QTime(0, 0, 0).addMSecs(pos).toString().toUtf8().constData(), pos, double(pos - demuxer->startTime())/double(demuxer->duration())*100.0);
     demuxer->setSeekType(type);
@@ -474,7 +481,7 @@ void AVDemuxThread::frameDeliveredOnStepForward()
         thread->clock()->setClockAuto(clock_type & 1);
         thread->clock()->setClockType(AVClock::ClockType(clock_type/2));
         clock_type = -1;
-        thread->clock()->updateExternalClock((thread->previousHistoryPts() - thread->clock()->initialValue())*1000.0);
+        thread->clock()->updateExternalClockUs(qRound64(thread->previousHistoryPts()*1000000.0) - thread->clock()->initialValueUs());
     }
     Q_EMIT stepFinished();
 }
@@ -613,9 +620,11 @@ void AVDemuxThread::run()
             continue; //the queue is empty and will block
         }
         updateBufferState();
+        QTAV_TRACE_VAR(trace_read, "demux", "read");
         if (!demuxer->readFrame()) {
             continue;
         }
+        trace_read.end();
         stream = demuxer->stream();
         pkt = demuxer->packet();
         Packet apkt;
@@ -21,6 +21,8 @@
 #include "QtAV/AVDemuxer.h"
 #include "QtAV/MediaIO.h"
 #include "QtAV/private/AVCompat.h"
+#include <QtCore/QDir>
+#include <QtCore/QFileInfo>
 #include <QtCore/QMutex>
 #include <QtCore/QStringList>
 #if QT_VERSION >= QT_VERSION_CHECK(4, 7, 0)
@@ -29,6 +31,8 @@
 #include <QtCore/QTime>
 typedef QTime QElapsedTimer;
 #endif
+#include "KeyFrameIndex.h"
+#include "PacketPool.h"
 #include "utils/internal.h"
 #include "utils/Logger.h"
 
@@ -212,8 +216,11 @@ public:
         , dict(0)
         , interrupt_hanlder(0)
         , custom_duration(0)
+        , packet_pool(PacketPool::create())
+        , index_stream(-1)
     {}
     ~Private() {
+        packet_pool->deref(); // packets may still alive
         delete interrupt_hanlder;
         if (dict) {
             av_dict_free(&dict);
@@ -275,6 +282,48 @@ public:
     bool setStream(AVDemuxer::StreamType st, int streamValue);
     //called by loadFile(). if change to a new stream, call it(e.g. in AVPlayer)
     bool prepareStreams();
+    // seek to the indexed video key frame <= upos. the container index is not used
+    bool seekToKeyFrame(qint64 upos) {
+        KeyFrameIndex::Entry e;
+        if (vstream.stream < 0 || index_stream != vstream.stream || !index.find(upos, &e))
+            return false;
+        int ret = -1;
+        // byte seek lands on the key packet exactly. mp4, mkv etc. do not support it
+        if (e.pos >= 0 && !(format_ctx->iformat->flags & AVFMT_NO_BYTE_SEEK))
+            ret = av_seek_frame(format_ctx, vstream.stream, e.pos, AVSEEK_FLAG_BYTE);
+        if (ret < 0) {
+            const AVRational us = { 1, AV_TIME_BASE };
+            const int64_t ts = av_rescale_q(e.pts, us, format_ctx->streams[vstream.stream]->time_base);
+            // 1 tick tolerance for rounding of us
+            ret = avformat_seek_file(format_ctx, vstream.stream, ts - 1, ts, ts + 1, 0);
+        }
+        if (ret < 0)
+            return false;
+        qDebug("seek to indexed key frame %lldms for %lldms", e.pts/1000LL, upos/1000LL);
+        return true;
+    }
+    void loadIndex() {
+        index.clear();
+        index_stream = vstream.stream;
+        index_file.clear();
+        const QString dir(AVDemuxer::keyFrameIndexCacheDir());
+        if (dir.isEmpty() || input || index_stream < 0)
+            return;
+        const QString name(KeyFrameIndex::cacheFileName(file));
+        if (name.isEmpty())
+            return;
+        index_file = QDir(dir).absoluteFilePath(name);
+        index.load(index_file, index_stream);
+    }
+    void saveIndex() {
+        if (!index_file.isEmpty() && index.isModified() && index_stream >= 0) {
+            QDir().mkpath(QFileInfo(index_file).absolutePath());
+            index.save(index_file, index_stream);
+        }
+        index.clear();
+        index_stream = -1;
+        index_file.clear();
+    }
 
     MediaStatus media_status;
     bool seekable;
@@ -320,8 +369,15 @@ public:
     AVDemuxer::InterruptHandler *interrupt_hanlder;
     QMutex mutex; //TODO: remove if load, read, seek is called in 1 thread
     int64_t custom_duration;
+    PacketPool *packet_pool;
+    KeyFrameIndex index; // video key frames
+    int index_stream;
+    QString index_file; // cache file
 };
 
+static QMutex index_cache_mutex;
+static QString index_cache_dir;
+
 AVDemuxer::AVDemuxer(QObject *parent)
     : QObject(parent)
     , d(new Private())
@@ -522,9 +578,16 @@ bool AVDemuxer::readFrame()
         return false;
     }
     // TODO: v4l2 copy
-    d->pkt = Packet::fromAVPacket(&packet, av_q2d(d->format_ctx->streams[d->stream]->time_base));
-    av_packet_unref(&packet); //important!
+    // packet data is moved to d->pkt without adding a new reference
+    d->packet_pool->fromAVPacket(&d->pkt, &packet, d->format_ctx->streams[d->stream]->time_base);
     d->eof = false;
+    if (d->stream == videoStream() && !d->has_attached_pic) {
+        if (d->index_stream != d->stream) {
+            d->index.clear();
+            d->index_stream = d->stream;
+        }
+        d->index.addPacket(d->pkt.ptsUs(), d->pkt.position, d->pkt.hasKeyFrame);
+    }
     if (d->pkt.pts > qreal(duration())/1000.0) {
         d->max_pts = d->pkt.pts;
     }
@@ -626,13 +689,15 @@ bool AVDemuxer::seek(qint64 pos)
     //qDebug("seek flag: %d", seek_flag);
     //bool seek_bytes = !!(d->format_ctx->iformat->flags & AVFMT_TS_DISCONT) && strcmp("ogg", d->format_ctx->iformat->name);
     int ret = 0;
+    d->index.discontinue();
     if (d->custom_duration > 0 && mediaIO()) {
         ret = mediaIO()->seek(pos, -200);
         if (ret) {
             avformat_flush(d->format_ctx);
         }
-    }
-    else {
+    } else if ((seek_flag & AVSEEK_FLAG_BACKWARD) && !(seek_flag & AVSEEK_FLAG_ANY) && d->seekToKeyFrame(upos)) {
+        ret = 0;
+    } else {
         ret = av_seek_frame(d->format_ctx, -1, upos, seek_flag);
         //int ret = avformat_seek_file(d->format_ctx, -1, INT64_MIN, upos, upos, seek_flag);
         //avformat_seek_file()
@@ -665,6 +730,35 @@ bool AVDemuxer::seek(qint64 pos)
     return true;
 }
 
+qint64 AVDemuxer::keyFrameBefore(qint64 pos) const
+{
+    KeyFrameIndex::Entry e;
+    if (d->index_stream != videoStream() || !d->index.find(pos*1000LL, &e))
+        return -1;
+    return e.pts/1000LL;
+}
+
+qint64 AVDemuxer::maxGopDuration() const
+{
+    if (d->index_stream != videoStream())
+        return 0;
+    return d->index.maxGop()/1000LL;
+}
+
+void AVDemuxer::setKeyFrameIndexCacheDir(const QString &dir)
+{
+    QMutexLocker lock(&index_cache_mutex);
+    Q_UNUSED(lock);
+    index_cache_dir = dir;
+}
+
+QString AVDemuxer::keyFrameIndexCacheDir()
+{
+    QMutexLocker lock(&index_cache_mutex);
+    Q_UNUSED(lock);
+    return index_cache_dir;
+}
+
 bool AVDemuxer::seek(qreal q)
 {
     if (duration() <= 0) {
@@ -906,6 +1000,7 @@ bool AVDemuxer::load()
         return false;
     }
     d->started = false;
+    d->loadIndex();
     setMediaStatus(LoadedMedia);
     Q_EMIT loaded();
     const bool was_seekable = d->seekable;
@@ -942,6 +1037,7 @@ bool AVDemuxer::unload()
     d->resetStreams();
     d->interrupt_hanlder->setStatus(0);
     d->custom_duration = 0;
+    d->saveIndex();
     //av_close_input_file(d->format_ctx); //deprecated
     if (d->format_ctx) {
         qDebug("closing d->format_ctx");
@@ -1224,6 +1320,16 @@ QVariantHash AVDemuxer::options() const
     return d->options;
 }
 
+QVariantHash AVDemuxer::packetPoolStatistics() const
+{
+    const PacketPool::Statistics st = d->packet_pool->statistics();
+    QVariantHash h;
+    h[QStringLiteral("hits")] = st.hits;
+    h[QStringLiteral("misses")] = st.misses;
+    h[QStringLiteral("free")] = st.free;
+    return h;
+}
+
 qint64 AVDemuxer::clock()
 {
     if (d->input) {
@@ -20,10 +20,12 @@
 ******************************************************************************/
 
 #include "QtAV/AVMuxer.h"
+#include "QtAV/AVDemuxer.h"
 #include "QtAV/private/AVCompat.h"
 #include "QtAV/MediaIO.h"
 #include "QtAV/VideoEncoder.h"
 #include "QtAV/AudioEncoder.h"
+#include <QtCore/QVector>
 #include "utils/internal.h"
 #include "utils/Logger.h"
 
@@ -31,8 +33,8 @@ namespace QtAV {
 static const char kFileScheme[] = "file:";
 #define CHAR_COUNT(s) (sizeof(s) - 1) // tail '\0'
 
-// Packet::asAVPacket() assumes time base is 0.001
-static const AVRational kTB = {1, 1000};
+// Packet::asAVPacket() assumes time base is 1/AV_TIME_BASE
+static const AVRational kTB = {1, AV_TIME_BASE};
 
 class AVMuxer::Private
 {
@@ -50,6 +52,7 @@ public:
         , dict(0)
         , aenc(0)
         , venc(0)
+        , demuxer(0)
     {
 #if !AVFORMAT_STATIC_REGISTER
         av_register_all();
@@ -67,7 +70,9 @@ public:
         }
     }
     AVStream* addStream(AVFormatContext* ctx, const QString& codecName, AVCodecID codecId);
+    AVStream* copyStream(AVFormatContext* ctx, AVStream* in);
     bool prepareStreams();
+    bool writePacket(const Packet& packet, int stream);
     void applyOptionsForDict();
     void applyOptionsForContext();
 
@@ -90,6 +95,8 @@ public:
     QList<int> audio_streams, video_streams, subtitle_streams;
     AudioEncoder *aenc; // not owner
     VideoEncoder *venc; // not owner
+    AVDemuxer *demuxer; // not owner. stream copy source
+    QVector<qint64> last_dts; // output time base
 };
 
 AVStream *AVMuxer::Private::addStream(AVFormatContext* ctx, const QString &codecName, AVCodecID codecId)
@@ -132,6 +139,28 @@ AVStream *AVMuxer::Private::addStream(AVFormatContext* ctx, const QString &codec
     return s;
 }
 
+AVStream* AVMuxer::Private::copyStream(AVFormatContext *ctx, AVStream *in)
+{
+    AVStream *s = avformat_new_stream(ctx, NULL);
+    if (!s) {
+        qWarning("Can not allocate stream");
+        return 0;
+    }
+    s->id = ctx->nb_streams - 1;
+    AV_ENSURE_OK(avcodec_copy_context(s->codec, in->codec), 0);
+    // codec tag of input container may be invalid for output container
+    s->codec->codec_tag = 0;
+    if (ctx->oformat->flags & AVFMT_GLOBALHEADER)
+        s->codec->flags |= AV_CODEC_FLAG_GLOBAL_HEADER;
+    // a hint. may be changed in avformat_write_header
+    s->time_base = in->time_base;
+    s->avg_frame_rate = in->avg_frame_rate;
+    s->sample_aspect_ratio = in->sample_aspect_ratio;
+    s->disposition = in->disposition;
+    av_dict_copy(&s->metadata, in->metadata, 0);
+    return s;
+}
+
 bool AVMuxer::Private::prepareStreams()
 {
     audio_streams.clear();
@@ -153,6 +182,10 @@ bool AVMuxer::Private::prepareStreams()
 
             video_streams.push_back(s->id);
         }
+    } else if (demuxer && demuxer->videoStream() >= 0) {
+        AVStream *s = copyStream(format_ctx, demuxer->formatContext()->streams[demuxer->videoStream()]);
+        if (s)
+            video_streams.push_back(s->id);
     }
     if (aenc) {
         AVStream *s = addStream(format_ctx, aenc->codecName(), fmt->audio_codec);
@@ -179,6 +212,10 @@ bool AVMuxer::Private::prepareStreams()
 
             audio_streams.push_back(s->id);
         }
+    } else if (demuxer && demuxer->audioStream() >= 0) {
+        AVStream *s = copyStream(format_ctx, demuxer->formatContext()->streams[demuxer->audioStream()]);
+        if (s)
+            audio_streams.push_back(s->id);
     }
     return !(audio_streams.isEmpty() && video_streams.isEmpty() && subtitle_streams.isEmpty());
 }
@@ -424,6 +461,7 @@ bool AVMuxer::open()
     }
     // d->format_ctx->start_time_realtime
     AV_ENSURE_OK(avformat_write_header(d->format_ctx, &d->dict), false);
+    d->last_dts.fill((qint64)AV_NOPTS_VALUE, d->format_ctx->nb_streams);
     d->started = false;
     d->open = true;
 
@@ -459,14 +497,41 @@ bool AVMuxer::isOpen() const
     return d->open;
 }
 
-bool AVMuxer::writeAudio(const QtAV::Packet& packet)
+bool AVMuxer::Private::writePacket(const Packet &packet, int stream)
 {
-    AVPacket *pkt = (AVPacket*)packet.asAVPacket(); //FIXME
-    pkt->stream_index = d->audio_streams[0]; //FIXME
-    AVStream *s = d->format_ctx->streams[pkt->stream_index];
+    // asAVPacket() is shared by all copies of packet (encoder, signal arguments, queues) and must not be modified.
+    // av_interleaved_write_frame() modifies the packet and takes the reference, so write a new reference
+    AVPacket avpkt;
+    av_init_packet(&avpkt);
+    if (av_packet_ref(&avpkt, (AVPacket*)packet.asAVPacket()) < 0)
+        return false;
+    AVPacket *pkt = &avpkt;
+    pkt->stream_index = stream;
+    AVStream *s = format_ctx->streams[stream];
     // stream.time_base is set in avformat_write_header
     av_packet_rescale_ts(pkt, kTB, s->time_base);
-    av_interleaved_write_frame(d->format_ctx, pkt);
+    // dts must increase (strictly for most formats), otherwise the packet is rejected.
+    // copied streams can have equal dts because negative dts are clamped in Packet. fix it like ffmpeg does
+    qint64 &last = last_dts[pkt->stream_index];
+    if (pkt->dts != (qint64)AV_NOPTS_VALUE && !(format_ctx->oformat->flags & AVFMT_NOTIMESTAMPS)) {
+        if (last != (qint64)AV_NOPTS_VALUE) {
+            const qint64 min_dts = last + !(format_ctx->oformat->flags & AVFMT_TS_NONSTRICT);
+            if (pkt->dts < min_dts) {
+                if (pkt->pts != (qint64)AV_NOPTS_VALUE && pkt->pts >= pkt->dts)
+                    pkt->pts = qMax<qint64>(pkt->pts, min_dts);
+                pkt->dts = min_dts;
+            }
+        }
+        last = pkt->dts;
+    }
+    const int ret = av_interleaved_write_frame(format_ctx, pkt);
+    av_packet_unref(pkt); // blank if written
+    return ret >= 0;
+}
+
+bool AVMuxer::writeAudio(const QtAV::Packet& packet)
+{
+    d->writePacket(packet, d->audio_streams[0]);
 
     d->started = true;
     return true;
@@ -474,14 +539,9 @@ bool AVMuxer::writeAudio(const QtAV::Packet& packet)
 
 bool AVMuxer::writeVideo(const QtAV::Packet& packet)
 {
-    AVPacket *pkt = (AVPacket*)packet.asAVPacket();
-    pkt->stream_index = d->video_streams[0];
-    AVStream *s = d->format_ctx->streams[pkt->stream_index];
-    // stream.time_base is set in avformat_write_header
-    av_packet_rescale_ts(pkt, kTB, s->time_base);
-    //av_write_frame
-    av_interleaved_write_frame(d->format_ctx, pkt);
+    d->writePacket(packet, d->video_streams[0]);
 #if 0
+    AVStream *s = d->format_ctx->streams[pkt->stream_index];
     qDebug("mux packet.pts: %.3f dts:%.3f duration: %.3f, avpkt.pts: %lld,dts:%lld,duration:%lld"
            , packet.pts, packet.dts, packet.duration
            , pkt->pts, pkt->dts, pkt->duration);
@@ -505,6 +565,11 @@ void AVMuxer::copyProperties(AudioEncoder *enc)
     d->aenc = enc;
 }
 
+void AVMuxer::copyProperties(AVDemuxer *demuxer)
+{
+    d->demuxer = demuxer;
+}
+
 void AVMuxer::setOptions(const QVariantHash &dict)
 {
     d->options = dict;
@@ -204,6 +204,18 @@ qreal AVPlayer::speed() const
     return d->speed;
 }
 
+void AVPlayer::setPitchCompensation(bool value)
+{
+    d->pitch_compensation = value;
+    if (d->athread)
+        d->athread->setPitchCompensation(value);
+}
+
+bool AVPlayer::pitchCompensation() const
+{
+    return d->pitch_compensation;
+}
+
 void AVPlayer::setInterruptTimeout(qint64 ms)
 {
     if (ms < 0LL)
@@ -248,6 +260,24 @@ qreal AVPlayer::forcedFrameRate() const
     return d->force_fps;
 }
 
+void AVPlayer::setVideoDecodeAhead(int frames, qint64 bytes)
+{
+    d->decode_ahead_frames = frames;
+    d->decode_ahead_bytes = bytes;
+    if (d->vthread)
+        d->vthread->setDecodeAhead(frames, bytes);
+}
+
+int AVPlayer::videoDecodeAheadFrames() const
+{
+    return d->decode_ahead_frames;
+}
+
+qint64 AVPlayer::videoDecodeAheadBytes() const
+{
+    return d->decode_ahead_bytes;
+}
+
 const Statistics& AVPlayer::statistics() const
 {
     return d->statistics;
@@ -28,6 +28,7 @@
 #include "QtAV/MediaIO.h"
 #include "QtAV/VideoCapture.h"
 #include "QtAV/private/AVCompat.h"
+#include "Statistics_p.h"
 #if AV_MODULE_CHECK(LIBAVFORMAT, 55, 18, 0, 39, 100)
 extern "C" {
 #include <libavutil/display.h>
@@ -98,6 +99,7 @@ AVPlayer::Private::Private()
     , vthread(0)
     , vcapture(0)
     , speed(1.0)
+    , pitch_compensation(true)
     , vos(0)
     , aos(0)
     , brightness(0)
@@ -107,6 +109,8 @@ AVPlayer::Private::Private()
     , seek_type(AccurateSeek)
     , interrupt_timeout(30000)
     , force_fps(0)
+    , decode_ahead_frames(3)
+    , decode_ahead_bytes(0)
     , notify_interval(-500)
     , status(NoMedia)
     , state(AVPlayer::StoppedState)
@@ -114,6 +118,7 @@ AVPlayer::Private::Private()
     , custom_duration(0)
 {
     demuxer.setInterruptTimeout(interrupt_timeout);
+    ao->setStatistics(&statistics);
     /*
      * reset_state = true;
      * must be the same value at the end of stop(), and must be different from value in
@@ -417,7 +422,9 @@ bool AVPlayer::Private::setupAudioThread(AVPlayer *player)
         athread = new AudioThread(player);
         athread->setClock(clock);
         athread->setStatistics(&statistics);
+        athread->packetQueue()->setCounters(statistics.counters(), Statistics::Counters::Audio);
         athread->setOutputSet(aos);
+        athread->setPitchCompensation(pitch_compensation);
         qDebug("demux thread setAudioThread");
         read_thread->setAudioThread(athread);
         //reconnect if disconnected
@@ -597,6 +604,7 @@ bool AVPlayer::Private::setupVideoThread(AVPlayer *player)
         vthread = new VideoThread(player);
         vthread->setClock(clock);
         vthread->setStatistics(&statistics);
+        vthread->packetQueue()->setCounters(statistics.counters(), Statistics::Counters::Video);
         vthread->setVideoCapture(vcapture);
         vthread->setOutputSet(vos);
         read_thread->setVideoThread(vthread);
@@ -610,6 +618,7 @@ bool AVPlayer::Private::setupVideoThread(AVPlayer *player)
         QObject::connect(vthread, SIGNAL(finished()), player, SLOT(tryClearVideoRenderers()), Qt::DirectConnection);
     }
     vthread->setDecoder(vdec);
+    vthread->setDecodeAhead(decode_ahead_frames, decode_ahead_bytes);
 
     vthread->setBrightness(brightness);
     vthread->setContrast(contrast);
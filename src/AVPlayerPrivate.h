@@ -137,6 +137,7 @@ public:
     VideoCapture *vcapture;
     Statistics statistics;
     qreal speed;
+    bool pitch_compensation;
     OutputSet *vos, *aos;
     QVector<VideoDecoderId> vc_ids;
     int brightness, contrast, saturation;
@@ -148,6 +149,8 @@ public:
     qint64 interrupt_timeout;
 
     qreal force_fps;
+    int decode_ahead_frames;
+    qint64 decode_ahead_bytes;
     // timerEvent interval in ms. can divide 1000. depends on media duration, fps etc.
     // <0: auto compute internally, |notify_interval| is the real interval
     int notify_interval;
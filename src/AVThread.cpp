@@ -27,6 +27,7 @@
 #include "QtAV/AVOutput.h"
 #include "QtAV/Filter.h"
 #include "output/OutputSet.h"
+#include "utils/Trace.h"
 #include "utils/Logger.h"
 
 namespace QtAV {
@@ -166,13 +167,13 @@ qreal AVThread::previousHistoryPts() const
         return 0;
     }
     if (d.pts_history.size() == 1)
-        return -d.pts_history.back();
-    const qreal current_pts = d.pts_history.back();
+        return -qreal(d.pts_history.back())/1000000.0;
+    const qint64 current_pts = d.pts_history.back();
     for (int i = d.pts_history.size() - 2; i > 0; --i) {
         if (d.pts_history.at(i) < current_pts)
-            return d.pts_history.at(i);
+            return qreal(d.pts_history.at(i))/1000000.0;
     }
-    return -d.pts_history.front();
+    return -qreal(d.pts_history.front())/1000000.0;
 }
 
 qreal AVThread::decodeFrameRate() const
@@ -180,7 +181,7 @@ qreal AVThread::decodeFrameRate() const
     DPTR_D(const AVThread);
     if (d.pts_history.size() <= 1)
         return 0;
-    const qreal dt = d.pts_history.back() - d.pts_history.front();
+    const qreal dt = qreal(d.pts_history.back() - d.pts_history.front())/1000000.0;
     if (dt <= 0)
         return 0;
     return d.pts_history.size()/dt;
@@ -312,7 +313,7 @@ void AVThread::resetState()
 {
     DPTR_D(AVThread);
     pause(false);
-    d.pts_history = ring<qreal>(d.pts_history.capacity());
+    d.pts_history = ring<qint64>(d.pts_history.capacity());
     d.tasks.clear();
     d.render_pts0 = -1;
     d.stop = false;
@@ -366,6 +367,7 @@ void AVThread::waitAndCheck(ulong value, qreal pts)
     DPTR_D(AVThread);
     if (value <= 0)
         return;
+    QTAV_TRACE("sync", "wait");
     value += d.wait_err;
     d.wait_timer.restart();
     //qDebug("wating for %lu msecs", value);
@@ -96,7 +96,7 @@ public:
 
     static QVariantHash dec_opt_framedrop, dec_opt_normal;
     bool drop_frame_seek;
-    ring<qreal> pts_history;
+    ring<qint64> pts_history; // us
 
     qint64 wait_err;
     QElapsedTimer wait_timer;
@@ -21,28 +21,474 @@
 
 #include "QtAV/AVTranscoder.h"
 #include "QtAV/AVPlayer.h"
+#include "QtAV/AVDemuxer.h"
 #include "QtAV/AVMuxer.h"
+#include "QtAV/AudioDecoder.h"
+#include "QtAV/VideoDecoder.h"
 #include "QtAV/EncodeFilter.h"
+#include "QtAV/FilterContext.h"
 #include "QtAV/Statistics.h"
+#include "QtAV/private/AVCompat.h"
+#include <limits>
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QMutex>
+#include <QtCore/QQueue>
+#include <QtCore/QThread>
+#include <QtCore/QWaitCondition>
 #include "utils/BlockingQueue.h"
+#include "utils/Trace.h"
 #include "utils/Logger.h"
 
 namespace QtAV {
 
+/*!
+ * \brief The TranscodeEngine class
+ * Drives demuxer => decoders => filters => encode filters for a media file without clock.
+ * Demuxing, decoding and encoding of each stream run in their own threads connected by bounded queues,
+ * so a stage is blocked only if the next stage is slower.
+ * In stream copy mode, demuxed packets are rebased and written to transcoder's muxer in demux thread.
+ */
+class TranscodeEngine
+{
+public:
+    enum { kPacketQueueSize = 64, kVideoFrameQueueSize = 4, kAudioFrameQueueSize = 16 };
+
+    TranscodeEngine(AVTranscoder *t)
+        : transcoder(t)
+        , start_us(0)
+        , stop_us(0)
+        , copy_video(false)
+        , copy_audio(false)
+        , vdec(0)
+        , adec(0)
+        , venc(0)
+        , aenc(0)
+        , filter_context(0)
+        , stopping(false)
+        , aborted(false)
+        , paused(false)
+    {
+        vpackets.setCapacity(kPacketQueueSize);
+        apackets.setCapacity(kPacketQueueSize);
+        vframes.setCapacity(kVideoFrameQueueSize);
+        aframes.setCapacity(kAudioFrameQueueSize);
+    }
+    ~TranscodeEngine() {
+        abort();
+        if (vdec) {
+            vdec->close();
+            delete vdec;
+        }
+        if (adec) {
+            adec->close();
+            delete adec;
+        }
+        if (filter_context) {
+            delete filter_context;
+            filter_context = 0;
+        }
+        demuxer.unload();
+    }
+    bool load(const QString& file) {
+        demuxer.setMedia(file);
+        if (!demuxer.load()) {
+            qWarning("TranscodeEngine failed to load media: %s", file.toUtf8().constData());
+            return false;
+        }
+        statistics.reset();
+        statistics.url = file;
+        statistics.video.frame_rate = demuxer.frameRate();
+        return true;
+    }
+    /*!
+     * \brief openDecoders
+     * Open decoders of the streams to be encoded
+     */
+    bool openDecoders(bool video, bool audio, const QStringList& vcodecs) {
+        if (video && demuxer.videoStream() >= 0) {
+            foreach (const QString& name, vcodecs) {
+                VideoDecoder *dec = VideoDecoder::create(name.toLatin1().constData());
+                if (!dec)
+                    continue;
+                dec->setCodecContext(demuxer.videoCodecContext());
+                if (dec->open()) {
+                    vdec = dec;
+                    break;
+                }
+                delete dec;
+            }
+            if (!vdec)
+                qWarning("TranscodeEngine: no video decoder is available");
+        }
+        if (audio && demuxer.audioStream() >= 0) {
+            adec = AudioDecoder::create();
+            if (adec) {
+                adec->setCodecContext(demuxer.audioCodecContext());
+                if (!adec->open()) {
+                    qWarning("TranscodeEngine: failed to open audio decoder");
+                    delete adec;
+                    adec = 0;
+                }
+            }
+        }
+        return vdec || adec;
+    }
+    AVDemuxer* sourceDemuxer() { return &demuxer;}
+    bool hasVideo() const { return !!vdec;}
+    bool hasAudio() const { return !!adec;}
+    qreal frameRate() const { return demuxer.frameRate();}
+    qint64 startPosition() const { return demuxer.startTime();}
+    qint64 duration() const { return demuxer.duration();}
+    /*!
+     * \brief start
+     * Start threads. Frames are sent to encode filters synchronously in encode threads,
+     * and the filters finish() when all frames are encoded.
+     */
+    void start(qint64 start_ms, qint64 stop_ms, VideoEncodeFilter* vf, AudioEncodeFilter* af, const QList<Filter*>& userFilters) {
+        venc = vdec ? vf : 0;
+        aenc = adec ? af : 0;
+        filters = userFilters;
+        seekToStart(start_ms, stop_ms);
+        if (venc) {
+            threads.append(new Stage(this, &TranscodeEngine::decodeVideo));
+            threads.append(new Stage(this, &TranscodeEngine::encodeVideo));
+        }
+        if (aenc) {
+            threads.append(new Stage(this, &TranscodeEngine::decodeAudio));
+            threads.append(new Stage(this, &TranscodeEngine::encodeAudio));
+        }
+        threads.append(new Stage(this, &TranscodeEngine::demux));
+        foreach (QThread *t, threads) {
+            t->start();
+        }
+    }
+    /*!
+     * \brief startCopy
+     * Stream copy the current video and audio streams. Output starts at the video key frame where the demuxer seeks
+     * to for start_ms, and stops before the first video key frame at or after stop_ms. Timestamps start from 0.
+     */
+    void startCopy(qint64 start_ms, qint64 stop_ms, bool video, bool audio) {
+        copy_video = video;
+        copy_audio = audio;
+        seekToStart(start_ms, stop_ms);
+        threads.append(new Stage(this, &TranscodeEngine::remux));
+        threads.first()->start();
+    }
+    /// stop reading packets. queued packets and frames are still encoded
+    void stop() {
+        stopping = true;
+        pause(false);
+    }
+    /// stop all stages as soon as possible and wait for the threads
+    void abort() {
+        aborted = true;
+        stop();
+        vpackets.setBlocking(false);
+        apackets.setBlocking(false);
+        vframes.setBlocking(false);
+        aframes.setBlocking(false);
+        wait();
+    }
+    void wait() {
+        foreach (QThread *t, threads) {
+            t->wait();
+            delete t;
+        }
+        threads.clear();
+    }
+    void pause(bool value) {
+        QMutexLocker lock(&pause_mutex);
+        Q_UNUSED(lock);
+        paused = value;
+        if (!paused)
+            pause_cond.wakeAll();
+    }
+    bool isPaused() const {
+        QMutexLocker lock(&pause_mutex);
+        Q_UNUSED(lock);
+        return paused;
+    }
+
+private:
+    class Stage : public QThread {
+    public:
+        typedef void (TranscodeEngine::*Job)();
+        Stage(TranscodeEngine *e, Job j) : engine(e), job(j) {}
+    protected:
+        void run() Q_DECL_OVERRIDE { (engine->*job)();}
+    private:
+        TranscodeEngine *engine;
+        Job job;
+    };
+
+    void seekToStart(qint64 start_ms, qint64 stop_ms) {
+        stopping = false;
+        aborted = false;
+        start_us = start_ms*1000LL;
+        stop_us = stop_ms > 0 ? stop_ms*1000LL : std::numeric_limits<qint64>::max();
+        if (start_ms > 0) {
+            demuxer.setSeekType(AccurateSeek); // backward, to the key frame before start_ms
+            demuxer.seek(start_ms);
+        }
+    }
+    void waitForResume() {
+        QMutexLocker lock(&pause_mutex);
+        Q_UNUSED(lock);
+        while (paused && !stopping)
+            pause_cond.wait(&pause_mutex);
+    }
+    void demux() {
+        const int vstream = demuxer.videoStream();
+        const int astream = demuxer.audioStream();
+        // each stream stops at its 1st packet at or after stop_us. streams are interleaved, so others are still read
+        bool video_end = !venc;
+        bool audio_end = !aenc;
+        while (!stopping && !demuxer.atEnd() && !(video_end && audio_end)) {
+            waitForResume();
+            QTAV_TRACE("transcode", "demux");
+            if (!demuxer.readFrame())
+                continue;
+            const int stream = demuxer.stream();
+            if (!video_end && stream == vstream) {
+                video_end = demuxer.packet().ptsUs() >= stop_us;
+                if (!video_end)
+                    vpackets.put(demuxer.packet());
+            } else if (!audio_end && stream == astream) {
+                audio_end = demuxer.packet().ptsUs() >= stop_us;
+                if (!audio_end)
+                    apackets.put(demuxer.packet());
+            }
+        }
+        if (venc)
+            vpackets.put(Packet::createEOF());
+        if (aenc)
+            apackets.put(Packet::createEOF());
+    }
+    // shift timestamps so that output starts from 0. exact timestamps are kept
+    static void rebase(Packet *pkt, qint64 offset_us) {
+        if (pkt->hasExactTimestamps()) {
+            const AVRational tb = { pkt->timeBaseNum(), pkt->timeBaseDen() };
+            const qint64 offset = av_rescale_q(offset_us, AV_TIME_BASE_Q, tb);
+            pkt->setExactTimestamps(pkt->ptsTicks() - offset, pkt->dtsTicks() - offset, pkt->durationTicks(), tb.num, tb.den);
+        } else {
+            pkt->pts -= qreal(offset_us)/1000000.0;
+            pkt->dts -= qreal(offset_us)/1000000.0;
+        }
+    }
+    // write audio packets in [begin, end). packets after end are kept
+    void copyAudio(QList<Packet> *packets, qint64 begin, qint64 end, qint64 offset_us) {
+        while (!packets->isEmpty()) {
+            const qint64 pts = packets->first().ptsUs();
+            if (pts >= end)
+                return;
+            Packet pkt(packets->takeFirst());
+            if (pts < begin)
+                continue;
+            rebase(&pkt, offset_us);
+            transcoder->writeAudio(pkt);
+        }
+    }
+    void remux() {
+        const int vstream = copy_video ? demuxer.videoStream() : -1;
+        const int astream = copy_audio ? demuxer.audioStream() : -1;
+        const qint64 kMax = std::numeric_limits<qint64>::max();
+        qint64 cut_start = -1; // pts of the first output video key frame, or the first audio packet if no video
+        qint64 cut_stop = kMax;
+        qint64 offset = 0;
+        // audio packets read before the video cut points are known
+        QList<Packet> audio_packets;
+        while (!stopping && !demuxer.atEnd()) {
+            waitForResume();
+            QTAV_TRACE("transcode", "remux");
+            if (!demuxer.readFrame())
+                continue;
+            const int stream = demuxer.stream();
+            Packet pkt(demuxer.packet());
+            if (stream == vstream) {
+                if (cut_start < 0) {
+                    if (!pkt.hasKeyFrame)
+                        continue;
+                    cut_start = pkt.ptsUs();
+                    offset = pkt.dtsUs(); // dts of all output packets >= 0
+                } else if (pkt.hasKeyFrame && pkt.ptsUs() >= stop_us) {
+                    cut_stop = pkt.ptsUs();
+                    break;
+                }
+                rebase(&pkt, offset);
+                transcoder->writeVideo(pkt);
+                copyAudio(&audio_packets, cut_start, stop_us, offset);
+            } else if (stream == astream) {
+                if (vstream >= 0) {
+                    audio_packets.append(pkt);
+                    if (cut_start >= 0)
+                        copyAudio(&audio_packets, cut_start, stop_us, offset);
+                    continue;
+                }
+                const qint64 pts = pkt.ptsUs();
+                if (pts < start_us)
+                    continue;
+                if (pts >= stop_us)
+                    break;
+                if (cut_start < 0)
+                    cut_start = offset = pts;
+                rebase(&pkt, offset);
+                transcoder->writeAudio(pkt);
+            }
+        }
+        if (cut_start >= 0)
+            copyAudio(&audio_packets, cut_start, cut_stop, offset);
+        QMetaObject::invokeMethod(transcoder, "tryFinish", Qt::QueuedConnection);
+    }
+    void decodeVideo() {
+        while (!aborted) {
+            const Packet pkt(vpackets.take());
+            if (aborted)
+                break;
+            {
+                QTAV_TRACE("transcode", "video decode");
+                if (!vdec->sendPacket(pkt) && !pkt.isEOF())
+                    continue;
+            }
+            while (vdec->receiveFrame()) {
+                VideoFrame frame(vdec->frame());
+                if (!frame)
+                    continue;
+                applyFilters(&frame);
+                vframes.put(frame);
+            }
+            if (pkt.isEOF())
+                break;
+        }
+        vframes.put(VideoFrame()); // end of stream
+    }
+    void decodeAudio() {
+        while (!aborted) {
+            const Packet pkt(apackets.take());
+            if (aborted)
+                break;
+            {
+                QTAV_TRACE("transcode", "audio decode");
+                if (!adec->sendPacket(pkt) && !pkt.isEOF())
+                    continue;
+            }
+            while (adec->receiveFrame()) {
+                // decoded samples are overwritten by the next frame, and the decoder's resampler can not be used in encode thread
+                AudioFrame frame(adec->frame().clone());
+                if (!frame)
+                    continue;
+                applyFilters(&frame);
+                aframes.put(frame);
+            }
+            if (pkt.isEOF())
+                break;
+        }
+        aframes.put(AudioFrame()); // end of stream
+    }
+    void encodeVideo() {
+        while (!aborted) {
+            VideoFrame frame(vframes.take());
+            if (aborted || !frame.isValid())
+                break;
+            if (!venc->isEnabled())
+                continue;
+            QTAV_TRACE("transcode", "video encode");
+            venc->apply(&statistics, &frame);
+        }
+        if (!aborted)
+            venc->finish(); // encode delayed frames
+    }
+    void encodeAudio() {
+        while (!aborted) {
+            AudioFrame frame(aframes.take());
+            if (aborted || !frame.isValid())
+                break;
+            if (!aenc->isEnabled())
+                continue;
+            QTAV_TRACE("transcode", "audio encode");
+            aenc->apply(&statistics, &frame);
+        }
+        if (!aborted)
+            aenc->finish();
+    }
+    void applyFilters(VideoFrame* frame) {
+        if (filters.isEmpty())
+            return;
+        QTAV_TRACE("transcode", "video filter");
+        foreach (Filter *filter, filters) {
+            VideoFilter *vf = qobject_cast<VideoFilter*>(filter);
+            if (!vf || !vf->isEnabled())
+                continue;
+            if (!filter_context)
+                filter_context = VideoFilterContext::create(VideoFilterContext::QtPainter);
+            if (vf->prepareContext(filter_context, &statistics, frame))
+                vf->apply(&statistics, frame);
+        }
+    }
+    void applyFilters(AudioFrame* frame) {
+        if (filters.isEmpty())
+            return;
+        QTAV_TRACE("transcode", "audio filter");
+        foreach (Filter *filter, filters) {
+            AudioFilter *af = qobject_cast<AudioFilter*>(filter);
+            if (!af || !af->isEnabled())
+                continue;
+            af->apply(&statistics, frame);
+        }
+    }
+
+    AVTranscoder *transcoder;
+    qint64 start_us, stop_us;
+    bool copy_video, copy_audio;
+    AVDemuxer demuxer;
+    VideoDecoder *vdec;
+    AudioDecoder *adec;
+    VideoEncodeFilter *venc;
+    AudioEncodeFilter *aenc;
+    QList<Filter*> filters;
+    VideoFilterContext *filter_context;
+    Statistics statistics;
+    BlockingQueue<Packet> vpackets, apackets;
+    BlockingQueue<VideoFrame> vframes;
+    BlockingQueue<AudioFrame> aframes;
+    QList<QThread*> threads;
+    volatile bool stopping;
+    volatile bool aborted;
+    mutable QMutex pause_mutex;
+    QWaitCondition pause_cond;
+    bool paused;
+};
+
 class AVTranscoder::Private
 {
 public:
     Private()
         : started(false)
         , async(false)
+        , encode_audio(false)
+        , encode_video(false)
         , encoded_frames(0)
+        , encoded_size(0)
         , start_time(0)
+        , stream_copy(false)
+        , stop_time(0)
+        , progress_origin(0)
+        , progress_length(0)
+        , first_pts(-1)
+        , last_pts(0)
+        , progress_permille(0)
         , source_player(0)
+        , engine(0)
         , afilter(0)
         , vfilter(0)
-    {}
+    {
+        vdecoders << QStringLiteral("FFmpeg");
+    }
 
     ~Private() {
+        if (engine) {
+            delete engine;
+            engine = 0;
+        }
         muxer.close();
         if (afilter) {
             delete afilter;
@@ -51,20 +497,78 @@ public:
             delete vfilter;
         }
     }
+    void resetStatistics() {
+        QMutexLocker lock(&mutex);
+        Q_UNUSED(lock);
+        encoded_frames = 0;
+        encoded_size = 0;
+        first_pts = -1;
+        last_pts = 0;
+        progress_permille = 0;
+        timer.start();
+    }
+    // call with mutex locked. return true if progress changed
+    bool packetWritten(const Packet& packet, bool master) {
+        encoded_size += packet.data.size();
+        if (!master)
+            return false;
+        encoded_frames++;
+        if (first_pts < 0)
+            first_pts = packet.pts;
+        if (packet.pts > last_pts)
+            last_pts = packet.pts;
+        if (progress_length <= 0)
+            return false;
+        const qint64 pos = qint64(last_pts*1000.0) - progress_origin;
+        const int permille = qBound<qint64>(0, pos*1000LL/progress_length, 1000);
+        if (permille == progress_permille)
+            return false;
+        progress_permille = permille;
+        return true;
+    }
 
     bool started;
     bool async;
+    bool encode_audio, encode_video;
     int encoded_frames;
+    qint64 encoded_size;
     qint64 start_time;
+    bool stream_copy;
+    qint64 stop_time;
+    // written timestamp range for progress, ms
+    qint64 progress_origin, progress_length;
+    qreal first_pts, last_pts;
+    int progress_permille;
+    QElapsedTimer timer;
     AVPlayer *source_player;
+    QString source_file;
+    QStringList vdecoders;
+    QList<Filter*> user_filters;
+    TranscodeEngine *engine;
     AudioEncodeFilter *afilter;
     VideoEncodeFilter *vfilter;
-    //BlockingQueue<Packet> aqueue, vqueue; // TODO: 1 queue if packet.mediaType is enabled
+    // packets encoded before all encoders are open
+    QList<Packet> pending_audio, pending_video;
+    QMutex mutex; // muxer and encoded statistics. packets are written in encoding threads
     AVMuxer muxer;
     QString format;
     QVector<Filter*> filters;
 };
 
+/*
+ * Player filters emit readyToEncode() in player threads, a blocking connection ensures muxer open()/close() in transcoder's thread.
+ * Engine threads call prepareMuxer() directly, because transcoder's thread waits for engine threads in stopInternal() and
+ * ~AVTranscoder(), a blocking connection dead locks if an encoding thread is emitting readyToEncode() at that time.
+ * The muxer is guarded by the mutex.
+ */
+static void connectPrepareMuxer(AVTranscoder *transcoder, Filter *filter, Qt::ConnectionType type)
+{
+    if (!filter)
+        return;
+    QObject::disconnect(filter, SIGNAL(readyToEncode()), transcoder, SLOT(prepareMuxer()));
+    QObject::connect(filter, SIGNAL(readyToEncode()), transcoder, SLOT(prepareMuxer()), type);
+}
+
 AVTranscoder::AVTranscoder(QObject *parent)
     : QObject(parent)
     , d(new Private())
@@ -75,6 +579,14 @@ AVTranscoder::~AVTranscoder()
 {
     stop();
     //TODO: wait for stopped()
+    if (d->engine) {
+        // no packet is written to the muxer being destroyed
+        if (d->afilter)
+            d->afilter->disconnect(this);
+        if (d->vfilter)
+            d->vfilter->disconnect(this);
+        d->engine->abort();
+    }
 }
 
 void AVTranscoder::setAsync(bool value)
@@ -98,6 +610,7 @@ bool AVTranscoder::isAsync() const
 
 void AVTranscoder::setMediaSource(AVPlayer *player)
 {
+    d->source_file.clear();
     if (d->source_player) {
         if (d->afilter)
             disconnect(d->source_player, SIGNAL(stopped()), d->afilter, SLOT(finish()));
@@ -106,6 +619,8 @@ void AVTranscoder::setMediaSource(AVPlayer *player)
         disconnect(d->source_player, SIGNAL(started()), this, SLOT(onSourceStarted()));
     }
     d->source_player = player;
+    if (!player)
+        return;
     // direct connect to ensure it's called before encoders open in filters
     connect(d->source_player, SIGNAL(started()), this, SLOT(onSourceStarted()), Qt::DirectConnection);
 }
@@ -115,6 +630,40 @@ AVPlayer* AVTranscoder::sourcePlayer() const
     return d->source_player;
 }
 
+void AVTranscoder::setMediaSource(const QString &fileName)
+{
+    setMediaSource((AVPlayer*)0);
+    d->source_file = fileName;
+}
+
+QString AVTranscoder::sourceFile() const
+{
+    return d->source_file;
+}
+
+void AVTranscoder::setVideoDecoders(const QStringList &names)
+{
+    d->vdecoders = names;
+}
+
+QStringList AVTranscoder::videoDecoders() const
+{
+    return d->vdecoders;
+}
+
+bool AVTranscoder::installFilter(Filter *filter)
+{
+    if (!filter || d->user_filters.contains(filter))
+        return false;
+    d->user_filters.append(filter);
+    return true;
+}
+
+bool AVTranscoder::uninstallFilter(Filter *filter)
+{
+    return d->user_filters.removeOne(filter);
+}
+
 QString AVTranscoder::outputFile() const
 {
     return d->muxer.fileName();
@@ -215,6 +764,8 @@ bool AVTranscoder::isRunning() const
 
 bool AVTranscoder::isPaused() const
 {
+    if (d->engine)
+        return d->engine->isPaused();
     if (d->vfilter) {
         if (d->vfilter->isEnabled())
             return false;
@@ -228,6 +779,74 @@ bool AVTranscoder::isPaused() const
     return false; //stopped
 }
 
+qint64 AVTranscoder::encodedSize() const
+{
+    QMutexLocker lock(&d->mutex);
+    Q_UNUSED(lock);
+    return d->encoded_size;
+}
+
+qreal AVTranscoder::startTimestamp() const
+{
+    QMutexLocker lock(&d->mutex);
+    Q_UNUSED(lock);
+    return qMax<qreal>(0, d->first_pts);
+}
+
+qreal AVTranscoder::encodedDuration() const
+{
+    QMutexLocker lock(&d->mutex);
+    Q_UNUSED(lock);
+    if (d->first_pts < 0)
+        return 0;
+    return d->last_pts - d->first_pts;
+}
+
+qreal AVTranscoder::progress() const
+{
+    QMutexLocker lock(&d->mutex);
+    Q_UNUSED(lock);
+    return qreal(d->progress_permille)/1000.0;
+}
+
+qreal AVTranscoder::speed() const
+{
+    const qint64 elapsed = d->timer.isValid() ? d->timer.elapsed() : 0;
+    if (elapsed <= 0)
+        return 0;
+    return encodedDuration()*1000.0/qreal(elapsed);
+}
+
+qreal AVTranscoder::encodeFrameRate() const
+{
+    const qint64 elapsed = d->timer.isValid() ? d->timer.elapsed() : 0;
+    if (elapsed <= 0)
+        return 0;
+    QMutexLocker lock(&d->mutex);
+    Q_UNUSED(lock);
+    return qreal(d->encoded_frames)*1000.0/qreal(elapsed);
+}
+
+void AVTranscoder::setStreamCopy(bool value)
+{
+    d->stream_copy = value;
+}
+
+bool AVTranscoder::isStreamCopy() const
+{
+    return d->stream_copy;
+}
+
+qint64 AVTranscoder::stopTime() const
+{
+    return d->stop_time;
+}
+
+void AVTranscoder::setStopTime(qint64 ms)
+{
+    d->stop_time = ms;
+}
+
 qint64 AVTranscoder::startTime() const
 {
     return d->start_time;
@@ -247,13 +866,23 @@ void AVTranscoder::setStartTime(qint64 ms)
 
 void AVTranscoder::start()
 {
+    if (!sourceFile().isEmpty()) {
+        startFile();
+        return;
+    }
     if (!videoEncoder())
         return;
     if (!sourcePlayer())
         return;
-    d->encoded_frames = 0;
+    d->resetStatistics();
+    d->progress_origin = startTime();
+    d->progress_length = sourcePlayer()->duration() - startTime();
+    d->encode_audio = !!d->afilter;
+    d->encode_video = !!d->vfilter;
     d->started = true;
     d->filters.clear();
+    connectPrepareMuxer(this, d->afilter, Qt::BlockingQueuedConnection);
+    connectPrepareMuxer(this, d->vfilter, Qt::BlockingQueuedConnection);
     if (sourcePlayer()) {
         if (d->afilter) {
             d->filters.append(d->afilter);
@@ -277,10 +906,85 @@ void AVTranscoder::start()
     Q_EMIT started();
 }
 
+void AVTranscoder::startFile()
+{
+    if (isRunning())
+        return;
+    if (!isStreamCopy() && !videoEncoder() && !audioEncoder())
+        return;
+    if (d->engine)
+        delete d->engine;
+    d->engine = new TranscodeEngine(this);
+    if (!d->engine->load(sourceFile())
+            || (!isStreamCopy() && !d->engine->openDecoders(!!d->vfilter, !!d->afilter, d->vdecoders))) {
+        delete d->engine;
+        d->engine = 0;
+        return;
+    }
+    d->resetStatistics();
+    const qint64 source_start = d->engine->startPosition();
+    qint64 source_end = source_start + d->engine->duration();
+    if (stopTime() > 0)
+        source_end = qMin(source_end, stopTime());
+    d->progress_length = source_end - qMax(source_start, startTime());
+    if (isStreamCopy()) {
+        AVDemuxer *demuxer = d->engine->sourceDemuxer();
+        d->encode_audio = demuxer->audioStream() >= 0;
+        d->encode_video = demuxer->videoStream() >= 0;
+        d->progress_origin = 0; // timestamps are rebased
+        // output streams are copied from demuxer, encoders are not used
+        d->muxer.copyProperties((AudioEncoder*)0);
+        d->muxer.copyProperties((VideoEncoder*)0);
+        d->muxer.copyProperties(demuxer);
+        if (!d->format.isEmpty())
+            d->muxer.setFormat(d->format);
+        const bool ok = d->muxer.open(); // no packet is written before engine starts
+        d->muxer.copyProperties((AVDemuxer*)0);
+        if (!ok) {
+            qWarning("Failed to open muxer for stream copy");
+            delete d->engine;
+            d->engine = 0;
+            return;
+        }
+        d->started = true;
+        d->filters.clear();
+        d->engine->startCopy(startTime(), stopTime(), d->encode_video, d->encode_audio);
+        Q_EMIT started();
+        return;
+    }
+    d->progress_origin = qMax(source_start, startTime());
+    d->encode_audio = d->engine->hasAudio();
+    d->encode_video = d->engine->hasVideo();
+    d->started = true;
+    d->filters.clear();
+    // encoding threads are managed by engine
+    connectPrepareMuxer(this, d->afilter, Qt::DirectConnection);
+    connectPrepareMuxer(this, d->vfilter, Qt::DirectConnection);
+    if (d->encode_audio) {
+        d->filters.append(d->afilter);
+        d->afilter->setAsync(false);
+        d->afilter->setStartTime(startTime());
+    }
+    if (d->encode_video) {
+        d->filters.append(d->vfilter);
+        d->vfilter->setAsync(false);
+        d->vfilter->setStartTime(startTime());
+        if (videoEncoder()->frameRate() <= 0)
+            videoEncoder()->setFrameRate(d->engine->frameRate());
+    }
+    d->engine->start(startTime(), stopTime(), d->encode_video ? d->vfilter : 0, d->encode_audio ? d->afilter : 0, d->user_filters);
+    Q_EMIT started();
+}
+
 void AVTranscoder::stop()
 {
     if (!isRunning())
         return;
+    if (d->engine) {
+        // remaining packets are encoded, then encode filters finish
+        d->engine->stop();
+        return;
+    }
     if (!d->muxer.isOpen())
         return;
     // uninstall encoder filters first then encoders can be closed safely
@@ -298,6 +1002,14 @@ void AVTranscoder::stop()
 
 void AVTranscoder::stopInternal()
 {
+    if (d->engine) {
+        delete d->engine; // all threads are finished
+        d->engine = 0;
+    }
+    QMutexLocker lock(&d->mutex);
+    Q_UNUSED(lock);
+    d->pending_audio.clear();
+    d->pending_video.clear();
     d->muxer.close();
     d->started = false;
     Q_EMIT stopped();
@@ -306,6 +1018,11 @@ void AVTranscoder::stopInternal()
 
 void AVTranscoder::pause(bool value)
 {
+    if (d->engine) {
+        d->engine->pause(value);
+        Q_EMIT paused(value);
+        return;
+    }
     if (d->vfilter)
         d->vfilter->setEnabled(!value);
     if (d->afilter)
@@ -325,59 +1042,85 @@ void AVTranscoder::onSourceStarted()
 
 void AVTranscoder::prepareMuxer()
 {
-    // TODO: lock here?
+    QMutexLocker lock(&d->mutex);
+    Q_UNUSED(lock);
+    if (d->muxer.isOpen())
+        return;
+    AudioEncoder *aenc = d->encode_audio ? audioEncoder() : 0;
+    VideoEncoder *venc = d->encode_video ? videoEncoder() : 0;
     // open muxer only if all encoders are open
-    if (audioEncoder() && videoEncoder()) {
-        if (!audioEncoder()->isOpen() || !videoEncoder()->isOpen()) {
-            qDebug("encoders are not readly a:%d v:%d", audioEncoder()->isOpen(), videoEncoder()->isOpen());
+    if (aenc && venc) {
+        if (!aenc->isOpen() || !venc->isOpen()) {
+            qDebug("encoders are not readly a:%d v:%d", aenc->isOpen(), venc->isOpen());
             return;
         }
     }
-    if (audioEncoder())
-        d->muxer.copyProperties(audioEncoder());
-    if (videoEncoder())
-        d->muxer.copyProperties(videoEncoder());
+    d->muxer.copyProperties(aenc);
+    d->muxer.copyProperties(venc);
+    d->muxer.copyProperties((AVDemuxer*)0);
     if (!d->format.isEmpty())
         d->muxer.setFormat(d->format); // clear when media changed
     if (!d->muxer.open()) {
         qWarning("Failed to open muxer");
         return;
     }
+    foreach (const Packet& pkt, d->pending_audio) {
+        d->muxer.writeAudio(pkt);
+        d->packetWritten(pkt, !d->encode_video);
+    }
+    foreach (const Packet& pkt, d->pending_video) {
+        d->muxer.writeVideo(pkt);
+        d->packetWritten(pkt, true);
+    }
+    d->pending_audio.clear();
+    d->pending_video.clear();
 }
 
 void AVTranscoder::writeAudio(const QtAV::Packet &packet)
 {
-    // TODO: muxer maybe is not open. queue the packet
-    if (!d->muxer.isOpen()) {
-        //d->aqueue.put(packet);
-        return;
+    bool progress_changed = false;
+    {
+        QMutexLocker lock(&d->mutex);
+        Q_UNUSED(lock);
+        if (!d->muxer.isOpen()) { // the other encoder is not open yet
+            d->pending_audio.append(packet);
+            return;
+        }
+        d->muxer.writeAudio(packet);
+        // encoded frames and progress are counted by video if exists
+        progress_changed = d->packetWritten(packet, !d->encode_video);
     }
-    d->muxer.writeAudio(packet);
     Q_EMIT audioFrameEncoded(packet.pts);
-
-    if (d->vfilter)
-        return;
-    // TODO: startpts, duration, encoded size
-    d->encoded_frames++;
+    if (progress_changed)
+        Q_EMIT progressChanged(progress());
     //qDebug("encoded frames: %d, pos: %lld", d->encoded_frames, packet.position);
 }
 
 void AVTranscoder::writeVideo(const QtAV::Packet &packet)
 {
-    // TODO: muxer maybe is not open. queue the packet
-    if (!d->muxer.isOpen())
-        return;
-    d->muxer.writeVideo(packet);
+    bool progress_changed = false;
+    {
+        QMutexLocker lock(&d->mutex);
+        Q_UNUSED(lock);
+        if (!d->muxer.isOpen()) {
+            d->pending_video.append(packet);
+            return;
+        }
+        d->muxer.writeVideo(packet);
+        progress_changed = d->packetWritten(packet, true);
+    }
     Q_EMIT videoFrameEncoded(packet.pts);
-    // TODO: startpts, duration, encoded size
-    d->encoded_frames++;
-    printf("encoded frames: %d, @%.3f pos: %lld\r", d->encoded_frames, packet.pts, packet.position);fflush(0);
+    if (progress_changed)
+        Q_EMIT progressChanged(progress());
+    //qDebug("encoded frames: %d, @%.3f pos: %lld", d->encoded_frames, packet.pts, packet.position);
 }
 
 void AVTranscoder::tryFinish()
 {
     Filter* f = qobject_cast<Filter*>(sender());
-    d->filters.remove(d->filters.indexOf(f));
+    const int idx = d->filters.indexOf(f); // not a filter for stream copy
+    if (idx >= 0)
+        d->filters.remove(idx);
     if (d->filters.isEmpty())
         stopInternal();
 }
@@ -23,6 +23,10 @@
 #include "QtAV/private/Frame_p.h"
 #include "QtAV/AudioResampler.h"
 #include "QtAV/private/AVCompat.h"
+#include "output/audio/AudioScale.h"
+#include <QtCore/QAtomicInt>
+#include <QtCore/QMutex>
+#include <QtCore/QVariantHash>
 #include "utils/Logger.h"
 
 namespace QtAV {
@@ -33,6 +37,81 @@ static const struct RegisterMetaTypes
         qRegisterMetaType<QtAV::AudioFrame>("QtAV::AudioFrame");
     }
 } _registerMetaTypes;
+
+/*!
+ * Free resamplers keyed by input and output format. A resampler is owned by one caller between acquire() and release().
+ * Only resamplers with the same input and output sample rate are cached. They have no delayed samples, so no reset is required.
+ * A resampler changing the sample rate keeps samples of its stream, it must be scoped to the stream (AudioFrame::setAudioResampler())
+ */
+class AudioResamplerCache
+{
+public:
+    typedef struct {
+        qint64 hits;
+        qint64 misses;
+        int free;
+    } Statistics;
+
+    AudioResamplerCache() { memset(&m_stat, 0, sizeof(m_stat));}
+    ~AudioResamplerCache() {
+        foreach (const Entry& e, m_free) {
+            delete e.conv;
+        }
+    }
+    AudioResampler* acquire(const AudioFormat& in, const AudioFormat& out) {
+        {
+            QMutexLocker lock(&m_mutex);
+            Q_UNUSED(lock);
+            for (int i = 0; i < m_free.size(); ++i) {
+                const Entry& e = m_free.at(i);
+                if (e.in == in && e.out == out) {
+                    m_stat.hits++;
+                    return m_free.takeAt(i).conv;
+                }
+            }
+            m_stat.misses++;
+        }
+        AudioResampler *conv = AudioResampler::create(AudioResamplerId_FF);
+        if (!conv)
+            conv = AudioResampler::create(AudioResamplerId_Libav);
+        return conv;
+    }
+    void release(const AudioFormat& in, const AudioFormat& out, AudioResampler* conv) {
+        if (!conv)
+            return;
+        Entry e;
+        e.in = in;
+        e.out = out;
+        e.conv = conv;
+        AudioResampler *evicted = 0;
+        {
+            QMutexLocker lock(&m_mutex);
+            Q_UNUSED(lock);
+            m_free.prepend(e);
+            if (m_free.size() > kMaxFreeResamplers)
+                evicted = m_free.takeLast().conv;
+        }
+        delete evicted;
+    }
+    Statistics statistics() const {
+        QMutexLocker lock(&m_mutex);
+        Q_UNUSED(lock);
+        Statistics st = m_stat;
+        st.free = m_free.size();
+        return st;
+    }
+private:
+    enum { kMaxFreeResamplers = 8 };
+    struct Entry {
+        AudioFormat in, out;
+        AudioResampler *conv;
+    };
+    mutable QMutex m_mutex;
+    QList<Entry> m_free; // most recently released first
+    Statistics m_stat;
+};
+Q_GLOBAL_STATIC(AudioResamplerCache, resamplerCache)
+static QAtomicInt fast_conversions;
 }
 
 class AudioFramePrivate : public FramePrivate
@@ -116,9 +195,16 @@ QByteArray AudioFrame::data()
     if (!isValid())
         return QByteArray();
     Q_D(AudioFrame);
-    if (d->data.isEmpty()) {
-        AudioFrame a(clone());
-        d->data = a.data();
+    if (d->data.isEmpty()) { // decoded or pooled data. planes are copied as mid()
+        const int bpl = bytesPerLine(0);
+        QByteArray buf;
+        buf.resize(bpl*planeCount());
+        char *dst = buf.data(); //must before buf is shared, otherwise data will be detached.
+        for (int i = 0; i < planeCount(); ++i) {
+            memcpy(dst, constBits(i), bpl);
+            dst += bpl;
+        }
+        d->data = buf;
     }
     return d->data;
 }
@@ -165,17 +251,18 @@ AudioFrame AudioFrame::mid(int pos, int len) const
         lenBytes = bufSize;
     }
 
-    QByteArray buf(bufSize * planeCount(), 0);
-    char *dst = buf.data(); //must before buf is shared, otherwise data will be detached.
-
+    if (bufSize <= 0)
+        return AudioFrame(format());
+    AudioFrame f(d->format);
+    uchar *dst = f.d_func()->allocate(bufSize * planeCount());
     for (int i = 0; i < planeCount(); ++i) {
         memcpy(dst, constBits(i) + posBytes, lenBytes);
+        f.setBits(dst, i);
+        f.setBytesPerLine(bufSize, i);
         dst += lenBytes;
     }
-
-    AudioFrame f(d->format, buf);
     f.setSamplesPerChannel(bufSize / d->format.bytesPerSample());
-    f.setTimestamp(d->timestamp + (qreal) d->format.durationForBytes(posBytes) / AudioFormat::kHz);
+    f.setTimestampUs(d->timestamp_us + d->format.durationForBytes(posBytes));
     // meta data?
     return f;
 }
@@ -189,9 +276,11 @@ void AudioFrame::prepend(AudioFrame &other)
         return;
     }
 
+    if (d->data.isEmpty())
+        data();
     d->data.prepend(other.data());
     d->samples_per_ch += other.samplesPerChannel();
-    d->timestamp = other.timestamp();
+    d->timestamp_us = other.timestampUs();
 
     for (int i = 0; i < planeCount(); i++) {
         d->line_sizes[i] += other.bytesPerLine(i);
@@ -248,34 +337,85 @@ AudioFrame AudioFrame::to(const AudioFormat &fmt) const
 {
     if (!isValid() || !constBits(0))
         return AudioFrame();
-    //if (fmt == format())
-      //  return clone(); //FIXME: clone a frame from ffmpeg is not enough?
     Q_D(const AudioFrame);
-    // TODO: use a pool
+    // the resampler of the stream may change the speed (AudioThread without pitch compensation)
+    const bool speed_changed = d->conv && !qFuzzyCompare(d->conv->speed(), (qreal)1.0);
+    if (fmt == format() && !speed_changed)
+        return *this;
+    // only sample format or layout changes: convert directly into a pooled buffer
+    if (!speed_changed
+            && fmt.sampleRate() == d->format.sampleRate()
+            && fmt.channels() == d->format.channels()
+            && fmt.channelLayoutFFmpeg() == d->format.channelLayoutFFmpeg()) {
+        convert_samples_func cvt = get_sample_converter(d->format.sampleFormat(), fmt.sampleFormat());
+        if (cvt) {
+            AudioFrame f(fmt);
+            const int nb_planes = fmt.planeCount();
+            const int bpl = fmt.bytesPerSample()*samplesPerChannel()*(fmt.isPlanar() ? 1 : fmt.channels());
+            uchar *buf = f.d_func()->allocate(bpl*nb_planes);
+            if (buf) {
+                for (int i = 0; i < nb_planes; ++i) {
+                    f.setBits(buf + i*bpl, i);
+                    f.setBytesPerLine(bpl, i);
+                }
+                f.setSamplesPerChannel(samplesPerChannel());
+                cvt((quint8* const*)f.d_func()->planes.constData(), (const quint8* const*)d->planes.constData(), fmt.channels(), samplesPerChannel());
+                f.setTimestamp(timestamp());
+                f.d_ptr->metadata = d->metadata; // need metadata?
+                fast_conversions.ref();
+                return f;
+            }
+        }
+    }
     AudioResampler *conv = d->conv;
+    AudioResamplerCache *cache = 0;
     QScopedPointer<AudioResampler> c;
     if (!conv) {
-        conv = AudioResampler::create(AudioResamplerId_FF);
-        if (!conv)
-            conv = AudioResampler::create(AudioResamplerId_Libav);
+        // a sample rate converter keeps delayed samples of the stream, a temporary one is used if the stream has no resampler
+        if (fmt.sampleRate() == d->format.sampleRate())
+            cache = resamplerCache();
+        if (cache) {
+            conv = cache->acquire(format(), fmt);
+        } else {
+            conv = AudioResampler::create(AudioResamplerId_FF);
+            if (!conv)
+                conv = AudioResampler::create(AudioResamplerId_Libav);
+            c.reset(conv);
+        }
         if (!conv) {
             qWarning("no audio resampler is available");
             return AudioFrame();
         }
-        c.reset(conv);
     }
     conv->setInAudioFormat(format());
     conv->setOutAudioFormat(fmt);
     //conv->prepare(); // already called in setIn/OutFormat
     conv->setInSampesPerChannel(samplesPerChannel()); //TODO
-    if (!conv->convert((const quint8**)d->planes.constData())) {
+    AudioFrame f;
+    if (conv->convert((const quint8**)d->planes.constData())) {
+        f = AudioFrame(fmt, conv->outData());
+        f.setSamplesPerChannel(conv->outSamplesPerChannel());
+        f.setTimestamp(timestamp());
+        f.d_ptr->metadata = d->metadata; // need metadata?
+    } else {
         qWarning() << "AudioFrame::to error: " << format() << "=>" << fmt;
-        return AudioFrame();
     }
-    AudioFrame f(fmt, conv->outData());
-    f.setSamplesPerChannel(conv->outSamplesPerChannel());
-    f.setTimestamp(timestamp());
-    f.d_ptr->metadata = d->metadata; // need metadata?
+    if (cache)
+        cache->release(format(), fmt, conv);
     return f;
 }
+
+QVariantHash AudioFrame::cacheStatistics()
+{
+    QVariantHash h;
+    AudioResamplerCache *cache = resamplerCache();
+    if (cache) {
+        const AudioResamplerCache::Statistics st = cache->statistics();
+        h[QStringLiteral("resamplerHits")] = st.hits;
+        h[QStringLiteral("resamplerMisses")] = st.misses;
+        h[QStringLiteral("freeResamplers")] = st.free;
+    }
+    h[QStringLiteral("fastConversions")] = fast_conversions.fetchAndAddRelaxed(0);
+    return h;
+}
 } //namespace QtAV
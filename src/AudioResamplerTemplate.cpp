@@ -162,7 +162,7 @@ bool AudioResamplerFF::prepare()
     //DO NOT set sample rate here, we should keep the original and multiply 1/speed when needed
     //if (d.speed != 1.0)
     //    d.out_format.setSampleRate(int(qreal(d.out_format.sampleFormat())/d.speed));
-    qDebug("swr speed=%.2f", d.speed);
+    //qDebug("swr speed=%.2f", d.speed);
 
     //d.in_planes = av_sample_fmt_is_planar((enum AVSampleFormat)d.in_sample_format) ? d.in_channels : 1;
     //d.out_planes = av_sample_fmt_is_planar((enum AVSampleFormat)d.out_sample_format) ? d.out_channels : 1;
@@ -185,14 +185,14 @@ bool AudioResamplerFF::prepare()
     av_opt_set_int(d.context, "out_sample_rate",       d.out_format.sampleRate(), 0);
     av_opt_set_sample_fmt(d.context, "out_sample_fmt", (enum AVSampleFormat)out_format.sampleFormatFFmpeg(), 0);
     */
-    qDebug("out: {cl: %lld, fmt: %s, freq: %d}"
-           , d.out_format.channelLayoutFFmpeg()
-           , qPrintable(d.out_format.sampleFormatName())
-           , d.out_format.sampleRate());
-    qDebug("in {cl: %lld, fmt: %s, freq: %d}"
-           , d.in_format.channelLayoutFFmpeg()
-           , qPrintable(d.in_format.sampleFormatName())
-           , d.in_format.sampleRate());
+    //qDebug("out: {cl: %lld, fmt: %s, freq: %d}"
+    //       , d.out_format.channelLayoutFFmpeg()
+    //       , qPrintable(d.out_format.sampleFormatName())
+    //       , d.out_format.sampleRate());
+    //qDebug("in {cl: %lld, fmt: %s, freq: %d}"
+    //       , d.in_format.channelLayoutFFmpeg()
+    //       , qPrintable(d.in_format.sampleFormatName())
+    //       , d.in_format.sampleRate());
 
     if (!d.context) {
         qWarning("Allocat swr context failed!");
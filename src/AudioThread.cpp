@@ -28,10 +28,12 @@
 #include "QtAV/AudioResampler.h"
 #include "QtAV/AVClock.h"
 #include "QtAV/Filter.h"
+#include "AudioTimeStretch.h"
 #include "output/OutputSet.h"
 #include "QtAV/private/AVCompat.h"
 #include <QtCore/QCoreApplication>
 #include <QtCore/QDateTime>
+#include "utils/Trace.h"
 #include "utils/Logger.h"
 
 namespace QtAV {
@@ -39,6 +41,10 @@ namespace QtAV {
 class AudioThreadPrivate : public AVThreadPrivate
 {
 public:
+    AudioThreadPrivate()
+        : AVThreadPrivate()
+        , pitch_compensation(true)
+    {}
     void init() {
         resample = false;
         last_pts = 0;
@@ -46,6 +52,8 @@ public:
 
     bool resample;
     qreal last_pts; //used when audio output is not available, to calculate the aproximate sleeping time
+    bool pitch_compensation;
+    AudioTimeStretch stretch;
 };
 
 AudioThread::AudioThread(QObject *parent)
@@ -53,9 +61,20 @@ AudioThread::AudioThread(QObject *parent)
 {
 }
 
+void AudioThread::setPitchCompensation(bool value)
+{
+    d_func().pitch_compensation = value;
+}
+
+bool AudioThread::pitchCompensation() const
+{
+    return d_func().pitch_compensation;
+}
+
 void AudioThread::applyFilters(AudioFrame &frame)
 {
     DPTR_D(AudioThread);
+    QTAV_TRACE("audio", "filter");
     //QMutexLocker locker(&d.mutex);
     //Q_UNUSED(locker);
     if (!d.filters.isEmpty()) {
@@ -100,6 +119,7 @@ void AudioThread::run()
             d.seek_requested = false;
             qDebug("request seek audio thread");
             pkt = Packet(); // last decode failed and pkt is valid, reset pkt to force take the next packet if seek is requested
+            d.stretch.reset();
             msleep(1);
         } else {
             // d.render_pts0 < 0 means seek finished here
@@ -131,6 +151,7 @@ void AudioThread::run()
                     Q_UNUSED(locker);
                     if (d.dec) //maybe set to null in setDecoder()
                         d.dec->flush();
+                    d.stretch.reset();
                     d.render_pts0 = pkt.pts;
                     sync_id = pkt.position;
                     qDebug("audio seek: %.3f, id: %d", d.render_pts0, sync_id);
@@ -232,18 +253,21 @@ void AudioThread::run()
 
         //DO NOT decode and convert if ao is not available or mute!
         bool has_ao = ao && ao->isAvailable();
+        // keep the pitch: resample without changing speed, then time stretch
+        const bool stretch = has_ao && d.pitch_compensation && !qFuzzyCompare(ao->speed(), (qreal)1.0);
+        const qreal resample_speed = stretch ? 1.0 : (has_ao ? ao->speed() : 1.0);
         //if (!has_ao) {//do not decode?
         // TODO: move resampler to AudioFrame, like VideoFrame does
         if (has_ao && dec->resampler()) {
-            if (dec->resampler()->speed() != ao->speed()
+            if (dec->resampler()->speed() != resample_speed
                     || dec->resampler()->outAudioFormat() != ao->audioFormat()) {
                 //resample later to ensure thread safe. TODO: test
                 if (d.resample) {
                     qDebug() << "ao.format " << ao->audioFormat();
                     qDebug() << "swr.format " << dec->resampler()->outAudioFormat();
-                    qDebug("decoder set speed: %.2f", ao->speed());
+                    qDebug("decoder set speed: %.2f", resample_speed);
                     dec->resampler()->setOutAudioFormat(ao->audioFormat());
-                    dec->resampler()->setSpeed(ao->speed());
+                    dec->resampler()->setSpeed(resample_speed);
                     dec->resampler()->prepare();
                     d.resample = false;
                 } else {
@@ -267,7 +291,10 @@ void AudioThread::run()
             break;
         }
         //qDebug("apkt: %.3f, %lld %p", pkt.pts, pkt.asAVPacket()->pts, pkt.asAVPacket()->data);
-        if (!dec->decode(pkt)) {
+        QTAV_TRACE_VAR(trace_decode, "audio", "decode");
+        const bool dec_ok = dec->decode(pkt);
+        trace_decode.end();
+        if (!dec_ok) {
             qWarning("Decode audio failed. undecoded: %d", dec->undecodedSize());
             if (pkt.isEOF()) {
                 qDebug("audio decode eof done");
@@ -276,7 +303,7 @@ void AudioThread::run()
                     qDebug("audio seek done at eof pts: %.3f. id: %d", pkt.pts, sync_id);
                     d.render_pts0 = -1;
                     d.clock->syncEndOnce(sync_id);
-                    Q_EMIT seekFinished(qint64(pkt.pts*1000.0)); //TODO: pts
+                    Q_EMIT seekFinished(pkt.ptsUs()/1000LL); //TODO: pts
                 }
                 if (!pkt.position)
                     break;
@@ -295,12 +322,13 @@ void AudioThread::run()
         // reduce here to ensure to decode the rest data in the next loop
         if (!pkt.isEOF())
             pkt.skip(pkt.data.size() - dec->undecodedSize());
+        bool volume_applied = false;
 #if USE_AUDIO_FRAME
         AudioFrame frame(dec->frame());
         if (!frame)
             continue; //pkt data is updated after decode, no reset here
-        if (frame.timestamp() <= 0)
-            frame.setTimestamp(pkt.pts); // pkt.pts is wrong. >= real timestamp
+        if (frame.timestampUs() <= 0)
+            frame.setTimestampUs(pkt.ptsUs()); // pkt.pts is wrong. >= real timestamp
         if (d.render_pts0 >= 0.0) { // seeking
             d.clock->updateValue(frame.timestamp());
             if (frame.timestamp() < d.render_pts0) {
@@ -310,7 +338,7 @@ void AudioThread::run()
             qDebug("audio seek finished @%.3f. id: %d", frame.timestamp(), sync_id);
             d.render_pts0 = -1.0;
             d.clock->syncEndOnce(sync_id);
-            Q_EMIT seekFinished(qint64(frame.timestamp()*1000.0));
+            Q_EMIT seekFinished(frame.timestampUs()/1000LL);
             if (has_ao) {
                 ao->clear();
             }
@@ -318,10 +346,23 @@ void AudioThread::run()
         if (has_ao) {
             applyFilters(frame);
             frame.setAudioResampler(dec->resampler()); //!!!
+            QTAV_TRACE("audio", "convert");
+            if (stretch) {
+                AudioFormat af(ao->audioFormat());
+                af.setSampleFormat(AudioFormat::SampleFormat_Float);
+                frame = frame.to(af);
+                d.stretch.setSpeed(ao->speed());
+                frame = d.stretch.process(frame);
+                if (frame.samplesPerChannel() <= 0)
+                    continue; // more input is required
+            }
+            // convert and apply software volume in 1 pass if resampling is not required
+            if (stretch || qFuzzyCompare(resample_speed, (qreal)1.0))
+                volume_applied = ao->convertFrame(frame, &frame);
             // FIXME: resample ONCE is required for audio frames from ffmpeg
-            //if (ao->audioFormat() != frame.format()) {
+            if (!volume_applied) {
                 frame = frame.to(ao->audioFormat());
-            //}
+            }
         }
         QByteArray decoded(frame.data());
 #else
@@ -331,6 +372,8 @@ void AudioThread::run()
         int decodedPos = 0;
         qreal delay = 0;
         const qreal byte_rate = frame.format().bytesPerSecond();
+        // media time of 1 second output
+        const qreal media_rate = has_ao ? ao->speed() : 1.0;
         qreal pts = frame.timestamp();
         //qDebug("frame samples: %d @%.3f+%lld", frame.samplesPerChannel()*frame.channelCount(), frame.timestamp(), frame.duration()/1000LL);
         while (decodedSize > 0) {
@@ -344,7 +387,9 @@ void AudioThread::run()
             if (has_ao && ao->isOpen()) {
                 QByteArray decodedChunk = QByteArray::fromRawData(decoded.constData() + decodedPos, chunk);
                 //qDebug("ao.timestamp: %.3f, pts: %.3f, pktpts: %.3f", ao->timestamp(), pts, pkt.pts);
-                ao->play(decodedChunk, pts);
+                QTAV_TRACE_VAR(trace_play, "audio", "deliver");
+                ao->play(decodedChunk, pts, !volume_applied);
+                trace_play.end();
                 if (!is_external_clock && ao->timestamp() > 0) {//TODO: clear ao buffer
                    // const qreal da = qAbs(pts - ao->timestamp());
                    // if (da > 1.0) { // what if frame duration is long?
@@ -364,7 +409,7 @@ void AudioThread::run()
             }
             decodedPos += chunk;
             decodedSize -= chunk;
-            pts += chunk_delay;
+            pts += chunk_delay*media_rate;
             pkt.pts += chunk_delay; // packet not fully decoded, use new pts in the next decoding
             pkt.dts += chunk_delay;
         }
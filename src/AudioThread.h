@@ -35,6 +35,13 @@ class AudioThread : public AVThread
     DPTR_DECLARE_PRIVATE(AudioThread)
 public:
     explicit AudioThread(QObject *parent = 0);
+    /*!
+     * \brief setPitchCompensation
+     * If enabled, the tempo is changed by time stretching and the pitch is kept when playback speed is not 1.0.
+     * Otherwise the speed is changed by resampling. Default is true
+     */
+    void setPitchCompensation(bool value);
+    bool pitchCompensation() const;
 
 protected:
     void applyFilters(AudioFrame& frame);
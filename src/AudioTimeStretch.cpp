@@ -0,0 +1,227 @@
+/******************************************************************************
+    QtAV:  Multimedia framework based on Qt and FFmpeg
+    Copyright (C) 2012-2017 Wang Bin <wbsecg1@gmail.com>
+
+*   This file is part of QtAV (from 2017)
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+******************************************************************************/
+
+#include "AudioTimeStretch.h"
+#include <float.h>
+#include <math.h>
+#include <string.h>
+// sse2 is always available on x64. other simd code is in separated files and dispatched at runtime, see AudioScale.cpp
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define TS_SSE2 1
+#elif defined(__ARM_NEON__) || defined(__ARM_NEON)
+#include <arm_neon.h>
+#define TS_NEON 1
+#endif
+#include "utils/Logger.h"
+
+namespace QtAV {
+
+// sequence length, overlap and seek window in ms. the larger seek window, the better quality and the more cpu usage
+static const int kSequenceMs = 40;
+static const int kOverlapMs = 8;
+static const int kSeekMs = 15;
+// reset if the input timestamp jumps
+static const qint64 kMaxGapUs = 100000LL;
+
+static float dot_product(const float* a, const float* b, int n)
+{
+    int i = 0;
+    float sum = 0;
+#if TS_SSE2
+    __m128 s0 = _mm_setzero_ps();
+    __m128 s1 = _mm_setzero_ps();
+    for (; i <= n - 8; i += 8) {
+        s0 = _mm_add_ps(s0, _mm_mul_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+        s1 = _mm_add_ps(s1, _mm_mul_ps(_mm_loadu_ps(a + i + 4), _mm_loadu_ps(b + i + 4)));
+    }
+    s0 = _mm_add_ps(s0, s1);
+    s0 = _mm_add_ps(s0, _mm_movehl_ps(s0, s0));
+    s0 = _mm_add_ss(s0, _mm_shuffle_ps(s0, s0, 1));
+    sum = _mm_cvtss_f32(s0);
+#elif TS_NEON
+    float32x4_t s0 = vdupq_n_f32(0);
+    float32x4_t s1 = vdupq_n_f32(0);
+    for (; i <= n - 8; i += 8) {
+        s0 = vmlaq_f32(s0, vld1q_f32(a + i), vld1q_f32(b + i));
+        s1 = vmlaq_f32(s1, vld1q_f32(a + i + 4), vld1q_f32(b + i + 4));
+    }
+    s0 = vaddq_f32(s0, s1);
+    const float32x2_t s = vadd_f32(vget_low_f32(s0), vget_high_f32(s0));
+    sum = vget_lane_f32(vpadd_f32(s, s), 0);
+#endif
+    for (; i < n; ++i)
+        sum += a[i]*b[i];
+    return sum;
+}
+
+// dst = a + (b - a)*w, w from 0 to 1 in frames
+static void cross_fade(float* dst, const float* a, const float* b, int frames, int channels)
+{
+    const float dw = 1.0f/float(frames);
+    for (int i = 0; i < frames; ++i) {
+        const float w = float(i)*dw;
+        for (int c = 0; c < channels; ++c) {
+            const int k = i*channels + c;
+            dst[k] = a[k] + (b[k] - a[k])*w;
+        }
+    }
+}
+
+AudioTimeStretch::AudioTimeStretch()
+    : m_speed(1.0)
+    , m_channels(0)
+    , m_rate(0)
+    , m_seq(0)
+    , m_overlap(0)
+    , m_seek(0)
+    , m_first(true)
+    , m_skip_frac(0)
+    , m_discard(0)
+    , m_in_ts(-1)
+    , m_in_pos(0)
+{
+}
+
+void AudioTimeStretch::setSpeed(qreal value)
+{
+    if (value <= 0)
+        return;
+    m_speed = value;
+}
+
+void AudioTimeStretch::setFormat(int channels, int sampleRate)
+{
+    if (channels == m_channels && sampleRate == m_rate)
+        return;
+    m_channels = channels;
+    m_rate = sampleRate;
+    m_seq = sampleRate*kSequenceMs/1000;
+    m_overlap = sampleRate*kOverlapMs/1000;
+    m_seek = sampleRate*kSeekMs/1000;
+    m_mid.resize(m_overlap*channels);
+    reset();
+}
+
+void AudioTimeStretch::reset()
+{
+    m_in.clear();
+    m_first = true;
+    m_skip_frac = 0;
+    m_discard = 0;
+    m_in_ts = -1;
+    m_in_pos = 0;
+}
+
+int AudioTimeStretch::seekBestOffset(const float *in) const
+{
+    const int n = m_overlap*m_channels;
+    const float *ref = m_mid.constData();
+    float norm = dot_product(in, in, n);
+    float best_score = -FLT_MAX;
+    int best = 0;
+    for (int k = 0; k < m_seek; ++k) {
+        const float *cand = in + k*m_channels;
+        // normalized cross correlation
+        const float score = dot_product(ref, cand, n)/sqrtf(qMax(norm, 1e-9f));
+        if (score > best_score) {
+            best_score = score;
+            best = k;
+        }
+        for (int c = 0; c < m_channels; ++c)
+            norm += cand[n + c]*cand[n + c] - cand[c]*cand[c];
+    }
+    return best;
+}
+
+qint64 AudioTimeStretch::process(const float *in, int frames, qint64 timestampUs, QVector<float> *out)
+{
+    out->clear();
+    const int C = m_channels;
+    if (C <= 0 || m_rate <= 0 || frames <= 0)
+        return timestampUs;
+    if (m_in_ts >= 0 && timestampUs >= 0) {
+        const qint64 expected = m_in_ts + (m_in_pos + m_in.size()/C + m_discard)*1000000LL/qint64(m_rate);
+        if (qAbs(timestampUs - expected) > kMaxGapUs) {
+            qDebug("AudioTimeStretch reset. timestamp jumps from %lld to %lld", expected, timestampUs);
+            reset();
+        }
+    }
+    const int skip = qMin(m_discard, frames);
+    m_discard -= skip;
+    frames -= skip;
+    in += skip*C;
+    if (m_in.isEmpty()) {
+        m_in_ts = timestampUs;
+        m_in_pos = skip;
+    }
+    const int old = m_in.size();
+    m_in.resize(old + frames*C);
+    memcpy(m_in.data() + old, in, frames*C*sizeof(float));
+
+    const qint64 out_ts = m_in_ts + m_in_pos*1000000LL/qint64(m_rate);
+    const int buffered = m_in.size()/C;
+    int pos = 0;
+    while (buffered - pos >= m_seq + m_seek) {
+        const float *src = m_in.constData() + pos*C;
+        const float *seq = src + (m_first ? 0 : seekBestOffset(src))*C;
+        const int n0 = out->size();
+        out->resize(n0 + (m_seq - m_overlap)*C);
+        float *o = out->data() + n0;
+        if (m_first)
+            memcpy(o, seq, m_overlap*C*sizeof(float));
+        else
+            cross_fade(o, m_mid.constData(), seq, m_overlap, C);
+        memcpy(o + m_overlap*C, seq + m_overlap*C, (m_seq - 2*m_overlap)*C*sizeof(float));
+        memcpy(m_mid.data(), seq + (m_seq - m_overlap)*C, m_overlap*C*sizeof(float));
+        m_first = false;
+        // (m_seq - m_overlap) samples output, speed*(m_seq - m_overlap) samples consumed
+        const double adv = double(m_seq - m_overlap)*m_speed + m_skip_frac;
+        const int iadv = int(adv);
+        m_skip_frac = adv - double(iadv);
+        pos += iadv;
+    }
+    if (pos > buffered) {
+        m_discard += pos - buffered;
+        pos = buffered;
+    }
+    if (pos > 0) {
+        m_in.remove(0, pos*C);
+        m_in_pos += pos;
+    }
+    return out_ts;
+}
+
+AudioFrame AudioTimeStretch::process(const AudioFrame &frame)
+{
+    const AudioFormat fmt(frame.format());
+    if (fmt.sampleFormat() != AudioFormat::SampleFormat_Float) {
+        qWarning("AudioTimeStretch: unsupported sample format");
+        return frame;
+    }
+    setFormat(fmt.channels(), fmt.sampleRate());
+    const qint64 ts = process((const float*)frame.constBits(0), frame.samplesPerChannel(), frame.timestampUs(), &m_out);
+    AudioFrame f(fmt, QByteArray((const char*)m_out.constData(), m_out.size()*sizeof(float)));
+    f.setSamplesPerChannel(m_out.size()/qMax(1, m_channels));
+    f.setTimestampUs(ts);
+    return f;
+}
+} //namespace QtAV
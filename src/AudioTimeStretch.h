@@ -0,0 +1,85 @@
+/******************************************************************************
+    QtAV:  Multimedia framework based on Qt and FFmpeg
+    Copyright (C) 2012-2017 Wang Bin <wbsecg1@gmail.com>
+
+*   This file is part of QtAV (from 2017)
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+******************************************************************************/
+
+#ifndef QTAV_AUDIOTIMESTRETCH_H
+#define QTAV_AUDIOTIMESTRETCH_H
+
+#include <QtCore/QVector>
+#include <QtAV/AudioFrame.h>
+
+namespace QtAV {
+/*!
+ * \brief The AudioTimeStretch class
+ * Change the audio tempo without changing the pitch. WSOLA (waveform similarity overlap-add):
+ * input is cut into sequences, the start of each sequence is searched in a small window to find the position most
+ * similar to the tail of the previous sequence, then the sequences are cross faded.
+ * Only packed float samples are supported.
+ */
+class Q_AV_PRIVATE_EXPORT AudioTimeStretch
+{
+public:
+    AudioTimeStretch();
+    /*!
+     * \brief setSpeed
+     * >1: faster, <1: slower. Buffered data is kept.
+     */
+    void setSpeed(qreal value);
+    qreal speed() const { return m_speed;}
+    /// reset if format changed
+    void setFormat(int channels, int sampleRate);
+    int channels() const { return m_channels;}
+    int sampleRate() const { return m_rate;}
+    /// drop buffered samples, e.g. when seeking
+    void reset();
+    /*!
+     * \brief process
+     * Append interleaved float samples and output all samples that can be stretched.
+     * A timestamp discontinuity resets the internal state.
+     * \param frames samples per channel
+     * \param timestampUs timestamp of the 1st input sample
+     * \param out output samples, cleared before appending
+     * \return timestamp of the 1st output sample in us
+     */
+    qint64 process(const float* in, int frames, qint64 timestampUs, QVector<float>* out);
+    /*!
+     * \brief process
+     * frame must be in packed float format
+     * \return stretched frame. samplesPerChannel() can be 0 if more input is required
+     */
+    AudioFrame process(const AudioFrame& frame);
+private:
+    int seekBestOffset(const float* in) const;
+
+    qreal m_speed;
+    int m_channels, m_rate;
+    int m_seq, m_overlap, m_seek; // in samples per channel
+    bool m_first;
+    double m_skip_frac;
+    int m_discard; // input samples per channel to skip
+    // timestamp of m_in[0] is m_in_ts + m_in_pos/m_rate. samples are counted to avoid rounding errors accumulated in every process()
+    qint64 m_in_ts;
+    qint64 m_in_pos; // input samples per channel consumed since m_in_ts
+    QVector<float> m_in; // interleaved input
+    QVector<float> m_mid; // tail of the previous sequence to cross fade with the next one
+    QVector<float> m_out;
+};
+} //namespace QtAV
+#endif //QTAV_AUDIOTIMESTRETCH_H
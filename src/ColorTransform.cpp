@@ -66,6 +66,19 @@ static const QMatrix4x4 yuv2rgb_bt709 =
                 0.0f, 0.0f, 1.0f, -0.5f,
                 0.0f, 0.0f, 0.0f, 1.0f)
         ;
+static const QMatrix4x4 yuv2rgb_bt2020 =
+           QMatrix4x4(
+                1.0f,  0.000f,   1.4746f, 0.0f,
+                1.0f, -0.16455f, -0.57135f, 0.0f,
+                1.0f,  1.8814f,  0.000f,  0.0f,
+                0.0f,  0.000f,   0.000f,  1.0f)
+            *
+            QMatrix4x4(
+                1.0f, 0.0f, 0.0f, 0.0f,
+                0.0f, 1.0f, 0.0f, -0.5f,
+                0.0f, 0.0f, 1.0f, -0.5f,
+                0.0f, 0.0f, 0.0f, 1.0f)
+        ;
 
 const QMatrix4x4& ColorTransform::YUV2RGB(ColorSpace cs)
 {
@@ -74,6 +87,8 @@ const QMatrix4x4& ColorTransform::YUV2RGB(ColorSpace cs)
         return yuv2rgb_bt601;
     case ColorSpace_BT709:
         return yuv2rgb_bt709;
+    case ColorSpace_BT2020:
+        return yuv2rgb_bt2020;
     default:
         return yuv2rgb_bt601;
     }
@@ -38,7 +38,7 @@ class ColorTransform
 {
 public:
     //http://msdn.microsoft.com/en-us/library/dd206750.aspx
-    // cs: BT601 or BT709
+    // cs: BT601, BT709 or BT2020
     static const QMatrix4x4& YUV2RGB(ColorSpace cs);
 
     ColorTransform();
@@ -21,10 +21,39 @@
 
 #include "QtAV/Frame.h"
 #include "QtAV/private/Frame_p.h"
+#include "QtAV/private/AVCompat.h"
+#include "FrameBufferPool.h"
 #include "utils/Logger.h"
 
 namespace QtAV {
 
+FramePrivate::~FramePrivate()
+{
+#if QTAV_HAVE(AVBUFREF)
+    av_buffer_unref(&buf);
+#endif
+}
+
+uchar* FramePrivate::allocate(int size)
+{
+#if QTAV_HAVE(AVBUFREF)
+    av_buffer_unref(&buf);
+    FrameBufferPool *pool = FrameBufferPool::instance();
+    if (pool)
+        buf = pool->allocBuffer(size);
+    if (buf) {
+        data = QByteArray();
+        data_align = 1;
+        return buf->data;
+    }
+#endif
+    data = QByteArray();
+    data.resize(size + 15); // not initialized
+    data_align = 16;
+    uchar *p = (uchar*)data.data();
+    return p + ((16 - ((quintptr)p & 15)) & 15);
+}
+
 Frame::Frame(const Frame &other)
     :d_ptr(other.d_ptr)
 {
@@ -202,12 +231,22 @@ void Frame::setMetaData(const QString &key, const QVariant &value)
 
 qreal Frame::timestamp() const
 {
-    return d_func()->timestamp;
+    return qreal(d_func()->timestamp_us)/1000000.0;
 }
 
 void Frame::setTimestamp(qreal ts)
 {
-    d_func()->timestamp = ts;
+    d_func()->timestamp_us = qRound64(ts*1000000.0);
+}
+
+qint64 Frame::timestampUs() const
+{
+    return d_func()->timestamp_us;
+}
+
+void Frame::setTimestampUs(qint64 us)
+{
+    d_func()->timestamp_us = us;
 }
 
 } //namespace QtAV
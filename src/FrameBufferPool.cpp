@@ -0,0 +1,213 @@
+/******************************************************************************
+    QtAV:  Multimedia framework based on Qt and FFmpeg
+    Copyright (C) 2012-2017 Wang Bin <wbsecg1@gmail.com>
+
+*   This file is part of QtAV (from 2017)
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+******************************************************************************/
+
+
+#include "FrameBufferPool.h"
+#include <string.h>
+#include "QtAV/private/AVCompat.h"
+#include "utils/Logger.h"
+
+namespace QtAV {
+// bytes before the data to store the bucket size. keep the data alignment of av_malloc()
+static const int kHeaderSize = 64;
+static const int kPageSize = 4096;
+static const qint64 kDefaultMaxFreeBytes = 128*1024*1024;
+
+namespace {
+class PoolHolder {
+public:
+    PoolHolder() : pool(new FrameBufferPool()) {}
+    ~PoolHolder() { pool->deref();} // buffers alive hold references
+    FrameBufferPool *pool;
+};
+}
+Q_GLOBAL_STATIC(PoolHolder, globalPool)
+
+FrameBufferPool* FrameBufferPool::instance()
+{
+    PoolHolder *h = globalPool();
+    return h ? h->pool : 0;
+}
+
+FrameBufferPool::FrameBufferPool()
+    : m_ref(1)
+    , m_free_bytes(0)
+    , m_max_free_bytes(kDefaultMaxFreeBytes)
+{
+    memset(&m_stat, 0, sizeof(m_stat));
+}
+
+FrameBufferPool::~FrameBufferPool()
+{
+    foreach (const Bucket& b, m_buckets) {
+        foreach (uint8_t* p, b.free) {
+            av_free(p);
+        }
+    }
+}
+
+void FrameBufferPool::ref()
+{
+    m_ref.ref();
+}
+
+void FrameBufferPool::deref()
+{
+    if (!m_ref.deref())
+        delete this;
+}
+
+FrameBufferPool::Statistics FrameBufferPool::statistics() const
+{
+    QMutexLocker lock(&m_mutex);
+    Q_UNUSED(lock);
+    Statistics st = m_stat;
+    st.free = 0;
+    foreach (const Bucket& b, m_buckets)
+        st.free += b.free.size();
+    st.free_bytes = m_free_bytes;
+    return st;
+}
+
+AVBufferRef* FrameBufferPool::allocBuffer(int size)
+{
+#if QTAV_HAVE(AVBUFREF)
+    if (size <= 0)
+        return 0;
+    const int bucket_size = FFALIGN(size, kPageSize);
+    uint8_t *p = 0;
+    {
+        QMutexLocker lock(&m_mutex);
+        Q_UNUSED(lock);
+        for (int i = 0; i < m_buckets.size(); ++i) {
+            if (m_buckets.at(i).size != bucket_size)
+                continue;
+            if (i > 0)
+                m_buckets.move(i, 0);
+            Bucket &b = m_buckets.first();
+            if (!b.free.isEmpty()) {
+                p = b.free.last();
+                b.free.pop_back();
+                m_free_bytes -= bucket_size;
+            }
+            break;
+        }
+        if (p)
+            m_stat.hits++;
+        else
+            m_stat.misses++;
+    }
+    if (!p) {
+        p = (uint8_t*)av_malloc(kHeaderSize + bucket_size);
+        if (!p)
+            return 0;
+        *(int*)p = bucket_size;
+    }
+    ref(); // released in releaseBuffer()
+    AVBufferRef *buf = av_buffer_create(p + kHeaderSize, bucket_size, releaseBuffer, this, 0);
+    if (!buf)
+        releaseBuffer(this, p + kHeaderSize);
+    return buf;
+#else
+    Q_UNUSED(size);
+    return 0;
+#endif
+}
+
+void FrameBufferPool::releaseBuffer(void *opaque, uint8_t *data)
+{
+    FrameBufferPool *pool = (FrameBufferPool*)opaque;
+    uint8_t *p = data - kHeaderSize;
+    const int bucket_size = *(int*)p;
+    QVector<uint8_t*> evicted;
+    {
+        QMutexLocker lock(&pool->m_mutex);
+        Q_UNUSED(lock);
+        int i = 0;
+        for (; i < pool->m_buckets.size(); ++i) {
+            if (pool->m_buckets.at(i).size == bucket_size)
+                break;
+        }
+        if (i == pool->m_buckets.size()) {
+            Bucket b;
+            b.size = bucket_size;
+            pool->m_buckets.prepend(b);
+            i = 0;
+        }
+        pool->m_buckets[i].free.append(p);
+        pool->m_free_bytes += bucket_size;
+        pool->trim(&evicted);
+    }
+    foreach (uint8_t* e, evicted) {
+        av_free(e);
+    }
+    pool->deref();
+}
+
+void FrameBufferPool::trim(QVector<uint8_t*> *evicted)
+{
+    // free buffers of the least recently used buckets, e.g. buckets of old streams or previous video size
+    while (m_free_bytes > m_max_free_bytes && !m_buckets.isEmpty()) {
+        Bucket &b = m_buckets.last();
+        if (b.free.isEmpty()) {
+            m_buckets.removeLast();
+            continue;
+        }
+        evicted->append(b.free.last());
+        b.free.pop_back();
+        m_free_bytes -= b.size;
+    }
+}
+
+void FrameBufferPool::setMaxFreeBytes(qint64 value)
+{
+    QVector<uint8_t*> evicted;
+    {
+        QMutexLocker lock(&m_mutex);
+        Q_UNUSED(lock);
+        m_max_free_bytes = qMax<qint64>(0, value);
+        trim(&evicted);
+    }
+    foreach (uint8_t* e, evicted) {
+        av_free(e);
+    }
+}
+
+qint64 FrameBufferPool::maxFreeBytes() const
+{
+    QMutexLocker lock(&m_mutex);
+    Q_UNUSED(lock);
+    return m_max_free_bytes;
+}
+
+void setFrameBufferPoolSize(qint64 bytes)
+{
+    FrameBufferPool *pool = FrameBufferPool::instance();
+    if (pool)
+        pool->setMaxFreeBytes(bytes);
+}
+
+qint64 frameBufferPoolSize()
+{
+    FrameBufferPool *pool = FrameBufferPool::instance();
+    return pool ? pool->maxFreeBytes() : 0;
+}
+} //namespace QtAV
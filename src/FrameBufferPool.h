@@ -0,0 +1,84 @@
+/******************************************************************************
+    QtAV:  Multimedia framework based on Qt and FFmpeg
+    Copyright (C) 2012-2017 Wang Bin <wbsecg1@gmail.com>
+
+*   This file is part of QtAV (from 2017)
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+******************************************************************************/
+
+
+#ifndef QTAV_FRAMEBUFFERPOOL_H
+#define QTAV_FRAMEBUFFERPOOL_H
+
+#include <stdint.h>
+#include <QtCore/QAtomicInt>
+#include <QtCore/QList>
+#include <QtCore/QMutex>
+#include <QtCore/QVector>
+#include <QtAV/QtAV_Global.h>
+
+struct AVBufferRef;
+namespace QtAV {
+/*!
+ * \brief The FrameBufferPool class
+ * Recycles frame data buffers. Buffers are bucketed by size (rounded up to 4KB), so frames of the same stream always hit the same bucket.
+ * The memory is not initialized, and the data is aligned as av_malloc(). A buffer goes back to the pool when the last AVBufferRef (and thus the last frame) referencing it is released.
+ * Allocation and release can be in any thread.
+ */
+class FrameBufferPool
+{
+public:
+    typedef struct {
+        qint64 hits; // buffer reused
+        qint64 misses; // buffer allocated
+        int free; // buffers in pool
+        qint64 free_bytes;
+    } Statistics;
+
+    /// the global pool. null after it is destroyed at exit, then allocate buffers without pool
+    static FrameBufferPool* instance();
+    /*!
+     * \brief allocBuffer
+     * \return an uninitialized buffer aligned by av_malloc() with at least \a size bytes. null if AVBufferRef is not supported
+     */
+    AVBufferRef* allocBuffer(int size);
+    Statistics statistics() const;
+    /// high-water mark of free buffers in bytes. Buffers of the least recently used sizes are freed first if exceeded
+    void setMaxFreeBytes(qint64 value);
+    qint64 maxFreeBytes() const;
+
+    FrameBufferPool(); // the reference count is 1
+    void ref();
+    void deref(); // delete if reference count becomes 0
+private:
+    ~FrameBufferPool();
+    static void releaseBuffer(void *opaque, uint8_t *data); // AVBuffer free callback
+    // take free buffers exceeding the high-water mark. called with lock held
+    void trim(QVector<uint8_t*> *evicted);
+
+    struct Bucket {
+        int size;
+        QVector<uint8_t*> free;
+    };
+    QAtomicInt m_ref;
+    mutable QMutex m_mutex;
+    QList<Bucket> m_buckets; // the most recently used first
+    qint64 m_free_bytes;
+    qint64 m_max_free_bytes;
+    Statistics m_stat;
+};
+} //namespace QtAV
+#endif //QTAV_FRAMEBUFFERPOOL_H
@@ -138,8 +138,8 @@ qint64 FrameReader::Private::seekInternal(qint64 value)
             continue;
         pkt = demuxer.packet();
         if (pts0 < 0LL)
-            pts0 = (qint64)(pkt.pts*1000.0);
-        if ((qint64)(pkt.pts*1000.0) - value > (qint64)range) {
+            pts0 = pkt.ptsUs()/1000LL;
+        if (pkt.ptsUs()/1000LL - value > (qint64)range) {
             if (warn_out_of_range)
                 qDebug("read packet out of range");
             warn_out_of_range = false;
@@ -155,7 +155,7 @@ qint64 FrameReader::Private::seekInternal(qint64 value)
         warn_bad_seek = false;
     }
     // enlarge range if seek to key-frame failed
-    const qint64 key_pts = (qint64)(pkt.pts*1000.0);
+    const qint64 key_pts = pkt.ptsUs()/1000LL;
     const bool enlarge_range = pts0 >= 0LL && key_pts - pts0 > 0LL;
     if (enlarge_range) {
         range = qMax<qint64>(key_pts - value, range);
@@ -179,11 +179,11 @@ qint64 FrameReader::Private::seekInternal(qint64 value)
     // if seek backward correctly to key frame, diff0 = t - value <= 0
     // but sometimes seek to no-key frame(and range is enlarged), diff0 >= 0
     // decode key frame
-    const int diff0 = qint64(frame.timestamp()*1000.0) - value;
+    const int diff0 = frame.timestampUs()/1000LL - value;
     if (qAbs(diff0) <= range) { //TODO: flag forward: result pts must >= value
         if (frame.isValid()) {
             qDebug() << "VideoFrameExtractor: key frame found @" << frame.timestamp() <<" diff=" << diff0 << ". format: " <<  frame.format();
-            return qint64(frame.timestamp()*1000.0);
+            return frame.timestampUs()/1000LL;
         }
     }
     QVariantHash* dec_opt = &dec_opt_normal; // 0: default, 1: framedrop
@@ -194,8 +194,8 @@ qint64 FrameReader::Private::seekInternal(qint64 value)
         if (demuxer.stream() != vstream)
             continue;
         pkt = demuxer.packet();
-        const qreal t = pkt.pts;
-        //qDebug("video packet: %f, delta=%lld", t, value - qint64(t*1000.0));
+        const qint64 t = pkt.ptsUs();
+        //qDebug("video packet: %lld us, delta=%lld", t, value - t/1000LL);
         if (!pkt.isValid()) {
             qWarning("invalid packet. no decode");
             continue;
@@ -205,7 +205,7 @@ qint64 FrameReader::Private::seekInternal(qint64 value)
             //qCritical("Internal error. Can not be a key frame!!!!");
             //return false; //??
         }
-        qint64 diff = qint64(t*1000.0) - value;
+        qint64 diff = t/1000LL - value;
         QVariantHash *dec_opt_old = dec_opt;
         if (nb_seek == 0 || diff >= 0)
             dec_opt = &dec_opt_normal;
@@ -214,36 +214,43 @@ qint64 FrameReader::Private::seekInternal(qint64 value)
         if (dec_opt != dec_opt_old)
             decoder->setOptions(*dec_opt);
         // invalid packet?
-        if (!decoder->decode(pkt)) {
+        if (!decoder->sendPacket(pkt)) {
             qWarning("!!!!!!!!!decode failed!!!!");
             frame = VideoFrame();
             return -1;
         }
-        // store the last decoded frame because next frame may be out of range
-        const VideoFrame f = decoder->frame();
-        if (!f.isValid()) {
-            //qDebug("VideoFrameExtractor: invalid frame!!!");
-            continue;
+        // a packet can produce more than 1 frame
+        bool found = false;
+        while (decoder->receiveFrame()) {
+            // store the last decoded frame because next frame may be out of range
+            const VideoFrame f = decoder->frame();
+            if (!f.isValid()) {
+                //qDebug("VideoFrameExtractor: invalid frame!!!");
+                continue;
+            }
+            frame = f;
+            const qreal pts = frame.timestamp();
+            const qint64 pts_ms = frame.timestampUs()/1000LL;
+            if (pts_ms < value)
+                continue; //
+            diff = pts_ms - value;
+            if (qAbs(diff) <= (qint64)range) {
+                qDebug("got frame at %fs, diff=%lld", pts, diff);
+                found = true;
+                break;
+            }
+            // if decoder was not flushed, we may get old frame which is acceptable
+            if (diff > range && t > frame.timestampUs()) {
+                qWarning("out pts out of range. diff=%lld, range=%d", diff, range);
+                frame = VideoFrame();
+                return -1;
+            }
         }
-        frame = f;
-        const qreal pts = frame.timestamp();
-        const qint64 pts_ms = pts*1000.0;
-        if (pts_ms < value)
-            continue; //
-        diff = pts_ms - value;
-        if (qAbs(diff) <= (qint64)range) {
-            qDebug("got frame at %fs, diff=%lld", pts, diff);
+        if (found)
             break;
-        }
-        // if decoder was not flushed, we may get old frame which is acceptable
-        if (diff > range && t > pts) {
-            qWarning("out pts out of range. diff=%lld, range=%d", diff, range);
-            frame = VideoFrame();
-            return -1;
-        }
     }
     ++nb_seek;
-    return qint64(frame.timestamp()*1000.0);
+    return frame.timestampUs()/1000LL;
 }
 
 FrameReader::FrameReader(QObject *parent)
@@ -344,7 +351,12 @@ void FrameReader::readMoreInternal()
             continue;
         }
         pkt = d->demuxer.packet();
-        if (d->decoder->decode(pkt)) {
+        if (!d->decoder->sendPacket(pkt)) {
+            qDebug("dec error, continue to decoder");
+            continue;
+        }
+        // a packet can produce more than 1 frame. read all of them, otherwise they are dropped by the next packet
+        while (d->decoder->receiveFrame()) {
             const VideoFrame frame(d->decoder->frame());
             if (!frame) {
                 qDebug("no frame got, continue to decoder");
@@ -353,11 +365,9 @@ void FrameReader::readMoreInternal()
             d->vframes.put(frame);
             Q_EMIT frameRead(frame);
             //qDebug("frame got @%.3f, queue enough: %d", frame.timestamp(), vframes.isEnough());
-            if (d->vframes.isEnough())
-                break;
-        } else {
-            qDebug("dec error, continue to decoder");
         }
+        if (d->vframes.isEnough())
+            break;
     }
     if (d->demuxer.atEnd()) {
         d->vframes.setThreshold(1);
@@ -25,6 +25,7 @@
 #include "QtAV/private/factory.h"
 #include "ImageConverter.h"
 #include "utils/Logger.h"
+#include <string.h>
 
 namespace QtAV {
 
@@ -143,6 +144,20 @@ ColorRange ImageConverter::outRange() const
     return d_func().range_out;
 }
 
+void ImageConverter::setInColorSpace(ColorSpace cs)
+{
+    DPTR_D(ImageConverter);
+    if (d.cs_in == cs)
+        return;
+    d.cs_in = cs;
+    d.setupColorspaceDetails();
+}
+
+ColorSpace ImageConverter::inColorSpace() const
+{
+    return d_func().cs_in;
+}
+
 void ImageConverter::setBrightness(int value)
 {
     DPTR_D(ImageConverter);
@@ -185,6 +200,16 @@ int ImageConverter::saturation() const
     return d_func().saturation;
 }
 
+void ImageConverter::setScaleFilter(ScaleFilter value)
+{
+    d_func().scale_filter = value;
+}
+
+ImageConverter::ScaleFilter ImageConverter::scaleFilter() const
+{
+    return d_func().scale_filter;
+}
+
 QVector<quint8*> ImageConverter::outPlanes() const
 {
     return d_func().bits;
@@ -237,4 +262,89 @@ bool ImageConverter::prepareData()
     return true;
 }
 
+// converters for different frame kinds in use at the same time, e.g. renderer, capture and encoder
+static const int kMaxFreeConverters = 8;
+Q_GLOBAL_STATIC(ImageConverterCache, globalConverterCache)
+
+ImageConverterCache::Key::Key()
+    : format_in(QTAV_PIX_FMT_C(NONE)), format_out(QTAV_PIX_FMT_C(NONE))
+    , width_in(0), height_in(0), width_out(0), height_out(0)
+    , range_in(ColorRange_Unknown)
+    , cs_in(ColorSpace_Unknown)
+{}
+
+bool ImageConverterCache::Key::operator==(const Key &other) const
+{
+    return format_in == other.format_in && format_out == other.format_out
+            && width_in == other.width_in && height_in == other.height_in
+            && width_out == other.width_out && height_out == other.height_out
+            && range_in == other.range_in && cs_in == other.cs_in;
+}
+
+ImageConverterCache* ImageConverterCache::instance()
+{
+    return globalConverterCache();
+}
+
+ImageConverterCache::ImageConverterCache()
+{
+    memset(&m_stat, 0, sizeof(m_stat));
+}
+
+ImageConverterCache::~ImageConverterCache()
+{
+    foreach (const Entry& e, m_free) {
+        delete e.conv;
+    }
+}
+
+ImageConverter* ImageConverterCache::acquire(const Key &key)
+{
+    {
+        QMutexLocker lock(&m_mutex);
+        Q_UNUSED(lock);
+        for (int i = 0; i < m_free.size(); ++i) {
+            if (!(m_free.at(i).key == key))
+                continue;
+            m_stat.hits++;
+            return m_free.takeAt(i).conv;
+        }
+        m_stat.misses++;
+    }
+    ImageConverter *conv = new ImageConverterYUV();
+    conv->setInFormat(key.format_in);
+    conv->setOutFormat(key.format_out);
+    conv->setInSize(key.width_in, key.height_in);
+    conv->setOutSize(key.width_out, key.height_out);
+    conv->setInRange(key.range_in);
+    conv->setInColorSpace(key.cs_in);
+    return conv;
+}
+
+void ImageConverterCache::release(const Key &key, ImageConverter *conv)
+{
+    if (!conv)
+        return;
+    Entry e;
+    e.key = key;
+    e.conv = conv;
+    ImageConverter *evicted = 0;
+    {
+        QMutexLocker lock(&m_mutex);
+        Q_UNUSED(lock);
+        m_free.prepend(e);
+        if (m_free.size() > kMaxFreeConverters)
+            evicted = m_free.takeLast().conv;
+    }
+    delete evicted;
+}
+
+ImageConverterCache::Statistics ImageConverterCache::statistics() const
+{
+    QMutexLocker lock(&m_mutex);
+    Q_UNUSED(lock);
+    Statistics st = m_stat;
+    st.free = m_free.size();
+    return st;
+}
 } //namespace QtAV
@@ -25,17 +25,28 @@
 
 #include <QtAV/QtAV_Global.h>
 #include <QtAV/VideoFormat.h>
+#include <QtCore/QList>
+#include <QtCore/QMutex>
 #include <QtCore/QVector>
 
 namespace QtAV {
 
 typedef int ImageConverterId;
 class ImageConverterPrivate;
-class ImageConverter //export is not needed
+class Q_AV_PRIVATE_EXPORT ImageConverter // exported for tests
 {
     DPTR_DECLARE_PRIVATE(ImageConverter)
 public:
     enum { DataAlignment = 16 };
+    /// scaling algorithm, from fast to high quality
+    enum ScaleFilter {
+        ScaleFilter_Auto, ///< point if no scaling, otherwise fast bilinear
+        ScaleFilter_Point,
+        ScaleFilter_FastBilinear,
+        ScaleFilter_Bilinear,
+        ScaleFilter_Bicubic,
+        ScaleFilter_Lanczos
+    };
 
     ImageConverter();
     virtual ~ImageConverter();
@@ -59,6 +70,9 @@ public:
     // default is full range
     void setOutRange(ColorRange range);
     ColorRange outRange() const;
+    /// yuv matrix of input. default is unknown: bt601
+    void setInColorSpace(ColorSpace cs);
+    ColorSpace inColorSpace() const;
     /*!
      * brightness, contrast, saturation: -100~100
      * If value changes, setup sws
@@ -69,6 +83,9 @@ public:
     int contrast() const;
     void setSaturation(int value);
     int saturation() const;
+    /// Default is ScaleFilter_Auto
+    void setScaleFilter(ScaleFilter value);
+    ScaleFilter scaleFilter() const;
     QVector<quint8*> outPlanes() const;
     QVector<int> outLineSizes() const;
     virtual bool convert(const quint8 *const src[], const int srcStride[]);
@@ -101,7 +118,7 @@ class ImageConverterFFPrivate;
  * \brief The ImageConverterFF class
  * based on libswscale
  */
-class ImageConverterFF Q_DECL_FINAL: public ImageConverter //Q_AV_EXPORT is not needed
+class Q_AV_PRIVATE_EXPORT ImageConverterFF Q_DECL_FINAL: public ImageConverter
 {
     DPTR_DECLARE_PRIVATE(ImageConverterFF)
 public:
@@ -113,9 +130,94 @@ public:
 };
 typedef ImageConverterFF ImageConverterSWS;
 
+class ImageConverterFFSlicePrivate;
+/*!
+ * \brief The ImageConverterFFSlice class
+ * based on libswscale. The output frame is split into horizontal slices converted in parallel by a thread pool.
+ * Slices are independent if the height and vertical chroma subsampling are not changed and the output is not dithered.
+ * Otherwise, e.g. vertical scaling or yuv420p to rgb, slices are parallel only with libswscale >= 6.1 (slice output api),
+ * or the frame is converted in the calling thread. The output is the same as ImageConverterFF.
+ */
+class Q_AV_PRIVATE_EXPORT ImageConverterFFSlice Q_DECL_FINAL: public ImageConverter
+{
+    DPTR_DECLARE_PRIVATE(ImageConverterFFSlice)
+public:
+    ImageConverterFFSlice();
+    /*!
+     * \brief setThreads
+     * Max number of slices. A slice has at least 64 rows.
+     * \param value <=0: QThread::idealThreadCount(). Default is 0
+     */
+    void setThreads(int value);
+    int threads() const;
+    bool check() const Q_DECL_OVERRIDE;
+    bool convert(const quint8 *const src[], const int srcStride[]) Q_DECL_OVERRIDE { return ImageConverter::convert(src, srcStride);}
+    bool convert(const quint8 *const src[], const int srcStride[], quint8 *const dst[], const int dstStride[]) Q_DECL_OVERRIDE;
+};
+
+class ImageConverterYUVPrivate;
+/*!
+ * \brief The ImageConverterYUV class
+ * SIMD yuv to 32bpp rgb conversion without scaling. The matrix is from ColorTransform.
+ * Input: yuv420p, yuv422p (and jpeg range variants), nv12, nv21, p010le. Output: bgra(rgb32), rgba, bgr0, rgb0.
+ * libswscale is used if formats are not supported, size changes or brightness, contrast, saturation is set.
+ */
+class Q_AV_PRIVATE_EXPORT ImageConverterYUV Q_DECL_FINAL: public ImageConverter
+{
+    DPTR_DECLARE_PRIVATE(ImageConverterYUV)
+public:
+    ImageConverterYUV();
+    /// in, out: ffmpeg pixel formats. true if the fast path supports the conversion
+    static bool isSupported(int in, int out);
+    bool check() const Q_DECL_OVERRIDE;
+    bool convert(const quint8 *const src[], const int srcStride[]) Q_DECL_OVERRIDE { return ImageConverter::convert(src, srcStride);}
+    bool convert(const quint8 *const src[], const int srcStride[], quint8 *const dst[], const int dstStride[]) Q_DECL_OVERRIDE;
+};
+
+/*!
+ * \brief The ImageConverterCache class
+ * Thread safe cache of prepared converters, so that the sws context and the SIMD coefficients are reused when converting the same kind of frames repeatedly.
+ * A converter is used exclusively between acquire() and release().
+ */
+class Q_AV_PRIVATE_EXPORT ImageConverterCache
+{
+public:
+    struct Key {
+        Key();
+        bool operator==(const Key& other) const;
+        int format_in, format_out; // ffmpeg pixel format
+        int width_in, height_in, width_out, height_out;
+        ColorRange range_in;
+        ColorSpace cs_in;
+    };
+    typedef struct {
+        qint64 hits; // a prepared converter is reused
+        qint64 misses; // a new converter is created
+        int free; // converters in cache
+    } Statistics;
+
+    static ImageConverterCache* instance();
+    ImageConverterCache();
+    ~ImageConverterCache();
+    /// Take a converter prepared for key from cache, or create a new ImageConverterYUV. It must be given back by release()
+    ImageConverter* acquire(const Key& key);
+    void release(const Key& key, ImageConverter* conv);
+    Statistics statistics() const;
+private:
+    struct Entry {
+        Key key;
+        ImageConverter *conv;
+    };
+    mutable QMutex m_mutex;
+    QList<Entry> m_free; // the most recently used first
+    Statistics m_stat;
+};
+
 //ImageConverter* c = ImageConverter::create(ImageConverterId_FF);
-extern ImageConverterId ImageConverterId_FF;
+extern Q_AV_PRIVATE_EXPORT ImageConverterId ImageConverterId_FF;
 extern ImageConverterId ImageConverterId_IPP;
+extern Q_AV_PRIVATE_EXPORT ImageConverterId ImageConverterId_FFSlice;
+extern Q_AV_PRIVATE_EXPORT ImageConverterId ImageConverterId_YUV;
 
 } //namespace QtAV
 #endif // QTAV_IMAGECONVERTER_H
@@ -83,7 +83,7 @@ bool ImageConverterFF::convert(const quint8 *const src[], const int srcStride[],
     d.sws_ctx = sws_getCachedContext(d.sws_ctx
             , d.w_in, d.h_in, (AVPixelFormat)d.fmt_in
             , d.w_out, d.h_out, (AVPixelFormat)d.fmt_out
-            , (d.w_in == d.w_out && d.h_in == d.h_out) ? SWS_POINT : SWS_FAST_BILINEAR //SWS_BICUBIC
+            , d.swsFlags()
             , NULL, NULL, NULL
             );
     //int64_t flags = SWS_CPU_CAPS_SSE2 | SWS_CPU_CAPS_MMX | SWS_CPU_CAPS_MMX2;
@@ -117,8 +117,7 @@ bool ImageConverterFFPrivate::setupColorspaceDetails(bool force)
     }
     const int srcRange = range_in == ColorRange_Limited ? 0 : 1;
     int dstRange = range_out == ColorRange_Limited ? 0 : 1;
-    // TODO: color space
-    bool supported = sws_setColorspaceDetails(sws_ctx, sws_getCoefficients(SWS_CS_DEFAULT)
+    bool supported = sws_setColorspaceDetails(sws_ctx, sws_getCoefficients(swsColorSpace())
                              , srcRange, sws_getCoefficients(SWS_CS_DEFAULT)
                              , dstRange
                              , ((brightness << 16) + 50)/100
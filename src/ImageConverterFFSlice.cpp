@@ -0,0 +1,358 @@
+/******************************************************************************
+    QtAV:  Multimedia framework based on Qt and FFmpeg
+    Copyright (C) 2012-2017 Wang Bin <wbsecg1@gmail.com>
+
+*   This file is part of QtAV (from 2017)
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+******************************************************************************/
+
+#include "ImageConverter.h"
+#include "ImageConverter_p.h"
+#include <QtCore/QRunnable>
+#include <QtCore/QSemaphore>
+#include <QtCore/QThread>
+#include <QtCore/QThreadPool>
+#include "QtAV/private/AVCompat.h"
+#include "QtAV/private/mkid.h"
+#include "QtAV/private/factory.h"
+#include "utils/Logger.h"
+
+// sws_receive_slice() outputs the given rows of a frame, so vertical scaling can be parallel
+#define QTAV_SWS_SLICE_API (LIBSWSCALE_VERSION_INT >= AV_VERSION_INT(6, 1, 100))
+#if QTAV_SWS_SLICE_API
+#include <libavutil/frame.h>
+#endif
+// ffmpeg3.0 151aa2e/ libav>11 2268db2
+#if AV_MODULE_CHECK(LIBAVUTIL, 55, 0, 0, 0, 100)
+#define DESC_VAL(X) (X)
+#else
+#define DESC_VAL(X) (X##_minus1 + 1)
+#endif
+
+namespace QtAV {
+ImageConverterId ImageConverterId_FFSlice = mkid::id32base36_5<'S', 'l', 'i', 'c', 'e'>::value;
+FACTORY_REGISTER(ImageConverter, FFSlice, "FFmpegSlice")
+
+Q_GLOBAL_STATIC(QThreadPool, sliceThreadPool)
+
+// thread overhead is larger than conversion time for smaller slices
+static const int kMinSliceRows = 64;
+// slice rows are multiple of it to keep chroma rows of all subsampled formats
+static const int kSliceAlign = 16;
+
+// log2 of rows of a plane to luma rows
+static int planeRowShift(const AVPixFmtDescriptor *desc, int plane)
+{
+    if (desc->flags & AV_PIX_FMT_FLAG_RGB)
+        return 0;
+    for (int c = 1; c < 3 && c < desc->nb_components; ++c) {
+        if (desc->comp[c].plane == plane)
+            return desc->log2_chroma_h;
+    }
+    return 0;
+}
+
+/*
+ * Rows of a slice can be converted by an independent context only if every output row is computed from the same
+ * input row as a single context, i.e. no vertical scaling of any plane.
+ * Chroma is interpolated vertically if vertical subsampling changes, e.g. yuv420p to rgb, so the interpolation is
+ * cut at slice borders. gray has no chroma to interpolate.
+ */
+static bool rowsIndependent(AVPixelFormat in, AVPixelFormat out)
+{
+    const AVPixFmtDescriptor *din = av_pix_fmt_desc_get(in);
+    const AVPixFmtDescriptor *dout = av_pix_fmt_desc_get(out);
+    if (!din || !dout)
+        return false;
+    const bool chroma_in = din->nb_components >= 3 && !(din->flags & AV_PIX_FMT_FLAG_PAL);
+    const bool chroma_out = dout->nb_components >= 3;
+    return !(chroma_in && chroma_out && din->log2_chroma_h != dout->log2_chroma_h);
+}
+
+// low depth output can be dithered by error diffusion. the error is carried between rows, so slices are not the same as a single context
+static bool isDithered(AVPixelFormat fmt)
+{
+    const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get(fmt);
+    if (!desc)
+        return true;
+    for (int c = 0; c < desc->nb_components; ++c) {
+        if (DESC_VAL(desc->comp[c].depth) < 8)
+            return true;
+    }
+    return false;
+}
+
+#if QTAV_SWS_SLICE_API
+static void no_free(void*, uint8_t*) {}
+
+// a frame referencing external data, no copy in av_frame_ref()
+static AVFrame* wrapFrame(AVPixelFormat fmt, int w, int h, const quint8 *const data[], const int linesize[])
+{
+    AVFrame *f = av_frame_alloc();
+    if (!f)
+        return 0;
+    f->format = fmt;
+    f->width = w;
+    f->height = h;
+    const int nb_planes = qMax(av_pix_fmt_count_planes(fmt), 1);
+    for (int i = 0; i < nb_planes && i < AV_NUM_DATA_POINTERS; ++i) {
+        f->data[i] = (uint8_t*)data[i];
+        f->linesize[i] = linesize[i];
+    }
+    f->buf[0] = av_buffer_create(f->data[0], f->linesize[0]*h, no_free, NULL, 0);
+    if (!f->buf[0])
+        av_frame_free(&f);
+    return f;
+}
+#endif //QTAV_SWS_SLICE_API
+
+class ImageConverterFFSlicePrivate Q_DECL_FINAL: public ImageConverterPrivate
+{
+public:
+    ImageConverterFFSlicePrivate()
+        : threads(0)
+        , src(0)
+        , src_stride(0)
+        , dst(0)
+        , dst_stride(0)
+        , frame_in(0)
+        , frame_out(0)
+    {}
+    ~ImageConverterFFSlicePrivate() {
+        foreach (SwsContext *c, ctx) {
+            sws_freeContext(c);
+        }
+        ctx.clear();
+    }
+    bool setupColorspaceDetails(bool force = true) Q_DECL_FINAL;
+    bool setupContext(int i, int h_in, int h_out) {
+        SwsContext *c = sws_getCachedContext(ctx[i]
+                , w_in, h_in, fmt_in
+                , w_out, h_out, fmt_out
+                , swsFlags()
+                , NULL, NULL, NULL
+                );
+        if (!c)
+            return false;
+        if (c != ctx[i]) { // new context, eq is not set
+            ctx[i] = c;
+            applyEq(c);
+        }
+        return true;
+    }
+    bool applyEq(SwsContext *c) {
+        const int srcRange = range_in == ColorRange_Limited ? 0 : 1;
+        const int dstRange = range_out == ColorRange_Limited ? 0 : 1;
+        return sws_setColorspaceDetails(c, sws_getCoefficients(swsColorSpace())
+                                 , srcRange, sws_getCoefficients(SWS_CS_DEFAULT)
+                                 , dstRange
+                                 , ((brightness << 16) + 50)/100
+                                 , (((contrast + 100) << 16) + 50)/100
+                                 , (((saturation + 100) << 16) + 50)/100
+                                 ) >= 0;
+    }
+    // convert output rows [y[i], y[i+1])
+    bool convertSlice(int i) {
+        const int y0 = y[i];
+        const int h = y[i+1] - y0;
+#if QTAV_SWS_SLICE_API
+        if (frame_in) {
+            SwsContext *c = ctx[i];
+            const bool res = sws_frame_start(c, frame_out, frame_in) >= 0
+                    && sws_send_slice(c, 0, h_in) >= 0
+                    && sws_receive_slice(c, y0, h) >= 0;
+            sws_frame_end(c);
+            return res;
+        }
+#endif //QTAV_SWS_SLICE_API
+        // the same height: input rows are the same as output rows
+        const AVPixFmtDescriptor *din = av_pix_fmt_desc_get(fmt_in);
+        const AVPixFmtDescriptor *dout = av_pix_fmt_desc_get(fmt_out);
+        const quint8 *s[4] = { src[0], 0, 0, 0 };
+        quint8 *d[4] = { dst[0], 0, 0, 0 };
+        const int nb_in = qMax(av_pix_fmt_count_planes(fmt_in), 1);
+        const int nb_out = qMax(av_pix_fmt_count_planes(fmt_out), 1);
+        for (int p = 0; p < 4; ++p) {
+            if (p < nb_in)
+                s[p] = src[p] + (y0 >> planeRowShift(din, p))*src_stride[p];
+            else if (p == 1 && (din->flags & AV_PIX_FMT_FLAG_PAL))
+                s[p] = src[p]; // palette
+            if (p < nb_out)
+                d[p] = dst[p] + (y0 >> planeRowShift(dout, p))*dst_stride[p];
+        }
+        return sws_scale(ctx[i], s, src_stride, 0, h, d, dst_stride) == h;
+    }
+
+    int threads;
+    QVector<SwsContext*> ctx; // 1 context per slice
+    QVector<int> y; // slice boundaries of output rows
+    // the current conversion
+    const quint8 *const *src;
+    const int *src_stride;
+    quint8 *const *dst;
+    const int *dst_stride;
+    AVFrame *frame_in, *frame_out; // used by sws_receive_slice()
+    QVector<bool> ok; // result of each slice
+};
+
+class SliceTask : public QRunnable
+{
+public:
+    SliceTask(ImageConverterFFSlicePrivate *d, int slice, bool *result, QSemaphore *s)
+        : priv(d), index(slice), ok(result), sem(s)
+    {
+        setAutoDelete(true);
+    }
+    void run() Q_DECL_OVERRIDE {
+        *ok = priv->convertSlice(index);
+        sem->release();
+    }
+private:
+    ImageConverterFFSlicePrivate *priv;
+    int index;
+    bool *ok;
+    QSemaphore *sem;
+};
+
+ImageConverterFFSlice::ImageConverterFFSlice()
+    : ImageConverter(*new ImageConverterFFSlicePrivate())
+{
+}
+
+void ImageConverterFFSlice::setThreads(int value)
+{
+    d_func().threads = value;
+}
+
+int ImageConverterFFSlice::threads() const
+{
+    return d_func().threads;
+}
+
+bool ImageConverterFFSlice::check() const
+{
+    if (!ImageConverter::check())
+        return false;
+    DPTR_D(const ImageConverterFFSlice);
+    if (sws_isSupportedInput((AVPixelFormat)d.fmt_in) <= 0) {
+        qWarning("Input pixel format not supported (%s)", av_get_pix_fmt_name((AVPixelFormat)d.fmt_in));
+        return false;
+    }
+    if (sws_isSupportedOutput((AVPixelFormat)d.fmt_out) <= 0) {
+        qWarning("Output pixel format not supported (%s)", av_get_pix_fmt_name((AVPixelFormat)d.fmt_out));
+        return false;
+    }
+    return true;
+}
+
+bool ImageConverterFFSlice::convert(const quint8 *const src[], const int srcStride[], quint8 *const dst[], const int dstStride[])
+{
+    DPTR_D(ImageConverterFFSlice);
+    if (d.w_out == 0 || d.h_out == 0) {
+        if (d.w_in == 0 || d.h_in == 0)
+            return false;
+        setOutSize(d.w_in, d.h_in);
+    }
+    // if rows are not independent, all input rows are sent to each context and sws_receive_slice() outputs the slice rows
+    const bool whole_frame = d.h_in != d.h_out || !rowsIndependent((AVPixelFormat)d.fmt_in, (AVPixelFormat)d.fmt_out);
+    int n = d.threads > 0 ? d.threads : QThread::idealThreadCount();
+    n = qBound(1, qMin(n, d.h_out/kMinSliceRows), 64);
+    if (isDithered((AVPixelFormat)d.fmt_out))
+        n = 1;
+    int align = kSliceAlign;
+    if (whole_frame) {
+#if QTAV_SWS_SLICE_API
+        for (int p = 0; p < 4; ++p) {
+            if ((src[p] && srcStride[p] < 0) || (dst[p] && dstStride[p] < 0))
+                n = 1;
+        }
+#else
+        n = 1;
+#endif //QTAV_SWS_SLICE_API
+    }
+    if (d.ctx.size() < n)
+        d.ctx.resize(n);
+    if (n == 1) {
+        if (!d.setupContext(0, d.h_in, d.h_out))
+            return false;
+        const int result_h = sws_scale(d.ctx[0], src, srcStride, 0, d.h_in, dst, dstStride);
+        if (result_h != d.h_out) {
+            qDebug("convert failed: %d, %d", result_h, d.h_out);
+            return false;
+        }
+    } else {
+        d.y.resize(n + 1);
+        d.y[0] = 0;
+        d.y[n] = d.h_out;
+        for (int i = 1; i < n; ++i)
+            d.y[i] = (d.h_out*i/n) & ~(align - 1);
+        for (int i = 0; i < n; ++i) {
+            if (!d.setupContext(i, whole_frame ? d.h_in : d.y[i+1] - d.y[i], whole_frame ? d.h_out : d.y[i+1] - d.y[i]))
+                return false;
+        }
+#if QTAV_SWS_SLICE_API
+        if (whole_frame) {
+            align = qMax(align, (int)sws_receive_slice_alignment(d.ctx[0]));
+            for (int i = 1; i < n; ++i)
+                d.y[i] = (d.h_out*i/n) & ~(align - 1);
+            d.frame_in = wrapFrame(d.fmt_in, d.w_in, d.h_in, src, srcStride);
+            d.frame_out = wrapFrame(d.fmt_out, d.w_out, d.h_out, dst, dstStride);
+            if (!d.frame_in || !d.frame_out) {
+                av_frame_free(&d.frame_in);
+                av_frame_free(&d.frame_out);
+                return false;
+            }
+        }
+#endif //QTAV_SWS_SLICE_API
+        d.src = src;
+        d.src_stride = srcStride;
+        d.dst = dst;
+        d.dst_stride = dstStride;
+        d.ok.fill(false, n);
+        bool *ok = d.ok.data();
+        QSemaphore sem;
+        for (int i = 1; i < n; ++i)
+            sliceThreadPool()->start(new SliceTask(&d, i, ok + i, &sem));
+        ok[0] = d.convertSlice(0);
+        sem.acquire(n - 1);
+#if QTAV_SWS_SLICE_API
+        av_frame_free(&d.frame_in);
+        av_frame_free(&d.frame_out);
+#endif //QTAV_SWS_SLICE_API
+        if (d.ok.contains(false)) {
+            qWarning("ImageConverterFFSlice: failed to convert slices");
+            return false;
+        }
+    }
+    for (int i = 0; i < d.pitchs.size(); ++i) {
+        d.bits[i] = dst[i];
+        d.pitchs[i] = dstStride[i];
+    }
+    return true;
+}
+
+bool ImageConverterFFSlicePrivate::setupColorspaceDetails(bool force)
+{
+    Q_UNUSED(force);
+    bool supported = true;
+    foreach (SwsContext *c, ctx) {
+        if (c)
+            supported &= applyEq(c);
+    }
+    return supported;
+}
+
+} //namespace QtAV
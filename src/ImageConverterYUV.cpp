@@ -0,0 +1,245 @@
+/******************************************************************************
+    QtAV:  Multimedia framework based on Qt and FFmpeg
+    Copyright (C) 2012-2017 Wang Bin <wbsecg1@gmail.com>
+
+*   This file is part of QtAV (from 2017)
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+******************************************************************************/
+
+#include "ImageConverter.h"
+#include "ImageConverter_p.h"
+#include "ColorTransform.h"
+#include "utils/YUV2RGB.h"
+#include "QtAV/private/AVCompat.h"
+#include "QtAV/private/mkid.h"
+#include "QtAV/private/factory.h"
+#include "utils/Logger.h"
+
+namespace QtAV {
+ImageConverterId ImageConverterId_YUV = mkid::id32base36_3<'Y', 'U', 'V'>::value;
+FACTORY_REGISTER(ImageConverter, YUV, "YUV")
+
+static bool inputLayout(AVPixelFormat fmt, YUVLayout *layout, bool *swap_uv)
+{
+    bool swap = false;
+    switch (fmt) {
+    case QTAV_PIX_FMT_C(YUV420P):
+    case QTAV_PIX_FMT_C(YUV422P):
+    case QTAV_PIX_FMT_C(YUVJ420P):
+    case QTAV_PIX_FMT_C(YUVJ422P):
+        *layout = YUVLayout_Planar8;
+        break;
+    case QTAV_PIX_FMT_C(NV12):
+        *layout = YUVLayout_SemiPlanar8;
+        break;
+    case QTAV_PIX_FMT_C(NV21):
+        *layout = YUVLayout_SemiPlanar8;
+        swap = true;
+        break;
+#ifdef AV_PIX_FMT_P010
+    case AV_PIX_FMT_P010LE:
+        *layout = YUVLayout_SemiPlanar16;
+        break;
+#endif //AV_PIX_FMT_P010
+    default:
+        return false;
+    }
+    if (swap_uv)
+        *swap_uv = swap;
+    return true;
+}
+
+// rows of ColorTransform matrix (r, g, b) for output bytes 0, 1, 2
+static const int* outputOrder(AVPixelFormat fmt)
+{
+    static const int bgr[] = { 2, 1, 0 };
+    static const int rgb[] = { 0, 1, 2 };
+    switch (fmt) {
+    case QTAV_PIX_FMT_C(BGRA):
+#if QTAV_USE_FFMPEG(LIBAVUTIL)
+    case QTAV_PIX_FMT_C(BGR0):
+#endif //QTAV_USE_FFMPEG(LIBAVUTIL)
+        return bgr;
+    case QTAV_PIX_FMT_C(RGBA):
+#if QTAV_USE_FFMPEG(LIBAVUTIL)
+    case QTAV_PIX_FMT_C(RGB0):
+#endif //QTAV_USE_FFMPEG(LIBAVUTIL)
+        return rgb;
+    default:
+        return 0;
+    }
+}
+
+class ImageConverterYUVPrivate Q_DECL_FINAL: public ImageConverterPrivate
+{
+public:
+    ImageConverterYUVPrivate()
+        : sws_ctx(0)
+        , update_eq(true)
+        , update_coeffs(true)
+        , row_func(0)
+    {}
+    ~ImageConverterYUVPrivate() {
+        if (sws_ctx) {
+            sws_freeContext(sws_ctx);
+            sws_ctx = 0;
+        }
+    }
+    bool setupColorspaceDetails(bool force = true) Q_DECL_FINAL {
+        Q_UNUSED(force);
+        update_eq = true;
+        update_coeffs = true;
+        return true;
+    }
+    bool fastPath() const {
+        // eq of swscale and ColorTransform are different, keep the same result as swscale
+        return w_in == w_out && h_in == h_out
+                && brightness == 0 && contrast == 0 && saturation == 0
+                && range_out != ColorRange_Limited
+                && ImageConverterYUV::isSupported(fmt_in, fmt_out);
+    }
+    void updateCoeffs();
+    bool convertSWS(const quint8 *const src[], const int srcStride[], quint8 *const dst[], const int dstStride[]);
+
+    SwsContext *sws_ctx;
+    bool update_eq;
+    bool update_coeffs;
+    AVPixelFormat coeffs_fmt_in, coeffs_fmt_out;
+    YUVLayout layout;
+    YUV2RGBCoeffs coeffs;
+    yuv2rgb_row_func row_func;
+};
+
+void ImageConverterYUVPrivate::updateCoeffs()
+{
+    update_coeffs = false;
+    coeffs_fmt_in = fmt_in;
+    coeffs_fmt_out = fmt_out;
+    bool swap_uv = false;
+    inputLayout(fmt_in, &layout, &swap_uv);
+    row_func = get_yuv2rgb_row(layout);
+    ColorTransform ct;
+    // unknown is bt601 and full range, the same as swscale
+    ct.setInputColorSpace(cs_in == ColorSpace_BT709 || cs_in == ColorSpace_BT2020 ? cs_in : ColorSpace_BT601);
+    ct.setInputColorRange(range_in == ColorRange_Limited ? ColorRange_Limited : ColorRange_Full);
+    ct.setOutputColorRange(ColorRange_Full);
+    const QMatrix4x4 &m = ct.matrixRef();
+    // matrix is for normalized values. 10 bit samples are treated as 8 bit samples x4, so limited range is [64, 940]
+    // coefficients are 13 bit fixed point for 8 bit samples, and all terms fit in 32 bits
+    const int depth = layout == YUVLayout_SemiPlanar16 ? 10 : 8;
+    coeffs.shift = 13 + depth - 8;
+    const int *order = outputOrder(fmt_out);
+    for (int i = 0; i < 3; ++i) {
+        const int r = order[i];
+        coeffs.ky[i] = qRound(m(r, 0)*float(1<<13));
+        coeffs.ku[i] = qRound(m(r, swap_uv ? 2 : 1)*float(1<<13));
+        coeffs.kv[i] = qRound(m(r, swap_uv ? 1 : 2)*float(1<<13));
+        coeffs.offset[i] = qRound(m(r, 3)*255.0f*float(1<<coeffs.shift)) + (1<<(coeffs.shift-1));
+    }
+}
+
+bool ImageConverterYUVPrivate::convertSWS(const quint8 *const src[], const int srcStride[], quint8 *const dst[], const int dstStride[])
+{
+    SwsContext *c = sws_getCachedContext(sws_ctx
+            , w_in, h_in, fmt_in
+            , w_out, h_out, fmt_out
+            , swsFlags()
+            , NULL, NULL, NULL
+            );
+    if (!c)
+        return false;
+    if (c != sws_ctx || update_eq) {
+        sws_ctx = c;
+        update_eq = false;
+        const int srcRange = range_in == ColorRange_Limited ? 0 : 1;
+        const int dstRange = range_out == ColorRange_Limited ? 0 : 1;
+        sws_setColorspaceDetails(c, sws_getCoefficients(swsColorSpace())
+                                 , srcRange, sws_getCoefficients(SWS_CS_DEFAULT)
+                                 , dstRange
+                                 , ((brightness << 16) + 50)/100
+                                 , (((contrast + 100) << 16) + 50)/100
+                                 , (((saturation + 100) << 16) + 50)/100
+                                 );
+    }
+    const int result_h = sws_scale(sws_ctx, src, srcStride, 0, h_in, dst, dstStride);
+    if (result_h != h_out) {
+        qDebug("convert failed: %d, %d", result_h, h_out);
+        return false;
+    }
+    return true;
+}
+
+ImageConverterYUV::ImageConverterYUV()
+    : ImageConverter(*new ImageConverterYUVPrivate())
+{
+}
+
+bool ImageConverterYUV::isSupported(int in, int out)
+{
+    YUVLayout layout;
+    return inputLayout((AVPixelFormat)in, &layout, 0) && outputOrder((AVPixelFormat)out);
+}
+
+bool ImageConverterYUV::check() const
+{
+    if (!ImageConverter::check())
+        return false;
+    DPTR_D(const ImageConverterYUV);
+    if (isSupported(d.fmt_in, d.fmt_out))
+        return true;
+    if (sws_isSupportedInput((AVPixelFormat)d.fmt_in) <= 0) {
+        qWarning("Input pixel format not supported (%s)", av_get_pix_fmt_name((AVPixelFormat)d.fmt_in));
+        return false;
+    }
+    if (sws_isSupportedOutput((AVPixelFormat)d.fmt_out) <= 0) {
+        qWarning("Output pixel format not supported (%s)", av_get_pix_fmt_name((AVPixelFormat)d.fmt_out));
+        return false;
+    }
+    return true;
+}
+
+bool ImageConverterYUV::convert(const quint8 *const src[], const int srcStride[], quint8 *const dst[], const int dstStride[])
+{
+    DPTR_D(ImageConverterYUV);
+    if (d.w_out == 0 || d.h_out == 0) {
+        if (d.w_in == 0 || d.h_in == 0)
+            return false;
+        setOutSize(d.w_in, d.h_in);
+    }
+    if (!d.fastPath()) {
+        if (!d.convertSWS(src, srcStride, dst, dstStride))
+            return false;
+    } else {
+        if (d.update_coeffs || d.coeffs_fmt_in != d.fmt_in || d.coeffs_fmt_out != d.fmt_out)
+            d.updateCoeffs();
+        const int chroma_shift = av_pix_fmt_desc_get(d.fmt_in)->log2_chroma_h;
+        for (int y = 0; y < d.h_out; ++y) {
+            const int cy = y >> chroma_shift;
+            d.row_func(dst[0] + y*dstStride[0]
+                       , src[0] + y*srcStride[0]
+                       , src[1] + cy*srcStride[1]
+                       , d.layout == YUVLayout_Planar8 ? src[2] + cy*srcStride[2] : 0
+                       , d.w_out, &d.coeffs);
+        }
+    }
+    for (int i = 0; i < d.pitchs.size(); ++i) {
+        d.bits[i] = dst[i];
+        d.pitchs[i] = dstStride[i];
+    }
+    return true;
+}
+
+} //namespace QtAV
@@ -25,6 +25,7 @@
 
 #include <QtAV/private/AVCompat.h>
 #include <QtCore/QVector>
+#include "ImageConverter.h"
 
 namespace QtAV {
 
@@ -39,9 +40,11 @@ public:
         , fmt_out(QTAV_PIX_FMT_C(RGB32))
         , range_in(ColorRange_Unknown)
         , range_out(ColorRange_Unknown)
+        , cs_in(ColorSpace_Unknown)
         , brightness(0)
         , contrast(0)
         , saturation(0)
+        , scale_filter(ImageConverter::ScaleFilter_Auto)
         , update_data(true)
         , out_offset(0)
     {
@@ -52,11 +55,35 @@ public:
         Q_UNUSED(force);
         return true;
     }
+    int swsFlags() const {
+        switch (scale_filter) {
+        case ImageConverter::ScaleFilter_Point: return SWS_POINT;
+        case ImageConverter::ScaleFilter_FastBilinear: return SWS_FAST_BILINEAR;
+        case ImageConverter::ScaleFilter_Bilinear: return SWS_BILINEAR;
+        case ImageConverter::ScaleFilter_Bicubic: return SWS_BICUBIC;
+        case ImageConverter::ScaleFilter_Lanczos: return SWS_LANCZOS;
+        default: break;
+        }
+        return (w_in == w_out && h_in == h_out) ? SWS_POINT : SWS_FAST_BILINEAR;
+    }
+    // for sws_getCoefficients()
+    int swsColorSpace() const {
+        switch (cs_in) {
+        case ColorSpace_BT709: return SWS_CS_ITU709;
+#ifdef SWS_CS_BT2020
+        case ColorSpace_BT2020: return SWS_CS_BT2020;
+#endif
+        default: break;
+        }
+        return SWS_CS_DEFAULT;
+    }
 
     int w_in, h_in, w_out, h_out;
     AVPixelFormat fmt_in, fmt_out;
     ColorRange range_in, range_out;
+    ColorSpace cs_in;
     int brightness, contrast, saturation;
+    ImageConverter::ScaleFilter scale_filter;
     bool update_data;
     int out_offset;
     QByteArray data_out;
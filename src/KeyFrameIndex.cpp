@@ -0,0 +1,219 @@
+/******************************************************************************
+    QtAV:  Multimedia framework based on Qt and FFmpeg
+    Copyright (C) 2012-2017 Wang Bin <wbsecg1@gmail.com>
+
+*   This file is part of QtAV (from 2017)
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+******************************************************************************/
+
+#include "KeyFrameIndex.h"
+#include <algorithm>
+#include <QtCore/QCryptographicHash>
+#include <QtCore/QDataStream>
+#include <QtCore/QFile>
+#include <QtCore/QFileInfo>
+#include <QtCore/QUrl>
+#include "utils/Logger.h"
+
+namespace QtAV {
+
+static const quint32 kMagic = 0x4b494458; // KIDX
+static const quint32 kVersion = 1;
+// bytes of file head and tail to compute the hash
+static const qint64 kHashBytes = 64*1024;
+
+static bool ptsLessThan(qint64 pts, const KeyFrameIndex::Entry& e)
+{
+    return pts < e.pts;
+}
+
+KeyFrameIndex::KeyFrameIndex()
+    : m_run_start(-1)
+    , m_run_end(-1)
+    , m_last_key(-1)
+    , m_max_gop(0)
+    , m_modified(false)
+{
+}
+
+void KeyFrameIndex::clear()
+{
+    m_entries.clear();
+    m_ranges.clear();
+    m_run_start = m_run_end = m_last_key = -1;
+    m_max_gop = 0;
+    m_modified = false;
+}
+
+void KeyFrameIndex::addPacket(qint64 pts, qint64 pos, bool keyFrame)
+{
+    if (pts < 0)
+        return;
+    if (keyFrame) {
+        // key frames are in presentation order, otherwise timestamps jump
+        if (m_last_key >= 0 && pts <= m_last_key)
+            discontinue();
+        if (m_run_start < 0)
+            m_run_start = m_run_end = pts;
+        if (m_last_key >= 0)
+            m_max_gop = qMax(m_max_gop, pts - m_last_key);
+        m_last_key = pts;
+        QVector<Entry>::iterator it = std::upper_bound(m_entries.begin(), m_entries.end(), pts, ptsLessThan);
+        if (it != m_entries.begin() && (it - 1)->pts == pts) {
+            if ((it - 1)->pos < 0 && pos >= 0)
+                (it - 1)->pos = pos;
+        } else {
+            m_entries.insert(it, Entry(pts, pos));
+            m_modified = true;
+        }
+    }
+    if (m_run_start >= 0 && pts > m_run_end)
+        m_run_end = pts;
+}
+
+void KeyFrameIndex::discontinue()
+{
+    mergeRun();
+    m_run_start = m_run_end = m_last_key = -1;
+}
+
+void KeyFrameIndex::mergeRun()
+{
+    if (m_run_start < 0 || m_run_end <= m_run_start)
+        return;
+    Range r(m_run_start, m_run_end);
+    QVector<Range> ranges;
+    ranges.reserve(m_ranges.size() + 1);
+    bool inserted = false;
+    foreach (const Range& x, m_ranges) {
+        if (x.second < r.first) {
+            ranges.append(x);
+        } else if (x.first > r.second) {
+            if (!inserted)
+                ranges.append(r);
+            inserted = true;
+            ranges.append(x);
+        } else { // overlap
+            r.first = qMin(r.first, x.first);
+            r.second = qMax(r.second, x.second);
+        }
+    }
+    if (!inserted)
+        ranges.append(r);
+    m_ranges = ranges;
+}
+
+bool KeyFrameIndex::find(qint64 pts, Entry *entry) const
+{
+    QVector<Entry>::const_iterator it = std::upper_bound(m_entries.constBegin(), m_entries.constEnd(), pts, ptsLessThan);
+    if (it == m_entries.constBegin())
+        return false;
+    const Entry &e = *(it - 1);
+    bool covered = m_run_start >= 0 && m_run_start <= e.pts && pts <= m_run_end;
+    for (int i = 0; i < m_ranges.size() && !covered; ++i)
+        covered = m_ranges.at(i).first <= e.pts && pts <= m_ranges.at(i).second;
+    if (!covered)
+        return false;
+    if (entry)
+        *entry = e;
+    return true;
+}
+
+bool KeyFrameIndex::save(const QString &fileName, int stream)
+{
+    mergeRun();
+    QFile f(fileName);
+    if (!f.open(QIODevice::WriteOnly)) {
+        qWarning("failed to open key frame index file '%s': %s", qPrintable(fileName), qPrintable(f.errorString()));
+        return false;
+    }
+    QDataStream ds(&f);
+    ds << kMagic << kVersion << qint32(stream) << m_max_gop;
+    ds << quint32(m_entries.size());
+    foreach (const Entry& e, m_entries)
+        ds << e.pts << e.pos;
+    ds << quint32(m_ranges.size());
+    foreach (const Range& r, m_ranges)
+        ds << r.first << r.second;
+    m_modified = false;
+    return ds.status() == QDataStream::Ok;
+}
+
+bool KeyFrameIndex::load(const QString &fileName, int stream)
+{
+    QFile f(fileName);
+    if (!f.open(QIODevice::ReadOnly))
+        return false;
+    QDataStream ds(&f);
+    quint32 magic = 0, version = 0;
+    qint32 s = -1;
+    ds >> magic >> version >> s;
+    if (magic != kMagic || version != kVersion || s != stream)
+        return false;
+    clear();
+    // counts are not trusted. a count larger than the rest of file is corrupted, no allocation for it
+    const qint64 record_size = 2*sizeof(qint64);
+    quint32 n = 0;
+    ds >> m_max_gop >> n;
+    bool ok = ds.status() == QDataStream::Ok && qint64(n) <= (f.size() - f.pos())/record_size;
+    for (quint32 i = 0; i < n && ok; ++i) {
+        Entry e;
+        ds >> e.pts >> e.pos;
+        ok = ds.status() == QDataStream::Ok;
+        if (ok)
+            m_entries.append(e);
+    }
+    if (ok) {
+        ds >> n;
+        ok = ds.status() == QDataStream::Ok && qint64(n) <= (f.size() - f.pos())/record_size;
+    }
+    for (quint32 i = 0; i < n && ok; ++i) {
+        Range r;
+        ds >> r.first >> r.second;
+        ok = ds.status() == QDataStream::Ok;
+        if (ok)
+            m_ranges.append(r);
+    }
+    if (!ok) {
+        qWarning("corrupted key frame index file '%s'", qPrintable(fileName));
+        clear();
+        return false;
+    }
+    qDebug("key frame index loaded. %d key frames, max gop: %lldms", m_entries.size(), m_max_gop/1000LL);
+    return true;
+}
+
+QString KeyFrameIndex::cacheFileName(const QString &media)
+{
+    QString path(media);
+    if (path.startsWith(QLatin1String("file:")))
+        path = QUrl(path).toLocalFile();
+    if (path.isEmpty() || !QFileInfo(path).isFile())
+        return QString();
+    QFile f(path);
+    if (!f.open(QIODevice::ReadOnly))
+        return QString();
+    const qint64 size = f.size();
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    hash.addData(QByteArray::number(size));
+    hash.addData(f.read(kHashBytes));
+    if (size > kHashBytes) {
+        f.seek(qMax(kHashBytes, size - kHashBytes));
+        hash.addData(f.read(kHashBytes));
+    }
+    return QString::fromLatin1(hash.result().toHex()) + QLatin1String(".kidx");
+}
+} //namespace QtAV
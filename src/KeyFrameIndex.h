@@ -0,0 +1,86 @@
+/******************************************************************************
+    QtAV:  Multimedia framework based on Qt and FFmpeg
+    Copyright (C) 2012-2017 Wang Bin <wbsecg1@gmail.com>
+
+*   This file is part of QtAV (from 2017)
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+******************************************************************************/
+
+#ifndef QTAV_KEYFRAMEINDEX_H
+#define QTAV_KEYFRAMEINDEX_H
+
+#include <QtCore/QPair>
+#include <QtCore/QString>
+#include <QtCore/QVector>
+#include <QtAV/QtAV_Global.h>
+
+namespace QtAV {
+/*!
+ * \brief The KeyFrameIndex class
+ * Key frames of a stream collected while demuxing. Packets are read in runs, a run is broken by seeking.
+ * A time range read in a run is covered, i.e. every key frame in it is known, so the nearest key frame before
+ * a position in a covered range is exact even if the container index is bad or missing.
+ * All timestamps are in us.
+ */
+class Q_AV_PRIVATE_EXPORT KeyFrameIndex
+{
+public:
+    struct Entry {
+        Entry(qint64 t = -1, qint64 p = -1) : pts(t), pos(p) {}
+        qint64 pts;
+        qint64 pos; ///< byte position in file. <0: unknown
+    };
+    KeyFrameIndex();
+    void clear();
+    bool isEmpty() const { return m_entries.isEmpty();}
+    int size() const { return m_entries.size();}
+    /// a packet of the stream is read. pos is used only for key frames
+    void addPacket(qint64 pts, qint64 pos, bool keyFrame);
+    /// seek or the stream changed. The next packet starts a new run
+    void discontinue();
+    /*!
+     * \brief find
+     * The nearest key frame whose pts <= the given pts
+     * \return false if unknown, i.e. the key frame and pts are not in the same covered range
+     */
+    bool find(qint64 pts, Entry* entry) const;
+    /// max duration between 2 consecutive key frames. 0 if unknown
+    qint64 maxGop() const { return m_max_gop;}
+    /// true if new key frames are added after load() or save()
+    bool isModified() const { return m_modified;}
+
+    bool save(const QString& fileName, int stream);
+    /// stream must be the same as saved
+    bool load(const QString& fileName, int stream);
+    /*!
+     * \brief cacheFileName
+     * A file name identifying the media content: a hash of the file size, the head and the tail of file.
+     * Empty if media is not a local file.
+     */
+    static QString cacheFileName(const QString& media);
+private:
+    void mergeRun();
+
+    typedef QPair<qint64, qint64> Range;
+    QVector<Entry> m_entries; // sorted by pts
+    QVector<Range> m_ranges; // covered ranges. sorted, no overlap
+    qint64 m_run_start, m_run_end; // the current run. start is the 1st key frame, <0: no key frame read yet
+    qint64 m_last_key; // the last key frame in the current run
+    qint64 m_max_gop;
+    bool m_modified;
+};
+} //namespace QtAV
+#endif //QTAV_KEYFRAMEINDEX_H
@@ -20,6 +20,9 @@
 ******************************************************************************/
 
 #include "QtAV/Packet.h"
+#include <limits.h>
+#include <string.h>
+#include "PacketPool.h"
 #include "QtAV/private/AVCompat.h"
 #include "utils/Logger.h"
 
@@ -38,12 +41,28 @@ public:
     PacketPrivate()
         : QSharedData()
         , initialized(false)
+        , pts_ticks(0)
+        , dts_ticks(0)
+        , duration_ticks(0)
+        , tb_num(0)
+        , tb_den(0)
+        , pts(0)
+        , dts(0)
+        , duration(0)
     {
         av_init_packet(&avpkt);
     }
     PacketPrivate(const PacketPrivate& o)
         : QSharedData(o)
         , initialized(o.initialized)
+        , pts_ticks(o.pts_ticks)
+        , dts_ticks(o.dts_ticks)
+        , duration_ticks(o.duration_ticks)
+        , tb_num(o.tb_num)
+        , tb_den(o.tb_den)
+        , pts(o.pts)
+        , dts(o.dts)
+        , duration(o.duration)
     { //used by QSharedDataPointer.detach()
         av_init_packet(&avpkt);
         av_packet_ref(&avpkt, (AVPacket*)&o.avpkt);
@@ -51,8 +70,18 @@ public:
      ~PacketPrivate() {
         av_packet_unref(&avpkt);
     }
+    // storage is from a PacketPool if allocated by new(pool), otherwise from heap. delete works for both
+    static void* operator new(size_t size) { return PacketPool::allocStorage(0, size);}
+    static void* operator new(size_t size, PacketPool* pool) { return PacketPool::allocStorage(pool, size);}
+    static void operator delete(void* p) { PacketPool::freeStorage(p);}
+    static void operator delete(void* p, PacketPool*) { PacketPool::freeStorage(p);}
     bool initialized;
     AVPacket avpkt;
+    // exact timestamps in stream time base tb_num/tb_den. tb_den is 0 if not available
+    qint64 pts_ticks, dts_ticks, duration_ticks;
+    int tb_num, tb_den;
+    // Packet.pts/dts/duration when the ticks are set. ticks of a value are valid only if Packet's value is not modified
+    qreal pts, dts, duration;
 };
 
 Packet Packet::createEOF()
@@ -75,12 +104,30 @@ Packet Packet::fromAVPacket(const AVPacket *avpkt, double time_base)
     return Packet();
 }
 
-// time_base: av_q2d(format_context->streams[stream_idx]->time_base)
-bool Packet::fromAVPacket(Packet* pkt, const AVPacket *avpkt, double time_base)
+// set the exact timestamps in d and the derived qreal views in pkt
+static void setTicks(Packet *pkt, PacketPrivate *d, qint64 pts, qint64 dts, qint64 duration, int num, int den)
 {
-    if (!pkt || !avpkt)
-        return false;
+    // qreal values are derived views
+    const AVRational tb = { num, den };
+    const double t = av_q2d(tb);
+    d->pts = pkt->pts = pts * t;
+    d->dts = pkt->dts = dts * t;
+    d->duration = pkt->duration = duration * t;
+    d->pts_ticks = pts;
+    d->dts_ticks = dts;
+    d->duration_ticks = duration;
+    d->tb_num = num;
+    d->tb_den = den;
+    if (d->tb_den <= 0) { // invalid time base. keep qreal values only
+        d->tb_num = 0;
+        d->tb_den = 0;
+    }
+}
 
+// time_base: format_context->streams[stream_idx]->time_base
+// set the properties from avpkt. data is not touched. d must be newly created
+static void setProperties(Packet* pkt, PacketPrivate *d, const AVPacket *avpkt, const AVRational& time_base)
+{
     pkt->position = avpkt->pos;
     pkt->hasKeyFrame = !!(avpkt->flags & AV_PKT_FLAG_KEY);
     // what about marking avpkt as invalid and do not use isCorrupt?
@@ -90,25 +137,22 @@ bool Packet::fromAVPacket(Packet* pkt, const AVPacket *avpkt, double time_base)
 
     // from av_read_frame: pkt->pts can be AV_NOPTS_VALUE if the video format has B-frames, so it is better to rely on pkt->dts if you do not decompress the payload.
     // old code set pts as dts is valid
+    qint64 pts = 0; // TODO: init value
     if (avpkt->pts != (qint64)AV_NOPTS_VALUE)
-        pkt->pts = avpkt->pts * time_base;
+        pts = avpkt->pts;
     else if (avpkt->dts != (qint64)AV_NOPTS_VALUE) // is it ok?
-        pkt->pts = avpkt->dts * time_base;
-    else
-        pkt->pts = 0; // TODO: init value
+        pts = avpkt->dts;
+    qint64 dts = pts;
     if (avpkt->dts != (qint64)AV_NOPTS_VALUE) //has B-frames
-        pkt->dts = avpkt->dts * time_base;
-    else
-        pkt->dts = pkt->pts;
+        dts = avpkt->dts;
     //qDebug("avpacket pts %lld, dts: %lld ", avpkt->pts, avpkt->dts);
     //TODO: pts must >= 0? look at ffplay
-    pkt->pts = qMax<qreal>(0, pkt->pts);
-    pkt->dts = qMax<qreal>(0, pkt->dts);
+    pts = qMax<qint64>(0, pts);
+    dts = qMax<qint64>(0, dts);
 
+    qint64 duration = 0;
     if (avpkt->duration > 0)
-        pkt->duration = avpkt->duration * time_base;
-    else
-        pkt->duration = 0;
+        duration = avpkt->duration;
 #if (LIBAVCODEC_VERSION_MAJOR < 57) //FF_API_CONVERGENCE_DURATION since 57
     // subtitle always has a key frame? convergence_duration may be 0
     if (avpkt->convergence_duration > 0
@@ -117,22 +161,49 @@ bool Packet::fromAVPacket(Packet* pkt, const AVPacket *avpkt, double time_base)
             && codec->codec_type == AVMEDIA_TYPE_SUBTITLE
 #endif
             )
-        pkt->duration = avpkt->convergence_duration * time_base;
+        duration = avpkt->convergence_duration;
 #endif
+    setTicks(pkt, d, pts, dts, duration, time_base.num, time_base.den);
     //qDebug("AVPacket.pts=%f, duration=%f, dts=%lld", pkt->pts, pkt->duration, packet.dts);
+}
+
+static AVRational timeBaseFromDouble(double time_base)
+{
+    return av_d2q(time_base, INT_MAX);
+}
+
+// rescale exact ticks to us without going through floating point. seconds is used if no ticks or it's modified
+static qint64 ticksToUs(const PacketPrivate *d, qint64 ticks, qreal seconds, qreal view)
+{
+    if (!d || d->tb_den <= 0 || seconds != view)
+        return qRound64(seconds*1000000.0);
+    const AVRational tb = { d->tb_num, d->tb_den };
+    return av_rescale_q(ticks, tb, AV_TIME_BASE_Q);
+}
+
+// p: the AVPacket in pkt->d. QtAV always use us (AV_TIME_BASE) and s. As a result no time_base is required by decoders and muxer
+static void setAVPacketTimestamps(AVPacket *p, const Packet *pkt)
+{
+    p->pts = pkt->ptsUs();
+    p->dts = pkt->dtsUs();
+    p->duration = pkt->durationUs();
+}
+
+bool Packet::fromAVPacket(Packet* pkt, const AVPacket *avpkt, double time_base)
+{
+    if (!pkt || !avpkt)
+        return false;
     pkt->data.clear();
     // TODO: pkt->avpkt. data is not necessary now. see mpv new_demux_packet_from_avpacket
     // copy properties and side data. does not touch data, size and ref
     pkt->d = QSharedDataPointer<PacketPrivate>(new PacketPrivate());
     pkt->d->initialized = true;
+    setProperties(pkt, pkt->d.data(), avpkt, timeBaseFromDouble(time_base));
     AVPacket *p = &pkt->d->avpkt;
     av_packet_ref(p, (AVPacket*)avpkt);  //properties are copied internally
     // add ref without copy, bytearray does not copy either. bytearray options linke remove() is safe. omit FF_INPUT_BUFFER_PADDING_SIZE
     pkt->data = QByteArray::fromRawData((const char*)p->data, p->size);
-    // QtAV always use ms (1/1000s) and s. As a result no time_base is required in Packet
-    p->pts = pkt->pts * 1000.0;
-    p->dts = pkt->dts * 1000.0;
-    p->duration = pkt->duration * 1000.0;
+    setAVPacketTimestamps(p, pkt);
     return true;
 }
 
@@ -182,8 +253,14 @@ const AVPacket *Packet::asAVPacket() const
 {
     if (d.constData()) { //why d->initialized (ref==1) result in detach?
         if (d.constData()->initialized) {//d.data() was 0 if d has not been accessed. now only contains avpkt, check d.constData() is engough
+            // d is shared by packet copies (demuxer, queue, decoder). d-> detaches and copies the packet, avoid it if nothing changed
+            const AVPacket *cp = &d.constData()->avpkt;
+            if (cp->data == (const uint8_t*)data.constData() && cp->size == data.size()
+                    && cp->pts == ptsUs() && cp->dts == dtsUs() && cp->duration == durationUs())
+                return cp;
             d->avpkt.data = (uint8_t*)data.constData();
             d->avpkt.size = data.size();
+            setAVPacketTimestamps(&d->avpkt, this);
             return &d->avpkt;
         }
     } else {
@@ -192,9 +269,7 @@ const AVPacket *Packet::asAVPacket() const
 
     d->initialized = true;
     AVPacket *p = &d->avpkt;
-    p->pts = pts * 1000.0;
-    p->dts = dts * 1000.0;
-    p->duration = duration * 1000.0;
+    setAVPacketTimestamps(p, this);
     p->pos = position;
     if (isCorrupt)
         p->flags |= AV_PKT_FLAG_CORRUPT;
@@ -213,12 +288,193 @@ void Packet::skip(int bytes)
         d = QSharedDataPointer<PacketPrivate>(new PacketPrivate());
     }
     d->initialized = false;
+    d->tb_num = d->tb_den = 0; // pts etc. will be modified by user
     data = QByteArray::fromRawData(data.constData() + bytes, data.size() - bytes);
     if (position >= 0)
         position += bytes;
     // TODO: if duration is valid, compute pts/dts and no manually update outside?
 }
 
+qint64 Packet::ptsUs() const
+{
+    const PacketPrivate *p = d.constData();
+    return ticksToUs(p, p ? p->pts_ticks : 0, pts, p ? p->pts : 0);
+}
+
+qint64 Packet::dtsUs() const
+{
+    const PacketPrivate *p = d.constData();
+    return ticksToUs(p, p ? p->dts_ticks : 0, dts, p ? p->dts : 0);
+}
+
+qint64 Packet::durationUs() const
+{
+    const PacketPrivate *p = d.constData();
+    return ticksToUs(p, p ? p->duration_ticks : 0, duration, p ? p->duration : 0);
+}
+
+bool Packet::hasExactTimestamps() const
+{
+    const PacketPrivate *p = d.constData();
+    return p && p->tb_den > 0 && pts == p->pts && dts == p->dts && duration == p->duration;
+}
+
+qint64 Packet::ptsTicks() const
+{
+    return d.constData() ? d.constData()->pts_ticks : 0;
+}
+
+qint64 Packet::dtsTicks() const
+{
+    return d.constData() ? d.constData()->dts_ticks : 0;
+}
+
+qint64 Packet::durationTicks() const
+{
+    return d.constData() ? d.constData()->duration_ticks : 0;
+}
+
+int Packet::timeBaseNum() const
+{
+    return d.constData() ? d.constData()->tb_num : 0;
+}
+
+int Packet::timeBaseDen() const
+{
+    return d.constData() ? d.constData()->tb_den : 0;
+}
+
+void Packet::setExactTimestamps(qint64 pts_ticks, qint64 dts_ticks, qint64 duration_ticks, int num, int den)
+{
+    if (!d.constData())
+        d = QSharedDataPointer<PacketPrivate>(new PacketPrivate());
+    setTicks(this, d.data(), pts_ticks, dts_ticks, duration_ticks, num, den);
+}
+
+namespace {
+// header of a storage block. keep the alignment of malloc
+typedef union {
+    PacketPool *pool;
+    double d;
+    qint64 i;
+} StorageHeader;
+static const int kMaxFreeStorages = 256;
+} //namespace
+
+PacketPool* PacketPool::create()
+{
+    return new PacketPool();
+}
+
+PacketPool::PacketPool()
+    : m_ref(1)
+{
+    memset(&m_stat, 0, sizeof(m_stat));
+}
+
+PacketPool::~PacketPool()
+{
+    foreach (void* p, m_storage) {
+        free(p);
+    }
+}
+
+void PacketPool::ref()
+{
+    m_ref.ref();
+}
+
+void PacketPool::deref()
+{
+    if (!m_ref.deref())
+        delete this;
+}
+
+PacketPool::Statistics PacketPool::statistics() const
+{
+    QMutexLocker lock(&m_mutex);
+    Q_UNUSED(lock);
+    Statistics st = m_stat;
+    st.free = m_storage.size();
+    return st;
+}
+
+// only PacketPrivate is allocated from pool, so all blocks have the same size
+void* PacketPool::allocStorage(PacketPool *pool, size_t size)
+{
+    void *p = 0;
+    if (pool) {
+        QMutexLocker lock(&pool->m_mutex);
+        Q_UNUSED(lock);
+        if (!pool->m_storage.isEmpty()) {
+            p = pool->m_storage.last();
+            pool->m_storage.pop_back();
+            pool->m_stat.hits++;
+        } else {
+            pool->m_stat.misses++;
+        }
+        pool->ref(); // released in freeStorage()
+    }
+    if (!p)
+        p = malloc(sizeof(StorageHeader) + size);
+    Q_CHECK_PTR(p);
+    StorageHeader *h = (StorageHeader*)p;
+    h->pool = pool;
+    return h + 1;
+}
+
+void PacketPool::freeStorage(void *p)
+{
+    if (!p)
+        return;
+    StorageHeader *h = (StorageHeader*)p - 1;
+    PacketPool *pool = h->pool;
+    if (!pool) {
+        free(h);
+        return;
+    }
+    {
+        QMutexLocker lock(&pool->m_mutex);
+        Q_UNUSED(lock);
+        if (pool->m_storage.size() < kMaxFreeStorages) {
+            pool->m_storage.append(h);
+            h = 0;
+        }
+    }
+    if (h)
+        free(h);
+    pool->deref();
+}
+
+bool PacketPool::fromAVPacket(Packet *pkt, AVPacket *avpkt, const AVRational& time_base)
+{
+    if (!pkt || !avpkt)
+        return false;
+    pkt->data.clear();
+    pkt->d = QSharedDataPointer<PacketPrivate>(new (this) PacketPrivate());
+    pkt->d->initialized = true;
+    setProperties(pkt, pkt->d.data(), avpkt, time_base);
+    AVPacket *p = &pkt->d->avpkt;
+#if QTAV_HAVE(AVBUFREF)
+    if (avpkt->buf) { // move the reference. av_packet_move_ref() is not available in old versions
+        *p = *avpkt;
+        av_init_packet(avpkt);
+        avpkt->buf = 0;
+        avpkt->data = 0;
+        avpkt->size = 0;
+    } else {
+        av_packet_ref(p, avpkt);
+        av_packet_unref(avpkt);
+    }
+#else
+    av_packet_ref(p, avpkt);
+    av_packet_unref(avpkt);
+#endif //QTAV_HAVE(AVBUFREF)
+    pkt->data = QByteArray::fromRawData((const char*)p->data, p->size);
+    setAVPacketTimestamps(p, pkt);
+    return true;
+}
+
 #ifndef QT_NO_DEBUG_STREAM
 QDebug operator<<(QDebug dbg, const Packet &pkt)
 {
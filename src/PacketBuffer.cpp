@@ -21,18 +21,26 @@
 
 #include "PacketBuffer.h"
 #include <QtCore/QDateTime>
+#include "Statistics_p.h"
 
 namespace QtAV {
 static const int kAvgSize = 16;
+// hard limit of packets. far more than the buffer max of common streams
+static const int kMaxPackets = 16384;
 PacketBuffer::PacketBuffer()
     : m_mode(BufferTime)
-    , m_buffering(true) // in buffering state at the beginning
+    , m_buffering(1) // in buffering state at the beginning
     , m_max(1.5)
     , m_buffer(0)
     , m_value0(0)
     , m_value1(0)
+    , m_queued0(0)
+    , m_queued_bytes(0)
     , m_history(kAvgSize)
+    , m_counters(0)
+    , m_stream(0)
 {
+    setMaxSize(kMaxPackets);
 }
 
 PacketBuffer::~PacketBuffer()
@@ -41,16 +49,7 @@ PacketBuffer::~PacketBuffer()
 
 void PacketBuffer::setBufferMode(BufferMode mode)
 {
-    m_mode = mode;
-    if (queue.isEmpty()) {
-        m_value0 = m_value1 = 0;
-        return;
-    }
-    if (m_mode == BufferTime) {
-        m_value0 = qint64(queue[0].pts*1000.0);
-    } else {
-        m_value0 = 0;
-    }
+    m_mode = mode; // values are recomputed in the next put()
 }
 
 BufferMode PacketBuffer::bufferMode() const
@@ -84,13 +83,14 @@ qreal PacketBuffer::bufferMax() const
 
 qint64 PacketBuffer::buffered() const
 {
-    Q_ASSERT(m_value1 >= m_value0);
-    return m_value1 - m_value0;
+    if (isEmpty())
+        return 0;
+    return qMax<qint64>(0, m_value1 - m_value0);
 }
 
 bool PacketBuffer::isBuffering() const
 {
-    return m_buffering;
+    return spsc::loadAcquire(m_buffering);
 }
 
 qreal PacketBuffer::bufferProgress() const
@@ -111,32 +111,65 @@ qreal PacketBuffer::bufferSpeedInBytes() const
 
 bool PacketBuffer::checkEnough() const
 {
+    update();
     return buffered() >= bufferValue();
 }
 
 bool PacketBuffer::checkFull() const
 {
+    update();
     return buffered() >= qint64(qreal(bufferValue())*bufferMax());
 }
 
-void PacketBuffer::onPut(const Packet &p)
+void PacketBuffer::update() const
 {
+    const int taken = m_queue.popped();
+    while (!m_queued.isEmpty() && taken - m_queued0 > 0) {
+        m_queued_bytes -= m_queued.dequeue().bytes;
+        ++m_queued0;
+    }
+    if (m_queued.isEmpty()) {
+        m_queued0 = taken;
+        m_queued_bytes = 0;
+        m_value0 = m_value1 = 0;
+        return;
+    }
     if (m_mode == BufferTime) {
-        m_value1 = qint64(p.pts*1000.0); // FIXME: what if no pts
-        m_value0 = qint64(queue[0].pts*1000.0); // must compute here because it is reset to 0 if take from empty
+        m_value0 = m_queued.head().pts;
+        m_value1 = m_queued.last().pts;
         //if (isBuffering())
           //  qDebug("+buffering progress: %.1f%%=%.1f/%.1f~%.1fs %d-%d", bufferProgress()*100.0, (qreal)buffered()/1000.0, (qreal)bufferValue()/1000.0, qreal(bufferValue())*bufferMax()/1000.0, m_value1, m_value0);
     } else if (m_mode == BufferBytes) {
-        m_value1 += p.data.size();
+        m_value0 = 0;
+        m_value1 = m_queued_bytes;
     } else {
-        m_value1++;
+        m_value0 = 0;
+        m_value1 = m_queued.size();
     }
-    if (!m_buffering)
+}
+
+void PacketBuffer::setCounters(Statistics::Counters *counters, int stream)
+{
+    m_counters = counters;
+    m_stream = stream;
+}
+
+void PacketBuffer::onPut(const Packet &p)
+{
+    if (m_counters)
+        m_counters->packetPut(Statistics::Counters::Stream(m_stream), size(), p.data.size(), p.isValid() ? p.dtsUs() : -1LL);
+    PacketInfo pi;
+    pi.pts = p.ptsUs()/1000LL; // FIXME: what if no pts
+    pi.bytes = p.data.size();
+    m_queued.enqueue(pi);
+    m_queued_bytes += pi.bytes;
+    if (!isBuffering()) {
+        update();
         return;
-    if (checkEnough()) {
-        m_buffering = false;
     }
-    if (!m_buffering) { //buffering=>buffered
+    if (checkEnough()) {
+        spsc::storeRelease(m_buffering, 0);
+        //buffering=>buffered
         m_history = ring<BufferInfo>(kAvgSize);
         return;
     }
@@ -151,23 +184,11 @@ void PacketBuffer::onPut(const Packet &p)
 
 void PacketBuffer::onTake(const Packet &p)
 {
+    if (m_counters)
+        m_counters->packetTaken(Statistics::Counters::Stream(m_stream), size(), p.data.size());
+    // buffered values are updated in demux thread because they depend on the packets put
     if (checkEmpty()) {
-        m_buffering = true;
-    }
-    if (queue.isEmpty()) {
-        m_value0 = 0;
-        m_value1 = 0;
-        return;
-    }
-    if (m_mode == BufferTime) {
-        m_value0 = qint64(queue[0].pts*1000.0);
-        //if (isBuffering())
-          //  qDebug("-buffering progress: %.1f=%.1f/%.1fs", bufferProgress(), (qreal)buffered()/1000.0, (qreal)bufferValue()/1000.0);
-    } else if (m_mode == BufferBytes) {
-        m_value1 -= p.data.size();
-        m_value1 = qMax<qint64>(0LL, m_value1);
-    } else {
-        m_value1--;
+        spsc::storeRelease(m_buffering, 1);
     }
 }
 
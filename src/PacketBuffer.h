@@ -24,7 +24,9 @@
 
 #include <QtCore/QQueue>
 #include <QtAV/Packet.h>
+#include <QtAV/Statistics.h>
 #include "utils/BlockingQueue.h"
+#include "utils/SPSCQueue.h"
 #include "utils/ring.h"
 
 namespace QtAV {
@@ -34,8 +36,13 @@ namespace QtAV {
  * take enough: start to put more packets
  * put enough: end buffering, end take block
  * put full: stop putting more packets
+ *
+ * Packets are put in demux thread and taken in AVThread. Buffered time/bytes/packets are computed in the demux thread
+ * from the packets still in queue, so no lock is required on put() and take().
+ * The full state depends on the buffer mode and value. The number of packets is also limited by maxSize() in case the full
+ * state is ignored (blockFull(false)) because a consumer is not running, e.g. the queue of a video stream without a video thread.
  */
-class PacketBuffer : public BlockingQueue<Packet, QQueue>
+class PacketBuffer : public BlockingSPSCQueue<Packet>
 {
 public:
     PacketBuffer();
@@ -77,13 +84,19 @@ public:
      */
     qreal bufferSpeed() const;
     qreal bufferSpeedInBytes() const;
+    /*!
+     * \brief setCounters
+     * Queue depth and bit rate are also updated in the counters. Call it before packets are put.
+     * \param stream Statistics::Counters::Stream
+     */
+    void setCounters(Statistics::Counters* counters, int stream);
 protected:
     bool checkEnough() const Q_DECL_OVERRIDE;
     bool checkFull() const Q_DECL_OVERRIDE;
     void onTake(const Packet &) Q_DECL_OVERRIDE;
     void onPut(const Packet &) Q_DECL_OVERRIDE;
 protected:
-    typedef BlockingQueue<Packet, QQueue> PQ;
+    typedef BlockingSPSCQueue<Packet> PQ;
     using PQ::setCapacity;
     using PQ::setThreshold;
     using PQ::capacity;
@@ -91,19 +104,32 @@ protected:
 
 private:
     qreal calc_speed(bool use_bytes) const;
+    // remove taken packets from m_queued and update m_value0, m_value1. called in demux thread
+    void update() const;
 
     BufferMode m_mode;
-    bool m_buffering;
+    QAtomicInt m_buffering;
     qreal m_max;
     // bytes or count
     qint64 m_buffer;
-    qint64 m_value0, m_value1;
+    // demux thread writes, others read
+    mutable qint64 m_value0, m_value1;
+    // packets in queue in demux thread's view. index of the 1st one is m_queued0
+    typedef struct {
+        qint64 pts; // ms
+        int bytes;
+    } PacketInfo;
+    mutable QQueue<PacketInfo> m_queued;
+    mutable int m_queued0;
+    mutable qint64 m_queued_bytes;
     typedef struct {
         qint64 v; //pts, total packes or total bytes
         qint64 bytes; //total bytes
         qint64 t;
     } BufferInfo;
     ring<BufferInfo> m_history;
+    Statistics::Counters *m_counters;
+    int m_stream;
 };
 
 } //namespace QtAV
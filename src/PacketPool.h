@@ -0,0 +1,75 @@
+/******************************************************************************
+    QtAV:  Multimedia framework based on Qt and FFmpeg
+    Copyright (C) 2012-2017 Wang Bin <wbsecg1@gmail.com>
+
+*   This file is part of QtAV (from 2017)
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+******************************************************************************/
+
+#ifndef QTAV_PACKETPOOL_H
+#define QTAV_PACKETPOOL_H
+
+#include <QtCore/QAtomicInt>
+#include <QtCore/QMutex>
+#include <QtCore/QVector>
+#include <QtAV/Packet.h>
+
+struct AVPacket;
+struct AVRational;
+namespace QtAV {
+/*!
+ * \brief The PacketPool class
+ * Recycles Packet storage: the private data of Packet (which contains an AVPacket).
+ * Payload buffers are not pooled. av_read_frame() returns reference counted packets allocated by the demuxer,
+ * their references are moved to Packet without copy.
+ * A demuxer owns a pool, every packet allocated from the pool holds a reference, so packets can outlive the demuxer.
+ * Allocation is in demux thread, release can be in any thread.
+ */
+class PacketPool
+{
+public:
+    typedef struct {
+        qint64 hits; // Packet storage reused
+        qint64 misses; // Packet storage allocated
+        int free; // Packet storages in pool
+    } Statistics;
+
+    static PacketPool* create(); // the reference count is 1
+    void ref();
+    void deref(); // delete if reference count becomes 0
+    /*!
+     * \brief fromAVPacket
+     * The same as Packet::fromAVPacket() but takes the ownership of avpkt data instead of adding a new reference if avpkt is reference counted,
+     * otherwise data is copied. avpkt is reset.
+     * time_base is the exact stream time base, Packet keeps the integer timestamps in it.
+     */
+    bool fromAVPacket(Packet *pkt, AVPacket *avpkt, const AVRational& time_base);
+    Statistics statistics() const;
+
+    // storage of PacketPrivate. pool can be null
+    static void* allocStorage(PacketPool* pool, size_t size);
+    static void freeStorage(void *p);
+private:
+    PacketPool();
+    ~PacketPool();
+
+    QAtomicInt m_ref;
+    mutable QMutex m_mutex;
+    QVector<void*> m_storage; // free storage blocks
+    Statistics m_stat;
+};
+} //namespace QtAV
+#endif //QTAV_PACKETPOOL_H
@@ -24,7 +24,6 @@
 
 #include <QtAV/QtAV_Global.h>
 #include <QtCore/QAtomicInt>
-#include <QtCore/QBasicTimer>
 #include <QtCore/QObject>
 #if QT_VERSION >= QT_VERSION_CHECK(4, 7, 0)
 #include <QtCore/QElapsedTimer>
@@ -38,10 +37,13 @@ typedef QTime QElapsedTimer;
  * The default clock type is Audio's clock, i.e. vedio synchronizes to audio. If audio stream is not
  * detected, then the clock will set to External clock automatically.
  * I name it ExternalClock because the clock can be corrected outside, though it is a clock inside AVClock
+ * Time values are stored as integer microseconds. The external clock is anchored to a monotonic timer, so no error accumulates
+ * no matter how long it runs. The double (seconds) api is derived from the microsecond api.
  */
 namespace QtAV {
 
 static const double kThousandth = 0.001;
+static const double kMillionth = 0.000001;
 
 class Q_AV_EXPORT AVClock : public QObject
 {
@@ -64,6 +66,8 @@ public:
      */
     void setInitialValue(double v);
     double initialValue() const;
+    void setInitialValueUs(qint64 us);
+    qint64 initialValueUs() const;
     /*
      * auto clock: use audio clock if audio stream found, otherwise use external clock
      */
@@ -88,6 +92,17 @@ public:
     inline double delay() const; //playing audio spends some time
     inline void updateDelay(double delay);
     inline qreal diff() const;
+    /*!
+     * microsecond api. the master clock value
+     */
+    inline qint64 ptsUs() const;
+    qint64 valueUs() const;
+    inline void updateValueUs(qint64 us);
+    void updateExternalClockUs(qint64 us);
+    inline void updateVideoTimeUs(qint64 us);
+    inline qint64 videoTimeUs() const;
+    inline qint64 delayUs() const;
+    inline void updateDelayUs(qint64 us);
 
     void setSpeed(qreal speed);
     inline qreal speed() const;
@@ -125,84 +140,92 @@ public Q_SLOTS:
     /*reset clock intial value and external clock parameters (and stop timer). keep speed() and isClockAuto()*/
     void reset();
 
-protected:
-    virtual void timerEvent(QTimerEvent *event);
-private Q_SLOTS:
-    /// make sure QBasic timer start/stop in a right thread
-    void restartCorrectionTimer();
-    void stopCorrectionTimer();
 private:
+    // pts_ + elapsed time since the timer started (the anchor). external clock only
+    qint64 externalPtsUs() const;
+    // restart the timer and move elapsed time into pts_
+    void anchor();
+
     bool auto_clock;
     int m_state;
     ClockType clock_type;
-    mutable double pts_;
-    mutable double pts_v;
-    double delay_;
-    mutable QElapsedTimer timer;
+    // all in us
+    qint64 pts_;
+    qint64 pts_v;
+    qint64 delay_;
+    QElapsedTimer timer;
     qreal mSpeed;
-    double value0;
-    /*!
-     * \brief correction_schedule_timer
-     * accumulative error is too large using QElapsedTimer.restart() frequently.
-     * we periodically correct value() to keep the error always less
-     * than the error of calling QElapsedTimer.restart() once
-     * see github issue 46, 307 etc
-     */
-    QBasicTimer correction_schedule_timer;
-    qint64 t; // absolute time for elapsed timer correction
-    static const int kCorrectionInterval = 1; // 1000ms
-    double last_pts;
-    double avg_err; // average error of restart()
-    mutable int nb_restarted;
+    qint64 value0;
     QAtomicInt nb_sync;
     int sync_id;
 };
 
+double AVClock::pts() const
+{
+    return double(ptsUs())*kMillionth;
+}
+
 double AVClock::value() const
 {
-    if (clock_type == AudioClock) {
-        // TODO: audio clock need a timer too
-        // timestamp from media stream is >= value0
-        return pts_ == 0 ? value0 : pts_ + delay_;
-    } else if (clock_type == ExternalClock) {
-        if (timer.isValid()) {
-            ++nb_restarted;
-            pts_ += (double(timer.restart()) * kThousandth + avg_err)* speed();
-        } else {//timer is paused
-            //qDebug("clock is paused. return the last value %f", pts_);
-        }
-        return pts_ + value0;
-    } else {
-        return pts_v; // value0 is 1st video pts_v already
-    }
+    return double(valueUs())*kMillionth;
 }
 
 void AVClock::updateValue(double pts)
 {
-    if (clock_type == AudioClock)
-        pts_ = pts;
+    updateValueUs(qRound64(pts*1000000.0));
 }
 
 void AVClock::updateVideoTime(double pts)
 {
-    pts_v = pts;
+    updateVideoTimeUs(qRound64(pts*1000000.0));
+}
+
+double AVClock::videoTime() const
+{
+    return double(videoTimeUs())*kMillionth;
+}
+
+double AVClock::delay() const
+{
+    return double(delayUs())*kMillionth;
+}
+
+void AVClock::updateDelay(double delay)
+{
+    updateDelayUs(qRound64(delay*1000000.0));
+}
+
+qint64 AVClock::ptsUs() const
+{
+    return pts_;
+}
+
+void AVClock::updateValueUs(qint64 us)
+{
+    if (clock_type == AudioClock)
+        pts_ = us;
+}
+
+void AVClock::updateVideoTimeUs(qint64 us)
+{
+    pts_v = us;
     if (clock_type == VideoClock)
         timer.restart();
 }
 
-double AVClock::videoTime() const
+qint64 AVClock::videoTimeUs() const
 {
     return pts_v;
 }
 
-double AVClock::delay() const
+qint64 AVClock::delayUs() const
 {
     return delay_;
 }
 
-void AVClock::updateDelay(double delay)
+void AVClock::updateDelayUs(qint64 us)
 {
-    delay_ = delay;
+    delay_ = us;
 }
 
 qreal AVClock::diff() const
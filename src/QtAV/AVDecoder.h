@@ -52,8 +52,29 @@ public:
     void* codecContext() const;
     /*not available if AVCodecContext == 0*/
     bool isAvailable() const;
+    /*!
+     * \brief decode
+     * Decode a packet and get at most 1 frame, use frame() of VideoDecoder/AudioDecoder to get it.
+     * For avcodec based decoders it's a compatible wrapper of sendPacket() + receiveFrame(). If a packet produces more than 1 frame,
+     * undecodedSize() is > 0 and the others are returned in the next decode() calls with the rest of the packet (Packet::skip()),
+     * the packet is not decoded again. If a different packet is decoded instead, the remaining frames are dropped.
+     */
     virtual bool decode(const Packet& packet) = 0;
     int undecodedSize() const; //TODO: remove. always decode whole input data completely
+    /*!
+     * \brief sendPacket
+     * Send a packet to decoder. A packet can produce 0, 1 or more frames, call receiveFrame() until it returns false to get all of them.
+     * Send an EOF packet(Packet::createEOF()) to drain the decoder. flush() to decode new packets after drained.
+     * The default implementation calls decode(), so at most 1 frame will be produced.
+     * \return false if error occured
+     */
+    virtual bool sendPacket(const Packet& packet);
+    /*!
+     * \brief receiveFrame
+     * Take the next decoded frame. Then frame() of VideoDecoder/AudioDecoder returns it.
+     * \return false if no more frame, i.e. need more packets or decoder is drained
+     */
+    virtual bool receiveFrame();
 
     // avcodec_open2
     /*!
@@ -119,6 +119,26 @@ public:
      * TODO: what if duration() is not valid but size is known?
      */
     bool seek(qreal q);
+    /*!
+     * \brief keyFrameBefore
+     * Key frames of the video stream are indexed while reading packets. Seeking backward (including AccurateSeek) to a
+     * position in an indexed range goes to the exact key frame, even if the container index is bad or missing.
+     * \return the nearest video key frame position (ms) <= pos, or -1 if it's not indexed yet
+     */
+    qint64 keyFrameBefore(qint64 pos) const;
+    /*!
+     * \brief maxGopDuration
+     * The longest interval between 2 consecutive video key frames read. 0 if unknown
+     */
+    qint64 maxGopDuration() const;
+    /*!
+     * \brief setKeyFrameIndexCacheDir
+     * If not empty, key frame index of local files is loaded from and saved to cache files in dir. A cache file is named by
+     * the hash of media content, so renamed or copied files share the cache. Default is empty, the index is only kept in memory.
+     * It applies to all demuxers.
+     */
+    static void setKeyFrameIndexCacheDir(const QString& dir);
+    static QString keyFrameIndexCacheDir();
     AVFormatContext* formatContext();
     QString formatName() const;
     QString formatLongName() const;
@@ -189,6 +209,12 @@ public:
      */
     void setOptions(const QVariantHash &dict);
     QVariantHash options() const;
+    /*!
+     * \brief packetPoolStatistics
+     * Packets read by the demuxer are allocated from a pool owned by the demuxer.
+     * \return "hits"/"misses": packet storages reused/allocated, "free": storages in the pool
+     */
+    QVariantHash packetPoolStatistics() const;
     qint64 clock();
     void setOptionsForIOCodec(const QVariantHash& dict);
 Q_SIGNALS:
@@ -33,6 +33,7 @@
 namespace QtAV {
 
 class MediaIO;
+class AVDemuxer;
 class VideoEncoder;
 class AudioEncoder;
 class Q_AV_EXPORT AVMuxer : public QObject
@@ -71,9 +72,15 @@ public:
     bool close();
     bool isOpen() const;
 
-    // TODO: copyAudioContext(void* avctx) for copy encoding without decoding
     void copyProperties(VideoEncoder* enc); //rename to setEncoder
     void copyProperties(AudioEncoder* enc);
+    /*!
+     * \brief copyProperties
+     * Stream copy without encoding. If no encoder is set for video/audio, an output stream is created for the current
+     * video/audio stream of demuxer with the same codec parameters, then demuxed packets can be written directly.
+     * demuxer must be loaded before open(), and is not used after open().
+     */
+    void copyProperties(AVDemuxer* demuxer);
 
     void setOptions(const QVariantHash &dict);
     QVariantHash options() const;
@@ -310,6 +310,14 @@ public:
      */
     void setSpeed(qreal speed);
     qreal speed() const;
+    /*!
+     * \brief setPitchCompensation
+     * If true, audio tempo is changed by time stretching and the pitch is kept when speed() is not 1.0.
+     * If false, audio is resampled and the pitch changes with the speed.
+     * Default is true.
+     */
+    void setPitchCompensation(bool value);
+    bool pitchCompensation() const;
 
     /*!
      * \brief setInterruptTimeout
@@ -335,7 +343,18 @@ public:
      */
     void setFrameRate(qreal value);
     qreal forcedFrameRate() const;
+    /*!
+     * \brief setVideoDecodeAhead
+     * Video frames can be decoded before they are presented, so decoding time spikes (e.g. a large key frame) will not make the frame late.
+     * \param frames max decoded frames waiting for presentation. <=1: decode and present one by one. Default is 3.
+     * Frames not in host memory (hardware decoder zero copy) are never queued more than 1.
+     * \param bytes max bytes of decoded frames waiting for presentation. <=0: no limit
+     */
+    void setVideoDecodeAhead(int frames, qint64 bytes = 0);
+    int videoDecodeAheadFrames() const;
+    qint64 videoDecodeAheadBytes() const;
     //Statistics& statistics();
+    /// statistics().metrics() is updated while playing, and can be polled without lock
     const Statistics& statistics() const;
     /*!
      * \brief installFilter
@@ -25,10 +25,12 @@
 #include <QtAV/MediaIO.h>
 #include <QtAV/AudioEncoder.h>
 #include <QtAV/VideoEncoder.h>
+#include <QtCore/QStringList>
 
 namespace QtAV {
 
 class AVPlayer;
+class Filter;
 class Q_AV_EXPORT AVTranscoder : public QObject
 {
     Q_OBJECT
@@ -39,6 +41,37 @@ public:
     // TODO: other source (more operations needed, e.g. seek)?
     void setMediaSource(AVPlayer* player);
     AVPlayer* sourcePlayer() const;
+    /*!
+     * \brief setMediaSource
+     * Transcode a media file without a player. Demuxing, decoding and encoding of each stream run in their own threads
+     * connected by bounded queues and are not synchronized by a clock, so the file is transcoded as fast as possible.
+     * Only the streams with an encoder are decoded. isAsync() has no effect.
+     */
+    void setMediaSource(const QString& fileName);
+    QString sourceFile() const;
+    /*!
+     * \brief setVideoDecoders
+     * Video decoder names in priority order used by file source. Default is "FFmpeg"
+     */
+    void setVideoDecoders(const QStringList& names);
+    QStringList videoDecoders() const;
+    /*!
+     * \brief installFilter
+     * Apply the filter to decoded frames of file source before encoding. Call it before start().
+     * The filter is not owned by transcoder. For player source, install filters to sourcePlayer()
+     * \return false if already installed
+     */
+    bool installFilter(Filter* filter);
+    bool uninstallFilter(Filter* filter);
+    /*!
+     * \brief setStreamCopy
+     * Remux file source without decoding and encoding. Packets of the current video and audio streams are written to output
+     * with the same codec parameters, and timestamps start from 0. Encoders are not required and are ignored.
+     * Cut points are video key frames: output starts from the key frame before startTime() and stops before
+     * the first key frame at or after stopTime(). Default is false.
+     */
+    void setStreamCopy(bool value = true);
+    bool isStreamCopy() const;
 
     QString outputFile() const;
     QIODevice* outputDevice() const;
@@ -103,6 +136,21 @@ public:
     qint64 encodedSize() const;
     qreal startTimestamp() const;
     qreal encodedDuration() const;
+    /*!
+     * \brief progress
+     * Encoded position in [startTime(), source duration], from 0 to 1. 0 if source duration is unknown
+     */
+    qreal progress() const;
+    /*!
+     * \brief speed
+     * Encoded media duration per second since start(). It's the speed relative to realtime playback
+     */
+    qreal speed() const;
+    /*!
+     * \brief encodeFrameRate
+     * Encoded video frames (or audio frames if no video) per second since start()
+     */
+    qreal encodeFrameRate() const;
 
     /*!
      * \brief startTime
@@ -110,6 +158,12 @@ public:
      */
     qint64 startTime() const;
     void setStartTime(qint64 ms);
+    /*!
+     * \brief stopTime
+     * Stop reading file source at stopTime() (ms). 0 means the end of source. No effect for player source, use sourcePlayer()->setStopPosition() instead
+     */
+    qint64 stopTime() const;
+    void setStopTime(qint64 ms);
 
 Q_SIGNALS:
     void videoFrameEncoded(qreal timestamp);
@@ -119,6 +173,11 @@ Q_SIGNALS:
     void paused(bool value);
     void startTimeChanged(qint64 ms);
     void asyncChanged();
+    /*!
+     * \brief progressChanged
+     * Emitted in encoding thread when progress() changes by at least 0.001
+     */
+    void progressChanged(qreal progress);
 
 public Q_SLOTS:
     void start();
@@ -143,6 +202,8 @@ private Q_SLOTS:
     void tryFinish();
 
 private:
+    friend class TranscodeEngine;
+    void startFile();
     void stopInternal();
     class Private;
     QScopedPointer<Private> d;
@@ -63,7 +63,19 @@ public:
     void setSamplesPerChannel(int samples);
     // may change after resampling
     int samplesPerChannel() const;
+    /*!
+     * \brief to
+     * Convert to the given format. The frame itself is returned if format is not changed and the resampler set by setAudioResampler() does not change the speed.
+     * Sample format and planar/packed changes without resampling or speed change use SIMD kernels,
+     * other conversions use a resampler from a shared cache if no resampler is set and sample rate is not changed.
+     * Set a resampler for the stream by setAudioResampler() to change the sample rate, it keeps delayed samples between frames
+     */
     AudioFrame to(const AudioFormat& fmt) const;
+    /*!
+     * \brief cacheStatistics
+     * Statistics of resampler cache and fast conversions used by to(). keys: resamplerHits, resamplerMisses, freeResamplers, fastConversions
+     */
+    static QVariantHash cacheStatistics();
     //AudioResamplerId
     void setAudioResampler(AudioResampler *conv); //TODO: remove
     /*!
@@ -113,6 +113,19 @@ public:
      * \return false if currently isPaused(), no backend is available or backend failed to play
      */
     bool play(const QByteArray& data, qreal pts = 0.0);
+    /*!
+     * \brief play
+     * \param applyVolume false if software volume is already applied to data, e.g. data is from convertFrame()
+     */
+    bool play(const QByteArray& data, qreal pts, bool applyVolume);
+    /*!
+     * \brief convertFrame
+     * Convert frame to audioFormat() and apply software volume in 1 pass, so the data is not walked twice.
+     * Only sample format conversion is supported: channels, channel layout and sample rate must be the same as audioFormat(). speed() is not applied.
+     * Play the result by play(data, pts, false).
+     * \return false if not supported, for example resampling is required. Use AudioFrame::to() instead.
+     */
+    bool convertFrame(const AudioFrame& frame, AudioFrame* out) const;
     /*!
      * \brief pause
      * Pause audio rendering. play() will fail.
@@ -212,7 +225,7 @@ Q_SIGNALS:
     void deliverAudioFrame(const QtAV::AudioFrame &frame);
 protected:
     // Store and fill data to audio buffers
-    bool receiveData(const QByteArray &data, qreal pts = 0.0);
+    bool receiveData(const QByteArray &data, qreal pts = 0.0, bool applyVolume = true);
     /*!
      * \brief waitForNextBuffer
      * wait until you can feed more data
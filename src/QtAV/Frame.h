@@ -60,7 +60,7 @@ public:
      * \return line size of plane
      */
     int bytesPerLine(int plane = 0) const;
-    // the whole frame data. may be empty unless clone() or allocate is called
+    // the whole frame data. may be empty, e.g. decoded frames and pooled frames from clone(). use constBits() instead
     // real data starts with dataAlignment() aligned address
     QByteArray frameData() const;
     int dataAlignment() const;
@@ -99,7 +99,17 @@ public:
     QVariant metaData(const QString& key) const;
     void setMetaData(const QString &key, const QVariant &value);
     void setTimestamp(qreal ts);
+    /*!
+     * \brief timestamp
+     * In seconds. Derived from timestampUs()
+     */
     qreal timestamp() const;
+    /*!
+     * \brief setTimestampUs timestampUs
+     * The exact timestamp in microseconds (AV_TIME_BASE). Decoders set it from the packet timestamps rescaled from stream time base
+     */
+    void setTimestampUs(qint64 us);
+    qint64 timestampUs() const;
     inline void swap(Frame &other) { qSwap(d_ptr, other.d_ptr); }
 
 protected:
@@ -0,0 +1,86 @@
+/******************************************************************************
+    QtAV:  Multimedia framework based on Qt and FFmpeg
+    Copyright (C) 2012-2017 Wang Bin <wbsecg1@gmail.com>
+
+*   This file is part of QtAV (from 2017)
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+******************************************************************************/
+
+#ifndef QTAV_NULLRENDERER_H
+#define QTAV_NULLRENDERER_H
+
+#include <QtAV/VideoRenderer.h>
+#include <QtCore/QVector>
+
+namespace QtAV {
+class AVClock;
+class NullRendererPrivate;
+/*!
+ * \brief The NullRenderer class
+ * A renderer without display for headless playback, e.g. performance tests and analysis pipelines.
+ * Frames go through the same path as other renderers: conversion in AVPlayer and renderer filters.
+ * Any pixel format is accepted. To convert frames like a real renderer, call
+ * setPreferredPixelFormat(fmt) and forcePreferredPixelFormat(true).
+ * receiveFrame() is called in video thread, other functions are thread safe.
+ */
+class Q_AV_EXPORT NullRenderer : public VideoRenderer
+{
+    DPTR_DECLARE_PRIVATE(NullRenderer)
+public:
+    struct FrameRecord {
+        qreal timestamp;
+        qint64 arrival; ///< us since the 1st frame after reset()
+        qreal delay; ///< clock value - timestamp when the frame arrives, in seconds. 0 if no clock
+    };
+    NullRenderer();
+    VideoRendererId id() const Q_DECL_OVERRIDE;
+    bool isSupported(VideoFormat::PixelFormat pixfmt) const Q_DECL_OVERRIDE;
+    /*!
+     * \brief setCopyEnabled
+     * Copy frames to host memory like a renderer uploading textures. Hardware decoded frames are mapped to host memory.
+     * Default is false.
+     */
+    void setCopyEnabled(bool value = true);
+    bool isCopyEnabled() const;
+    /*!
+     * \brief setClock
+     * The clock to compute presentation delay of each frame, usually AVPlayer::masterClock()
+     */
+    void setClock(AVClock* clock);
+    AVClock* clock() const;
+    /*!
+     * \brief setMaxRecords
+     * Max records kept until takeRecords() is called. The oldest records are discarded if full. 0: do not record. Default is 100000.
+     */
+    void setMaxRecords(int value);
+    int maxRecords() const;
+    QVector<FrameRecord> takeRecords();
+    qint64 framesReceived() const;
+    /*!
+     * \brief framesDropped
+     * Frames decoded but not rendered because they are late, since reset(). Requires the renderer is added to an AVPlayer
+     */
+    qint64 framesDropped() const;
+    void reset();
+    VideoFrame currentFrame() const;
+protected:
+    bool receiveFrame(const VideoFrame& frame) Q_DECL_OVERRIDE;
+    void drawFrame() Q_DECL_OVERRIDE;
+    void updateUi() Q_DECL_OVERRIDE;
+};
+typedef NullRenderer VideoRendererNull;
+} //namespace QtAV
+#endif //QTAV_NULLRENDERER_H
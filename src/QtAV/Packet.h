@@ -30,6 +30,7 @@ struct AVPacket;
 namespace QtAV {
 
 class PacketPrivate;
+class PacketPool;
 class Q_AV_EXPORT Packet
 {
 public:
@@ -50,25 +51,56 @@ public:
      * \brief asAVPacket
      * If Packet is constructed from AVPacket, then data and properties are the same as that AVPacket.
      * Otherwise, Packet's data and properties are used and no side data.
-     * Packet takes the owner ship. time unit is always ms even constructed from AVPacket.
+     * Packet takes the owner ship. time unit is always us (AV_TIME_BASE) even constructed from AVPacket.
+     * The AVPacket timestamps are refreshed if pts, dts or duration are modified after construction.
+     * The AVPacket is shared by copies of the Packet and must not be modified. Use av_packet_ref() to get a writable packet.
      */
     const AVPacket* asAVPacket() const;
     /*!
      * \brief skip
      * Skip bytes of packet data. User has to update pts, dts etc to new values.
      * Useful for asAVPakcet(). When asAVPakcet() is called, AVPacket->pts/dts will be updated to new values.
+     * Exact timestamps are invalidated, the qreal values are used.
      */
     void skip(int bytes);
+    /*!
+     * \brief ptsUs dtsUs durationUs
+     * Timestamps in microseconds. Rescaled from the exact stream timestamps if hasExactTimestamps(), otherwise from pts, dts and duration.
+     */
+    qint64 ptsUs() const;
+    qint64 dtsUs() const;
+    qint64 durationUs() const;
+    /*!
+     * \brief hasExactTimestamps
+     * True if constructed from AVPacket with a valid time base (or setExactTimestamps() is called), and pts, dts and duration are not modified since then.
+     */
+    bool hasExactTimestamps() const;
+    /*!
+     * \brief ptsTicks dtsTicks durationTicks
+     * Exact timestamps in stream time base timeBaseNum()/timeBaseDen(), set by fromAVPacket(). timeBaseDen() is 0 if not available.
+     * The ticks of a value are ignored by ptsUs() etc. if pts, dts or duration is modified.
+     */
+    qint64 ptsTicks() const;
+    qint64 dtsTicks() const;
+    qint64 durationTicks() const;
+    int timeBaseNum() const;
+    int timeBaseDen() const;
+    /*!
+     * \brief setExactTimestamps
+     * Set the exact timestamps in time base num/den. pts, dts and duration are updated.
+     */
+    void setExactTimestamps(qint64 pts_ticks, qint64 dts_ticks, qint64 duration_ticks, int num, int den);
 
     bool hasKeyFrame;
     bool isCorrupt;
     QByteArray data;
-    // time unit is s.
+    // time unit is s. derived from the exact timestamps if constructed from AVPacket
     qreal pts, duration;
     qreal dts;
     qint64 position; // position in source file byte stream
 
 private:
+    friend class PacketPool;
     // we must define  default/copy ctor, dtor and operator= so that we can provide only forward declaration of PacketPrivate
     mutable QSharedDataPointer<PacketPrivate> d;
 };
@@ -65,6 +65,7 @@
 #include <QtAV/VideoOutput.h>
 //The following renderer headers can be removed
 #include <QtAV/QPainterRenderer.h>
+#include <QtAV/NullRenderer.h>
 #if QT_VERSION >= QT_VERSION_CHECK(5,4,0)
 #include <QtAV/OpenGLWindowRenderer.h>
 #endif
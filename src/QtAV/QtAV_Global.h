@@ -79,6 +79,28 @@ Q_AV_EXPORT void setFFmpegLogLevel(const QByteArray& level);
 Q_AV_EXPORT QString avformatOptions();
 Q_AV_EXPORT QString avcodecOptions();
 
+/*!
+ * Pipeline tracing. If enabled, begin and end of demux (read, seek), decode, filter, convert, wait, deliver and
+ * renderer stages are recorded into per-thread ring buffers (the latest 32768 events of each thread).
+ * Buffers of finished threads are freed once dumped or cleared, at most 16 of them are kept otherwise.
+ * If disabled, the cost is a branch per event. Default is disabled.
+ */
+Q_AV_EXPORT void setTraceEnabled(bool value);
+Q_AV_EXPORT bool isTraceEnabled();
+/// Drop recorded events
+Q_AV_EXPORT void clearTrace();
+/// Recorded events in Chrome trace event json format, can be opened in chrome://tracing or https://ui.perfetto.dev
+/// Events of finished threads are dropped after dump
+Q_AV_EXPORT QByteArray traceJson();
+Q_AV_EXPORT bool saveTrace(const QString& path);
+/*!
+ * \brief setFrameBufferPoolSize
+ * Frame data allocated by VideoFrame::to(), VideoFrame::clone(), VideoFrame::fromGPU() and AudioFrame::mid() comes from a pool, and goes back to the pool when the last frame is destroyed.
+ * \param bytes high-water mark of free buffers kept by the pool. Buffers of the least recently used sizes are freed first. 0: free buffers immediately. Default is 128MB
+ */
+Q_AV_EXPORT void setFrameBufferPoolSize(qint64 bytes);
+Q_AV_EXPORT qint64 frameBufferPoolSize();
+
 ////////////Types/////////////
 enum MediaStatus
 {
@@ -125,7 +147,8 @@ enum ColorSpace {
     ColorSpace_GBR, // for planar gbr format(e.g. video from x264) used in glsl
     ColorSpace_BT601,
     ColorSpace_BT709,
-    ColorSpace_XYZ
+    ColorSpace_XYZ,
+    ColorSpace_BT2020 // non-constant luminance
 };
 
 /*!
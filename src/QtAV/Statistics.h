@@ -26,6 +26,7 @@
 #include <QtCore/QHash>
 #include <QtCore/QTime>
 #include <QtCore/QSharedData>
+#include <QtCore/QVariant>
 
 /*!
  * values from functions are dynamically calculated
@@ -110,9 +111,64 @@ public:
         /// return current absolute time (seconds since epcho
         qint64 frameDisplayed(qreal pts); // used to compute currentDisplayFPS()
     private:
+        friend class Statistics;
         class Private;
         QExplicitlySharedDataPointer<Private> d;
     } video_only;
+
+    /*!
+     * \brief The Histogram class
+     * Durations in power of 2 microseconds buckets
+     */
+    class Q_AV_EXPORT Histogram {
+    public:
+        enum { Buckets = 24 };
+        Histogram();
+        qint64 count() const;
+        /// upper bound of the bucket that contains the percentile p (0~1), in microseconds
+        qint64 percentile(qreal p) const;
+        /// counts[i]: durations in [2^i, 2^(i+1)) us. counts[0] includes 0, the last one includes all longer durations
+        qint64 counts[Buckets];
+        qint64 last, max; ///< microseconds
+    };
+    /*!
+     * \brief The Metrics class
+     * A snapshot of runtime metrics, which are updated continuously by playback threads
+     */
+    class Q_AV_EXPORT Metrics {
+    public:
+        Metrics();
+        /// for qml and logging. histograms are converted to p50, p99, max and count
+        QVariantMap toMap() const;
+        /// packets in queue between demuxer and decoder
+        int video_queue_packets, audio_queue_packets;
+        qint64 video_queue_bytes, audio_queue_bytes;
+        /// bits/s of demuxed packets, measured in about 1s of media time
+        int video_bit_rate, audio_bit_rate;
+        qint64 video_frames_decoded;
+        /// decoded but not rendered
+        qint64 video_frames_dropped;
+        /// rendered later than the sync threshold
+        qint64 video_frames_late;
+        /// seconds. video frame pts - clock when the frame is delivered to renderers. > 0: video is ahead
+        qreal av_sync_error;
+        /// audio device consumed all queued data before new data is written
+        qint64 audio_underruns;
+        Histogram video_decode_time;
+        /// frame conversion for renderers
+        Histogram video_convert_time;
+        /// frames converted for video renderers, and conversions avoided by sharing a converted frame between renderers
+        qint64 video_conversions, video_conversions_avoided;
+    };
+    /*!
+     * \brief metrics
+     * Lock-free, cheap enough to be polled frequently (e.g. 10Hz). Copies of a Statistics share the same metrics.
+     */
+    Metrics metrics() const;
+
+    class Counters;
+    /// internal use. updated by playback threads
+    Counters* counters() const;
 };
 
 } //namespace QtAV
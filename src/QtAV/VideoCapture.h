@@ -30,6 +30,7 @@
 
 namespace QtAV {
 
+class CaptureQueue;
 //on capture per thread or all in one thread?
 class Q_AV_EXPORT VideoCapture : public QObject
 {
@@ -41,8 +42,11 @@ class Q_AV_EXPORT VideoCapture : public QObject
     Q_PROPERTY(int quality READ quality WRITE setQuality NOTIFY qualityChanged)
     Q_PROPERTY(QString captureName READ captureName WRITE setCaptureName NOTIFY captureNameChanged)
     Q_PROPERTY(QString captureDir READ captureDir WRITE setCaptureDir NOTIFY captureDirChanged)
+    Q_PROPERTY(bool useEncoder READ useEncoder WRITE setUseEncoder NOTIFY useEncoderChanged)
+    Q_PROPERTY(int maxPending READ maxPending WRITE setMaxPending NOTIFY maxPendingChanged)
 public:
     explicit VideoCapture(QObject *parent = 0);
+    ~VideoCapture();
     // TODO: if async is true, the cloned hw frame shares the same interop object with original frame, so interop obj may do 2 map() at the same time. It's not safe
     void setAsync(bool value = true);
     bool isAsync() const;
@@ -85,6 +89,26 @@ public:
     QString captureName() const;
     void setCaptureDir(const QString& value);
     QString captureDir() const;
+    /*!
+     * \brief setUseEncoder
+     *  Encode the captured frame with FFmpeg mjpeg ("jpg", "jpeg" format) or png encoder instead of converting to QImage
+     *  and saving by Qt image plugins. YUV frames are encoded without converting to RGB for mjpeg.
+     *  Encoder context, converter and output buffer are reused until frame size or format changes.
+     *  Captures are encoded one by one in the capture thread pool if async, and imageCaptured() is not emitted.
+     *  Only works if autoSave is true and originalFormat is false, otherwise or for other formats, QImage is used.
+     *  Default is false.
+     */
+    void setUseEncoder(bool value = true);
+    bool useEncoder() const;
+    /*!
+     * \brief setMaxPending
+     *  Max captures waiting for encoding if useEncoder is true. If the queue is full, the oldest one is dropped.
+     *  0: no limit. Default is 4.
+     */
+    void setMaxPending(int value);
+    int maxPending() const;
+    /// Number of captures dropped because the encoding queue is full
+    qint64 droppedCount() const;
 public Q_SLOTS:
     void capture();
 Q_SIGNALS:
@@ -108,6 +132,12 @@ Q_SIGNALS:
      * \param path the saved captured frame path.
      */
     void saved(const QString& path);
+    /*!
+     * \brief captureLatency
+     * Only for autoSave is true. Emitted after saved().
+     * \param us microseconds from the captured frame is available to it is saved
+     */
+    void captureLatency(qint64 us);
 
     void asyncChanged();
     void autoSaveChanged();
@@ -116,6 +146,8 @@ Q_SIGNALS:
     void qualityChanged();
     void captureNameChanged();
     void captureDirChanged();
+    void useEncoderChanged();
+    void maxPendingChanged();
 private Q_SLOTS:
     void handleAppQuit();
 private:
@@ -124,6 +156,7 @@ private:
     void start();
 
     friend class CaptureTask;
+    friend class EncodeTask;
     friend class VideoThread;
     bool async;
     bool auto_save;
@@ -135,6 +168,9 @@ private:
     QString fmt;
     QString name, dir;
     VideoFrame frame;
+    bool use_encoder;
+    int max_pending;
+    CaptureQueue *queue;
 };
 
 } //namespace QtAV
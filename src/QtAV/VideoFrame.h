@@ -25,7 +25,8 @@
 #include <QtAV/Frame.h>
 #include <QtAV/VideoFormat.h>
 #include <QtCore/QSize>
-/// TODO: fromAVFrame(const AVFrame* f);
+
+struct AVFrame;
 namespace QtAV {
 
 /// metadata: pallete for pal8
@@ -49,6 +50,19 @@ public:
      */
     static VideoFrame fromGPU(const VideoFormat& fmt, int width, int height, int surface_h, quint8 *src[], int pitch[], bool optimized = true, bool swapUV = false);
     static void copyPlane(quint8 *dst, size_t dst_stride, const quint8 *src, size_t src_stride, unsigned byteWidth, unsigned height);
+    /*!
+     * \brief fromAVFrame
+     * Make a VideoFrame referencing the buffers of a ref counted AVFrame. No pixel data is copied, the frame holds a new reference until it is destroyed.
+     * If \a frame is not ref counted, the data is copied. Timestamp, color space and range are not set.
+     */
+    static VideoFrame fromAVFrame(const AVFrame* frame);
+    /*!
+     * \brief cacheStatistics
+     * to() reuses prepared converters and allocates the result from a frame buffer pool. Buffers go back to the pool when the last frame referencing them is destroyed.
+     * \return "converterHits"/"converterMisses": converters reused/created, "freeConverters": converters in cache,
+     * "bufferHits"/"bufferMisses": buffers reused/allocated, "freeBuffers"/"freeBufferBytes": buffers/bytes in the pool
+     */
+    static QVariantHash cacheStatistics();
 
     VideoFrame();
     //must set planes and linesize manually if data is empty
@@ -64,8 +78,20 @@ public:
     int channelCount() const Q_DECL_OVERRIDE;
     /*!
      * Deep copy. Given the format, width and height, plane addresses and line sizes.
+     * If the frame is backed by a ref counted AVFrame, the buffers are shared instead. Call makeWritable() before modifying the pixels.
      */
     VideoFrame clone() const;
+    /*!
+     * \brief avFrame
+     * The ref counted AVFrame backing this frame, or null if the frame is not created by fromAVFrame().
+     */
+    const AVFrame* avFrame() const;
+    /*!
+     * \brief makeWritable
+     * Ensure the pixel data is owned by this frame only, so that it can be modified in place. Data is copied only if it's shared with other frames or external memory.
+     * \return false if the frame has no data on host memory
+     */
+    bool makeWritable();
     VideoFormat format() const;
     VideoFormat::PixelFormat pixelFormat() const;
     QImage::Format imageFormat() const;
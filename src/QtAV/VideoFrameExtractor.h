@@ -23,6 +23,8 @@
 #define QTAV_VIDEOFRAMEEXTRACTOR_H
 
 #include <QtCore/QObject>
+#include <QtCore/QList>
+#include <QtGui/QImage>
 #include <QtAV/VideoFrame.h>
 
 //TODO: extract all streams
@@ -38,6 +40,15 @@ class Q_AV_EXPORT VideoFrameExtractor : public QObject
     Q_PROPERTY(int precision READ precision WRITE setPrecision NOTIFY precisionChanged)
     Q_PROPERTY(qint64 position READ position WRITE setPosition NOTIFY positionChanged)
 public:
+    /*!
+     * \brief The BatchPrecision enum
+     * How a frame is chosen for a position in extractBatch()
+     */
+    enum BatchPrecision {
+        KeyFramePrecision, ///< the key frame at or before the position. Only key frames are decoded
+        FastPrecision, ///< any frame in [position-precision(), position+precision()]
+        ExactPrecision ///< the 1st frame whose timestamp >= position
+    };
     explicit VideoFrameExtractor(QObject *parent = 0);
     /*!
      * \brief setSource
@@ -66,6 +77,27 @@ public:
     int precision() const;
     void setPosition(qint64 value);
     qint64 position() const;
+    /*!
+     * \brief extractBatch
+     * Extract frames of source() at a list of positions (in ms). Positions are sorted and split into contiguous ranges,
+     * each range is decoded by an independent demuxer/decoder pair in a thread pool. Decoding continues from the previous
+     * frame instead of seeking if the next position is in the same GOP, and a key frame is decoded only once for positions sharing it.
+     * The function blocks until all frames are extracted, call it in a worker thread for a responsive ui.
+     * It does not affect extract() and can be called in any thread.
+     * \param precisions precision of each position. If it's shorter than positions, the last value is used for the rest. Empty: FastPrecision
+     * \param size if valid, frames are scaled to this size and converted to RGB32 in the worker threads. Recommended for thumbnails because decoded frames can be large
+     * \param threads number of demuxer/decoder pairs. <=0: QThread::idealThreadCount()
+     * \return frames in the same order as positions. A frame is invalid if extraction failed
+     */
+    QList<VideoFrame> extractBatch(const QList<qint64>& positions, const QList<BatchPrecision>& precisions, const QSize& size = QSize(), int threads = 0);
+    QList<VideoFrame> extractBatch(const QList<qint64>& positions, BatchPrecision precision = FastPrecision, const QSize& size = QSize(), int threads = 0);
+    /*!
+     * \brief spriteSheet
+     * Tile frames into 1 image from left to right, top to bottom. Invalid frames are left black.
+     * \param columns number of tiles per row. <=0: ceil(sqrt(frames.size()))
+     * \param tileSize if empty, the size of the 1st valid frame is used
+     */
+    static QImage spriteSheet(const QList<VideoFrame>& frames, int columns = 0, const QSize& tileSize = QSize());
 
 Q_SIGNALS:
     void frameExtracted(const QtAV::VideoFrame& frame); // parameter: VideoFrame, bool changed?
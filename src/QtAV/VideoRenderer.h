@@ -44,6 +44,7 @@ namespace QtAV {
 
 typedef int VideoRendererId;
 extern Q_AV_EXPORT VideoRendererId VideoRendererId_OpenGLWindow;
+extern Q_AV_EXPORT VideoRendererId VideoRendererId_Null;
 class LibAVFilterVideo;
 class VideoFilterContext;
 class Filter;
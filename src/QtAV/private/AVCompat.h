@@ -150,6 +150,8 @@ int avformat_alloc_output_context2(AVFormatContext **avctx, AVOutputFormat *ofor
 
 //FFmpeg2.0, Libav10 2013-03-08 - Reference counted buffers - lavu 52.19.100/52.8.0, lavc 55.0.100 / 55.0.0, lavf 55.0.100 / 55.0.0, lavd 54.4.100 / 54.0.0, lavfi 3.5.0
 #define QTAV_HAVE_AVBUFREF AV_MODULE_CHECK(LIBAVUTIL, 52, 8, 0, 19, 100)
+//FFmpeg3.1, Libav12 2016-04-21 - avcodec_send_packet/avcodec_receive_frame - lavc 57.37.100 / 57.16.0
+#define QTAV_HAVE_AVCODEC_SEND_RECEIVE AV_MODULE_CHECK(LIBAVCODEC, 57, 16, 0, 37, 100)
 
 #if defined(_MSC_VER) || !defined(av_err2str) || (GCC_VERSION_AT_LEAST(4, 7, 0) && __cplusplus)
 #ifdef av_err2str
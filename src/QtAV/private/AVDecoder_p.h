@@ -23,9 +23,11 @@
 #define QTAV_AVDECODER_P_H
 
 #include <QtCore/QHash>
+#include <QtCore/QQueue>
 #include <QtCore/QSharedPointer>
 #include <QtCore/QVector>
 #include "QtAV/QtAV_Global.h"
+#include "QtAV/Packet.h"
 #include "QtAV/private/AVCompat.h"
 
 namespace QtAV {
@@ -74,6 +76,7 @@ public:
 };
 typedef QSharedPointer<AVFrameBuffers> AVFrameBuffersRef;
 
+class Packet;
 class Q_AV_PRIVATE_EXPORT AVDecoderPrivate : public DPtrPrivate<AVDecoder>
 {
 public:
@@ -95,10 +98,16 @@ public:
       , is_open(false)
       , undecoded_size(0)
       , dict(0)
+      , draining(false)
+      , frame_ready(false)
     {
         codec_ctx = avcodec_alloc_context3(NULL);
     }
     virtual ~AVDecoderPrivate() {
+        clearFrames();
+        foreach (AVFrame *f, free_frames) {
+            av_frame_free(&f);
+        }
         if (dict) {
             av_dict_free(&dict);
         }
@@ -111,6 +120,21 @@ public:
     virtual bool enableFrameRef() const { return true;}
     void applyOptionsForDict();
     void applyOptionsForContext();
+    /*!
+     * send/receive for avcodec based decoders. all frames decoded from a packet are queued.
+     * receiveFrame() moves the next queued frame to frame, return false if no frame queued
+     */
+    bool sendPacket(const Packet& packet);
+    bool receiveFrame(AVFrame *frame);
+    void clearFrames(); // also reset draining state. call it when flushing codec
+    /*!
+     * for decode() wrappers. decode() returns queued frames one by one and sets undecoded_size > 0 while frames are queued,
+     * so the caller calls decode() again with the rest of the packet data, i.e. the same data.
+     * return true if packet is the rest, then it must not be sent again. Otherwise the queued frames are dropped
+     * because the caller discards the rest, as undecoded data in avcodec_decode_video2/audio4 api.
+     */
+    bool isRestOfPacket(const Packet& packet);
+    void setUndecodedSize(const Packet& packet);
 
     AVCodecContext *codec_ctx; //set once and not change
     bool available; //TODO: true only when context(and hw ctx) is ready
@@ -119,6 +143,11 @@ public:
     QString codec_name;
     QVariantHash options;
     AVDictionary *dict;
+    bool draining; // eof packet is sent
+    bool frame_ready; // for decoders use decode() as sendPacket()
+    Packet sent_packet; // the last packet sent by decode() while its frames are queued. referenced, so its data address is not reused by a new packet
+    QQueue<AVFrame*> frames; // decoded but not received
+    QVector<AVFrame*> free_frames;
 };
 
 class AudioResampler;
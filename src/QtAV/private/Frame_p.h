@@ -27,6 +27,7 @@
 #include <QtCore/QVariant>
 #include <QtCore/QSharedData>
 
+struct AVBufferRef;
 namespace QtAV {
 
 class Frame;
@@ -35,17 +36,24 @@ class FramePrivate : public QSharedData
     Q_DISABLE_COPY(FramePrivate)
 public:
     FramePrivate()
-        : timestamp(0)
+        : timestamp_us(0)
         , data_align(1)
+        , buf(0)
     {}
-    virtual ~FramePrivate() {}
+    virtual ~FramePrivate();
+    /*!
+     * Uninitialized storage of size bytes from FrameBufferPool, or in data if the pool is not available. Released when the frame is destroyed.
+     * Planes are not set.
+     */
+    uchar* allocate(int size);
 
     QVector<uchar*> planes; //slice
     QVector<int> line_sizes; //stride
     QVariantMap metadata;
     QByteArray data;
-    qreal timestamp;
+    qint64 timestamp_us;
     int data_align;
+    AVBufferRef *buf; // pooled storage. planes point to it if not null
 };
 
 } //namespace QtAV
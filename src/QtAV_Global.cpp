@@ -418,6 +418,9 @@ ColorSpace colorSpaceFromFFmpeg(AVColorSpace cs)
     case AVCOL_SPC_BT709: return ColorSpace_BT709;
     case AVCOL_SPC_BT470BG: return ColorSpace_BT601;
     case AVCOL_SPC_SMPTE170M: return ColorSpace_BT601;
+#if LIBAV_MODULE_CHECK(LIBAVUTIL, 53, 0, 0) || FFMPEG_MODULE_CHECK(LIBAVUTIL, 52, 48, 101)
+    case AVCOL_SPC_BT2020_NCL: return ColorSpace_BT2020;
+#endif
     default: return ColorSpace_Unknown;
     }
 }
@@ -20,7 +20,11 @@
 ******************************************************************************/
 
 #include "QtAV/Statistics.h"
+#include "Statistics_p.h"
+#include <QtCore/QSharedPointer>
+#include <QtCore/qmath.h>
 #include "utils/ring.h"
+#include "utils/SPSCQueue.h"
 
 namespace QtAV {
 
@@ -48,6 +52,8 @@ public:
     {}
     qreal pts;
     ring<qreal> history;
+    // Statistics has no private data. counters are here because d is shared by copies of a Statistics, and so are the metrics
+    QSharedPointer<Counters> counters;
 };
 
 Statistics::VideoOnly::VideoOnly():
@@ -114,8 +120,205 @@ qreal Statistics::VideoOnly::currentDisplayFPS() const
     return (qreal)d->history.size()/dt;
 }
 
+Statistics::Histogram::Histogram()
+    : last(0)
+    , max(0)
+{
+    for (int i = 0; i < Buckets; ++i)
+        counts[i] = 0;
+}
+
+qint64 Statistics::Histogram::count() const
+{
+    qint64 n = 0;
+    for (int i = 0; i < Buckets; ++i)
+        n += counts[i];
+    return n;
+}
+
+qint64 Statistics::Histogram::percentile(qreal p) const
+{
+    const qint64 n = count();
+    if (n <= 0)
+        return 0;
+    const qint64 target = qMax<qint64>(1, qCeil(qBound<qreal>(0, p, 1)*n));
+    qint64 c = 0;
+    for (int i = 0; i < Buckets - 1; ++i) {
+        c += counts[i];
+        if (c >= target)
+            return qMin<qint64>(1LL << (i + 1), max);
+    }
+    return max;
+}
+
+Statistics::Metrics::Metrics()
+    : video_queue_packets(0)
+    , audio_queue_packets(0)
+    , video_queue_bytes(0)
+    , audio_queue_bytes(0)
+    , video_bit_rate(0)
+    , audio_bit_rate(0)
+    , video_frames_decoded(0)
+    , video_frames_dropped(0)
+    , video_frames_late(0)
+    , av_sync_error(0)
+    , audio_underruns(0)
+    , video_conversions(0)
+    , video_conversions_avoided(0)
+{
+}
+
+static QVariantMap histogramToMap(const Statistics::Histogram& h)
+{
+    QVariantMap m;
+    m[QStringLiteral("count")] = h.count();
+    m[QStringLiteral("p50")] = h.percentile(0.5);
+    m[QStringLiteral("p99")] = h.percentile(0.99);
+    m[QStringLiteral("max")] = h.max;
+    return m;
+}
+
+QVariantMap Statistics::Metrics::toMap() const
+{
+    QVariantMap m;
+    m[QStringLiteral("videoQueuePackets")] = video_queue_packets;
+    m[QStringLiteral("audioQueuePackets")] = audio_queue_packets;
+    m[QStringLiteral("videoQueueBytes")] = video_queue_bytes;
+    m[QStringLiteral("audioQueueBytes")] = audio_queue_bytes;
+    m[QStringLiteral("videoBitRate")] = video_bit_rate;
+    m[QStringLiteral("audioBitRate")] = audio_bit_rate;
+    m[QStringLiteral("videoFramesDecoded")] = video_frames_decoded;
+    m[QStringLiteral("videoFramesDropped")] = video_frames_dropped;
+    m[QStringLiteral("videoFramesLate")] = video_frames_late;
+    m[QStringLiteral("avSyncError")] = av_sync_error;
+    m[QStringLiteral("audioUnderruns")] = audio_underruns;
+    m[QStringLiteral("videoDecodeTime")] = histogramToMap(video_decode_time);
+    m[QStringLiteral("videoConvertTime")] = histogramToMap(video_convert_time);
+    m[QStringLiteral("videoConversions")] = video_conversions;
+    m[QStringLiteral("videoConversionsAvoided")] = video_conversions_avoided;
+    return m;
+}
+
+void Statistics::Counters::Histogram::reset()
+{
+    for (int i = 0; i < Statistics::Histogram::Buckets; ++i)
+        spsc::storeRelease(counts[i], 0);
+    spsc::storeRelease(last, 0);
+    spsc::storeRelease(max, 0);
+}
+
+void Statistics::Counters::Histogram::add(qint64 us)
+{
+    if (us < 0)
+        us = 0;
+    int b = 0;
+    for (qint64 v = us; v > 1 && b < Statistics::Histogram::Buckets - 1; v >>= 1)
+        ++b;
+    counts[b].ref();
+    const int v = (int)qMin<qint64>(us, INT_MAX);
+    spsc::storeRelease(last, v);
+    // may be added in more than 1 thread
+    int m = spsc::loadAcquire(max);
+    while (v > m && !max.testAndSetOrdered(m, v))
+        m = spsc::loadAcquire(max);
+}
+
+void Statistics::Counters::Histogram::read(Statistics::Histogram *h) const
+{
+    for (int i = 0; i < Statistics::Histogram::Buckets; ++i)
+        h->counts[i] = spsc::loadAcquire(counts[i]);
+    h->last = spsc::loadAcquire(last);
+    h->max = spsc::loadAcquire(max);
+}
+
+Statistics::Counters::Counters()
+{
+    for (int i = 0; i < NbStreams; ++i) {
+        window_start[i] = -1;
+        window_bytes[i] = 0;
+    }
+    reset();
+}
+
+void Statistics::Counters::reset()
+{
+    spsc::storeRelease(frames_decoded, 0);
+    spsc::storeRelease(frames_dropped, 0);
+    spsc::storeRelease(frames_late, 0);
+    spsc::storeRelease(conversions, 0);
+    spsc::storeRelease(conversions_avoided, 0);
+    spsc::storeRelease(audio_underruns, 0);
+    spsc::storeRelease(sync_error, 0);
+    decode_time.reset();
+    convert_time.reset();
+    for (int i = 0; i < NbStreams; ++i) {
+        spsc::storeRelease(queue_packets[i], 0);
+        spsc::storeRelease(queue_bytes[i], 0);
+        spsc::storeRelease(bit_rate[i], 0);
+        // the window is owned by demux thread
+        spsc::storeRelease(window_reset[i], 1);
+    }
+}
+
+void Statistics::Counters::read(Statistics::Metrics *m) const
+{
+    m->video_queue_packets = spsc::loadAcquire(queue_packets[Video]);
+    m->audio_queue_packets = spsc::loadAcquire(queue_packets[Audio]);
+    m->video_queue_bytes = qMax(0, spsc::loadAcquire(queue_bytes[Video]));
+    m->audio_queue_bytes = qMax(0, spsc::loadAcquire(queue_bytes[Audio]));
+    m->video_bit_rate = spsc::loadAcquire(bit_rate[Video]);
+    m->audio_bit_rate = spsc::loadAcquire(bit_rate[Audio]);
+    m->video_frames_decoded = spsc::loadAcquire(frames_decoded);
+    m->video_frames_dropped = spsc::loadAcquire(frames_dropped);
+    m->video_frames_late = spsc::loadAcquire(frames_late);
+    m->video_conversions = spsc::loadAcquire(conversions);
+    m->video_conversions_avoided = spsc::loadAcquire(conversions_avoided);
+    m->av_sync_error = qreal(spsc::loadAcquire(sync_error))/1000000.0;
+    m->audio_underruns = spsc::loadAcquire(audio_underruns);
+    decode_time.read(&m->video_decode_time);
+    convert_time.read(&m->video_convert_time);
+}
+
+void Statistics::Counters::packetPut(Stream s, int size, int bytes, qint64 us)
+{
+    spsc::storeRelease(queue_packets[s], size);
+    queue_bytes[s].fetchAndAddOrdered(bytes);
+    if (us < 0)
+        return;
+    // bit rate of packets in about 1s. restart if timestamp jumps (seek, discontinuity)
+    qint64 &t0 = window_start[s];
+    if (window_reset[s].testAndSetAcquire(1, 0))
+        t0 = -1;
+    if (t0 < 0 || us - t0 > 10000000LL || t0 - us > 1000000LL) {
+        t0 = us;
+        window_bytes[s] = bytes;
+        return;
+    }
+    window_bytes[s] += bytes;
+    if (us - t0 < 1000000LL)
+        return;
+    spsc::storeRelease(bit_rate[s], int(qMin<qint64>(window_bytes[s]*8LL*1000000LL/(us - t0), INT_MAX)));
+    t0 = us;
+    window_bytes[s] = 0;
+}
+
+void Statistics::Counters::packetTaken(Stream s, int size, int bytes)
+{
+    spsc::storeRelease(queue_packets[s], size);
+    if (size <= 0)
+        spsc::storeRelease(queue_bytes[s], 0);
+    else
+        queue_bytes[s].fetchAndAddOrdered(-bytes);
+}
+
+void Statistics::Counters::setSyncError(qreal seconds)
+{
+    spsc::storeRelease(sync_error, int(qBound<qreal>(-2000.0, seconds, 2000.0)*1000000.0));
+}
+
 Statistics::Statistics()
 {
+    video_only.d->counters = QSharedPointer<Counters>(new Counters());
 }
 
 Statistics::~Statistics()
@@ -128,8 +331,26 @@ void Statistics::reset()
     audio = Common();
     video = Common();
     audio_only = AudioOnly();
+    // playback threads keep the counters pointer
+    const QSharedPointer<Counters> counters(video_only.d->counters);
     video_only = VideoOnly();
+    video_only.d->counters = counters;
     metadata.clear();
+    if (counters)
+        counters->reset();
+}
+
+Statistics::Metrics Statistics::metrics() const
+{
+    Metrics m;
+    if (video_only.d->counters)
+        video_only.d->counters->read(&m);
+    return m;
+}
+
+Statistics::Counters* Statistics::counters() const
+{
+    return video_only.d->counters.data();
 }
 
 } //namespace QtAV
@@ -0,0 +1,75 @@
+/******************************************************************************
+    QtAV:  Multimedia framework based on Qt and FFmpeg
+    Copyright (C) 2012-2017 Wang Bin <wbsecg1@gmail.com>
+
+*   This file is part of QtAV (from 2017)
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+******************************************************************************/
+
+
+#ifndef QTAV_STATISTICS_P_H
+#define QTAV_STATISTICS_P_H
+
+#include "QtAV/Statistics.h"
+#include <QtCore/QAtomicInt>
+
+namespace QtAV {
+/*!
+ * \brief The Statistics::Counters class
+ * Runtime metrics written by playback threads with atomic operations and read by Statistics::metrics() without lock.
+ * Every value has a single writer thread unless noted.
+ */
+class Q_AV_PRIVATE_EXPORT Statistics::Counters
+{
+public:
+    enum Stream { Audio, Video, NbStreams };
+    class Histogram {
+    public:
+        Histogram() { reset();}
+        void reset();
+        void add(qint64 us);
+        void read(Statistics::Histogram *h) const;
+    private:
+        QAtomicInt counts[Statistics::Histogram::Buckets];
+        QAtomicInt last, max;
+    };
+
+    Counters();
+    void reset();
+    void read(Statistics::Metrics *m) const;
+    /// called by PacketBuffer in demux thread. size: packets in queue. us: packet timestamp, for bit rate
+    void packetPut(Stream s, int size, int bytes, qint64 us);
+    /// called by PacketBuffer in decoder thread, or by clear() with an empty packet
+    void packetTaken(Stream s, int size, int bytes);
+    void setSyncError(qreal seconds);
+
+    // video thread
+    QAtomicInt frames_decoded, frames_dropped, frames_late;
+    Histogram decode_time, convert_time;
+    QAtomicInt conversions, conversions_avoided;
+    // audio thread
+    QAtomicInt audio_underruns;
+private:
+    QAtomicInt queue_packets[NbStreams], queue_bytes[NbStreams];
+    QAtomicInt bit_rate[NbStreams];
+    QAtomicInt sync_error; // us
+    // bit rate window, demux thread only. reset() in another thread requests to restart the window by window_reset
+    QAtomicInt window_reset[NbStreams];
+    qint64 window_start[NbStreams]; // -1: no packet
+    qint64 window_bytes[NbStreams];
+};
+} //namespace QtAV
+#endif //QTAV_STATISTICS_P_H
@@ -21,13 +21,19 @@
 #include "QtAV/VideoCapture.h"
 #include <QtCore/QCoreApplication>
 #include <QtCore/QDir>
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QMutex>
+#include <QtCore/QQueue>
 #include <QtCore/QRunnable>
 #include <QtCore/QThreadPool>
+#include <QtCore/QWaitCondition>
 #if QT_VERSION < QT_VERSION_CHECK(5, 0, 0)
 #include <QtGui/QDesktopServices>
 #else
 #include <QtCore/QStandardPaths>
 #endif
+#include "QtAV/VideoEncoder.h"
+#include "ImageConverter.h"
 #include "utils/Logger.h"
 
 namespace QtAV {
@@ -84,9 +90,12 @@ public:
                 QMetaObject::invokeMethod(cap, "failed");
                 return;
             }
-            int sz = 0;
-            const char* data = (const char*)frame.frameDataPtr(&sz);
-            if (file.write(data, sz) <= 0) {
+            // planes one by one. the frame data can be pooled or referenced decoded buffers
+            bool written = true;
+            for (int i = 0; i < frame.planeCount() && written; ++i) {
+                written = file.write((const char*)frame.constBits(i), frame.bytesPerLine(i)*frame.planeHeight(i)) > 0;
+            }
+            if (!written) {
                 qWarning("VideoCapture is failed to write captured frame with original format");
                 QMetaObject::invokeMethod(cap, "failed");
                 file.close();
@@ -94,6 +103,7 @@ public:
             }
             file.close();
             QMetaObject::invokeMethod(cap, "saved", Q_ARG(QString, path));
+            QMetaObject::invokeMethod(cap, "captureLatency", Q_ARG(qint64, timer.nsecsElapsed()/1000LL));
             return;
         }
         if (image.isNull())
@@ -106,6 +116,7 @@ public:
             QMetaObject::invokeMethod(cap, "failed");
         }
         QMetaObject::invokeMethod(cap, "saved", Q_ARG(QString, path));
+        QMetaObject::invokeMethod(cap, "captureLatency", Q_ARG(qint64, timer.nsecsElapsed()/1000LL));
     }
 
     VideoCapture *cap;
@@ -115,6 +126,218 @@ public:
     QString format, dir, name;
     QImage::Format qfmt;
     VideoFrame frame;
+    QElapsedTimer timer;
+};
+
+// "jpg", "jpeg" => mjpeg, "png" => png. empty if no encoder is used for the format
+static QString encoderForFormat(const QString& format)
+{
+    const QString f(format.toLower());
+    if (f == QLatin1String("jpg") || f == QLatin1String("jpeg"))
+        return QStringLiteral("mjpeg");
+    if (f == QLatin1String("png"))
+        return QStringLiteral("png");
+    return QString();
+}
+
+struct CaptureRequest
+{
+    VideoFrame frame;
+    QString codec, suffix, dir, name;
+    int quality;
+    QElapsedTimer timer;
+};
+
+/*!
+ * Encodes captures of a VideoCapture in order. The encoder and converter are reopened only if
+ * frame size, format, color range, codec or quality changes, so the codec context and buffers are reused.
+ */
+class CaptureEncoder
+{
+public:
+    CaptureEncoder()
+        : enc(0)
+        , quality(-1)
+        , width(0)
+        , height(0)
+        , in_fmt(VideoFormat::Format_Invalid)
+        , out_fmt(VideoFormat::Format_Invalid)
+    {}
+    ~CaptureEncoder() { delete enc;}
+    // return the encoded image, empty if error
+    QByteArray encode(const VideoFrame& frame, const QString& codecName, int q) {
+        VideoFrame f(frame);
+        if (!f.constBits(0)) // hw surface
+            f = f.to(f.format());
+        if (!f.isValid() || !f.constBits(0))
+            return QByteArray();
+        if (!enc || !enc->isOpen() || codec != codecName || quality != q
+                || width != f.width() || height != f.height() || in_fmt != f.pixelFormat()) {
+            if (!open(f, codecName, q))
+                return QByteArray();
+        }
+        const VideoFormat fmt(out_fmt);
+        // jpeg is always full range
+        if (out_fmt != f.pixelFormat() || (!fmt.isRGB() && f.colorRange() != ColorRange_Full)) {
+            conv.setInFormat(f.pixelFormatFFmpeg());
+            conv.setOutFormat(fmt.pixelFormatFFmpeg());
+            conv.setInSize(f.width(), f.height());
+            conv.setOutSize(f.width(), f.height());
+            conv.setInRange(f.colorRange() == ColorRange_Unknown && !f.format().isRGB() ? ColorRange_Limited : f.colorRange());
+            conv.setOutRange(ColorRange_Full);
+            conv.setInColorSpace(f.colorSpace());
+            QVector<const uchar*> planes(f.planeCount());
+            QVector<int> strides(f.planeCount());
+            for (int i = 0; i < f.planeCount(); ++i) {
+                planes[i] = f.constBits(i);
+                strides[i] = f.bytesPerLine(i);
+            }
+            if (!conv.convert(planes.constData(), strides.constData())) {
+                qWarning() << "VideoCapture failed to convert " << f.format() << "=>" << fmt;
+                return QByteArray();
+            }
+            VideoFrame c(f.width(), f.height(), fmt);
+            c.setBits(conv.outPlanes());
+            c.setBytesPerLine(conv.outLineSizes());
+            c.setTimestamp(f.timestamp());
+            f = c;
+        }
+        if (!enc->encode(f)) {
+            qWarning("VideoCapture failed to encode with %s", qPrintable(codec));
+            return QByteArray();
+        }
+        return enc->encoded().data;
+    }
+private:
+    bool open(const VideoFrame& f, const QString& codecName, int q) {
+        if (!enc)
+            enc = VideoEncoder::create("FFmpeg");
+        if (!enc)
+            return false;
+        if (enc->isOpen())
+            enc->close();
+        codec = codecName;
+        quality = q;
+        width = f.width();
+        height = f.height();
+        in_fmt = f.pixelFormat();
+        QVariantHash avcodec;
+        if (codec == QLatin1String("mjpeg")) {
+            // yuv420p etc. instead of deprecated yuvj420p
+            avcodec[QStringLiteral("strict")] = -1;
+            avcodec[QStringLiteral("color_range")] = QStringLiteral("jpeg");
+            // constant quantizer. 0~100 => 31~2, default like ffmpeg -q:v 3
+            const int qscale = q < 0 ? 3 : 31 - qMin(q, 100)*29/100;
+            avcodec[QStringLiteral("qmin")] = qscale;
+            avcodec[QStringLiteral("qmax")] = qscale;
+        } else if (q >= 0) { // png. the same as Qt
+            avcodec[QStringLiteral("compression_level")] = (100 - qMin(q, 100))*9/100;
+        }
+        QVariantHash opt;
+        opt[QStringLiteral("avcodec")] = avcodec;
+        enc->setOptions(opt);
+        enc->setCodecName(codec);
+        enc->setWidth(width);
+        enc->setHeight(height);
+        // the encoder chooses a supported format if in_fmt is not supported
+        enc->setPixelFormat(in_fmt);
+        if (!enc->open()) {
+            qWarning("VideoCapture failed to open encoder %s", qPrintable(codec));
+            return false;
+        }
+        out_fmt = enc->pixelFormat();
+        return true;
+    }
+
+    VideoEncoder *enc;
+    ImageConverterFF conv;
+    QString codec;
+    int quality;
+    int width, height;
+    VideoFormat::PixelFormat in_fmt, out_fmt;
+};
+
+class CaptureQueue
+{
+public:
+    CaptureQueue() : running(false), dropped(0) {}
+    // encode and save in the calling thread
+    void process(VideoCapture *cap, CaptureRequest& r) {
+        QMutexLocker lock(&enc_mutex);
+        Q_UNUSED(lock);
+        if (!QDir(r.dir).exists()) {
+            if (!QDir().mkpath(r.dir)) {
+                qWarning("Failed to create capture dir [%s]", qPrintable(r.dir));
+                QMetaObject::invokeMethod(cap, "failed");
+                return;
+            }
+        }
+        const QByteArray data(encoder.encode(r.frame, r.codec, r.quality));
+        if (data.isEmpty()) {
+            QMetaObject::invokeMethod(cap, "failed");
+            return;
+        }
+        const QString path(r.dir + QStringLiteral("/") + r.name + QString::number(r.frame.timestamp(), 'f', 3) + QStringLiteral(".") + r.suffix);
+        QFile file(path);
+        if (!file.open(QIODevice::WriteOnly) || file.write(data) != data.size()) {
+            qWarning("VideoCapture is failed to write file %s", qPrintable(path));
+            QMetaObject::invokeMethod(cap, "failed");
+            return;
+        }
+        file.close();
+        QMetaObject::invokeMethod(cap, "saved", Q_ARG(QString, path));
+        QMetaObject::invokeMethod(cap, "captureLatency", Q_ARG(qint64, r.timer.nsecsElapsed()/1000LL));
+    }
+
+    QMutex mutex; // for pending, running and dropped
+    QWaitCondition cond;
+    QQueue<CaptureRequest> pending;
+    bool running; // an EncodeTask is started and not finished
+    qint64 dropped;
+private:
+    QMutex enc_mutex;
+    CaptureEncoder encoder;
+};
+
+// at most 1 task for each VideoCapture, so captures are encoded in order by the same encoder
+class EncodeTask : public QRunnable
+{
+public:
+    EncodeTask(VideoCapture *c)
+        : cap(c)
+        , queue(c->queue)
+        , done(false)
+    {
+        setAutoDelete(true);
+    }
+    // the task may be deleted by QThreadPool::clear() without running
+    ~EncodeTask() {
+        if (done)
+            return;
+        QMutexLocker lock(&queue->mutex);
+        Q_UNUSED(lock);
+        queue->running = false;
+        queue->cond.wakeAll();
+    }
+    virtual void run() {
+        while (true) {
+            QMutexLocker lock(&queue->mutex);
+            if (queue->pending.isEmpty() || app_is_dieing) {
+                queue->pending.clear();
+                queue->running = false;
+                done = true;
+                queue->cond.wakeAll();
+                return;
+            }
+            CaptureRequest r(queue->pending.dequeue());
+            lock.unlock();
+            queue->process(cap, r);
+        }
+    }
+private:
+    VideoCapture *cap;
+    CaptureQueue *queue;
+    bool done;
 };
 
 VideoCapture::VideoCapture(QObject *parent) :
@@ -123,6 +346,9 @@ VideoCapture::VideoCapture(QObject *parent) :
   , auto_save(true)
   , original_fmt(false)
   , qfmt(QImage::Format_ARGB32)
+  , use_encoder(false)
+  , max_pending(4)
+  , queue(new CaptureQueue())
 {
 #if QT_VERSION < QT_VERSION_CHECK(5, 0, 0)
     dir = QDesktopServices::storageLocation(QDesktopServices::PicturesLocation);
@@ -137,6 +363,18 @@ VideoCapture::VideoCapture(QObject *parent) :
     connect(qApp, SIGNAL(aboutToQuit()), SLOT(handleAppQuit()), Qt::DirectConnection);
 }
 
+VideoCapture::~VideoCapture()
+{
+    {
+        QMutexLocker lock(&queue->mutex);
+        Q_UNUSED(lock);
+        queue->pending.clear();
+        while (queue->running)
+            queue->cond.wait(&queue->mutex);
+    }
+    delete queue;
+}
+
 void VideoCapture::setAsync(bool value)
 {
     if (async == value)
@@ -176,6 +414,39 @@ bool VideoCapture::isOriginalFormat() const
     return original_fmt;
 }
 
+void VideoCapture::setUseEncoder(bool value)
+{
+    if (use_encoder == value)
+        return;
+    use_encoder = value;
+    Q_EMIT useEncoderChanged();
+}
+
+bool VideoCapture::useEncoder() const
+{
+    return use_encoder;
+}
+
+void VideoCapture::setMaxPending(int value)
+{
+    if (max_pending == value)
+        return;
+    max_pending = value;
+    Q_EMIT maxPendingChanged();
+}
+
+int VideoCapture::maxPending() const
+{
+    return max_pending;
+}
+
+qint64 VideoCapture::droppedCount() const
+{
+    QMutexLocker lock(&queue->mutex);
+    Q_UNUSED(lock);
+    return queue->dropped;
+}
+
 void VideoCapture::handleAppQuit()
 {
     app_is_dieing = true;
@@ -194,10 +465,40 @@ void  VideoCapture::capture()
 
 void VideoCapture::start()
 {
+    QElapsedTimer timer;
+    timer.start();
     Q_EMIT frameAvailable(frame);
     if (!frame.isValid() || !frame.constBits(0)) { // if frame is always cloned, then size is at least width*height
         qDebug("Captured frame from hardware decoder surface.");
     }
+    const QString codec(use_encoder && auto_save && !original_fmt ? encoderForFormat(fmt) : QString());
+    if (!codec.isEmpty() && frame.isValid()) {
+        CaptureRequest r;
+        r.frame = frame;
+        r.codec = codec;
+        r.suffix = fmt.toLower();
+        r.dir = dir;
+        r.name = name;
+        r.quality = qual;
+        r.timer = timer;
+        if (!isAsync()) {
+            queue->process(this, r);
+            return;
+        }
+        QMutexLocker lock(&queue->mutex);
+        Q_UNUSED(lock);
+        while (max_pending > 0 && queue->pending.size() >= max_pending) {
+            qDebug("VideoCapture queue is full. drop the oldest capture");
+            queue->pending.dequeue();
+            ++queue->dropped;
+        }
+        queue->pending.enqueue(r);
+        if (queue->running)
+            return;
+        queue->running = true;
+        videoCaptureThreadPool()->start(new EncodeTask(this));
+        return;
+    }
     CaptureTask *task = new CaptureTask(this);
     // copy properties so the task will not be affect even if VideoCapture properties changed
     task->save = autoSave();
@@ -207,6 +508,7 @@ void VideoCapture::start()
     task->name = name;
     task->format = fmt;
     task->qfmt = qfmt;
+    task->timer = timer;
     task->frame = frame; //copy here and it's safe in capture thread because start() is called immediatly after setVideoFrame
     if (isAsync()) {
         videoCaptureThreadPool()->start(task);
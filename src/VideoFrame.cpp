@@ -23,6 +23,7 @@
 #include "QtAV/private/Frame_p.h"
 #include "QtAV/SurfaceInterop.h"
 #include "ImageConverter.h"
+#include "FrameBufferPool.h"
 #include <QtCore/QSharedPointer>
 #include <QtGui/QImage>
 #include "QtAV/private/AVCompat.h"
@@ -41,6 +42,59 @@ static const struct RegisterMetaTypes
 } _registerMetaTypes;
 }
 
+/*!
+ * a frame with uninitialized data from FrameBufferPool. planes are contiguous
+ * pitch: line sizes of planes. aligned as ImageConverter output if null
+ * surface_h: height of planes in memory. can be greater than frame height because of alignment. frame height if <= 0
+ */
+static VideoFrame allocFrame(int width, int height, const VideoFormat& fmt, const int *pitch = 0, int surface_h = 0)
+{
+    const AVPixelFormat pixfmt = (AVPixelFormat)fmt.pixelFormatFFmpeg();
+    const int kAlign = ImageConverter::DataAlignment;
+    const int h = qMax(height, surface_h);
+    int linesize[4] = { 0 };
+    uint8_t *data[4] = { 0 };
+    AV_ENSURE(av_image_check_size(width, h, 0, NULL), VideoFrame());
+    if (pitch) {
+        for (int i = 0; i < qMin(fmt.planeCount(), 4); ++i)
+            linesize[i] = pitch[i];
+    } else {
+        AV_ENSURE(av_image_fill_linesizes(linesize, pixfmt, FFALIGN(width, 8)), VideoFrame());
+        for (int i = 0; i < 4; ++i)
+            linesize[i] = FFALIGN(linesize[i], kAlign);
+    }
+    const int size = av_image_fill_pointers(data, pixfmt, h, NULL, linesize);
+    if (size <= 0)
+        return VideoFrame();
+#if QTAV_HAVE(AVBUFREF)
+    FrameBufferPool *pool = FrameBufferPool::instance();
+    if (pool) {
+        AVFrame *avf = av_frame_alloc();
+        avf->buf[0] = pool->allocBuffer(size);
+        if (!avf->buf[0]) {
+            av_frame_free(&avf);
+            return VideoFrame();
+        }
+        avf->width = width;
+        avf->height = height;
+        avf->format = pixfmt;
+        av_image_fill_pointers(avf->data, pixfmt, h, avf->buf[0]->data, linesize);
+        memcpy(avf->linesize, linesize, sizeof(linesize));
+        VideoFrame f(VideoFrame::fromAVFrame(avf));
+        av_frame_free(&avf);
+        return f;
+    }
+#endif //QTAV_HAVE(AVBUFREF)
+    QByteArray buf;
+    buf.resize(size + kAlign - 1); // not initialized
+    const int offset = (kAlign - ((uintptr_t)buf.constData() & (kAlign-1))) & (kAlign-1);
+    av_image_fill_pointers(data, pixfmt, h, (uint8_t*)buf.constData() + offset, linesize);
+    VideoFrame f(width, height, fmt, buf, kAlign);
+    f.setBits(data);
+    f.setBytesPerLine(linesize);
+    return f;
+}
+
 VideoFrame VideoFrame::fromGPU(const VideoFormat& fmt, int width, int height, int surface_h, quint8 *src[], int pitch[], bool optimized, bool swapUV)
 {
     Q_ASSERT(src[0] && pitch[0] > 0 && "VideoFrame::fromGPU: src[0] and pitch[0] must be set");
@@ -62,38 +116,41 @@ VideoFrame VideoFrame::fromGPU(const VideoFormat& fmt, int width, int height, in
     }
     VideoFrame frame;
     if (optimized) {
-        int yuv_size = 0;
-        for (int i = 0; i < nb_planes; ++i) {
-            yuv_size += pitch[i]*h[i];
-        }
-        // additional 15 bytes to ensure 16 bytes aligned
-        QByteArray buf(15 + yuv_size, 0);
-        const int offset_16 = (16 - ((uintptr_t)buf.constData() & 0x0f)) & 0x0f;
-        // plane 1, 2... is aligned?
-        uchar* plane_ptr = (uchar*)buf.constData() + offset_16;
-        QVector<uchar*> dst(nb_planes, 0);
-        for (int i = 0; i < nb_planes; ++i) {
-            dst[i] = plane_ptr;
-            // TODO: add VideoFormat::planeWidth/Height() ?
-            // pitch instead of surface_width
-            plane_ptr += pitch[i] * h[i];
-            gpu_memcpy(dst[i], src[i], pitch[i]*h[i]);
-
+        frame = allocFrame(width, height, fmt, pitch, surface_h);
+        for (int i = 0; i < nb_planes && frame; ++i) {
+            gpu_memcpy(frame.bits(i), src[i], pitch[i]*h[i]);
         }
-        frame = VideoFrame(width, height, fmt, buf);
-        frame.setBits(dst);
-        frame.setBytesPerLine(pitch);
     } else {
         frame = VideoFrame(width, height, fmt);
         frame.setBits(src);
         frame.setBytesPerLine(pitch);
         // TODO: why clone is faster()?
-        // TODO: buffer pool and create VideoFrame when needed to avoid copy? also for other va
         frame = frame.clone();
     }
     return frame;
 }
 
+QVariantHash VideoFrame::cacheStatistics()
+{
+    QVariantHash h;
+    ImageConverterCache *cache = ImageConverterCache::instance();
+    if (cache) {
+        const ImageConverterCache::Statistics st = cache->statistics();
+        h[QStringLiteral("converterHits")] = st.hits;
+        h[QStringLiteral("converterMisses")] = st.misses;
+        h[QStringLiteral("freeConverters")] = st.free;
+    }
+    FrameBufferPool *pool = FrameBufferPool::instance();
+    if (pool) {
+        const FrameBufferPool::Statistics st = pool->statistics();
+        h[QStringLiteral("bufferHits")] = st.hits;
+        h[QStringLiteral("bufferMisses")] = st.misses;
+        h[QStringLiteral("freeBuffers")] = st.free;
+        h[QStringLiteral("freeBufferBytes")] = st.free_bytes;
+    }
+    return h;
+}
+
 void VideoFrame::copyPlane(quint8 *dst, size_t dst_stride, const quint8 *src, size_t src_stride, unsigned byteWidth, unsigned height)
 {
     if (!dst || !src)
@@ -121,6 +178,7 @@ public:
         , color_range(ColorRange_Unknown)
         , displayAspectRatio(0)
         , format(VideoFormat::Format_Invalid)
+        , avframe(0)
     {}
     VideoFramePrivate(int w, int h, const VideoFormat& fmt)
         : FramePrivate()
@@ -130,6 +188,7 @@ public:
         , color_range(ColorRange_Unknown)
         , displayAspectRatio(0)
         , format(fmt)
+        , avframe(0)
     {
         if (!format.isValid())
             return;
@@ -138,7 +197,12 @@ public:
         planes.reserve(format.planeCount());
         line_sizes.reserve(format.planeCount());
     }
-    ~VideoFramePrivate() {}
+    ~VideoFramePrivate() {
+#if QTAV_HAVE(AVBUFREF)
+        if (avframe)
+            av_frame_free(&avframe);
+#endif
+    }
     int width, height;
     ColorSpace color_space;
     ColorRange color_range;
@@ -147,8 +211,37 @@ public:
     QScopedPointer<QImage> qt_image;
 
     VideoSurfaceInteropPtr surface_interop;
+    AVFrame *avframe; // a reference owned by the frame. planes point to its data
 };
 
+VideoFrame VideoFrame::fromAVFrame(const AVFrame *frame)
+{
+    if (!frame || frame->width <= 0 || frame->height <= 0)
+        return VideoFrame();
+    const VideoFormat fmt(frame->format);
+    if (!fmt.isValid())
+        return VideoFrame();
+#if QTAV_HAVE(AVBUFREF)
+    if (frame->buf[0]) {
+        AVFrame *ref = av_frame_alloc();
+        if (av_frame_ref(ref, frame) < 0) {
+            qWarning("av_frame_ref error");
+            av_frame_free(&ref);
+            return VideoFrame();
+        }
+        VideoFrame f(frame->width, frame->height, fmt);
+        f.d_func()->avframe = ref;
+        f.setBits(ref->data);
+        f.setBytesPerLine(ref->linesize);
+        return f;
+    }
+#endif //QTAV_HAVE(AVBUFREF)
+    VideoFrame f(frame->width, frame->height, fmt);
+    f.setBits((quint8**)frame->data);
+    f.setBytesPerLine((int*)frame->linesize);
+    return f.clone();
+}
+
 VideoFrame::VideoFrame()
     : Frame(new VideoFramePrivate())
 {
@@ -208,41 +301,88 @@ VideoFrame VideoFrame::clone() const
     Q_D(const VideoFrame);
     if (!d->format.isValid())
         return VideoFrame();
-
+#if QTAV_HAVE(AVBUFREF)
+    if (d->avframe) { // share the buffers. copy on write in makeWritable()
+        VideoFrame f(fromAVFrame(d->avframe));
+        f.d_ptr->metadata = d->metadata;
+        f.setTimestampUs(d->timestamp_us);
+        f.setDisplayAspectRatio(d->displayAspectRatio);
+        f.setColorSpace(d->color_space);
+        f.setColorRange(d->color_range);
+        return f;
+    }
+#endif //QTAV_HAVE(AVBUFREF)
     // data may be not set (ff decoder)
     if (d->planes.isEmpty() || !d->planes.at(0)) {//d->data.size() < width()*height()) { // at least width*height
         // maybe in gpu memory, then bits() is not set
         qDebug("frame data not valid. size: %d", d->data.size());
         VideoFrame f(width(), height(), d->format);
         f.d_ptr->metadata = d->metadata; // need metadata?
-        f.setTimestamp(d->timestamp);
+        f.setTimestampUs(d->timestamp_us);
         f.setDisplayAspectRatio(d->displayAspectRatio);
         return f;
     }
-    int bytes = 0;
-    for (int i = 0; i < d->format.planeCount(); ++i) {
-        bytes += bytesPerLine(i)*planeHeight(i);
-    }
-
-    QByteArray buf(bytes, 0);
-    char *dst = buf.data(); //must before buf is shared, otherwise data will be detached.
-    VideoFrame f(width(), height(), d->format, buf);
+    // keep the line sizes unless the frame is flipped
     const int nb_planes = d->format.planeCount();
+    bool keep_pitch = true;
+    for (int i = 0; i < nb_planes; ++i)
+        keep_pitch &= d->line_sizes.at(i) > 0;
+    VideoFrame f(allocFrame(width(), height(), d->format, keep_pitch ? d->line_sizes.constData() : 0));
+    if (!f)
+        return VideoFrame();
     for (int i = 0; i < nb_planes; ++i) {
-        f.setBits((quint8*)dst, i);
-        f.setBytesPerLine(bytesPerLine(i), i);
-        const int plane_size = bytesPerLine(i)*planeHeight(i);
-        memcpy(dst, constBits(i), plane_size);
-        dst += plane_size;
+        const int bytes = keep_pitch ? bytesPerLine(i) : effectiveBytesPerLine(i);
+        copyPlane(f.bits(i), f.bytesPerLine(i), constBits(i), bytesPerLine(i), bytes, planeHeight(i));
     }
     f.d_ptr->metadata = d->metadata; // need metadata?
-    f.setTimestamp(d->timestamp);
+    f.setTimestampUs(d->timestamp_us);
     f.setDisplayAspectRatio(d->displayAspectRatio);
     f.setColorSpace(d->color_space);
     f.setColorRange(d->color_range);
     return f;
 }
 
+const AVFrame* VideoFrame::avFrame() const
+{
+    return d_func()->avframe;
+}
+
+bool VideoFrame::makeWritable()
+{
+    Q_D(VideoFrame);
+    if (!isValid() || d->planes.isEmpty() || !d->planes.at(0))
+        return false;
+#if QTAV_HAVE(AVBUFREF)
+    if (d->avframe) {
+        const uchar *old = d->avframe->data[0];
+        AV_ENSURE_OK(av_frame_make_writable(d->avframe), false);
+        if (old == d->avframe->data[0])
+            return true;
+        for (int i = 0; i < d->planes.size(); ++i) {
+            d->planes[i] = d->avframe->data[i];
+            d->line_sizes[i] = d->avframe->linesize[i];
+        }
+        return true;
+    }
+#endif //QTAV_HAVE(AVBUFREF)
+    // planes point to the data owned by this frame only
+    if (!d->data.isEmpty() && d->data.isDetached() && d->qt_image.isNull())
+        return true;
+    VideoFrame f(clone());
+    VideoFramePrivate *fd = f.d_func();
+    d->data = fd->data;
+    d->data_align = fd->data_align;
+    d->planes = fd->planes;
+    d->line_sizes = fd->line_sizes;
+#if QTAV_HAVE(AVBUFREF)
+    d->avframe = fd->avframe; // pooled data
+    fd->avframe = 0;
+#endif //QTAV_HAVE(AVBUFREF)
+    d->qt_image.reset();
+    d->metadata.remove(QStringLiteral("avbuf"));
+    return true;
+}
+
 VideoFormat VideoFrame::format() const
 {
     return d_func()->format;
@@ -354,7 +494,7 @@ QImage VideoFrame::toImage(QImage::Format fmt, const QSize& dstSize, const QRect
     VideoFrame f(to(VideoFormat(VideoFormat::pixelFormatFromImageFormat(fmt)), dstSize, roi));
     if (!f)
         return QImage();
-    QImage image(f.frameDataPtr(), f.width(), f.height(), f.bytesPerLine(0), fmt);
+    QImage image(f.constBits(0), f.width(), f.height(), f.bytesPerLine(0), fmt);
     return image.copy();
 }
 
@@ -386,19 +526,39 @@ VideoFrame VideoFrame::to(const VideoFormat &fmt, const QSize& dstSize, const QR
             )
         return *this;
     Q_D(const VideoFrame);
-    ImageConverterSWS conv;
-    conv.setInFormat(pixelFormatFFmpeg());
-    conv.setOutFormat(fmt.pixelFormatFFmpeg());
-    conv.setInSize(width(), height());
-    conv.setOutSize(w, h);
-    conv.setInRange(colorRange());
-    if (!conv.convert(d->planes.constData(), d->line_sizes.constData())) {
+    VideoFrame f(allocFrame(w, h, fmt));
+    if (!f)
+        return VideoFrame();
+    ImageConverterCache::Key key;
+    key.format_in = pixelFormatFFmpeg();
+    key.format_out = fmt.pixelFormatFFmpeg();
+    key.width_in = width();
+    key.height_in = height();
+    key.width_out = w;
+    key.height_out = h;
+    key.range_in = colorRange();
+    key.cs_in = colorSpace();
+    // simd yuv=>rgb if possible, otherwise swscale. reuse the converter prepared for the same kind of frames
+    ImageConverterCache *cache = ImageConverterCache::instance();
+    ImageConverter *conv = cache ? cache->acquire(key) : 0;
+    QScopedPointer<ImageConverter> local; // the cache is destroyed at exit
+    if (!conv) {
+        local.reset(new ImageConverterYUV());
+        conv = local.data();
+        conv->setInFormat(key.format_in);
+        conv->setOutFormat(key.format_out);
+        conv->setInSize(key.width_in, key.height_in);
+        conv->setOutSize(key.width_out, key.height_out);
+        conv->setInRange(key.range_in);
+        conv->setInColorSpace(key.cs_in);
+    }
+    const bool ok = conv->convert(d->planes.constData(), d->line_sizes.constData(), f.d_func()->planes.constData(), f.d_func()->line_sizes.constData());
+    if (!local)
+        cache->release(key, conv);
+    if (!ok) {
         qWarning() << "VideoFrame::to error: " << format() << "=>" << fmt;
         return VideoFrame();
     }
-    VideoFrame f(w, h, fmt, conv.outData(), ImageConverter::DataAlignment);
-    f.setBits(conv.outPlanes());
-    f.setBytesPerLine(conv.outLineSizes());
     if (fmt.isRGB()) {
         f.setColorSpace(fmt.isPlanar() ? ColorSpace_GBR : ColorSpace_RGB);
     } else {
@@ -506,7 +666,7 @@ VideoFrame VideoFrameConverter::convert(const VideoFrame &frame, int fffmt) cons
     //if (fffmt == format.pixelFormatFFmpeg())
       //  return *this;
     if (!m_cvt) {
-        m_cvt = new ImageConverterSWS();
+        m_cvt = new ImageConverterYUV();
     }
     m_cvt->setBrightness(m_eq[0]);
     m_cvt->setContrast(m_eq[1]);
@@ -516,6 +676,7 @@ VideoFrame VideoFrameConverter::convert(const VideoFrame &frame, int fffmt) cons
     m_cvt->setInSize(frame.width(), frame.height());
     m_cvt->setOutSize(frame.width(), frame.height());
     m_cvt->setInRange(frame.colorRange());
+    m_cvt->setInColorSpace(frame.colorSpace());
     const int pal = format.hasPalette();
     QVector<const uchar*> pitch(format.planeCount() + pal);
     QVector<int> stride(format.planeCount() + pal);
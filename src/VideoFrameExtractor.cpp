@@ -20,14 +20,18 @@
 ******************************************************************************/
 
 #include "QtAV/VideoFrameExtractor.h"
+#include <limits>
 #include <QtCore/QCoreApplication>
 #include <QtCore/QQueue>
 #include <QtCore/QRunnable>
 #include <QtCore/QScopedPointer>
 #include <QtCore/QStringList>
 #include <QtCore/QThread>
+#include <QtCore/QThreadPool>
 #include <QtCore/QMutex>
 #include <QtCore/QMutexLocker>
+#include <QtCore/qmath.h>
+#include <QtGui/QPainter>
 #include "QtAV/VideoCapture.h"
 #include "QtAV/VideoDecoder.h"
 #include "QtAV/AVDemuxer.h"
@@ -115,6 +119,221 @@ private:
 
 // FIXME: avcodec_close() crash
 const int kDefaultPrecision = 500;
+
+/*!
+ * Extract frames at sorted positions with its own demuxer and decoder.
+ * Decoder state is kept between positions: if the next position is not farther than the longest GOP seen,
+ * packets are decoded forward from the current position instead of seeking back to a key frame.
+ */
+class BatchExtractor : public QRunnable
+{
+public:
+    struct Request {
+        qint64 position;
+        int index; // index in results
+        VideoFrameExtractor::BatchPrecision precision;
+        bool operator<(const Request& other) const { return position < other.position;}
+    };
+    BatchExtractor(const QString& file, const QStringList& decoders, int range, const QSize& size, const Request* requests, int count, VideoFrame* results)
+        : m_file(file)
+        , m_codecs(decoders)
+        , m_range(range)
+        , m_size(size)
+        , m_requests(requests)
+        , m_count(count)
+        , m_results(results)
+        , m_vstream(-1)
+        , m_key_pts(-1)
+        , m_max_gop(0)
+        , m_eof(false)
+        , m_need_key(true)
+        , m_key_frame_pkt_pts(-1)
+        , m_scaled_ts(-1)
+    {
+        QVariantHash opt;
+        opt[QString::fromLatin1("skip_frame")] = 8;
+        opt[QString::fromLatin1("skip_loop_filter")] = 8;
+        m_opt_framedrop[QString::fromLatin1("avcodec")] = opt;
+        opt[QString::fromLatin1("skip_frame")] = 0;
+        opt[QString::fromLatin1("skip_loop_filter")] = 0;
+        m_opt_normal[QString::fromLatin1("avcodec")] = opt;
+    }
+    void run() {
+        if (!open())
+            return;
+        for (int i = 0; i < m_count; ++i) {
+            const Request &r = m_requests[i];
+            const VideoFrame f = r.precision == VideoFrameExtractor::KeyFramePrecision ? keyFrameAt(r.position) : frameAt(r.position, r.precision);
+            if (!f.isValid() || !m_size.isValid()) {
+                m_results[r.index] = f;
+                continue;
+            }
+            // a frame can be shared by neighboring positions, scale it once
+            if (!m_scaled.isValid() || f.timestampUs() != m_scaled_ts) {
+                m_scaled_ts = f.timestampUs();
+                m_scaled = f.to(VideoFormat::Format_RGB32, m_size);
+            }
+            m_results[r.index] = m_scaled;
+        }
+        m_decoder.reset(0);
+        m_demuxer.unload();
+    }
+
+private:
+    bool open() {
+        m_demuxer.setMedia(m_file);
+        if (!m_demuxer.load() || m_demuxer.videoStreams().isEmpty())
+            return false;
+        m_demuxer.setStreamIndex(AVDemuxer::VideoStream, 0);
+        m_vstream = m_demuxer.videoStream();
+        m_max_gop = m_demuxer.maxGopDuration(); // from index cache
+        foreach (const QString& c, m_codecs) {
+            VideoDecoder *vd = VideoDecoder::create(c.toUtf8().constData());
+            if (!vd)
+                continue;
+            m_decoder.reset(vd);
+            m_decoder->setCodecContext(m_demuxer.videoCodecContext());
+            if (m_decoder->open())
+                return true;
+            m_decoder.reset(0);
+        }
+        return false;
+    }
+    // true if got a video packet, false if end of file
+    bool readPacket(Packet *pkt) {
+        while (!m_demuxer.atEnd()) {
+            if (!m_demuxer.readFrame() || m_demuxer.stream() != m_vstream)
+                continue;
+            *pkt = m_demuxer.packet();
+            if (!pkt->isValid())
+                continue;
+            if (pkt->hasKeyFrame) {
+                const qint64 pts = pkt->ptsUs()/1000LL;
+                if (m_key_pts >= 0 && pts > m_key_pts)
+                    m_max_gop = qMax(m_max_gop, pts - m_key_pts);
+                m_key_pts = pts;
+            }
+            return true;
+        }
+        return false;
+    }
+    void seek(qint64 pos) {
+        if (pos < m_demuxer.startTime())
+            pos += m_demuxer.startTime();
+        m_demuxer.seek(pos);
+        m_decoder->flush();
+        m_frame = VideoFrame();
+        m_key_pts = -1;
+        m_eof = false;
+        m_need_key = true;
+    }
+    // decode the next frame. false if no more frame
+    // non-ref frames of packets before drop_before (ms) are not decoded
+    bool decodeNext(qint64 drop_before) {
+        while (true) {
+            if (m_decoder->receiveFrame()) {
+                const VideoFrame f(m_decoder->frame());
+                if (f.isValid()) {
+                    m_frame = f;
+                    return true;
+                }
+                continue;
+            }
+            if (m_eof)
+                return false;
+            Packet pkt;
+            if (!readPacket(&pkt)) {
+                m_eof = true;
+                m_decoder->sendPacket(Packet::createEOF());
+                continue;
+            }
+            if (m_need_key) {
+                if (!pkt.hasKeyFrame)
+                    continue;
+                m_need_key = false;
+            }
+            m_decoder->setOptions(pkt.ptsUs()/1000LL < drop_before ? m_opt_framedrop : m_opt_normal);
+            m_decoder->sendPacket(pkt);
+        }
+        return false;
+    }
+    VideoFrame frameAt(qint64 pos, VideoFrameExtractor::BatchPrecision precision) {
+        const int range = precision == VideoFrameExtractor::ExactPrecision ? 0 : m_range;
+        const qint64 ts = m_frame.isValid() ? m_frame.timestampUs()/1000LL : -1;
+        if (ts >= 0) {
+            // positions are sorted, m_frame is the 1st frame after the previous position, so no other frame in [pos-range, ts)
+            if (ts >= pos - range)
+                return m_frame;
+            if (m_eof)
+                return m_frame;
+            // decoding forward in the same GOP is faster than seeking back to the key frame
+            const qint64 key = m_demuxer.keyFrameBefore(pos);
+            if (key >= 0) {
+                if (key <= ts)
+                    return decodeTo(pos, range);
+            } else if (pos - ts <= qMax<qint64>(m_max_gop, range)) {
+                return decodeTo(pos, range);
+            }
+        }
+        return seekAndDecode(pos, range);
+    }
+    VideoFrame seekAndDecode(qint64 pos, int range) {
+        seek(pos);
+        return decodeTo(pos, range);
+    }
+    VideoFrame decodeTo(qint64 pos, int range) {
+        // frames displayed before pos-range are not required
+        while (decodeNext(pos - range)) {
+            if (m_frame.timestampUs()/1000LL >= pos - range)
+                break;
+        }
+        return m_frame;
+    }
+    VideoFrame keyFrameAt(qint64 pos) {
+        Packet pkt;
+        seek(pos);
+        if (!readPacket(&pkt))
+            return VideoFrame();
+        while (!pkt.hasKeyFrame) {
+            if (!readPacket(&pkt))
+                return VideoFrame();
+        }
+        // the same GOP as the previous position
+        if (m_key_frame.isValid() && pkt.ptsUs() == m_key_frame_pkt_pts)
+            return m_key_frame;
+        m_key_frame_pkt_pts = pkt.ptsUs();
+        m_need_key = false;
+        m_decoder->setOptions(m_opt_normal);
+        m_decoder->sendPacket(pkt);
+        // decoders with delay need more packets to output the key frame. frames after it are not required
+        m_key_frame = decodeNext(std::numeric_limits<qint64>::max()) ? m_frame : VideoFrame();
+        // non-ref frames are dropped, can not decode forward from here
+        m_frame = VideoFrame();
+        return m_key_frame;
+    }
+
+    QString m_file;
+    QStringList m_codecs;
+    int m_range;
+    QSize m_size;
+    const Request *m_requests;
+    int m_count;
+    VideoFrame *m_results;
+    AVDemuxer m_demuxer;
+    QScopedPointer<VideoDecoder> m_decoder;
+    int m_vstream;
+    qint64 m_key_pts; // ms, the last key packet read
+    qint64 m_max_gop; // ms
+    bool m_eof;
+    bool m_need_key;
+    VideoFrame m_frame; // the last decoded frame
+    VideoFrame m_key_frame;
+    qint64 m_key_frame_pkt_pts;
+    VideoFrame m_scaled;
+    qint64 m_scaled_ts;
+    QVariantHash m_opt_framedrop, m_opt_normal;
+};
+
 class VideoFrameExtractorPrivate : public DPtrPrivate<VideoFrameExtractor>
 {
 public:
@@ -216,6 +435,7 @@ public:
         frame = VideoFrame();
         if (value < demuxer.startTime())
             value += demuxer.startTime();
+        // seek to the exact key frame if indexed
         demuxer.seek(value);
         const int vstream = demuxer.videoStream();
         Packet pkt;
@@ -235,8 +455,8 @@ public:
                 continue;
             pkt = demuxer.packet();
             if (pts0 < 0LL)
-                pts0 = (qint64)(pkt.pts*1000.0);
-            if ((qint64)(pkt.pts*1000.0) - value > (qint64)range) {
+                pts0 = pkt.ptsUs()/1000LL;
+            if (pkt.ptsUs()/1000LL - value > (qint64)range) {
                 if (warn_out_of_range)
                     qDebug("read packet out of range");
                 warn_out_of_range = false;
@@ -252,7 +472,7 @@ public:
             warn_bad_seek = false;
         }
         // enlarge range if seek to key-frame failed
-        const qint64 key_pts = (qint64)(pkt.pts*1000.0);
+        const qint64 key_pts = pkt.ptsUs()/1000LL;
         const bool enlarge_range = pts0 >= 0LL && key_pts - pts0 > 0LL;
         if (enlarge_range) {
             range = qMax<qint64>(key_pts - value, range);
@@ -283,7 +503,7 @@ public:
         // if seek backward correctly to key frame, diff0 = t - value <= 0
         // but sometimes seek to no-key frame(and range is enlarged), diff0 >= 0
         // decode key frame
-        const int diff0 = qint64(frame.timestamp()*1000.0) - value;
+        const int diff0 = frame.timestampUs()/1000LL - value;
         if (qAbs(diff0) <= range) { //TODO: flag forward: result pts must >= value
             if (frame.isValid()) {
                 qDebug() << "VideoFrameExtractor: key frame found @" << frame.timestamp() <<" diff=" << diff0 << ". format: " <<  frame.format();
@@ -304,8 +524,8 @@ public:
             if (demuxer.stream() != vstream)
                 continue;
             pkt = demuxer.packet();
-            const qreal t = pkt.pts;
-            //qDebug("video packet: %f, delta=%lld", t, value - qint64(t*1000.0));
+            const qint64 t = pkt.ptsUs();
+            //qDebug("video packet: %lld us, delta=%lld", t, value - t/1000LL);
             if (!pkt.isValid()) {
                 qWarning("invalid packet. no decode");
                 continue;
@@ -315,7 +535,7 @@ public:
                 //qCritical("Internal error. Can not be a key frame!!!!");
                 //return false; //??
             }
-            qint64 diff = qint64(t*1000.0) - value;
+            qint64 diff = t/1000LL - value;
             QVariantHash *dec_opt_old = dec_opt;
             if (seek_count == 0 || diff >= 0)
                 dec_opt = &dec_opt_normal;
@@ -324,35 +544,42 @@ public:
             if (dec_opt != dec_opt_old)
                 decoder->setOptions(*dec_opt);
             // invalid packet?
-            if (!decoder->decode(pkt)) {
+            if (!decoder->sendPacket(pkt)) {
                 qWarning("!!!!!!!!!decode failed!!!!");
                 frame = VideoFrame();
                 err = "decode failed";
                 return false;
             }
-            // store the last decoded frame because next frame may be out of range
-            const VideoFrame f = decoder->frame();
-            if (!f.isValid()) {
-                //qDebug("VideoFrameExtractor: invalid frame!!!");
-                continue;
+            // a packet can produce more than 1 frame
+            bool found = false;
+            while (decoder->receiveFrame()) {
+                // store the last decoded frame because next frame may be out of range
+                const VideoFrame f = decoder->frame();
+                if (!f.isValid()) {
+                    //qDebug("VideoFrameExtractor: invalid frame!!!");
+                    continue;
+                }
+                frame = f;
+                const qreal pts = frame.timestamp();
+                const qint64 pts_ms = frame.timestampUs()/1000LL;
+                if (pts_ms < value)
+                    continue; //
+                diff = pts_ms - value;
+                if (qAbs(diff) <= (qint64)range) {
+                    qDebug("got frame at %fs, diff=%lld", pts, diff);
+                    found = true;
+                    break;
+                }
+                // if decoder was not flushed, we may get old frame which is acceptable
+                if (diff > range && t > frame.timestampUs()) {
+                    qWarning("out pts out of range. diff=%lld, range=%d", diff, range);
+                    frame = VideoFrame();
+                    err = QString().sprintf("out pts out of range. diff=%lld, range=%d", diff, range);
+                    return false;
+                }
             }
-            frame = f;
-            const qreal pts = frame.timestamp();
-            const qint64 pts_ms = pts*1000.0;
-            if (pts_ms < value)
-                continue; //
-            diff = pts_ms - value;
-            if (qAbs(diff) <= (qint64)range) {
-                qDebug("got frame at %fs, diff=%lld", pts, diff);
+            if (found)
                 break;
-            }
-            // if decoder was not flushed, we may get old frame which is acceptable
-            if (diff > range && t > pts) {
-                qWarning("out pts out of range. diff=%lld, range=%d", diff, range);
-                frame = VideoFrame();
-                err = QString().sprintf("out pts out of range. diff=%lld, range=%d", diff, range);
-                return false;
-            }
         }
         ++seek_count;
         // now we get the final frame
@@ -546,4 +773,71 @@ void VideoFrameExtractor::extractInternal(qint64 pos)
     Q_EMIT frameExtracted(d.frame);
 }
 
+QList<VideoFrame> VideoFrameExtractor::extractBatch(const QList<qint64> &positions, BatchPrecision precision, const QSize &size, int threads)
+{
+    return extractBatch(positions, QList<BatchPrecision>() << precision, size, threads);
+}
+
+QList<VideoFrame> VideoFrameExtractor::extractBatch(const QList<qint64> &positions, const QList<BatchPrecision> &precisions, const QSize &size, int threads)
+{
+    DPTR_D(VideoFrameExtractor);
+    QVector<VideoFrame> frames(positions.size());
+    if (positions.isEmpty() || d.source.isEmpty() || d.codecs.isEmpty())
+        return frames.toList();
+    QVector<BatchExtractor::Request> requests(positions.size());
+    for (int i = 0; i < positions.size(); ++i) {
+        BatchExtractor::Request &r = requests[i];
+        r.position = positions.at(i);
+        r.index = i;
+        r.precision = precisions.isEmpty() ? FastPrecision : precisions.at(qMin(i, precisions.size() - 1));
+    }
+    qStableSort(requests.begin(), requests.end());
+    if (threads <= 0)
+        threads = QThread::idealThreadCount();
+    // every thread opens the file and decodes at least a GOP, too small shards are slower
+    const int kMinShard = 4;
+    threads = qBound(1, qMin(threads, (requests.size() + kMinShard - 1)/kMinShard), requests.size());
+    const int range = d.auto_precision ? kDefaultPrecision : d.precision;
+    QThreadPool pool;
+    pool.setMaxThreadCount(threads);
+    for (int i = 0; i < threads; ++i) {
+        const int begin = requests.size()*i/threads;
+        const int end = requests.size()*(i + 1)/threads;
+        pool.start(new BatchExtractor(d.source, d.codecs, range, size, requests.constData() + begin, end - begin, frames.data()));
+    }
+    pool.waitForDone();
+    return frames.toList();
+}
+
+QImage VideoFrameExtractor::spriteSheet(const QList<VideoFrame> &frames, int columns, const QSize &tileSize)
+{
+    if (frames.isEmpty())
+        return QImage();
+    QSize tile(tileSize);
+    if (tile.isEmpty()) {
+        foreach (const VideoFrame& f, frames) {
+            if (f.isValid()) {
+                tile = f.size();
+                break;
+            }
+        }
+        if (tile.isEmpty())
+            return QImage();
+    }
+    if (columns <= 0)
+        columns = qCeil(qSqrt(qreal(frames.size())));
+    const int rows = (frames.size() + columns - 1)/columns;
+    QImage sheet(tile.width()*columns, tile.height()*rows, QImage::Format_RGB32);
+    sheet.fill(0);
+    QPainter painter(&sheet);
+    for (int i = 0; i < frames.size(); ++i) {
+        const VideoFrame &f = frames.at(i);
+        if (!f.isValid())
+            continue;
+        const QImage img(f.toImage(QImage::Format_RGB32, tile));
+        painter.drawImage((i % columns)*tile.width(), (i / columns)*tile.height(), img);
+    }
+    return sheet;
+}
+
 } //namespace QtAV
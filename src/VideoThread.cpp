@@ -31,11 +31,25 @@
 #include "QtAV/FilterContext.h"
 #include "output/OutputSet.h"
 #include "QtAV/private/AVCompat.h"
+#include "Statistics_p.h"
+#include <QtCore/QElapsedTimer>
 #include <QtCore/QFileInfo>
+#include <QtCore/QQueue>
+#include "utils/Trace.h"
 #include "utils/Logger.h"
 
 namespace QtAV {
 
+// decoded and filtered frame waiting to be presented
+struct DecodedFrame {
+    VideoFrame frame;
+    qreal dts; // packet dts used to sync with clock
+    qint64 pts_us; // decoded pts before filters. recorded in pts history when presented
+    bool key;
+    bool seek_target; // decoded while seeking and not before the seek target. seek finishes when it is presented
+    qint64 bytes; // 0 if frame is not in host memory
+};
+
 class VideoThreadPrivate : public AVThreadPrivate
 {
 public:
@@ -45,7 +59,11 @@ public:
       , force_dt(0)
       , capture(0)
       , filter_context(0)
+      , frames_bytes(0)
+      , max_frames(3)
+      , max_frames_bytes(0)
     {
+        eq[0] = eq[1] = eq[2] = 0;
     }
     ~VideoThreadPrivate() {
         //not neccesary context is managed by filters.
@@ -55,7 +73,6 @@ public:
         }
     }
 
-    VideoFrameConverter conv;
     qreal force_fps; // <=0: try to use pts. if no pts in stream(guessed by 5 packets), use |force_fps|
     // not const.
     int force_dt; //unit: ms. force_fps = 1/force_dt.
@@ -64,6 +81,25 @@ public:
     VideoCapture *capture;
     VideoFilterContext *filter_context;//TODO: use own smart ptr. QSharedPointer "=" is ugly
     VideoFrame displayed_frame;
+    // decode ahead queue. decoding can run ahead of presentation to absorb decoding time spikes
+    QQueue<DecodedFrame> frames;
+    qint64 frames_bytes;
+    int max_frames; // <=1: no decode ahead
+    qint64 max_frames_bytes; // <=0: no limit
+    int eq[3]; // brightness, contrast, saturation. applied to outputSet when the thread starts
+
+    void clearFrames() {
+        frames.clear();
+        frames_bytes = 0;
+    }
+    bool framesFull() const {
+        if (frames.size() >= qMax(1, max_frames))
+            return true;
+        // hw surfaces are limited and shared with decoder, do not hold more than 1
+        if (!frames.isEmpty() && !frames.last().frame.constBits(0))
+            return true;
+        return max_frames_bytes > 0 && frames_bytes >= max_frames_bytes;
+    }
 };
 
 VideoThread::VideoThread(QObject *parent) :
@@ -138,6 +174,23 @@ void VideoThread::setFrameRate(qreal value)
     }
 }
 
+void VideoThread::setDecodeAhead(int frames, qint64 bytes)
+{
+    DPTR_D(VideoThread);
+    d.max_frames = frames;
+    d.max_frames_bytes = bytes;
+}
+
+int VideoThread::decodeAheadFrames() const
+{
+    return d_func().max_frames;
+}
+
+qint64 VideoThread::decodeAheadBytes() const
+{
+    return d_func().max_frames_bytes;
+}
+
 void VideoThread::setBrightness(int val)
 {
     setEQ(val, 101, 101);
@@ -157,23 +210,32 @@ void VideoThread::setEQ(int b, int c, int s)
 {
     class EQTask : public QRunnable {
     public:
-        EQTask(VideoFrameConverter *c)
+        EQTask(OutputSet *s)
             : brightness(0)
             , contrast(0)
             , saturation(0)
-            , conv(c)
+            , outset(s)
         {
             //qDebug("EQTask tid=%p", QThread::currentThread());
         }
         void run() {
-            conv->setEq(brightness, contrast, saturation);
+            outset->setEq(brightness, contrast, saturation);
         }
         int brightness, contrast, saturation;
     private:
-        VideoFrameConverter *conv;
+        OutputSet *outset;
     };
     DPTR_D(VideoThread);
-    EQTask *task = new EQTask(&d.conv);
+    // out of range values are ignored, as OutputSet::setEq()
+    if (b >= -100 && b <= 100)
+        d.eq[0] = b;
+    if (c >= -100 && c <= 100)
+        d.eq[1] = c;
+    if (s >= -100 && s <= 100)
+        d.eq[2] = s;
+    if (!d.outputSet) // applied in run()
+        return;
+    EQTask *task = new EQTask(d.outputSet);
     task->brightness = b;
     task->contrast = c;
     task->saturation = s;
@@ -188,6 +250,7 @@ void VideoThread::setEQ(int b, int c, int s)
 void VideoThread::applyFilters(VideoFrame &frame)
 {
     DPTR_D(VideoThread);
+    QTAV_TRACE("video", "filter");
     QMutexLocker locker(&d.mutex);
     Q_UNUSED(locker);
     if (!d.filters.isEmpty()) {
@@ -206,38 +269,29 @@ void VideoThread::applyFilters(VideoFrame &frame)
 bool VideoThread::deliverVideoFrame(VideoFrame &frame)
 {
     DPTR_D(VideoThread);
-    /*
-     * TODO: video renderers sorted by preferredPixelFormat() and convert in AVOutputSet.
-     * Convert only once for the renderers has the same preferredPixelFormat().
-     */
+    QTAV_TRACE("video", "deliver");
+    // renderers are grouped by format in OutputSet, frame is converted only once for the renderers have the same format
     d.outputSet->lock();
-    QList<AVOutput *> outputs = d.outputSet->outputs();
-    VideoRenderer *vo = 0;
-    if (!outputs.isEmpty())
-        vo = static_cast<VideoRenderer*>(outputs.first());
-    if (vo && (!vo->isSupported(frame.pixelFormat())
-            || (vo->isPreferredPixelFormatForced() && vo->preferredPixelFormat() != frame.pixelFormat())
-            )) {
-        VideoFormat fmt(frame.format());
-        if (fmt.hasPalette() || fmt.isRGB())
-            fmt = VideoFormat::Format_RGB32;
-        else
-            fmt = vo->preferredPixelFormat();
-        VideoFrame outFrame(d.conv.convert(frame, fmt));
-        if (!outFrame.isValid()) {
-            d.outputSet->unlock();
-            return false;
-        }
-        frame = outFrame;
-    }
     frame.statistics = d.statistics;
-    d.outputSet->sendVideoFrame(frame); //TODO: group by format, convert group by group
+    const bool ok = d.outputSet->sendVideoFrame(frame);
     d.outputSet->unlock();
+    if (!ok)
+        return false;
 
     Q_EMIT frameDelivered();
     return true;
 }
 
+static qint64 frameBytes(const VideoFrame& frame)
+{
+    if (!frame.constBits(0))
+        return 0;
+    qint64 bytes = 0;
+    for (int i = 0; i < frame.planeCount(); ++i)
+        bytes += qint64(frame.bytesPerLine(i))*qint64(frame.planeHeight(i));
+    return bytes;
+}
+
 //TODO: if output is null or dummy, the use duration to wait
 void VideoThread::run()
 {
@@ -245,6 +299,8 @@ void VideoThread::run()
     if (!d.dec || !d.dec->isAvailable() || !d.outputSet)
         return;
     resetState();
+    d.clearFrames();
+    d.outputSet->setEq(d.eq[0], d.eq[1], d.eq[2]); // eq can be set before the output set
     if (d.capture->autoSave()) {
         d.capture->setCaptureName(QFileInfo(d.statistics->url).completeBaseName());
     }
@@ -278,6 +334,7 @@ void VideoThread::run()
     const char* pkt_data = NULL; // workaround for libav9 decode fail but error code >= 0
     qint64 last_deliver_time = 0;
     int sync_id = 0;
+    bool eof_drained = false; // eof packet is decoded and no more frame from decoder, present the queued frames
     while (!d.stop) {
         processNextTask();
         //TODO: why put it at the end of loop then stepForward() not work?
@@ -294,6 +351,8 @@ void VideoThread::run()
             d.seek_requested = false;
             qDebug("request seek video thread");
             pkt = Packet(); // last decode failed and pkt is valid, reset pkt to force take the next packet if seek is requested
+            d.clearFrames(); // frames before seek target
+            eof_drained = false;
             msleep(1);
         } else {
             // d.render_pts0 < 0 means seek finished here
@@ -308,6 +367,150 @@ void VideoThread::run()
                 sync_id = 0;
             }
         }
+        if (d.clock->clockType() == AVClock::AudioClock) {
+            sync_audio = true;
+            sync_video = false;
+        } else if (d.clock->clockType() == AVClock::VideoClock) {
+            sync_audio = false;
+            sync_video = true;
+        } else {
+            sync_audio = false;
+            sync_video = false;
+        }
+        /*
+         * Present the oldest decoded frame if the queue is full, the frame is due, or decoding can not go ahead
+         * without blocking (no packet available, or all frames are drained from decoder at eof).
+         * The seek target frame is presented immediately.
+         * Otherwise decode the next packet into the queue.
+         */
+        if (!d.frames.isEmpty()) {
+            const qreal head_dts = d.frames.head().dts;
+            const bool seeking = d.render_pts0 >= 0.0;
+            const bool due = head_dts <= 0 || head_dts - d.clock->value() + v_a <= kSyncThreshold;
+            const bool starving = !pkt.isValid() && !pkt.isEOF() && d.packets.isEmpty();
+            if (d.framesFull() || due || starving || eof_drained || seeking) {
+                const DecodedFrame df = d.frames.dequeue();
+                d.frames_bytes -= df.bytes;
+                VideoFrame frame = df.frame;
+                const qreal dts = df.dts;
+                // if dts is invalid, diff can be very small (<0) and video will be rendered immediately
+                qreal diff = dts > 0 ? dts - d.clock->value() + v_a : v_a;
+                if (diff < 0 && sync_video)
+                    diff = 0; // this ensures no frame drop
+                if (seeking)
+                    diff = 0;
+                if (!sync_audio && diff > 0) {
+                    // wait to dts reaches
+                    // d.force_fps>0: wait before deliver
+                    if (d.force_fps <= 0)
+                        waitAndCheck(diff*1000UL, dts);
+                    diff = 0;
+                }
+                // update here after wait. TODO: use guessed next pts?
+                d.clock->updateVideoTime(dts); // FIXME: dts or pts?
+                bool skip_render = false;
+                if (qAbs(diff) >= 0.5 && !seeking) { //when to drop off?
+                    qDebug("delay %fs @%.3fs pts:%.3f", diff, d.clock->value(), frame.timestamp());
+                    if (diff < 0) {
+                        if (nb_dec_slow > kNbSlowSkip) {
+                            skip_render = !df.key && (nb_dec_slow %2);
+                        }
+                    } else {
+                        const double s = qMin<qreal>(0.01*(nb_dec_fast>>1), diff);
+                        qWarning("video too fast!!! sleep %.2f s, nb fast: %d, v_a: %.4f", s, nb_dec_fast, v_a);
+                        waitAndCheck(s*1000UL, dts);
+                        diff = 0;
+                    }
+                }
+                // late frame: drop it if the next decoded frame is already late too, showing the next one is closer to the clock
+                if (!skip_render && !seeking && sync_audio && diff < -kSyncThreshold && !d.frames.isEmpty()) {
+                    const qreal next_dts = d.frames.head().dts;
+                    if (next_dts > 0 && next_dts - d.clock->value() + v_a < 0)
+                        skip_render = true;
+                }
+                //audio packet not cleaned up?
+                if (diff > 0 && diff < 1.0 && !seeking) {
+                    waitAndCheck(diff*1000UL, dts);
+                }
+                if (skip_render) {
+                    qDebug("skip rendering @%.3f", frame.timestamp());
+                    d.statistics->counters()->frames_dropped.ref();
+                    v_a = 0;
+                    continue;
+                }
+                d.pts_history.push_back(df.pts_us);
+                if (seeking && df.seek_target) {
+                    d.render_pts0 = -1;
+                    qDebug("video seek finished @%lld us. id: %d", df.pts_us, sync_id);
+                    d.clock->syncEndOnce(sync_id);
+                    Q_EMIT seekFinished(df.pts_us/1000LL);
+                    if (seek_count == -1)
+                        seek_count = 1;
+                    else if (seek_count > 0)
+                        seek_count++;
+                }
+                Q_ASSERT(d.statistics);
+                if (!seeking && diff < -kSyncThreshold)
+                    d.statistics->counters()->frames_late.ref();
+                d.statistics->video.current_time = QTime(0, 0, 0).addMSecs(int(frame.timestampUs()/1000LL)); //TODO: is it expensive?
+                //while can pause, processNextTask, not call outset.puase which is deperecated
+                while (d.outputSet->canPauseThread()) {
+                    d.outputSet->pauseThread(100);
+                    //tryPause(100);
+                    processNextTask();
+                }
+                //qDebug("force fps: %f dt: %d", d.force_fps, d.force_dt);
+                if (d.force_dt > 0) {// && qFuzzyCompare(d.clock->speed(), 1.0)) {
+                    const qint64 now = QDateTime::currentMSecsSinceEpoch();
+                    const qint64 delta = qint64(d.force_dt) - (now - last_deliver_time);
+                    if (frame.timestamp() <= 0) {
+                        // TODO: what if seek happens during playback?
+                        const int msecs_started(now + qMax(0LL, delta) - start_time);
+                        frame.setTimestampUs(msecs_started*1000LL);
+                        clock()->updateValue(frame.timestamp()); //external clock?
+                    }
+                    if (delta > 0LL) { // limit up bound?
+                        waitAndCheck((ulong)delta, -1); // wait and not compare pts-clock
+                    }
+                }
+                // no return even if d.stop is true. ensure frame is displayed. otherwise playing an image may be failed to display
+                if (!deliverVideoFrame(frame))
+                    continue;
+                //qDebug("clock.diff: %.3f", d.clock->diff());
+                if (d.force_dt > 0)
+                    last_deliver_time = QDateTime::currentMSecsSinceEpoch();
+                d.statistics->counters()->setSyncError(frame.timestamp() - d.clock->value());
+                // TODO: store original frame. now the frame is filtered and maybe converted to renderer perferred format
+                d.displayed_frame = frame;
+                if (d.clock->clockType() == AVClock::AudioClock) {
+                    const qreal v_a_ = frame.timestamp() - d.clock->value();
+                    if (!qFuzzyIsNull(v_a_)) {
+                        if (v_a_ < -0.1) {
+                            if (v_a <= v_a_)
+                                v_a += -0.01;
+                            else
+                                v_a = (v_a_ +v_a)*0.5;
+                        } else if (v_a_ < -0.002) {
+                            v_a += -0.001;
+                        } else if (v_a_ < 0.002) {
+                        } else if (v_a_ < 0.1) {
+                            v_a += 0.001;
+                        } else {
+                            if (v_a >= v_a_)
+                                v_a += 0.01;
+                            else
+                                v_a = (v_a_ +v_a)*0.5;
+                        }
+
+                        if (v_a < -2 || v_a > 2)
+                           v_a /= 2.0;
+                    }
+                    //qDebug("v_a:%.4f, v_a_: %.4f", v_a, v_a_);
+                }
+                continue;
+            }
+        }
+        eof_drained = false;
         if(!pkt.isValid() && !pkt.isEOF()) { // can't seek back if eof packet is read
             pkt = d.packets.take(); //wait to dequeue
            // TODO: push pts history here and reorder
@@ -321,13 +524,14 @@ void VideoThread::run()
             if (!pkt.isValid()) {
                 // may be we should check other information. invalid packet can come from
                 wait_key_frame = true;
-                qDebug("Invalid packet! flush video codec context!!!!!!!!!! video packet queue size: %d", d.packets.size());  
+                qDebug("Invalid packet! flush video codec context!!!!!!!!!! video packet queue size: %d", d.packets.size());
                 d.dec->flush(); //d.dec instead of dec because d.dec maybe changed in processNextTask() but dec is not
+                d.clearFrames();
                 d.render_pts0 = pkt.pts;
                 sync_id = pkt.position;
                 if (pkt.pts >= 0)
                     qDebug("video seek: %.3f, id: %d", d.render_pts0, sync_id);
-                d.pts_history = ring<qreal>(d.pts_history.capacity());
+                d.pts_history = ring<qint64>(d.pts_history.capacity());
                 v_a = 0;
                 continue;
             }
@@ -346,20 +550,9 @@ void VideoThread::run()
             else if (d.force_fps == 0)
                 setFrameRate(24);
         }
-
-        if (d.clock->clockType() == AVClock::AudioClock) {
-            sync_audio = true;
-            sync_video = false;
-        } else if (d.clock->clockType() == AVClock::VideoClock) {
-            sync_audio = false;
-            sync_video = true;
-        } else {
-            sync_audio = false;
-            sync_video = false;
-        }
         const qreal dts = pkt.dts; //FIXME: pts and dts
         // TODO: delta ref time
-        // if dts is invalid, diff can be very small (<0) and video will be decoded and rendered(display_wait is disabled for now) immediately
+        // decoding runs ahead of presentation, so diff is how far decoding is ahead of the clock. waiting for display is in the present step
         qreal diff = dts > 0 ? dts - d.clock->value() + v_a : v_a;
         if (pkt.isEOF())
             diff = qMin<qreal>(1.0, qMax<qreal>(d.delay, 1.0/d.statistics->video_only.currentDisplayFPS()));
@@ -401,45 +594,6 @@ void VideoThread::run()
         }
         // can not change d.delay after! we need it to comapre to next loop
         d.delay = diff;
-        /*
-         *after seeking forward, a packet may be the old, v packet may be
-         *the new packet, then the d.delay is very large, omit it.
-        */
-        if (seeking)
-            diff = 0; // TODO: here?
-        if (!sync_audio && diff > 0) {
-            // wait to dts reaches
-            // d.force_fps>0: wait after decoded before deliver
-            if (d.force_fps <= 0)// || !qFuzzyCompare(d.clock->speed(), 1.0))
-                waitAndCheck(diff*1000UL, dts); // TODO: count decoding and filter time, or decode immediately but wait for display
-            diff = 0; // TODO: can not change delay!
-        }
-        // update here after wait. TODO: use decoded timestamp/guessed next pts?
-        d.clock->updateVideoTime(dts); // FIXME: dts or pts?
-        bool skip_render = false;
-        if (qAbs(diff) < 0.5) {
-            if (diff < -kSyncThreshold) { //Speed up. drop frame?
-                //continue;
-            }
-        } else if (!seeking) { //when to drop off?
-            qDebug("delay %fs @%.3fs pts:%.3f", diff, d.clock->value(), pkt.pts);
-            if (diff < 0) {
-                if (nb_dec_slow > kNbSlowSkip) {
-                    skip_render = !pkt.hasKeyFrame && (nb_dec_slow %2);
-                }
-            } else {
-                const double s = qMin<qreal>(0.01*(nb_dec_fast>>1), diff);
-                qWarning("video too fast!!! sleep %.2f s, nb fast: %d, v_a: %.4f", s, nb_dec_fast, v_a);
-                waitAndCheck(s*1000UL, dts);
-                diff = 0;
-                skip_render = false;
-            }
-        }
-        //audio packet not cleaned up?
-        if (diff > 0 && diff < 1.0 && !seeking) {
-            // can not change d.delay here! we need it to comapre to next loop
-            waitAndCheck(diff*1000UL, dts);
-        }
         if (wait_key_frame) {
             if (!pkt.hasKeyFrame) {
                 qDebug("waiting for key frame. queue size: %d. pkt.size: %d", d.packets.size(), pkt.data.size());
@@ -487,17 +641,32 @@ void VideoThread::run()
         }
         if (dec_opt != dec_opt_old)
             dec->setOptions(*dec_opt);
-        if (!dec->decode(pkt)) {
+        QTAV_TRACE_VAR(trace_decode, "video", "decode");
+        QElapsedTimer dec_timer;
+        dec_timer.start();
+        const bool dec_ok = dec->decode(pkt);
+        trace_decode.end();
+        if (dec_ok)
+            d.statistics->counters()->decode_time.add(dec_timer.nsecsElapsed()/1000LL);
+        if (!dec_ok) {
+            if (pkt.isEOF() && !d.frames.isEmpty()) {
+                // all frames are decoded. keep the eof packet until queued frames are presented
+                eof_drained = true;
+                continue;
+            }
             d.pts_history.push_back(d.pts_history.back());
             //qWarning("Decode video failed. undecoded: %d/%d", dec->undecodedSize(), pkt.data.size());
             if (pkt.isEOF()) {
+                // display the last frame for a while
+                if (diff > 0 && diff < 1.0 && !seeking)
+                    waitAndCheck(diff*1000UL, -1);
                 Q_EMIT eofDecoded();
                 qDebug("video decode eof done. d.render_pts0: %.3f", d.render_pts0);
                 if (d.render_pts0 >= 0) {
-                    qDebug("video seek done at eof pts: %.3f. id: %d", d.pts_history.back(), sync_id);
+                    qDebug("video seek done at eof pts: %lld us. id: %d", d.pts_history.back(), sync_id);
                     d.render_pts0 = -1;
                     d.clock->syncEndOnce(sync_id);
-                    Q_EMIT seekFinished(qint64(d.pts_history.back()*1000.0));
+                    Q_EMIT seekFinished(d.pts_history.back()/1000LL);
                     if (seek_count == -1)
                         seek_count = 1;
                     else if (seek_count > 0)
@@ -524,99 +693,28 @@ void VideoThread::run()
             continue;
         }
         pkt_data = pkt.data.constData();
-        if (frame.timestamp() <= 0)
-            frame.setTimestamp(pkt.pts); // pkt.pts is wrong. >= real timestamp
+        d.statistics->counters()->frames_decoded.ref();
+        if (frame.timestampUs() <= 0)
+            frame.setTimestampUs(pkt.ptsUs()); // pkt.pts is wrong. >= real timestamp
         const qreal pts = frame.timestamp();
-        d.pts_history.push_back(pts);
-        // seek finished because we can ensure no packet before seek decoded when render_pts0 is set
+        // no packet before seek is decoded when render_pts0 is set. the 1st frame not before the target finishes seeking when it is presented
         //qDebug("pts0: %f, pts: %f, clock: %d", d.render_pts0, pts, d.clock->clockType());
-        if (d.render_pts0 >= 0.0) {
-            if (pts < d.render_pts0) {
-                if (!pkt.isEOF())
-                    pkt = Packet();
-                v_a = 0;
-                continue;
-            }
-            d.render_pts0 = -1;
-            qDebug("video seek finished @%f. id: %d", pts, sync_id);
-            d.clock->syncEndOnce(sync_id);
-            Q_EMIT seekFinished(qint64(pts*1000.0));
-            if (seek_count == -1)
-                seek_count = 1;
-            else if (seek_count > 0)
-                seek_count++;
-        }
-        if (skip_render) {
-            qDebug("skip rendering @%.3f", pts);
-            pkt = Packet();
+        if (d.render_pts0 >= 0.0 && pts < d.render_pts0) {
+            if (!pkt.isEOF())
+                pkt = Packet();
             v_a = 0;
             continue;
         }
-        Q_ASSERT(d.statistics);
-        d.statistics->video.current_time = QTime(0, 0, 0).addMSecs(int(pts * 1000.0)); //TODO: is it expensive?
         applyFilters(frame);
-
-        //while can pause, processNextTask, not call outset.puase which is deperecated
-        while (d.outputSet->canPauseThread()) {
-            d.outputSet->pauseThread(100);
-            //tryPause(100);
-            processNextTask();
-        }
-        //qDebug("force fps: %f dt: %d", d.force_fps, d.force_dt);
-        if (d.force_dt > 0) {// && qFuzzyCompare(d.clock->speed(), 1.0)) {
-            const qint64 now = QDateTime::currentMSecsSinceEpoch();
-            const qint64 delta = qint64(d.force_dt) - (now - last_deliver_time);
-            if (frame.timestamp() <= 0) {
-                // TODO: what if seek happens during playback?
-                const int msecs_started(now + qMax(0LL, delta) - start_time);
-                frame.setTimestamp(qreal(msecs_started)/1000.0);
-                clock()->updateValue(frame.timestamp()); //external clock?
-            }
-            if (delta > 0LL) { // limit up bound?
-                waitAndCheck((ulong)delta, -1); // wait and not compare pts-clock
-            }
-        } else if (false) { //FIXME: may block a while when seeking
-            const qreal display_wait = pts - clock()->value();
-            if (!seeking && display_wait > 0.0) {
-                // wait to pts reaches. TODO: count rendering time
-                //qDebug("wait %f to display for pts %f-%f", display_wait, pts, clock()->value());
-                if (display_wait < 1.0)
-                    waitAndCheck(display_wait*1000UL, pts); // TODO: count decoding and filter time
-            }
-        }
-        // no return even if d.stop is true. ensure frame is displayed. otherwise playing an image may be failed to display
-        if (!deliverVideoFrame(frame))
-            continue;
-        //qDebug("clock.diff: %.3f", d.clock->diff());
-        if (d.force_dt > 0)
-            last_deliver_time = QDateTime::currentMSecsSinceEpoch();
-        // TODO: store original frame. now the frame is filtered and maybe converted to renderer perferred format
-        d.displayed_frame = frame;
-        if (d.clock->clockType() == AVClock::AudioClock) {
-            const qreal v_a_ = frame.timestamp() - d.clock->value();
-            if (!qFuzzyIsNull(v_a_)) {
-                if (v_a_ < -0.1) {
-                    if (v_a <= v_a_)
-                        v_a += -0.01;
-                    else
-                        v_a = (v_a_ +v_a)*0.5;
-                } else if (v_a_ < -0.002) {
-                    v_a += -0.001;
-                } else if (v_a_ < 0.002) {
-                } else if (v_a_ < 0.1) {
-                    v_a += 0.001;
-                } else {
-                    if (v_a >= v_a_)
-                        v_a += 0.01;
-                    else
-                        v_a = (v_a_ +v_a)*0.5;
-                }
-
-                if (v_a < -2 || v_a > 2)
-                   v_a /= 2.0;
-            }
-            //qDebug("v_a:%.4f, v_a_: %.4f", v_a, v_a_);
-        }
+        DecodedFrame df;
+        df.frame = frame;
+        df.dts = dts;
+        df.pts_us = frame.timestampUs();
+        df.key = pkt.hasKeyFrame;
+        df.seek_target = d.render_pts0 >= 0.0;
+        df.bytes = frameBytes(frame);
+        d.frames.enqueue(df);
+        d.frames_bytes += df.bytes;
     }
 #if 0
     if (d.stop) {// user stop
@@ -627,6 +725,7 @@ void VideoThread::run()
     }
 #endif
     d.packets.clear();
+    d.clearFrames();
     qDebug("Video thread stops running...");
 }
 
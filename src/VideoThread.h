@@ -41,6 +41,13 @@ public:
     VideoCapture *videoCapture() const;
     VideoFrame displayedFrame() const;
     void setFrameRate(qreal value);
+    /*!
+     * \brief setDecodeAhead
+     * Max decoded frames (and bytes if > 0) waiting for presentation. frames <= 1: no decode ahead
+     */
+    void setDecodeAhead(int frames, qint64 bytes = 0);
+    int decodeAheadFrames() const;
+    qint64 decodeAheadBytes() const;
     //virtual bool event(QEvent *event);
     void setBrightness(int val);
     void setContrast(int val);
@@ -21,6 +21,7 @@
 
 #include <QtAV/AVDecoder.h>
 #include <QtAV/private/AVDecoder_p.h>
+#include <QtAV/Packet.h>
 #include <QtAV/version.h>
 #include "utils/internal.h"
 #include "utils/Logger.h"
@@ -150,7 +151,25 @@ void AVDecoder::flush()
         return;
     if (!isOpen())
         return;
-    avcodec_flush_buffers(d_func().codec_ctx);
+    DPTR_D(AVDecoder);
+    d.clearFrames();
+    d.frame_ready = false;
+    avcodec_flush_buffers(d.codec_ctx);
+}
+
+bool AVDecoder::sendPacket(const Packet &packet)
+{
+    DPTR_D(AVDecoder);
+    d.frame_ready = decode(packet);
+    return true;
+}
+
+bool AVDecoder::receiveFrame()
+{
+    DPTR_D(AVDecoder);
+    const bool ready = d.frame_ready;
+    d.frame_ready = false;
+    return ready;
 }
 
 /*
@@ -275,4 +294,126 @@ void AVDecoderPrivate::applyOptionsForContext()
     // TODO: wrong if opt is empty
     Internal::setOptionsToFFmpegObj(options.value(QStringLiteral("avcodec")), codec_ctx);
 }
+
+bool AVDecoderPrivate::sendPacket(const Packet &packet)
+{
+    const bool eof = packet.isEOF();
+    if (eof) {
+        if (draining) // already sent
+            return true;
+        draining = true;
+    }
+    AVPacket eofpkt;
+    av_init_packet(&eofpkt);
+    eofpkt.data = NULL;
+    eofpkt.size = 0;
+    // const AVPacket*: ffmpeg >= 1.0. no libav
+    AVPacket *pkt = eof ? &eofpkt : (AVPacket*)packet.asAVPacket();
+#if QTAV_HAVE(AVCODEC_SEND_RECEIVE)
+    int ret = avcodec_send_packet(codec_ctx, eof ? NULL : pkt);
+    // EAGAIN: can not happen because all frames are received after a packet is sent
+    if (ret < 0 && ret != AVERROR_EOF) {
+        qWarning("avcodec_send_packet error: %s", av_err2str(ret));
+        return false;
+    }
+    while (true) {
+        AVFrame *f = free_frames.isEmpty() ? av_frame_alloc() : free_frames.takeLast();
+        ret = avcodec_receive_frame(codec_ctx, f);
+        if (ret < 0) {
+            free_frames.append(f);
+            break;
+        }
+        frames.enqueue(f);
+    }
+    if (ret != AVERROR(EAGAIN) && ret != AVERROR_EOF) {
+        qWarning("avcodec_receive_frame error: %s", av_err2str(ret));
+        return false;
+    }
+#else
+    // a video packet is always decoded completely. an audio packet may contain multiple frames
+    AVPacket p = *pkt;
+    while (true) {
+        if (!enableFrameRef()) // frame data is owned by codec and will be invalid in the next decoding
+            clearFrames();
+        AVFrame *f = free_frames.isEmpty() ? av_frame_alloc() : free_frames.takeLast();
+        int got_frame_ptr = 0;
+        int ret = 0;
+        if (codec_ctx->codec_type == AVMEDIA_TYPE_AUDIO)
+            ret = avcodec_decode_audio4(codec_ctx, f, &got_frame_ptr, &p);
+        else
+            ret = avcodec_decode_video2(codec_ctx, f, &got_frame_ptr, &p);
+        if (got_frame_ptr)
+            frames.enqueue(f);
+        else
+            free_frames.append(f);
+        if (ret < 0) {
+            qWarning("decode error: %s", av_err2str(ret));
+            return false;
+        }
+        if (eof) { // flush all delayed frames
+            if (!got_frame_ptr)
+                break;
+            continue;
+        }
+        if (codec_ctx->codec_type != AVMEDIA_TYPE_AUDIO || ret == 0 || ret >= p.size)
+            break;
+        p.data += ret;
+        p.size -= ret;
+    }
+#endif //QTAV_HAVE(AVCODEC_SEND_RECEIVE)
+    return true;
+}
+
+bool AVDecoderPrivate::receiveFrame(AVFrame *frame)
+{
+    if (frames.isEmpty())
+        return false;
+    AVFrame *f = frames.dequeue();
+#if QTAV_HAVE(AVBUFREF)
+    av_frame_unref(frame);
+    av_frame_move_ref(frame, f);
+#else
+    qSwap(*frame, *f);
+#endif
+    free_frames.append(f);
+    return true;
+}
+
+bool AVDecoderPrivate::isRestOfPacket(const Packet &packet)
+{
+    if (frames.isEmpty())
+        return false;
+    bool rest = draining;
+    if (!packet.isEOF()) {
+        // the same data or the tail of sent packet after Packet::skip()
+        const char *p0 = sent_packet.data.constData();
+        const char *p = packet.data.constData();
+        rest = p0 && p >= p0 && p + packet.data.size() == p0 + sent_packet.data.size()
+                && (packet.position < 0 || sent_packet.position < 0 || packet.position - sent_packet.position == p - p0);
+    }
+    if (rest)
+        return true;
+    clearFrames();
+    return false;
+}
+
+void AVDecoderPrivate::setUndecodedSize(const Packet &packet)
+{
+    undecoded_size = frames.isEmpty() || packet.isEOF() ? 0 : packet.data.size();
+    if (frames.isEmpty())
+        sent_packet = Packet();
+}
+
+void AVDecoderPrivate::clearFrames()
+{
+    while (!frames.isEmpty()) {
+        AVFrame *f = frames.dequeue();
+#if QTAV_HAVE(AVBUFREF)
+        av_frame_unref(f);
+#endif
+        free_frames.append(f);
+    }
+    draining = false;
+    sent_packet = Packet();
+}
 } //namespace QtAV
@@ -48,6 +48,8 @@ public:
                 .arg(QTAV_VERSION_MAJOR(avcodec_version())).arg(QTAV_VERSION_MINOR(avcodec_version())).arg(patch);
     }
     bool decode(const Packet& packet) Q_DECL_OVERRIDE Q_DECL_FINAL;
+    bool sendPacket(const Packet& packet) Q_DECL_OVERRIDE Q_DECL_FINAL;
+    bool receiveFrame() Q_DECL_OVERRIDE Q_DECL_FINAL;
     AudioFrame frame() Q_DECL_OVERRIDE Q_DECL_FINAL;
 Q_SIGNALS:
     void codecNameChanged() Q_DECL_OVERRIDE Q_DECL_FINAL;
@@ -93,30 +95,41 @@ bool AudioDecoderFFmpeg::decode(const Packet &packet)
         return false;
     DPTR_D(AudioDecoderFFmpeg);
     d.decoded.clear();
-    int got_frame_ptr = 0;
-    int ret = 0;
-    if (packet.isEOF()) {
-        AVPacket eofpkt;
-        av_init_packet(&eofpkt);
-        eofpkt.data = NULL;
-        eofpkt.size = 0;
-        ret = avcodec_decode_audio4(d.codec_ctx, d.frame, &got_frame_ptr, &eofpkt);
-    } else {
-    // const AVPacket*: ffmpeg >= 1.0. no libav
-        ret = avcodec_decode_audio4(d.codec_ctx, d.frame, &got_frame_ptr, (AVPacket*)packet.asAVPacket());
+    d.undecoded_size = 0;
+    if (!d.isRestOfPacket(packet)) {
+        d.sent_packet = packet;
+        if (!sendPacket(packet))
+            return false;
     }
-    d.undecoded_size = qMin(packet.data.size() - ret, packet.data.size());
-    if (ret == AVERROR(EAGAIN)) {
+    // if more than 1 frame is decoded, undecodedSize() > 0 and the rest are returned in the next calls with the same packet
+    const bool got = receiveFrame();
+    d.setUndecodedSize(packet);
+    if (got)
+        return true;
+    if (packet.isEOF())
         return false;
-    }
-    if (ret < 0) {
-        qWarning("[AudioDecoder] %s", av_err2str(ret));
+    // need more data. frame() is invalid
+#if QTAV_HAVE(AVBUFREF)
+    av_frame_unref(d.frame);
+#else
+    d.frame->format = -1;
+#endif
+    return true;
+}
+
+bool AudioDecoderFFmpeg::sendPacket(const Packet &packet)
+{
+    if (!isAvailable())
+        return false;
+    return d_func().sendPacket(packet);
+}
+
+bool AudioDecoderFFmpeg::receiveFrame()
+{
+    DPTR_D(AudioDecoderFFmpeg);
+    d.decoded.clear();
+    if (!d.receiveFrame(d.frame))
         return false;
-    }
-    if (!got_frame_ptr) {
-        qWarning("[AudioDecoder] got_frame_ptr=false. decoded: %d, un: %d %s", ret, d.undecoded_size, av_err2str(ret));
-        return !packet.isEOF();
-    }
 #if USE_AUDIO_FRAME
     return true;
 #endif
@@ -126,7 +139,6 @@ bool AudioDecoderFFmpeg::decode(const Packet &packet)
     }
     d.decoded = d.resampler->outData();
     return true;
-    return !d.decoded.isEmpty();
 }
 
 AudioFrame AudioDecoderFFmpeg::frame()
@@ -145,7 +157,7 @@ AudioFrame AudioDecoderFFmpeg::frame()
     f.setBytesPerLine(d.frame->linesize[0], 0); // for correct alignment
     f.setSamplesPerChannel(d.frame->nb_samples);
     // TODO: ffplay check AVFrame.pts, pkt_pts, last_pts+nb_samples. move to AudioFrame::from(AVFrame*)
-    f.setTimestamp((double)d.frame->pkt_pts/1000.0);
+    f.setTimestampUs(d.frame->pkt_pts);
     f.setAudioResampler(d.resampler); // TODO: remove. it's not safe if frame is shared. use a pool or detach if ref >1
     return f;
 }
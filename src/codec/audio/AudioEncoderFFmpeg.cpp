@@ -189,7 +189,7 @@ bool AudioEncoderFFmpeg::encode(const AudioFrame &frame)
         f->nb_samples = d.frame_size;
         /// f->quality = d.avctx->global_quality; //TODO
         // TODO: record last pts. mpv compute pts internally and also use playback time
-        f->pts = int64_t(frame.timestamp()*fmt.sampleRate()); // TODO
+        f->pts = av_rescale(frame.timestampUs(), fmt.sampleRate(), AV_TIME_BASE); // TODO
         // pts is set in muxer
         const int nb_planes = frame.planeCount();
         // bytes between 2 samples on a plane. TODO: add to AudioFormat? what about bytesPerFrame?
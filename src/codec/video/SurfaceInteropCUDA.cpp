@@ -83,7 +83,7 @@ void* InteropResource::mapToHost(const VideoFormat &format, void *handle, int pi
     frame.setBytesPerLine(pitches);
 
     VideoFrame *f = reinterpret_cast<VideoFrame*>(handle);
-    frame.setTimestamp(f->timestamp());
+    frame.setTimestampUs(f->timestampUs());
     frame.setDisplayAspectRatio(f->displayAspectRatio());
     if (format == frame.format())
         *f = frame.clone();
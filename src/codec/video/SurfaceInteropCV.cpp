@@ -203,7 +203,7 @@ void* SurfaceInteropCV::mapToHost(const VideoFormat &format, void *handle, int p
     if (fmt != format)
         frame = frame.to(format);
     VideoFrame *f = reinterpret_cast<VideoFrame*>(handle);
-    frame.setTimestamp(f->timestamp());
+    frame.setTimestampUs(f->timestampUs());
     frame.setDisplayAspectRatio(f->displayAspectRatio());
     *f = frame;
     return f;
@@ -410,7 +410,7 @@ bool VideoDecoderCUDA::decode(const Packet &packet)
     // TODO: other flags
     if (packet.pts >= 0.0) {
         cuvid_pkt.flags = CUVID_PKT_TIMESTAMP;
-        cuvid_pkt.timestamp = packet.pts * 1000.0; // TODO: 10MHz?
+        cuvid_pkt.timestamp = packet.ptsUs(); // TODO: 10MHz?
     }
     //TODO: fill NALU header for h264? https://devtalk.nvidia.com/default/topic/515571/what-the-data-format-34-cuvidparsevideodata-34-can-accept-/
     d.doParseVideoData(&cuvid_pkt);
@@ -759,7 +759,7 @@ bool VideoDecoderCUDAPrivate::processDecodedData(CUVIDPARSERDISPINFO *cuviddisp,
             frame.setBytesPerLine(pitches);
             frame.setColorRange(yuv_range);
         }
-        frame.setTimestamp((double)cuviddisp->timestamp/1000.0);
+        frame.setTimestampUs(cuviddisp->timestamp);
         if (codec_ctx && codec_ctx->sample_aspect_ratio.num > 1) //skip 1/1 because is the default value
             frame.setDisplayAspectRatio(frame.displayAspectRatio()*av_q2d(codec_ctx->sample_aspect_ratio));
         if (copy_mode == VideoDecoderCUDA::GenericCopy)
@@ -116,31 +116,42 @@ bool VideoDecoderFFmpegBase::decode(const Packet &packet)
     if (!isAvailable())
         return false;
     DPTR_D(VideoDecoderFFmpegBase);
-    // some decoders might need other fields like flags&AV_PKT_FLAG_KEY
-    // const AVPacket*: ffmpeg >= 1.0. no libav
-    int got_frame_ptr = 0;
-    int ret = 0;
-    if (packet.isEOF()) {
-        AVPacket eofpkt;
-        av_init_packet(&eofpkt);
-        eofpkt.data = NULL;
-        eofpkt.size = 0;
-        ret = avcodec_decode_video2(d.codec_ctx, d.frame, &got_frame_ptr, &eofpkt);
-    } else {
-        ret = avcodec_decode_video2(d.codec_ctx, d.frame, &got_frame_ptr, (AVPacket*)packet.asAVPacket());
+    d.undecoded_size = 0;
+    if (!d.isRestOfPacket(packet)) {
+        d.sent_packet = packet;
+        if (!sendPacket(packet))
+            return false;
     }
-    //qDebug("pic_type=%c", av_get_picture_type_char(d.frame->pict_type));
-    d.undecoded_size = qMin(packet.data.size() - ret, packet.data.size());
-    if (ret < 0) {
-        //qWarning("[VideoDecoderFFmpegBase] %s", av_err2str(ret));
+    // if more than 1 frame is decoded, undecodedSize() > 0 and the rest are returned in the next calls with the same packet
+    const bool got = receiveFrame();
+    d.setUndecodedSize(packet);
+    if (got)
+        return true;
+    if (packet.isEOF())
         return false;
-    }
-    if (!got_frame_ptr) {
-        qWarning("no frame could be decompressed: %s %d/%d", av_err2str(ret), d.undecoded_size, packet.data.size());
-        return !packet.isEOF();
-    }
-    if (!d.codec_ctx->width || !d.codec_ctx->height)
+    // need more data. frame() is invalid
+#if QTAV_HAVE(AVBUFREF)
+    av_frame_unref(d.frame);
+#else
+    d.frame->width = d.frame->height = 0;
+#endif
+    return true;
+}
+
+bool VideoDecoderFFmpegBase::sendPacket(const Packet &packet)
+{
+    if (!isAvailable())
+        return false;
+    return d_func().sendPacket(packet);
+}
+
+bool VideoDecoderFFmpegBase::receiveFrame()
+{
+    DPTR_D(VideoDecoderFFmpegBase);
+    if (!d.receiveFrame(d.frame))
         return false;
+    //qDebug("pic_type=%c", av_get_picture_type_char(d.frame->pict_type));
+    // the frame is dequeued. frame() checks the size, a frame is not dropped here even if codec size is not set
     //qDebug("codec %dx%d, frame %dx%d", d.codec_ctx->width, d.codec_ctx->height, d.frame->width, d.frame->height);
     d.width = d.frame->width; // TODO: remove? used in hwdec
     d.height = d.frame->height;
@@ -153,14 +164,22 @@ VideoFrame VideoDecoderFFmpegBase::frame()
     DPTR_D(VideoDecoderFFmpegBase);
     if (d.frame->width <= 0 || d.frame->height <= 0 || !d.codec_ctx)
         return VideoFrame();
-    // it's safe if width, height, pixfmt will not change, only data change
-    VideoFrame frame(d.frame->width, d.frame->height, VideoFormat((int)d.codec_ctx->pix_fmt));
+    VideoFrame frame;
+#if QTAV_HAVE(AVBUFREF)
+    // zero copy. the frame holds a reference of decoded buffers
+    if (d.frame->buf[0] && d.frame->format == d.codec_ctx->pix_fmt)
+        frame = VideoFrame::fromAVFrame(d.frame);
+#endif //QTAV_HAVE(AVBUFREF)
+    if (!frame.isValid()) {
+        // it's safe if width, height, pixfmt will not change, only data change
+        frame = VideoFrame(d.frame->width, d.frame->height, VideoFormat((int)d.codec_ctx->pix_fmt));
+        frame.setBits(d.frame->data);
+        frame.setBytesPerLine(d.frame->linesize);
+        frame.setMetaData(QStringLiteral("avbuf"), QVariant::fromValue(AVFrameBuffersRef(new AVFrameBuffers(d.frame))));
+    }
     frame.setDisplayAspectRatio(d.getDAR(d.frame));
-    frame.setBits(d.frame->data);
-    frame.setBytesPerLine(d.frame->linesize);
-    // in s. TODO: what about AVFrame.pts? av_frame_get_best_effort_timestamp? move to VideoFrame::from(AVFrame*)
-    frame.setTimestamp((double)d.frame->pkt_pts/1000.0);
-    frame.setMetaData(QStringLiteral("avbuf"), QVariant::fromValue(AVFrameBuffersRef(new AVFrameBuffers(d.frame))));
+    // in s. TODO: what about AVFrame.pts? av_frame_get_best_effort_timestamp?
+    frame.setTimestampUs(d.frame->pkt_pts);
     d.updateColorDetails(&frame);
     if (frame.format().hasPalette()) {
         frame.setMetaData(QStringLiteral("pallete"), QByteArray((const char*)d.frame->data[1], 256*4));
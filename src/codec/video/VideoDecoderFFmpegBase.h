@@ -35,6 +35,8 @@ class VideoDecoderFFmpegBase : public VideoDecoder
     DPTR_DECLARE_PRIVATE(VideoDecoderFFmpegBase)
 public:
     virtual bool decode(const Packet& packet) Q_DECL_OVERRIDE;
+    virtual bool sendPacket(const Packet& packet) Q_DECL_OVERRIDE;
+    virtual bool receiveFrame() Q_DECL_OVERRIDE;
     virtual VideoFrame frame() Q_DECL_OVERRIDE;
 protected:
     VideoDecoderFFmpegBase(VideoDecoderFFmpegBasePrivate &d);
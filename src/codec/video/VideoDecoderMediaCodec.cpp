@@ -52,13 +52,7 @@ public:
     QString description() const Q_DECL_OVERRIDE;
     VideoFrame frame() Q_DECL_OVERRIDE;
 
-    void flush() Q_DECL_OVERRIDE { // workaroudn for EAGAIN error in avcodec_receive_frame
-        if (copyMode() == ZeroCopy) {
-
-        } else {
-            VideoDecoderFFmpegHW::flush();
-        }
-    }
+    void flush() Q_DECL_OVERRIDE;
 };
 
 extern VideoDecoderId VideoDecoderId_MediaCodec;
@@ -109,6 +103,16 @@ public:
 #endif
 };
 
+void VideoDecoderMediaCodec::flush()
+{
+    // workaroudn for EAGAIN error in avcodec_receive_frame
+    if (copyMode() == ZeroCopy) {
+        d_func().clearFrames();
+    } else {
+        VideoDecoderFFmpegHW::flush();
+    }
+}
+
 VideoDecoderMediaCodec::VideoDecoderMediaCodec()
     : VideoDecoderFFmpegHW(*new VideoDecoderMediaCodecPrivate())
 {
@@ -151,7 +155,7 @@ VideoFrame VideoDecoderMediaCodec::frame()
         frame.setBits(d.frame->data);
         frame.setBytesPerLine(d.frame->linesize);
         // in s. TODO: what about AVFrame.pts? av_frame_get_best_effort_timestamp? move to VideoFrame::from(AVFrame*)
-        frame.setTimestamp((double)d.frame->pkt_pts/1000.0);
+        frame.setTimestampUs(d.frame->pkt_pts);
         frame.setMetaData(QStringLiteral("avbuf"), QVariant::fromValue(AVFrameBuffersRef(new AVFrameBuffers(d.frame))));
         d.updateColorDetails(&frame);
         return frame;
@@ -160,7 +164,7 @@ VideoFrame VideoDecoderMediaCodec::frame()
     VideoFrame frame(d.frame->width, d.frame->height, VideoFormat::Format_RGB32);
     frame.setBytesPerLine(d.frame->width*4);
     frame.setDisplayAspectRatio(d.getDAR(d.frame));
-    frame.setTimestamp(d.frame->pkt_pts/1000.0);
+    frame.setTimestampUs(d.frame->pkt_pts);
 #ifdef MEDIACODEC_TEXTURE
     class MediaCodecTextureInterop : public VideoSurfaceInterop
     {
@@ -379,7 +379,7 @@ VideoFrame VideoDecoderVAAPI::frame()
             VAWARN(vaDestroyImage(d.display->get(), img.image_id));
         }
         f.setMetaData(QStringLiteral("surface_interop"), QVariant::fromValue(VideoSurfaceInteropPtr(interop)));
-        f.setTimestamp(double(d.frame->pkt_pts)/1000.0);
+        f.setTimestampUs(d.frame->pkt_pts);
         f.setDisplayAspectRatio(d.getDAR(d.frame));
         d.updateColorDetails(&f);
         const ColorSpace cs = f.colorSpace();
@@ -222,7 +222,7 @@ VideoFrame VideoDecoderVDA::frame()
             if (fmt != format)
                 frame = frame.to(format);
             VideoFrame *f = reinterpret_cast<VideoFrame*>(handle);
-            frame.setTimestamp(f->timestamp());
+            frame.setTimestampUs(f->timestampUs());
             frame.setDisplayAspectRatio(f->displayAspectRatio());
             *f = frame;
             return f;
@@ -332,7 +332,7 @@ VideoFrame VideoDecoderVDA::frame()
     if (zero_copy) {
         f = VideoFrame(d.width, d.height, fmt);
         f.setBytesPerLine(pitch);
-        f.setTimestamp(double(d.frame->pkt_pts)/1000.0);
+        f.setTimestampUs(d.frame->pkt_pts);
         f.setDisplayAspectRatio(d.getDAR(d.frame));
         if (zero_copy) {
             f.setMetaData(QStringLiteral("target"), QByteArrayLiteral("rect"));
@@ -219,7 +219,7 @@ VideoFrame VideoDecoderVideoToolbox::frame()
         f = VideoFrame(d.width, d.height, fmt);
         f.setBytesPerLine(pitch);
         // TODO: move to updateFrameInfo
-        f.setTimestamp(double(d.frame->pkt_pts)/1000.0);
+        f.setTimestampUs(d.frame->pkt_pts);
         f.setDisplayAspectRatio(d.getDAR(d.frame));
         d.updateColorDetails(&f);
         if (d.interop_res) { // zero_copy
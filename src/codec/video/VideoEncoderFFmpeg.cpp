@@ -298,6 +298,14 @@ bool VideoEncoderFFmpeg::encode(const VideoFrame &frame)
     AVPixelFormat pixfmt = AVPixelFormat(frame.pixelFormatFFmpeg());
     if (frame.isValid()) {
         f.reset(av_frame_alloc());
+        bool referenced = false;
+#if QTAV_HAVE(AVBUFREF)
+        if (frame.avFrame()) { // ref counted. the encoder can keep a reference instead of copying
+            AV_ENSURE_OK(av_frame_ref(f.data(), frame.avFrame()), false);
+            f->pict_type = AV_PICTURE_TYPE_NONE; // do not force the decoded picture type
+            referenced = true;
+        }
+#endif //QTAV_HAVE(AVBUFREF)
         f->format = pixfmt;
         f->width = frame.width();
         f->height = frame.height();
@@ -314,7 +322,7 @@ bool VideoEncoderFFmpeg::encode(const VideoFrame &frame)
         }
 
         // pts is set in muxer
-        const int nb_planes = frame.planeCount();
+        const int nb_planes = referenced ? 0 : frame.planeCount();
         for (int i = 0; i < nb_planes; ++i) {
             f->linesize[i] = frame.bytesPerLine(i);
             f->data[i] = (uint8_t*)frame.constBits(i);
@@ -194,7 +194,7 @@ void* SurfaceInterop::mapToHost(const VideoFormat &format, void *handle, int pla
     if (format != fmt)
         frame = frame.to(format);
     VideoFrame *f = reinterpret_cast<VideoFrame*>(handle);
-    frame.setTimestamp(f->timestamp());
+    frame.setTimestampUs(f->timestampUs());
     *f = frame;
     return f;
 }
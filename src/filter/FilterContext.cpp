@@ -282,7 +282,11 @@ void QPainterFilterContext::initializeOnFrame(VideoFrame *vframe)
         paint_device = 0;
     }
     Q_ASSERT(video_width > 0 && video_height > 0);
-    // direct draw on frame data, so use VideoFrame::constBits()
+    // direct draw on frame data. detach if the data is shared, e.g. decoded buffers referenced by decoder
+    if (!vframe->makeWritable()) {
+        qWarning("frame data is not writable");
+        return;
+    }
     paint_device = new QImage((uchar*)vframe->constBits(0), video_width, video_height, vframe->bytesPerLine(0), format.imageFormat());
     if (!painter)
         painter = new QPainter();
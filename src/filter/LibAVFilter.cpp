@@ -356,11 +356,18 @@ void LibAVFilterVideo::process(Statistics *statistics, VideoFrame *frame)
     if (!ref)
         return;
     const AVFrame *f = ref->frame();
-    VideoFrame vf(f->width, f->height, VideoFormat(f->format));
-    vf.setBits((quint8**)f->data);
-    vf.setBytesPerLine((int*)f->linesize);
-    vf.setMetaData(QStringLiteral("avframe_hoder_ref"), QVariant::fromValue(ref));
-    vf.setTimestamp(ref->frame()->pts/1000000.0); //pkt_pts?
+    VideoFrame vf;
+#if QTAV_HAVE_av_buffersink_get_frame
+    if (f->buf[0])
+        vf = VideoFrame::fromAVFrame(f);
+#endif //QTAV_HAVE_av_buffersink_get_frame
+    if (!vf.isValid()) {
+        vf = VideoFrame(f->width, f->height, VideoFormat(f->format));
+        vf.setBits((quint8**)f->data);
+        vf.setBytesPerLine((int*)f->linesize);
+        vf.setMetaData(QStringLiteral("avframe_hoder_ref"), QVariant::fromValue(ref));
+    }
+    vf.setTimestampUs(ref->frame()->pts); //pkt_pts?
     //vf.setMetaData(frame->availableMetaData());
     *frame = vf;
 #else
@@ -460,7 +467,7 @@ void LibAVFilterAudio::process(Statistics *statistics, AudioFrame *frame)
     af.setBytesPerLine(f->linesize[0], 0); // for correct alignment
     af.setSamplesPerChannel(f->nb_samples);
     af.setMetaData(QStringLiteral("avframe_hoder_ref"), QVariant::fromValue(ref));
-    af.setTimestamp(ref->frame()->pts/1000000.0); //pkt_pts?
+    af.setTimestampUs(ref->frame()->pts); //pkt_pts?
     //af.setMetaData(frame->availableMetaData());
     *frame = af;
 #else
@@ -479,10 +486,21 @@ bool LibAVFilter::Private::pushVideoFrame(Frame *frame, bool changed, const QStr
             return false;
         }
     }
+#if QTAV_HAVE(AVBUFREF)
+    if (vf->avFrame()) { // ref counted. libavfilter takes a new reference instead of copying the data
+        av_frame_unref(avframe);
+        AV_ENSURE_OK(av_frame_ref(avframe, vf->avFrame()), false);
+        avframe->pts = frame->timestampUs(); // time_base is 1/1000000
+        const int ret = av_buffersrc_write_frame(in_filter_ctx, avframe);
+        av_frame_unref(avframe);
+        AV_ENSURE_OK(ret, false);
+        return true;
+    }
+#endif //QTAV_HAVE(AVBUFREF)
     if (!vf->constBits(0)) {
         *vf = vf->to(vf->format());
     }
-    avframe->pts = frame->timestamp() * 1000000.0; // time_base is 1/1000000
+    avframe->pts = frame->timestampUs(); // time_base is 1/1000000
     avframe->width = vf->width();
     avframe->height = vf->height();
     avframe->format = (AVPixelFormat)vf->pixelFormatFFmpeg();
@@ -518,7 +536,7 @@ bool LibAVFilter::Private::pushAudioFrame(Frame *frame, bool changed, const QStr
     }
     AudioFrame *af = static_cast<AudioFrame*>(frame);
     const AudioFormat afmt(af->format());
-    avframe->pts = frame->timestamp() * 1000000.0; // time_base is 1/1000000
+    avframe->pts = frame->timestampUs(); // time_base is 1/1000000
     avframe->sample_rate = afmt.sampleRate();
     avframe->channel_layout = afmt.channelLayoutFFmpeg();
 #if QTAV_USE_FFMPEG(LIBAVCODEC) || QTAV_USE_FFMPEG(LIBAVUTIL) //AVFrame was in avcodec
@@ -22,6 +22,7 @@ config_libcedarv: CONFIG *= neon config_simd #need by qt4 addSimdCompiler(). neo
 ## sse2 sse4_1 may be defined in Qt5 qmodule.pri but is not included. Qt4 defines sse and sse2
 sse4_1|config_sse4_1|contains(TARGET_ARCH_SUB, sse4.1): CONFIG *= sse4_1 config_simd
 sse2|config_sse2|contains(TARGET_ARCH_SUB, sse2): CONFIG *= sse2 config_simd
+avx2|config_avx2|contains(TARGET_ARCH_SUB, avx2): CONFIG *= avx2 config_simd
 CONFIG(debug, debug|release): DEFINES += DEBUG
 #release: DEFINES += QT_NO_DEBUG_OUTPUT
 #var with '_' can not pass to pri?
@@ -81,7 +82,12 @@ sse4_1 {
 sse2 {
   DEFINES += QTAV_HAVE_SSE2=1
   !config_simd: CONFIG *= simd
-  SSE2_SOURCES += utils/CopyFrame_SSE2.cpp
+  SSE2_SOURCES += utils/CopyFrame_SSE2.cpp output/audio/AudioScale_SSE2.cpp utils/YUV2RGB_SSE2.cpp subtitle/BlendASS_SSE2.cpp
+}
+avx2 {
+  DEFINES += QTAV_HAVE_AVX2=1
+  !config_simd: CONFIG *= simd
+  AVX2_SOURCES += output/audio/AudioScale_AVX2.cpp utils/YUV2RGB_AVX2.cpp subtitle/BlendASS_AVX2.cpp
 }
 
 win32 {
@@ -434,6 +440,8 @@ SOURCES += \
     AVCompat.cpp \
     QtAV_Global.cpp \
     subtitle/SubImage.cpp \
+    subtitle/BlendASS.cpp \
+    subtitle/SubtitleIndex.cpp \
     subtitle/CharsetDetector.cpp \
     subtitle/PlainText.cpp \
     subtitle/PlayerSubtitle.cpp \
@@ -442,6 +450,8 @@ SOURCES += \
     subtitle/SubtitleProcessorFFmpeg.cpp \
     utils/GPUMemCopy.cpp \
     utils/Logger.cpp \
+    utils/Trace.cpp \
+    utils/YUV2RGB.cpp \
     AudioThread.cpp \
     utils/internal.cpp \
     AVThread.cpp \
@@ -469,8 +479,13 @@ SOURCES += \
     filter/EncodeFilter.cpp \
     ImageConverter.cpp \
     ImageConverterFF.cpp \
+    ImageConverterFFSlice.cpp \
+    ImageConverterYUV.cpp \
     Packet.cpp \
     PacketBuffer.cpp \
+    AudioTimeStretch.cpp \
+    KeyFrameIndex.cpp \
+    FrameBufferPool.cpp \
     AVError.cpp \
     AVPlayer.cpp \
     AVPlayerPrivate.cpp \
@@ -483,11 +498,13 @@ SOURCES += \
     io/QIODeviceIO.cpp \
     io/DVDNavIO.cpp \
     output/audio/AudioOutput.cpp \
+    output/audio/AudioScale.cpp \
     output/audio/AudioOutputBackend.cpp \
     output/audio/AudioOutputNull.cpp \
     output/video/VideoRenderer.cpp \
     output/video/VideoOutput.cpp \
     output/video/QPainterRenderer.cpp \
+    output/video/NullRenderer.cpp \
     output/AVOutput.cpp \
     output/OutputSet.cpp \
     Statistics.cpp \
@@ -522,6 +539,7 @@ SDK_HEADERS *= \
     QtAV/Frame.h \
     QtAV/FrameReader.h \
     QtAV/QPainterRenderer.h \
+    QtAV/NullRenderer.h \
     QtAV/Packet.h \
     QtAV/AVError.h \
     QtAV/AVPlayer.h \
@@ -576,6 +594,11 @@ HEADERS *= \
     AVThread_p.h \
     AudioThread.h \
     PacketBuffer.h \
+    Statistics_p.h \
+    AudioTimeStretch.h \
+    KeyFrameIndex.h \
+    PacketPool.h \
+    FrameBufferPool.h \
     VideoThread.h \
     ImageConverter.h \
     ImageConverter_p.h \
@@ -585,13 +608,19 @@ HEADERS *= \
     filter/FilterManager.h \
     subtitle/CharsetDetector.h \
     subtitle/PlainText.h \
+    subtitle/BlendASS.h \
+    subtitle/SubtitleIndex.h \
     utils/BlockingQueue.h \
+    utils/SPSCQueue.h \
     utils/GPUMemCopy.h \
     utils/Logger.h \
+    utils/Trace.h \
     utils/SharedPtr.h \
     utils/ring.h \
     utils/internal.h \
+    utils/YUV2RGB.h \
     output/OutputSet.h \
+    output/audio/AudioScale.h \
     ColorTransform.h
 # from mkspecs/features/qt_module.prf
 # OS X and iOS frameworks
@@ -20,17 +20,67 @@
 ******************************************************************************/
 
 #include "output/OutputSet.h"
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QRunnable>
+#include <QtCore/QSemaphore>
+#include <QtCore/QThread>
+#include <QtCore/QThreadPool>
 #include "QtAV/AVPlayer.h"
+#include "QtAV/Statistics.h"
 #include "QtAV/VideoRenderer.h"
+#include "Statistics_p.h"
+#include "utils/Trace.h"
 
 namespace QtAV {
 
+Q_GLOBAL_STATIC(QThreadPool, conversionThreadPool)
+
+namespace {
+// the target format of renderer for frame
+VideoFormat::PixelFormat targetFormat(const VideoRenderer *vo, const VideoFrame &frame)
+{
+    const VideoFormat::PixelFormat pixfmt = frame.pixelFormat();
+    if (vo->isSupported(pixfmt)
+            && !(vo->isPreferredPixelFormatForced() && vo->preferredPixelFormat() != pixfmt))
+        return pixfmt;
+    const VideoFormat fmt(frame.format());
+    if ((fmt.hasPalette() || fmt.isRGB()) && vo->isSupported(VideoFormat::Format_RGB32))
+        return VideoFormat::Format_RGB32;
+    return vo->preferredPixelFormat();
+}
+
+struct FormatGroup {
+    VideoFormat::PixelFormat format;
+    VideoFrame frame;
+    QList<VideoRenderer*> renderers;
+};
+
+class ConvertTask : public QRunnable {
+public:
+    ConvertTask(const VideoFrameConverter *c, const VideoFrame &f, FormatGroup *g, QSemaphore *s)
+        : conv(c), in(f), group(g), sem(s)
+    {
+        setAutoDelete(true);
+    }
+    void run() {
+        group->frame = conv->convert(in, group->format);
+        sem->release();
+    }
+private:
+    const VideoFrameConverter *conv;
+    VideoFrame in;
+    FormatGroup *group;
+    QSemaphore *sem;
+};
+} //namespace
+
 OutputSet::OutputSet(AVPlayer *player):
     QObject(player)
   , mCanPauseThread(false)
   , mpPlayer(player)
   , mPauseCount(0)
 {
+    mEq[0] = mEq[1] = mEq[2] = 0;
 }
 
 OutputSet::~OutputSet()
@@ -38,6 +88,8 @@ OutputSet::~OutputSet()
     mCond.wakeAll();
     //delete? may be deleted by vo's parent
     clearOutputs();
+    qDeleteAll(mConverters);
+    mConverters.clear();
 }
 
 void OutputSet::lock()
@@ -55,19 +107,101 @@ QList<AVOutput *> OutputSet::outputs()
     return mOutputs;
 }
 
-void OutputSet::sendVideoFrame(VideoFrame &frame)
+bool OutputSet::sendVideoFrame(VideoFrame &frame)
 {
+    QTAV_TRACE("output", "sendVideoFrame");
     if (mOutputs.isEmpty())
-        return;
-    VideoFrame f(frame);
+        return true;
+    if (!frame.isValid()) { // clear renderers
+        VideoFrame f(frame);
+        foreach(AVOutput *output, mOutputs) {
+            if (output->isAvailable())
+                static_cast<VideoRenderer*>(output)->receive(f);
+        }
+        return true;
+    }
+    // group renderers by target format, the 1st group contains the 1st renderer
+    QVector<FormatGroup> groups;
+    int nb_converted = 0; // renderers require conversion
     foreach(AVOutput *output, mOutputs) {
         if (!output->isAvailable())
             continue;
         VideoRenderer *vo = static_cast<VideoRenderer*>(output);
-        // TODO: sort vo by supported formats when a new vo is added to reduce convertion
-        if (!vo->isSupported(frame.pixelFormat()))
-            f = frame.to(vo->preferredPixelFormat());
-        vo->receive(f);
+        const VideoFormat::PixelFormat fmt = targetFormat(vo, frame);
+        if (fmt != frame.pixelFormat())
+            nb_converted++;
+        int i = 0;
+        for (; i < groups.size(); ++i) {
+            if (groups[i].format == fmt)
+                break;
+        }
+        if (i == groups.size()) {
+            FormatGroup g;
+            g.format = fmt;
+            if (fmt == frame.pixelFormat())
+                g.frame = frame;
+            groups.append(g);
+        }
+        groups[i].renderers.append(vo);
+    }
+    if (groups.isEmpty())
+        return true;
+    QVector<FormatGroup*> pending;
+    for (int i = 0; i < groups.size(); ++i) {
+        if (groups[i].format == frame.pixelFormat())
+            continue;
+        pending.append(&groups[i]);
+        if (!mConverters.contains(groups[i].format)) {
+            VideoFrameConverter *conv = new VideoFrameConverter();
+            conv->setEq(mEq[0], mEq[1], mEq[2]);
+            mConverters.insert(groups[i].format, conv);
+        }
+    }
+    QTAV_TRACE_VAR(trace_convert, "output", "convert");
+    QElapsedTimer convert_timer;
+    convert_timer.start();
+    // converters are not shared between groups. hw frames are converted in current thread
+    if (pending.size() > 1 && frame.constBits(0) && QThread::idealThreadCount() > 1) {
+        QSemaphore sem;
+        for (int i = 1; i < pending.size(); ++i)
+            conversionThreadPool()->start(new ConvertTask(mConverters.value(pending[i]->format), frame, pending[i], &sem));
+        pending[0]->frame = mConverters.value(pending[0]->format)->convert(frame, pending[0]->format);
+        sem.acquire(pending.size() - 1);
+    } else {
+        foreach (FormatGroup *g, pending) {
+            g->frame = mConverters.value(g->format)->convert(frame, g->format);
+        }
+    }
+    trace_convert.end();
+    if (frame.statistics && !pending.isEmpty())
+        frame.statistics->counters()->convert_time.add(convert_timer.nsecsElapsed()/1000LL);
+    if (frame.statistics) {
+        frame.statistics->counters()->conversions.fetchAndAddRelaxed(pending.size());
+        frame.statistics->counters()->conversions_avoided.fetchAndAddRelaxed(nb_converted - pending.size());
+    }
+    for (int i = 0; i < groups.size(); ++i) {
+        FormatGroup &g = groups[i];
+        if (!g.frame.isValid())
+            continue;
+        g.frame.statistics = frame.statistics;
+        foreach (VideoRenderer *vo, g.renderers) {
+            vo->receive(g.frame);
+        }
+    }
+    frame = groups[0].frame;
+    return frame.isValid();
+}
+
+void OutputSet::setEq(int brightness, int contrast, int saturation)
+{
+    if (brightness >= -100 && brightness <= 100)
+        mEq[0] = brightness;
+    if (contrast >= -100 && contrast <= 100)
+        mEq[1] = contrast;
+    if (saturation >= -100 && saturation <= 100)
+        mEq[2] = saturation;
+    foreach (VideoFrameConverter *conv, mConverters) {
+        conv->setEq(mEq[0], mEq[1], mEq[2]);
     }
 }
 
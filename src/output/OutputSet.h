@@ -22,6 +22,7 @@
 #ifndef QTAV_OUTPUTSET_H
 #define QTAV_OUTPUTSET_H
 
+#include <QtCore/QHash>
 #include <QtCore/QObject>
 #include <QtCore/QMutex>
 #include <QtCore/QWaitCondition>
@@ -32,6 +33,7 @@ namespace QtAV {
 
 class AVPlayer;
 class VideoFrame;
+class VideoFrameConverter;
 class OutputSet : public QObject
 {
     Q_OBJECT
@@ -50,7 +52,15 @@ public:
     //each(OutputOperation(data))
     //
     void sendData(const QByteArray& data);
-    void sendVideoFrame(VideoFrame& frame);
+    /*!
+     * \brief sendVideoFrame
+     * Renderers are grouped by target pixel format. frame is converted once for each group (in parallel if possible) and the result is shared.
+     * frame is replaced by the frame sent to the first renderer.
+     * \return false if failed to convert frame for the first renderer
+     */
+    bool sendVideoFrame(VideoFrame& frame);
+    /// eq for conversions in sendVideoFrame(). value out of [-100, 100] will be ignored. Call it in the thread calling sendVideoFrame()
+    void setEq(int brightness, int contrast, int saturation);
 
     void clearOutputs();
     void addOutput(AVOutput* output);
@@ -77,6 +87,8 @@ private:
     QList<AVOutput*> mOutputs;
     QMutex mMutex;
     QWaitCondition mCond; //pause
+    int mEq[3];
+    QHash<int, VideoFrameConverter*> mConverters; // key: target pixel format. converters of different formats can run in parallel
 };
 
 } //namespace QtAV
@@ -23,12 +23,14 @@
 #include "QtAV/private/AVOutput_p.h"
 #include "QtAV/private/AudioOutputBackend.h"
 #include "QtAV/private/AVCompat.h"
+#include "Statistics_p.h"
 #if QT_VERSION >= QT_VERSION_CHECK(4, 7, 0)
 #include <QtCore/QElapsedTimer>
 #else
 #include <QtCore/QTime>
 typedef QTime QElapsedTimer;
 #endif
+#include "AudioScale.h"
 #include "utils/ring.h"
 #include "utils/Logger.h"
 
@@ -40,82 +42,6 @@ namespace QtAV {
 static const int kBufferSamples = 512;
 static const int kBufferCount = 8*2; // may wait too long at the beginning (oal) if too large. if buffer count is too small, can not play for high sample rate audio.
 
-typedef void (*scale_samples_func)(quint8 *dst, const quint8 *src, int nb_samples, int volume, float volumef);
-
-/// from libavfilter/af_volume begin
-static inline void scale_samples_u8(quint8 *dst, const quint8 *src, int nb_samples, int volume, float)
-{
-    for (int i = 0; i < nb_samples; i++)
-        dst[i] = av_clip_uint8(((((qint64)src[i] - 128) * volume + 128) >> 8) + 128);
-}
-
-static inline void scale_samples_u8_small(quint8 *dst, const quint8 *src, int nb_samples, int volume, float)
-{
-    for (int i = 0; i < nb_samples; i++)
-        dst[i] = av_clip_uint8((((src[i] - 128) * volume + 128) >> 8) + 128);
-}
-
-static inline void scale_samples_s16(quint8 *dst, const quint8 *src, int nb_samples, int volume, float)
-{
-    int16_t *smp_dst       = (int16_t *)dst;
-    const int16_t *smp_src = (const int16_t *)src;
-    for (int i = 0; i < nb_samples; i++)
-        smp_dst[i] = av_clip_int16(((qint64)smp_src[i] * volume + 128) >> 8);
-}
-
-static inline void scale_samples_s16_small(quint8 *dst, const quint8 *src, int nb_samples, int volume, float)
-{
-    int16_t *smp_dst       = (int16_t *)dst;
-    const int16_t *smp_src = (const int16_t *)src;
-    for (int i = 0; i < nb_samples; i++)
-        smp_dst[i] = av_clip_int16((smp_src[i] * volume + 128) >> 8);
-}
-
-static inline void scale_samples_s32(quint8 *dst, const quint8 *src, int nb_samples, int volume, float)
-{
-    qint32 *smp_dst       = (qint32 *)dst;
-    const qint32 *smp_src = (const qint32 *)src;
-    for (int i = 0; i < nb_samples; i++)
-        smp_dst[i] = av_clipl_int32((((qint64)smp_src[i] * volume + 128) >> 8));
-}
-/// from libavfilter/af_volume end
-
-//TODO: simd
-template<typename T>
-static inline void scale_samples(quint8 *dst, const quint8 *src, int nb_samples, int, float volume)
-{
-    T *smp_dst = (T *)dst;
-    const T *smp_src = (const T *)src;
-    for (int i = 0; i < nb_samples; ++i)
-        smp_dst[i] = smp_src[i] * (T)volume;
-}
-
-scale_samples_func get_scaler(AudioFormat::SampleFormat fmt, qreal vol, int* voli)
-{
-    int v = (int)(vol * 256.0 + 0.5);
-    if (voli)
-        *voli = v;
-    switch (fmt) {
-    case AudioFormat::SampleFormat_Unsigned8:
-    case AudioFormat::SampleFormat_Unsigned8Planar:
-        return v < 0x1000000 ? scale_samples_u8_small : scale_samples_u8;
-    case AudioFormat::SampleFormat_Signed16:
-    case AudioFormat::SampleFormat_Signed16Planar:
-        return v < 0x10000 ? scale_samples_s16_small : scale_samples_s16;
-    case AudioFormat::SampleFormat_Signed32:
-    case AudioFormat::SampleFormat_Signed32Planar:
-        return scale_samples_s32;
-    case AudioFormat::SampleFormat_Float:
-    case AudioFormat::SampleFormat_FloatPlanar:
-        return scale_samples<float>;
-    case AudioFormat::SampleFormat_Double:
-    case AudioFormat::SampleFormat_DoublePlanar:
-        return scale_samples<double>;
-    default:
-        return 0;
-    }
-}
-
 class AudioOutputPrivate : public AVOutputPrivate
 {
 public:
@@ -394,15 +320,47 @@ bool AudioOutput::isOpen() const
 }
 
 bool AudioOutput::play(const QByteArray &data, qreal pts)
+{
+    return play(data, pts, true);
+}
+
+bool AudioOutput::play(const QByteArray &data, qreal pts, bool applyVolume)
 {
     DPTR_D(AudioOutput);
     if (!d.backend)
         return false;
-    if (!receiveData(data, pts))
+    if (!receiveData(data, pts, applyVolume))
         return false;
     return d.backend->play();
 }
 
+bool AudioOutput::convertFrame(const AudioFrame &frame, AudioFrame *out) const
+{
+    DPTR_D(const AudioOutput);
+    if (!out || !frame.isValid() || !frame.constBits(0) || !d.format.isValid())
+        return false;
+    const AudioFormat &fmt = frame.format();
+    if (fmt.channels() != d.format.channels()
+            || fmt.channelLayout() != d.format.channelLayout()
+            || fmt.sampleRate() != d.format.sampleRate())
+        return false;
+    convert_scale_func convert_scale = get_convert_scaler(fmt.sampleFormat(), d.format.sampleFormat());
+    if (!convert_scale)
+        return false;
+    const int nb_samples = frame.samplesPerChannel();
+    QByteArray data;
+    data.resize(nb_samples*d.format.bytesPerFrame());
+    QVector<const quint8*> planes(frame.planeCount());
+    for (int i = 0; i < planes.size(); ++i)
+        planes[i] = frame.constBits(i);
+    convert_scale((quint8*)data.data(), planes.constData(), fmt.channels(), nb_samples, d.sw_volume ? (float)volume() : 1.0f);
+    AudioFrame f(d.format, data);
+    f.setSamplesPerChannel(nb_samples);
+    f.setTimestampUs(frame.timestampUs());
+    *out = f;
+    return true;
+}
+
 void AudioOutput::pause(bool value)
 {
     DPTR_D(AudioOutput);
@@ -415,7 +373,7 @@ bool AudioOutput::isPaused() const
     return d_func().paused;
 }
 
-bool AudioOutput::receiveData(const QByteArray &data, qreal pts)
+bool AudioOutput::receiveData(const QByteArray &data, qreal pts, bool applyVolume)
 {
     DPTR_D(AudioOutput);
     if (isPaused())
@@ -427,7 +385,8 @@ bool AudioOutput::receiveData(const QByteArray &data, qreal pts)
             s = 1<<((d.format.bytesPerSample() << 3)-1);
         queue_data.fill(s);
     } else {
-        if (!qFuzzyCompare(volume(), (qreal)1.0)
+        if (applyVolume
+                && !qFuzzyCompare(volume(), (qreal)1.0)
                 && d.sw_volume
                 && d.scale_samples
                 ) {
@@ -755,16 +714,19 @@ bool AudioOutput::waitForNextBuffer() // parameter bool wait: if no wait and no
             next = d.frame_infos.front().data.size();
         }
         //qDebug("remove: %d, unremoved bytes < %d, writable_bytes: %d", remove, free_bytes, d.processed_remain);
-        return true;
-    }
-    //qDebug("remove count: %d", remove);
-    while (remove-- > 0) {
-        if (d.frame_infos.empty()) {
-//            qWarning("empty. can not pop!");
-            break;
+    } else {
+        //qDebug("remove count: %d", remove);
+        while (remove-- > 0) {
+            if (d.frame_infos.empty()) {
+//                qWarning("empty. can not pop!");
+                break;
+            }
+            d.frame_infos.pop_front();
         }
-        d.frame_infos.pop_front();
     }
+    // all queued data is played before the next write. blocking backends always remove the only one queued
+    if (d.frame_infos.empty() && !(f & AudioOutputBackend::Blocking) && d.statistics)
+        d.statistics->counters()->audio_underruns.ref();
     return true;
 }
 
@@ -0,0 +1,445 @@
+/******************************************************************************
+    QtAV:  Multimedia framework based on Qt and FFmpeg
+    Copyright (C) 2012-2017 Wang Bin <wbsecg1@gmail.com>
+
+*   This file is part of QtAV (from 2017)
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+******************************************************************************/
+
+#include "AudioScale.h"
+extern "C" {
+#include <libavutil/cpu.h>
+}
+#if defined(__ARM_NEON__) || defined(__ARM_NEON)
+#include <arm_neon.h>
+#define QTAV_HAVE_NEON_INTRINSICS 1
+#endif
+
+namespace QtAV {
+
+// not cached here. av_get_cpu_flags() is cheap and respects av_force_cpu_flags(), so kernels can be compared with the c version
+static int cpuFlags()
+{
+    return av_get_cpu_flags();
+}
+
+#if QTAV_HAVE(SSE2)
+static bool has_sse2() { return !!(cpuFlags() & AV_CPU_FLAG_SSE2); }
+#endif
+#if QTAV_HAVE(AVX2)
+static bool has_avx2()
+{
+#ifdef AV_CPU_FLAG_AVX2
+    return !!(cpuFlags() & AV_CPU_FLAG_AVX2);
+#else
+    return false;
+#endif
+}
+#endif
+#if QTAV_HAVE(NEON_INTRINSICS)
+static bool has_neon()
+{
+#ifdef AV_CPU_FLAG_NEON
+    return !!(cpuFlags() & AV_CPU_FLAG_NEON);
+#else
+    return true;
+#endif
+}
+#endif
+
+#if QTAV_HAVE(NEON_INTRINSICS)
+// 8 samples per loop
+static void scale_samples_u8_neon(quint8 *dst, const quint8 *src, int nb_samples, int volume, float)
+{
+    const int16x4_t v = vdup_n_s16(volume);
+    const int16x8_t c128 = vdupq_n_s16(128);
+    int i = 0;
+    for (; i <= nb_samples - 8; i += 8) {
+        const int16x8_t s = vsubq_s16(vreinterpretq_s16_u16(vmovl_u8(vld1_u8(src + i))), c128);
+        const int32x4_t lo = vmull_s16(vget_low_s16(s), v);
+        const int32x4_t hi = vmull_s16(vget_high_s16(s), v);
+        // (x*v + 128)>>8, saturate to s16 then add 128 and saturate to u8
+        const int16x8_t r = vcombine_s16(vqrshrn_n_s32(lo, 8), vqrshrn_n_s32(hi, 8));
+        vst1_u8(dst + i, vqmovun_s16(vqaddq_s16(r, c128)));
+    }
+    scale_samples_u8_small(dst + i, src + i, nb_samples - i, volume, 0);
+}
+
+static void scale_samples_s16_neon(quint8 *dst, const quint8 *src, int nb_samples, int volume, float)
+{
+    const int16x4_t v = vdup_n_s16(volume);
+    const int16_t *s = (const int16_t*)src;
+    int16_t *d = (int16_t*)dst;
+    int i = 0;
+    for (; i <= nb_samples - 8; i += 8) {
+        const int16x8_t x = vld1q_s16(s + i);
+        const int32x4_t lo = vmull_s16(vget_low_s16(x), v);
+        const int32x4_t hi = vmull_s16(vget_high_s16(x), v);
+        vst1q_s16(d + i, vcombine_s16(vqrshrn_n_s32(lo, 8), vqrshrn_n_s32(hi, 8)));
+    }
+    scale_samples_s16_small(dst + i*2, src + i*2, nb_samples - i, volume, 0);
+}
+
+static void scale_samples_s32_neon(quint8 *dst, const quint8 *src, int nb_samples, int volume, float)
+{
+    const int32x2_t v = vdup_n_s32(volume);
+    const int32_t *s = (const int32_t*)src;
+    int32_t *d = (int32_t*)dst;
+    int i = 0;
+    for (; i <= nb_samples - 4; i += 4) {
+        const int32x4_t x = vld1q_s32(s + i);
+        const int64x2_t lo = vmull_s32(vget_low_s32(x), v);
+        const int64x2_t hi = vmull_s32(vget_high_s32(x), v);
+        vst1q_s32(d + i, vcombine_s32(vqrshrn_n_s64(lo, 8), vqrshrn_n_s64(hi, 8)));
+    }
+    scale_samples_s32(dst + i*4, src + i*4, nb_samples - i, volume, 0);
+}
+
+static void scale_samples_flt_neon(quint8 *dst, const quint8 *src, int nb_samples, int volume, float volumef)
+{
+    const float32x4_t v = vdupq_n_f32(volumef);
+    const float *s = (const float*)src;
+    float *d = (float*)dst;
+    int i = 0;
+    for (; i <= nb_samples - 8; i += 8) {
+        vst1q_f32(d + i, vmulq_f32(vld1q_f32(s + i), v));
+        vst1q_f32(d + i + 4, vmulq_f32(vld1q_f32(s + i + 4), v));
+    }
+    scale_samples<float>(dst + i*4, src + i*4, nb_samples - i, volume, volumef);
+}
+
+#ifdef __aarch64__
+// no double vector on armv7
+static void scale_samples_dbl_neon(quint8 *dst, const quint8 *src, int nb_samples, int volume, float volumef)
+{
+    const float64x2_t v = vdupq_n_f64(volumef);
+    const double *s = (const double*)src;
+    double *d = (double*)dst;
+    int i = 0;
+    for (; i <= nb_samples - 4; i += 4) {
+        vst1q_f64(d + i, vmulq_f64(vld1q_f64(s + i), v));
+        vst1q_f64(d + i + 2, vmulq_f64(vld1q_f64(s + i + 2), v));
+    }
+    scale_samples<double>(dst + i*8, src + i*8, nb_samples - i, volume, volumef);
+}
+#endif //__aarch64__
+
+// round to nearest like lrintf
+static inline int32x4_t cvt_s32_f32_neon(float32x4_t v)
+{
+#ifdef __aarch64__
+    return vcvtnq_s32_f32(v);
+#else
+    // ties to even as lrintf. 1.5*2^23 moves the fraction out of float mantissa, v is clamped to s16 range before
+    const float32x4_t magic = vdupq_n_f32(12582912.0f);
+    v = vminq_f32(vmaxq_f32(v, vdupq_n_f32(-32768.0f)), vdupq_n_f32(32767.0f));
+    return vcvtq_s32_f32(vsubq_f32(vaddq_f32(v, magic), magic));
+#endif
+}
+
+static void convert_scale_fltp_s16_neon(quint8 *dst, const quint8 *const *src, int channels, int nb_samples, float volume)
+{
+    const float32x4_t v = vdupq_n_f32(volume*float(1<<15));
+    int16_t *d = (int16_t*)dst;
+    int i = 0;
+    if (channels == 2) {
+        const float *l = (const float*)src[0];
+        const float *r = (const float*)src[1];
+        for (; i <= nb_samples - 4; i += 4) {
+            int16x4x2_t lr;
+            lr.val[0] = vqmovn_s32(cvt_s32_f32_neon(vmulq_f32(vld1q_f32(l + i), v)));
+            lr.val[1] = vqmovn_s32(cvt_s32_f32_neon(vmulq_f32(vld1q_f32(r + i), v)));
+            vst2_s16(d + 2*i, lr);
+        }
+    }
+    for (; i < nb_samples; ++i) {
+        for (int c = 0; c < channels; ++c)
+            d[i*channels + c] = clip_s16(float_to_s16(((const float*)src[c])[i]*volume));
+    }
+}
+#endif //QTAV_HAVE(NEON_INTRINSICS)
+
+scale_samples_func get_scaler(AudioFormat::SampleFormat fmt, qreal vol, int* voli)
+{
+    int v = (int)(vol * 256.0 + 0.5);
+    if (voli)
+        *voli = v;
+    const bool simd = v < 0x8000; // fixed point volume fits in 16 bits
+    Q_UNUSED(simd);
+    switch (fmt) {
+    case AudioFormat::SampleFormat_Unsigned8:
+    case AudioFormat::SampleFormat_Unsigned8Planar:
+#if QTAV_HAVE(AVX2)
+        if (simd && has_avx2())
+            return scale_samples_u8_avx2;
+#endif
+#if QTAV_HAVE(SSE2)
+        if (simd && has_sse2())
+            return scale_samples_u8_sse2;
+#endif
+#if QTAV_HAVE(NEON_INTRINSICS)
+        if (simd && has_neon())
+            return scale_samples_u8_neon;
+#endif
+        return v < 0x1000000 ? scale_samples_u8_small : scale_samples_u8;
+    case AudioFormat::SampleFormat_Signed16:
+    case AudioFormat::SampleFormat_Signed16Planar:
+#if QTAV_HAVE(AVX2)
+        if (simd && has_avx2())
+            return scale_samples_s16_avx2;
+#endif
+#if QTAV_HAVE(SSE2)
+        if (simd && has_sse2())
+            return scale_samples_s16_sse2;
+#endif
+#if QTAV_HAVE(NEON_INTRINSICS)
+        if (simd && has_neon())
+            return scale_samples_s16_neon;
+#endif
+        return v < 0x10000 ? scale_samples_s16_small : scale_samples_s16;
+    case AudioFormat::SampleFormat_Signed32:
+    case AudioFormat::SampleFormat_Signed32Planar:
+#if QTAV_HAVE(AVX2)
+        if (simd && has_avx2())
+            return scale_samples_s32_avx2;
+#endif
+#if QTAV_HAVE(SSE2)
+        if (simd && has_sse2())
+            return scale_samples_s32_sse2;
+#endif
+#if QTAV_HAVE(NEON_INTRINSICS)
+        if (simd && has_neon())
+            return scale_samples_s32_neon;
+#endif
+        return scale_samples_s32;
+    case AudioFormat::SampleFormat_Float:
+    case AudioFormat::SampleFormat_FloatPlanar:
+#if QTAV_HAVE(AVX2)
+        if (has_avx2())
+            return scale_samples_flt_avx2;
+#endif
+#if QTAV_HAVE(SSE2)
+        if (has_sse2())
+            return scale_samples_flt_sse2;
+#endif
+#if QTAV_HAVE(NEON_INTRINSICS)
+        if (has_neon())
+            return scale_samples_flt_neon;
+#endif
+        return scale_samples<float>;
+    case AudioFormat::SampleFormat_Double:
+    case AudioFormat::SampleFormat_DoublePlanar:
+#if QTAV_HAVE(AVX2)
+        if (has_avx2())
+            return scale_samples_dbl_avx2;
+#endif
+#if QTAV_HAVE(SSE2)
+        if (has_sse2())
+            return scale_samples_dbl_sse2;
+#endif
+#if QTAV_HAVE(NEON_INTRINSICS) && defined(__aarch64__)
+        if (has_neon())
+            return scale_samples_dbl_neon;
+#endif
+        return scale_samples<double>;
+    default:
+        return 0;
+    }
+}
+
+/*
+ * Generic conversion in float (or double for 32 bit integer and double formats) domain.
+ * The conversion is the same as libswresample.
+ */
+static inline float sample_to_float(quint8 v) { return float(int(v) - 0x80)*(1.0f/float(1<<7)); }
+static inline float sample_to_float(qint16 v) { return float(v)*(1.0f/float(1<<15)); }
+static inline float sample_to_float(float v) { return v; }
+static inline double sample_to_double(quint8 v) { return sample_to_float(v); }
+static inline double sample_to_double(qint16 v) { return sample_to_float(v); }
+static inline double sample_to_double(qint32 v) { return double(v)*(1.0/double(1U<<31)); }
+static inline double sample_to_double(float v) { return v; }
+static inline double sample_to_double(double v) { return v; }
+// not used by convert_scale_float(), but required to instantiate it
+static inline float sample_to_float(qint32 v) { return float(sample_to_double(v)); }
+static inline float sample_to_float(double v) { return float(v); }
+
+static inline void sample_from(quint8 *d, double v) { *d = av_clip_uint8(lrint(v*double(1<<7)) + 0x80); }
+static inline void sample_from(qint16 *d, double v) { *d = av_clip_int16(lrint(v*double(1<<15))); }
+static inline void sample_from(qint32 *d, double v) { *d = av_clipl_int32(llrint(v*double(1U<<31))); }
+static inline void sample_from(float *d, double v) { *d = float(v); }
+static inline void sample_from(double *d, double v) { *d = v; }
+static inline void sample_from(quint8 *d, float v) { *d = av_clip_uint8(lrintf(v*float(1<<7)) + 0x80); }
+static inline void sample_from(qint16 *d, float v) { *d = clip_s16(float_to_s16(v)); }
+static inline void sample_from(float *d, float v) { *d = v; }
+
+template<typename T>
+static inline void sample_convert(T *d, T v) { *d = v; }
+template<typename In, typename Out>
+static inline void sample_convert(Out *d, In v) { sample_from(d, sample_to_float(v)); }
+
+template<typename In, typename Out, bool in_planar, bool out_planar>
+static void convert_samples(quint8 *const *dst, const quint8 *const *src, int channels, int nb_samples)
+{
+    const int in_step = in_planar ? 1 : channels;
+    const int out_step = out_planar ? 1 : channels;
+    for (int c = 0; c < channels; ++c) {
+        const In *s = in_planar ? (const In*)src[c] : (const In*)src[0] + c;
+        Out *d = out_planar ? (Out*)dst[c] : (Out*)dst[0] + c;
+        for (int i = 0; i < nb_samples; ++i)
+            sample_convert(d + i*out_step, s[i*in_step]);
+    }
+}
+
+template<typename In, typename Out, bool planar>
+static void convert_scale_float(quint8 *dst, const quint8 *const *src, int channels, int nb_samples, float volume)
+{
+    Out *d = (Out*)dst;
+    for (int i = 0; i < nb_samples; ++i) {
+        for (int c = 0; c < channels; ++c) {
+            const In s = planar ? ((const In*)src[c])[i] : ((const In*)src[0])[i*channels + c];
+            sample_from(d++, sample_to_float(s)*volume);
+        }
+    }
+}
+
+template<typename In, typename Out, bool planar>
+static void convert_scale_double(quint8 *dst, const quint8 *const *src, int channels, int nb_samples, float volume)
+{
+    Out *d = (Out*)dst;
+    const double v = volume;
+    for (int i = 0; i < nb_samples; ++i) {
+        for (int c = 0; c < channels; ++c) {
+            const In s = planar ? ((const In*)src[c])[i] : ((const In*)src[0])[i*channels + c];
+            sample_from(d++, sample_to_double(s)*v);
+        }
+    }
+}
+
+template<typename In, bool planar>
+static convert_scale_func get_convert_scaler_from(AudioFormat::SampleFormat out, bool in_double)
+{
+    switch (out) {
+    case AudioFormat::SampleFormat_Unsigned8:
+        return in_double ? convert_scale_double<In, quint8, planar> : convert_scale_float<In, quint8, planar>;
+    case AudioFormat::SampleFormat_Signed16:
+        return in_double ? convert_scale_double<In, qint16, planar> : convert_scale_float<In, qint16, planar>;
+    case AudioFormat::SampleFormat_Signed32:
+        return convert_scale_double<In, qint32, planar>;
+    case AudioFormat::SampleFormat_Float:
+        return in_double ? convert_scale_double<In, float, planar> : convert_scale_float<In, float, planar>;
+    case AudioFormat::SampleFormat_Double:
+        return convert_scale_double<In, double, planar>;
+    default:
+        return 0;
+    }
+}
+
+convert_scale_func get_convert_scaler(AudioFormat::SampleFormat in, AudioFormat::SampleFormat out)
+{
+    // out must be packed, planar out is not handled in get_convert_scaler_from()
+    // common cases: float/float planar from decoder to s16/float packed
+    if (in == AudioFormat::SampleFormat_FloatPlanar && out == AudioFormat::SampleFormat_Signed16) {
+#if QTAV_HAVE(SSE2)
+        if (has_sse2())
+            return convert_scale_fltp_s16_sse2;
+#endif
+#if QTAV_HAVE(NEON_INTRINSICS)
+        if (has_neon())
+            return convert_scale_fltp_s16_neon;
+#endif
+    } else if (in == AudioFormat::SampleFormat_Float && out == AudioFormat::SampleFormat_Signed16) {
+#if QTAV_HAVE(SSE2)
+        if (has_sse2())
+            return convert_scale_flt_s16_sse2;
+#endif
+    } else if (in == AudioFormat::SampleFormat_FloatPlanar && out == AudioFormat::SampleFormat_Float) {
+#if QTAV_HAVE(SSE2)
+        if (has_sse2())
+            return convert_scale_fltp_flt_sse2;
+#endif
+    }
+    switch (in) {
+    case AudioFormat::SampleFormat_Unsigned8:
+        return get_convert_scaler_from<quint8, false>(out, false);
+    case AudioFormat::SampleFormat_Unsigned8Planar:
+        return get_convert_scaler_from<quint8, true>(out, false);
+    case AudioFormat::SampleFormat_Signed16:
+        return get_convert_scaler_from<qint16, false>(out, false);
+    case AudioFormat::SampleFormat_Signed16Planar:
+        return get_convert_scaler_from<qint16, true>(out, false);
+    case AudioFormat::SampleFormat_Signed32:
+        return get_convert_scaler_from<qint32, false>(out, true);
+    case AudioFormat::SampleFormat_Signed32Planar:
+        return get_convert_scaler_from<qint32, true>(out, true);
+    case AudioFormat::SampleFormat_Float:
+        return get_convert_scaler_from<float, false>(out, false);
+    case AudioFormat::SampleFormat_FloatPlanar:
+        return get_convert_scaler_from<float, true>(out, false);
+    case AudioFormat::SampleFormat_Double:
+        return get_convert_scaler_from<double, false>(out, true);
+    case AudioFormat::SampleFormat_DoublePlanar:
+        return get_convert_scaler_from<double, true>(out, true);
+    default:
+        return 0;
+    }
+}
+
+#if QTAV_HAVE(SSE2)
+// volume kernels with volume 1
+static void convert_samples_flt_s16_sse2(quint8 *const *dst, const quint8 *const *src, int channels, int nb_samples)
+{
+    convert_scale_flt_s16_sse2(dst[0], src, channels, nb_samples, 1.0f);
+}
+
+static void convert_samples_fltp_s16p_sse2(quint8 *const *dst, const quint8 *const *src, int channels, int nb_samples)
+{
+    for (int c = 0; c < channels; ++c)
+        convert_scale_flt_s16_sse2(dst[c], src + c, 1, nb_samples, 1.0f);
+}
+
+static void convert_samples_fltp_s16_sse2(quint8 *const *dst, const quint8 *const *src, int channels, int nb_samples)
+{
+    convert_scale_fltp_s16_sse2(dst[0], src, channels, nb_samples, 1.0f);
+}
+
+static void convert_samples_fltp_flt_sse2(quint8 *const *dst, const quint8 *const *src, int channels, int nb_samples)
+{
+    convert_scale_fltp_flt_sse2(dst[0], src, channels, nb_samples, 1.0f);
+}
+#define SAMPLE_CONVERTER(IN, OUT, GENERIC, SSE2) \
+    if (in == AudioFormat::SampleFormat_##IN && out == AudioFormat::SampleFormat_##OUT) \
+        return has_sse2() ? SSE2 : GENERIC;
+#else
+#define SAMPLE_CONVERTER(IN, OUT, GENERIC, SSE2) \
+    if (in == AudioFormat::SampleFormat_##IN && out == AudioFormat::SampleFormat_##OUT) \
+        return GENERIC;
+#endif //QTAV_HAVE(SSE2)
+
+convert_samples_func get_sample_converter(AudioFormat::SampleFormat in, AudioFormat::SampleFormat out)
+{
+    SAMPLE_CONVERTER(Signed16, Float, (convert_samples<qint16, float, false, false>), convert_samples_s16_flt_sse2)
+    SAMPLE_CONVERTER(Signed16Planar, FloatPlanar, (convert_samples<qint16, float, true, true>), convert_samples_s16p_fltp_sse2)
+    SAMPLE_CONVERTER(Float, Signed16, (convert_samples<float, qint16, false, false>), convert_samples_flt_s16_sse2)
+    SAMPLE_CONVERTER(FloatPlanar, Signed16Planar, (convert_samples<float, qint16, true, true>), convert_samples_fltp_s16p_sse2)
+    SAMPLE_CONVERTER(FloatPlanar, Signed16, (convert_samples<float, qint16, true, false>), convert_samples_fltp_s16_sse2)
+    SAMPLE_CONVERTER(Signed16Planar, Signed16, (convert_samples<qint16, qint16, true, false>), convert_samples_s16p_s16_sse2)
+    SAMPLE_CONVERTER(Signed16, Signed16Planar, (convert_samples<qint16, qint16, false, true>), convert_samples_s16_s16p_sse2)
+    SAMPLE_CONVERTER(FloatPlanar, Float, (convert_samples<float, float, true, false>), convert_samples_fltp_flt_sse2)
+    SAMPLE_CONVERTER(Float, FloatPlanar, (convert_samples<float, float, false, true>), convert_samples_flt_fltp_sse2)
+    return 0;
+}
+#undef SAMPLE_CONVERTER
+} //namespace QtAV
@@ -0,0 +1,143 @@
+/******************************************************************************
+    QtAV:  Multimedia framework based on Qt and FFmpeg
+    Copyright (C) 2012-2017 Wang Bin <wbsecg1@gmail.com>
+
+*   This file is part of QtAV (from 2017)
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+******************************************************************************/
+
+#ifndef QTAV_AUDIOSCALE_H
+#define QTAV_AUDIOSCALE_H
+
+#include <math.h>
+#include "QtAV/AudioFormat.h"
+#include "QtAV/private/AVCompat.h"
+
+namespace QtAV {
+/*!
+ * Software volume kernels. src and dst can be the same.
+ * volume is the fixed point value (vol*256) used by integer formats, volumef is used by float formats.
+ * nb_samples is the number of samples of all channels.
+ */
+typedef void (*scale_samples_func)(quint8 *dst, const quint8 *src, int nb_samples, int volume, float volumef);
+/*!
+ * Sample format conversion and software volume in 1 pass.
+ * src is an array of planes (only src[0] is used for packed input), dst is packed.
+ * nb_samples is the number of samples per channel.
+ */
+typedef void (*convert_scale_func)(quint8 *dst, const quint8 *const *src, int channels, int nb_samples, float volume);
+
+/*!
+ * \brief get_scaler
+ * The best kernel for current cpu
+ * \param voli the fixed point volume to pass to the kernel
+ * \return null if format is not supported
+ */
+Q_AV_PRIVATE_EXPORT scale_samples_func get_scaler(AudioFormat::SampleFormat fmt, qreal vol, int* voli);
+/*!
+ * \brief get_convert_scaler
+ * The best kernel for current cpu to convert from in to out. out must be packed
+ * \return null if not supported
+ */
+Q_AV_PRIVATE_EXPORT convert_scale_func get_convert_scaler(AudioFormat::SampleFormat in, AudioFormat::SampleFormat out);
+/*!
+ * Sample format or layout change without resampling and volume.
+ * dst and src are arrays of planes (only [0] is used for packed format), nb_samples is the number of samples per channel.
+ */
+typedef void (*convert_samples_func)(quint8 *const *dst, const quint8 *const *src, int channels, int nb_samples);
+/*!
+ * \brief get_sample_converter
+ * The best kernel for common pure sample format changes: s16 <=> float, float planar => s16 and planar <=> packed of the same sample type
+ * \return null if not supported. A resampler should be used
+ */
+Q_AV_PRIVATE_EXPORT convert_samples_func get_sample_converter(AudioFormat::SampleFormat in, AudioFormat::SampleFormat out);
+
+/// from libavfilter/af_volume begin
+static inline void scale_samples_u8(quint8 *dst, const quint8 *src, int nb_samples, int volume, float)
+{
+    for (int i = 0; i < nb_samples; i++)
+        dst[i] = av_clip_uint8(((((qint64)src[i] - 128) * volume + 128) >> 8) + 128);
+}
+
+static inline void scale_samples_u8_small(quint8 *dst, const quint8 *src, int nb_samples, int volume, float)
+{
+    for (int i = 0; i < nb_samples; i++)
+        dst[i] = av_clip_uint8((((src[i] - 128) * volume + 128) >> 8) + 128);
+}
+
+static inline void scale_samples_s16(quint8 *dst, const quint8 *src, int nb_samples, int volume, float)
+{
+    int16_t *smp_dst       = (int16_t *)dst;
+    const int16_t *smp_src = (const int16_t *)src;
+    for (int i = 0; i < nb_samples; i++)
+        smp_dst[i] = av_clip_int16(((qint64)smp_src[i] * volume + 128) >> 8);
+}
+
+static inline void scale_samples_s16_small(quint8 *dst, const quint8 *src, int nb_samples, int volume, float)
+{
+    int16_t *smp_dst       = (int16_t *)dst;
+    const int16_t *smp_src = (const int16_t *)src;
+    for (int i = 0; i < nb_samples; i++)
+        smp_dst[i] = av_clip_int16((smp_src[i] * volume + 128) >> 8);
+}
+
+static inline void scale_samples_s32(quint8 *dst, const quint8 *src, int nb_samples, int volume, float)
+{
+    qint32 *smp_dst       = (qint32 *)dst;
+    const qint32 *smp_src = (const qint32 *)src;
+    for (int i = 0; i < nb_samples; i++)
+        smp_dst[i] = av_clipl_int32((((qint64)smp_src[i] * volume + 128) >> 8));
+}
+/// from libavfilter/af_volume end
+
+template<typename T>
+static inline void scale_samples(quint8 *dst, const quint8 *src, int nb_samples, int, float volume)
+{
+    T *smp_dst = (T *)dst;
+    const T *smp_src = (const T *)src;
+    for (int i = 0; i < nb_samples; ++i)
+        smp_dst[i] = smp_src[i] * (T)volume;
+}
+
+// the same conversion as libswresample
+static inline float float_to_s16(float v) { return v*float(1<<15); }
+static inline qint16 clip_s16(float v) { return av_clip_int16(lrintf(v)); }
+
+// SIMD kernels. the fixed point volume of integer formats must be < 0x8000
+#if QTAV_HAVE(SSE2)
+void scale_samples_u8_sse2(quint8 *dst, const quint8 *src, int nb_samples, int volume, float volumef);
+void scale_samples_s16_sse2(quint8 *dst, const quint8 *src, int nb_samples, int volume, float volumef);
+void scale_samples_s32_sse2(quint8 *dst, const quint8 *src, int nb_samples, int volume, float volumef);
+void scale_samples_flt_sse2(quint8 *dst, const quint8 *src, int nb_samples, int volume, float volumef);
+void scale_samples_dbl_sse2(quint8 *dst, const quint8 *src, int nb_samples, int volume, float volumef);
+void convert_scale_flt_s16_sse2(quint8 *dst, const quint8 *const *src, int channels, int nb_samples, float volume);
+void convert_scale_fltp_s16_sse2(quint8 *dst, const quint8 *const *src, int channels, int nb_samples, float volume);
+void convert_scale_fltp_flt_sse2(quint8 *dst, const quint8 *const *src, int channels, int nb_samples, float volume);
+void convert_samples_s16_flt_sse2(quint8 *const *dst, const quint8 *const *src, int channels, int nb_samples);
+void convert_samples_s16p_fltp_sse2(quint8 *const *dst, const quint8 *const *src, int channels, int nb_samples);
+void convert_samples_s16p_s16_sse2(quint8 *const *dst, const quint8 *const *src, int channels, int nb_samples);
+void convert_samples_s16_s16p_sse2(quint8 *const *dst, const quint8 *const *src, int channels, int nb_samples);
+void convert_samples_flt_fltp_sse2(quint8 *const *dst, const quint8 *const *src, int channels, int nb_samples);
+#endif //QTAV_HAVE(SSE2)
+#if QTAV_HAVE(AVX2)
+void scale_samples_u8_avx2(quint8 *dst, const quint8 *src, int nb_samples, int volume, float volumef);
+void scale_samples_s16_avx2(quint8 *dst, const quint8 *src, int nb_samples, int volume, float volumef);
+void scale_samples_s32_avx2(quint8 *dst, const quint8 *src, int nb_samples, int volume, float volumef);
+void scale_samples_flt_avx2(quint8 *dst, const quint8 *src, int nb_samples, int volume, float volumef);
+void scale_samples_dbl_avx2(quint8 *dst, const quint8 *src, int nb_samples, int volume, float volumef);
+#endif //QTAV_HAVE(AVX2)
+} //namespace QtAV
+#endif //QTAV_AUDIOSCALE_H
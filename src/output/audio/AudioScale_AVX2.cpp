@@ -0,0 +1,119 @@
+/******************************************************************************
+    QtAV:  Multimedia framework based on Qt and FFmpeg
+    Copyright (C) 2012-2017 Wang Bin <wbsecg1@gmail.com>
+
+*   This file is part of QtAV (from 2017)
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+******************************************************************************/
+
+#include "AudioScale.h"
+#if defined(__AVX2__)
+#include <immintrin.h>
+
+namespace QtAV {
+// unpack and pack are in 128 bit lanes, so the sample order is kept
+
+// x: 16 s16 samples. (x*volume + 128)>>8 as 2x8 s32
+static inline void mul_s16_round(__m256i x, __m256i vol, __m256i *p0, __m256i *p1)
+{
+    const __m256i r = _mm256_set1_epi32(128);
+    const __m256i lo = _mm256_mullo_epi16(x, vol);
+    const __m256i hi = _mm256_mulhi_epi16(x, vol);
+    *p0 = _mm256_srai_epi32(_mm256_add_epi32(_mm256_unpacklo_epi16(lo, hi), r), 8);
+    *p1 = _mm256_srai_epi32(_mm256_add_epi32(_mm256_unpackhi_epi16(lo, hi), r), 8);
+}
+
+void scale_samples_u8_avx2(quint8 *dst, const quint8 *src, int nb_samples, int volume, float)
+{
+    const __m256i vol = _mm256_set1_epi16((short)volume);
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i c128 = _mm256_set1_epi16(128);
+    int i = 0;
+    for (; i <= nb_samples - 32; i += 32) {
+        const __m256i x = _mm256_loadu_si256((const __m256i*)(src + i));
+        __m256i p0, p1, p2, p3;
+        mul_s16_round(_mm256_sub_epi16(_mm256_unpacklo_epi8(x, zero), c128), vol, &p0, &p1);
+        mul_s16_round(_mm256_sub_epi16(_mm256_unpackhi_epi8(x, zero), c128), vol, &p2, &p3);
+        const __m256i a = _mm256_add_epi16(_mm256_packs_epi32(p0, p1), c128);
+        const __m256i b = _mm256_add_epi16(_mm256_packs_epi32(p2, p3), c128);
+        _mm256_storeu_si256((__m256i*)(dst + i), _mm256_packus_epi16(a, b));
+    }
+    scale_samples_u8_small(dst + i, src + i, nb_samples - i, volume, 0);
+}
+
+void scale_samples_s16_avx2(quint8 *dst, const quint8 *src, int nb_samples, int volume, float)
+{
+    const __m256i vol = _mm256_set1_epi16((short)volume);
+    const qint16 *s = (const qint16*)src;
+    qint16 *d = (qint16*)dst;
+    int i = 0;
+    for (; i <= nb_samples - 16; i += 16) {
+        __m256i p0, p1;
+        mul_s16_round(_mm256_loadu_si256((const __m256i*)(s + i)), vol, &p0, &p1);
+        _mm256_storeu_si256((__m256i*)(d + i), _mm256_packs_epi32(p0, p1));
+    }
+    scale_samples_s16_small(dst + i*2, src + i*2, nb_samples - i, volume, 0);
+}
+
+// (x*volume + 128)>>8 in double is exact because volume < 0x8000
+static inline __m128i scale_s32_pd(__m128i x, __m256d vol)
+{
+    const __m256d p = _mm256_mul_pd(_mm256_add_pd(_mm256_mul_pd(_mm256_cvtepi32_pd(x), vol), _mm256_set1_pd(128.0)), _mm256_set1_pd(1.0/256.0));
+    const __m256d c = _mm256_min_pd(_mm256_max_pd(p, _mm256_set1_pd(-2147483648.0)), _mm256_set1_pd(2147483647.0));
+    return _mm256_cvttpd_epi32(_mm256_floor_pd(c));
+}
+
+void scale_samples_s32_avx2(quint8 *dst, const quint8 *src, int nb_samples, int volume, float)
+{
+    const __m256d vol = _mm256_set1_pd(volume);
+    const qint32 *s = (const qint32*)src;
+    qint32 *d = (qint32*)dst;
+    int i = 0;
+    for (; i <= nb_samples - 8; i += 8) {
+        const __m128i lo = scale_s32_pd(_mm_loadu_si128((const __m128i*)(s + i)), vol);
+        const __m128i hi = scale_s32_pd(_mm_loadu_si128((const __m128i*)(s + i + 4)), vol);
+        _mm256_storeu_si256((__m256i*)(d + i), _mm256_inserti128_si256(_mm256_castsi128_si256(lo), hi, 1));
+    }
+    scale_samples_s32(dst + i*4, src + i*4, nb_samples - i, volume, 0);
+}
+
+void scale_samples_flt_avx2(quint8 *dst, const quint8 *src, int nb_samples, int volume, float volumef)
+{
+    const __m256 vol = _mm256_set1_ps(volumef);
+    const float *s = (const float*)src;
+    float *d = (float*)dst;
+    int i = 0;
+    for (; i <= nb_samples - 16; i += 16) {
+        _mm256_storeu_ps(d + i, _mm256_mul_ps(_mm256_loadu_ps(s + i), vol));
+        _mm256_storeu_ps(d + i + 8, _mm256_mul_ps(_mm256_loadu_ps(s + i + 8), vol));
+    }
+    scale_samples<float>(dst + i*4, src + i*4, nb_samples - i, volume, volumef);
+}
+
+void scale_samples_dbl_avx2(quint8 *dst, const quint8 *src, int nb_samples, int volume, float volumef)
+{
+    const __m256d vol = _mm256_set1_pd(volumef);
+    const double *s = (const double*)src;
+    double *d = (double*)dst;
+    int i = 0;
+    for (; i <= nb_samples - 8; i += 8) {
+        _mm256_storeu_pd(d + i, _mm256_mul_pd(_mm256_loadu_pd(s + i), vol));
+        _mm256_storeu_pd(d + i + 4, _mm256_mul_pd(_mm256_loadu_pd(s + i + 4), vol));
+    }
+    scale_samples<double>(dst + i*8, src + i*8, nb_samples - i, volume, volumef);
+}
+} //namespace QtAV
+#endif //defined(__AVX2__)
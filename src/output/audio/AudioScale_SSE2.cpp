@@ -0,0 +1,287 @@
+/******************************************************************************
+    QtAV:  Multimedia framework based on Qt and FFmpeg
+    Copyright (C) 2012-2017 Wang Bin <wbsecg1@gmail.com>
+
+*   This file is part of QtAV (from 2017)
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+******************************************************************************/
+
+#include "AudioScale.h"
+#if defined(__SSE__) || defined(_M_IX86) || defined(_M_X64) // gcc, clang defines __SSE__, vc does not
+#include <emmintrin.h>
+
+namespace QtAV {
+
+// x: 8 s16 samples. (x*volume + 128)>>8 as 2x4 s32
+static inline void mul_s16_round(__m128i x, __m128i vol, __m128i *p0, __m128i *p1)
+{
+    const __m128i r = _mm_set1_epi32(128);
+    const __m128i lo = _mm_mullo_epi16(x, vol);
+    const __m128i hi = _mm_mulhi_epi16(x, vol);
+    *p0 = _mm_srai_epi32(_mm_add_epi32(_mm_unpacklo_epi16(lo, hi), r), 8);
+    *p1 = _mm_srai_epi32(_mm_add_epi32(_mm_unpackhi_epi16(lo, hi), r), 8);
+}
+
+void scale_samples_u8_sse2(quint8 *dst, const quint8 *src, int nb_samples, int volume, float)
+{
+    const __m128i vol = _mm_set1_epi16((short)volume);
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i c128 = _mm_set1_epi16(128);
+    int i = 0;
+    for (; i <= nb_samples - 16; i += 16) {
+        const __m128i x = _mm_loadu_si128((const __m128i*)(src + i));
+        __m128i p0, p1, p2, p3;
+        mul_s16_round(_mm_sub_epi16(_mm_unpacklo_epi8(x, zero), c128), vol, &p0, &p1);
+        mul_s16_round(_mm_sub_epi16(_mm_unpackhi_epi8(x, zero), c128), vol, &p2, &p3);
+        const __m128i a = _mm_add_epi16(_mm_packs_epi32(p0, p1), c128);
+        const __m128i b = _mm_add_epi16(_mm_packs_epi32(p2, p3), c128);
+        _mm_storeu_si128((__m128i*)(dst + i), _mm_packus_epi16(a, b));
+    }
+    scale_samples_u8_small(dst + i, src + i, nb_samples - i, volume, 0);
+}
+
+void scale_samples_s16_sse2(quint8 *dst, const quint8 *src, int nb_samples, int volume, float)
+{
+    const __m128i vol = _mm_set1_epi16((short)volume);
+    const qint16 *s = (const qint16*)src;
+    qint16 *d = (qint16*)dst;
+    int i = 0;
+    for (; i <= nb_samples - 8; i += 8) {
+        __m128i p0, p1;
+        mul_s16_round(_mm_loadu_si128((const __m128i*)(s + i)), vol, &p0, &p1);
+        _mm_storeu_si128((__m128i*)(d + i), _mm_packs_epi32(p0, p1));
+    }
+    scale_samples_s16_small(dst + i*2, src + i*2, nb_samples - i, volume, 0);
+}
+
+// (x*volume + 128)>>8 in double is exact because volume < 0x8000
+static inline __m128i scale_s32_pd(__m128d x, __m128d vol)
+{
+    const __m128d p = _mm_mul_pd(_mm_add_pd(_mm_mul_pd(x, vol), _mm_set1_pd(128.0)), _mm_set1_pd(1.0/256.0));
+    const __m128d c = _mm_min_pd(_mm_max_pd(p, _mm_set1_pd(-2147483648.0)), _mm_set1_pd(2147483647.0));
+    // floor
+    const __m128d t = _mm_cvtepi32_pd(_mm_cvttpd_epi32(c));
+    const __m128d f = _mm_sub_pd(t, _mm_and_pd(_mm_cmpgt_pd(t, c), _mm_set1_pd(1.0)));
+    return _mm_cvttpd_epi32(f);
+}
+
+void scale_samples_s32_sse2(quint8 *dst, const quint8 *src, int nb_samples, int volume, float)
+{
+    const __m128d vol = _mm_set1_pd(volume);
+    const qint32 *s = (const qint32*)src;
+    qint32 *d = (qint32*)dst;
+    int i = 0;
+    for (; i <= nb_samples - 4; i += 4) {
+        const __m128i x = _mm_loadu_si128((const __m128i*)(s + i));
+        const __m128i lo = scale_s32_pd(_mm_cvtepi32_pd(x), vol);
+        const __m128i hi = scale_s32_pd(_mm_cvtepi32_pd(_mm_shuffle_epi32(x, _MM_SHUFFLE(1, 0, 3, 2))), vol);
+        _mm_storeu_si128((__m128i*)(d + i), _mm_unpacklo_epi64(lo, hi));
+    }
+    scale_samples_s32(dst + i*4, src + i*4, nb_samples - i, volume, 0);
+}
+
+void scale_samples_flt_sse2(quint8 *dst, const quint8 *src, int nb_samples, int volume, float volumef)
+{
+    const __m128 vol = _mm_set1_ps(volumef);
+    const float *s = (const float*)src;
+    float *d = (float*)dst;
+    int i = 0;
+    for (; i <= nb_samples - 8; i += 8) {
+        _mm_storeu_ps(d + i, _mm_mul_ps(_mm_loadu_ps(s + i), vol));
+        _mm_storeu_ps(d + i + 4, _mm_mul_ps(_mm_loadu_ps(s + i + 4), vol));
+    }
+    scale_samples<float>(dst + i*4, src + i*4, nb_samples - i, volume, volumef);
+}
+
+void scale_samples_dbl_sse2(quint8 *dst, const quint8 *src, int nb_samples, int volume, float volumef)
+{
+    const __m128d vol = _mm_set1_pd(volumef);
+    const double *s = (const double*)src;
+    double *d = (double*)dst;
+    int i = 0;
+    for (; i <= nb_samples - 4; i += 4) {
+        _mm_storeu_pd(d + i, _mm_mul_pd(_mm_loadu_pd(s + i), vol));
+        _mm_storeu_pd(d + i + 2, _mm_mul_pd(_mm_loadu_pd(s + i + 2), vol));
+    }
+    scale_samples<double>(dst + i*8, src + i*8, nb_samples - i, volume, volumef);
+}
+
+// x: 4 float samples multiplied by volume*32768. rounding mode is round to nearest as lrintf
+static inline __m128i cvt_s16_ps(__m128 x)
+{
+    x = _mm_min_ps(_mm_max_ps(x, _mm_set1_ps(-32768.0f)), _mm_set1_ps(32767.0f));
+    return _mm_cvtps_epi32(x);
+}
+
+void convert_scale_flt_s16_sse2(quint8 *dst, const quint8 *const *src, int channels, int nb_samples, float volume)
+{
+    const __m128 vol = _mm_set1_ps(volume*float(1<<15));
+    const float *s = (const float*)src[0];
+    qint16 *d = (qint16*)dst;
+    const int n = nb_samples*channels;
+    int i = 0;
+    for (; i <= n - 8; i += 8) {
+        const __m128i a = cvt_s16_ps(_mm_mul_ps(_mm_loadu_ps(s + i), vol));
+        const __m128i b = cvt_s16_ps(_mm_mul_ps(_mm_loadu_ps(s + i + 4), vol));
+        _mm_storeu_si128((__m128i*)(d + i), _mm_packs_epi32(a, b));
+    }
+    for (; i < n; ++i)
+        d[i] = clip_s16(float_to_s16(s[i]*volume));
+}
+
+void convert_scale_fltp_s16_sse2(quint8 *dst, const quint8 *const *src, int channels, int nb_samples, float volume)
+{
+    if (channels == 1) {
+        convert_scale_flt_s16_sse2(dst, src, channels, nb_samples, volume);
+        return;
+    }
+    const __m128 vol = _mm_set1_ps(volume*float(1<<15));
+    qint16 *d = (qint16*)dst;
+    int i = 0;
+    if (channels == 2) {
+        const float *l = (const float*)src[0];
+        const float *r = (const float*)src[1];
+        for (; i <= nb_samples - 4; i += 4) {
+            const __m128 L = _mm_mul_ps(_mm_loadu_ps(l + i), vol);
+            const __m128 R = _mm_mul_ps(_mm_loadu_ps(r + i), vol);
+            const __m128i a = cvt_s16_ps(_mm_unpacklo_ps(L, R));
+            const __m128i b = cvt_s16_ps(_mm_unpackhi_ps(L, R));
+            _mm_storeu_si128((__m128i*)(d + 2*i), _mm_packs_epi32(a, b));
+        }
+    }
+    for (; i < nb_samples; ++i) {
+        for (int c = 0; c < channels; ++c)
+            d[i*channels + c] = clip_s16(float_to_s16(((const float*)src[c])[i]*volume));
+    }
+}
+
+void convert_scale_fltp_flt_sse2(quint8 *dst, const quint8 *const *src, int channels, int nb_samples, float volume)
+{
+    float *d = (float*)dst;
+    if (channels == 1) {
+        scale_samples_flt_sse2(dst, src[0], nb_samples, 0, volume);
+        return;
+    }
+    const __m128 vol = _mm_set1_ps(volume);
+    int i = 0;
+    if (channels == 2) {
+        const float *l = (const float*)src[0];
+        const float *r = (const float*)src[1];
+        for (; i <= nb_samples - 4; i += 4) {
+            const __m128 L = _mm_mul_ps(_mm_loadu_ps(l + i), vol);
+            const __m128 R = _mm_mul_ps(_mm_loadu_ps(r + i), vol);
+            _mm_storeu_ps(d + 2*i, _mm_unpacklo_ps(L, R));
+            _mm_storeu_ps(d + 2*i + 4, _mm_unpackhi_ps(L, R));
+        }
+    }
+    for (; i < nb_samples; ++i) {
+        for (int c = 0; c < channels; ++c)
+            d[i*channels + c] = ((const float*)src[c])[i]*volume;
+    }
+}
+
+// x/32768, the same as libswresample
+static void convert_s16_flt_row_sse2(float *d, const qint16 *s, int n)
+{
+    const __m128 k = _mm_set1_ps(1.0f/float(1<<15));
+    int i = 0;
+    for (; i <= n - 8; i += 8) {
+        const __m128i x = _mm_loadu_si128((const __m128i*)(s + i));
+        // sign extend to s32
+        const __m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(x, x), 16);
+        const __m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(x, x), 16);
+        _mm_storeu_ps(d + i, _mm_mul_ps(_mm_cvtepi32_ps(lo), k));
+        _mm_storeu_ps(d + i + 4, _mm_mul_ps(_mm_cvtepi32_ps(hi), k));
+    }
+    for (; i < n; ++i)
+        d[i] = float(s[i])*(1.0f/float(1<<15));
+}
+
+void convert_samples_s16_flt_sse2(quint8 *const *dst, const quint8 *const *src, int channels, int nb_samples)
+{
+    convert_s16_flt_row_sse2((float*)dst[0], (const qint16*)src[0], nb_samples*channels);
+}
+
+void convert_samples_s16p_fltp_sse2(quint8 *const *dst, const quint8 *const *src, int channels, int nb_samples)
+{
+    for (int c = 0; c < channels; ++c)
+        convert_s16_flt_row_sse2((float*)dst[c], (const qint16*)src[c], nb_samples);
+}
+
+void convert_samples_s16p_s16_sse2(quint8 *const *dst, const quint8 *const *src, int channels, int nb_samples)
+{
+    qint16 *d = (qint16*)dst[0];
+    int i = 0;
+    if (channels == 2) {
+        const qint16 *l = (const qint16*)src[0];
+        const qint16 *r = (const qint16*)src[1];
+        for (; i <= nb_samples - 8; i += 8) {
+            const __m128i L = _mm_loadu_si128((const __m128i*)(l + i));
+            const __m128i R = _mm_loadu_si128((const __m128i*)(r + i));
+            _mm_storeu_si128((__m128i*)(d + 2*i), _mm_unpacklo_epi16(L, R));
+            _mm_storeu_si128((__m128i*)(d + 2*i + 8), _mm_unpackhi_epi16(L, R));
+        }
+    }
+    for (; i < nb_samples; ++i) {
+        for (int c = 0; c < channels; ++c)
+            d[i*channels + c] = ((const qint16*)src[c])[i];
+    }
+}
+
+void convert_samples_s16_s16p_sse2(quint8 *const *dst, const quint8 *const *src, int channels, int nb_samples)
+{
+    const qint16 *s = (const qint16*)src[0];
+    int i = 0;
+    if (channels == 2) {
+        qint16 *l = (qint16*)dst[0];
+        qint16 *r = (qint16*)dst[1];
+        for (; i <= nb_samples - 8; i += 8) {
+            const __m128i a = _mm_loadu_si128((const __m128i*)(s + 2*i));
+            const __m128i b = _mm_loadu_si128((const __m128i*)(s + 2*i + 8));
+            // low 16 bits of each 32 bits is left, high 16 bits is right. sign extend then pack without saturation
+            const __m128i La = _mm_srai_epi32(_mm_slli_epi32(a, 16), 16);
+            const __m128i Lb = _mm_srai_epi32(_mm_slli_epi32(b, 16), 16);
+            _mm_storeu_si128((__m128i*)(l + i), _mm_packs_epi32(La, Lb));
+            _mm_storeu_si128((__m128i*)(r + i), _mm_packs_epi32(_mm_srai_epi32(a, 16), _mm_srai_epi32(b, 16)));
+        }
+    }
+    for (; i < nb_samples; ++i) {
+        for (int c = 0; c < channels; ++c)
+            ((qint16*)dst[c])[i] = s[i*channels + c];
+    }
+}
+
+void convert_samples_flt_fltp_sse2(quint8 *const *dst, const quint8 *const *src, int channels, int nb_samples)
+{
+    const float *s = (const float*)src[0];
+    int i = 0;
+    if (channels == 2) {
+        float *l = (float*)dst[0];
+        float *r = (float*)dst[1];
+        for (; i <= nb_samples - 4; i += 4) {
+            const __m128 a = _mm_loadu_ps(s + 2*i);
+            const __m128 b = _mm_loadu_ps(s + 2*i + 4);
+            _mm_storeu_ps(l + i, _mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0)));
+            _mm_storeu_ps(r + i, _mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1)));
+        }
+    }
+    for (; i < nb_samples; ++i) {
+        for (int c = 0; c < channels; ++c)
+            ((float*)dst[c])[i] = s[i*channels + c];
+    }
+}
+} //namespace QtAV
+#endif
@@ -0,0 +1,194 @@
+/******************************************************************************
+    QtAV:  Multimedia framework based on Qt and FFmpeg
+    Copyright (C) 2012-2017 Wang Bin <wbsecg1@gmail.com>
+
+*   This file is part of QtAV (from 2017)
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+******************************************************************************/
+
+#include "QtAV/NullRenderer.h"
+#include "QtAV/private/VideoRenderer_p.h"
+#include "QtAV/AVClock.h"
+#include "QtAV/Statistics.h"
+#include "QtAV/private/factory.h"
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QMutexLocker>
+
+namespace QtAV {
+FACTORY_REGISTER(VideoRenderer, Null, "Null")
+
+class NullRendererPrivate : public VideoRendererPrivate
+{
+public:
+    NullRendererPrivate()
+        : copy(false)
+        , clock(0)
+        , max_records(100000)
+        , received(0)
+        , dropped0(-1)
+    {}
+    qint64 dropped() const { return statistics ? statistics->metrics().video_frames_dropped : 0;}
+
+    bool copy;
+    AVClock *clock;
+    int max_records;
+    qint64 received;
+    qint64 dropped0; // dropped frames when reset
+    QElapsedTimer timer;
+    QVector<NullRenderer::FrameRecord> records;
+    mutable QMutex mutex; // img_mutex is locked in receive(), so can not be used in other functions called by receive()
+};
+
+NullRenderer::NullRenderer()
+    : VideoRenderer(*new NullRendererPrivate())
+{
+}
+
+VideoRendererId NullRenderer::id() const
+{
+    return VideoRendererId_Null;
+}
+
+bool NullRenderer::isSupported(VideoFormat::PixelFormat pixfmt) const
+{
+    return pixfmt != VideoFormat::Format_Invalid;
+}
+
+void NullRenderer::setCopyEnabled(bool value)
+{
+    d_func().copy = value;
+}
+
+bool NullRenderer::isCopyEnabled() const
+{
+    return d_func().copy;
+}
+
+void NullRenderer::setClock(AVClock *clock)
+{
+    DPTR_D(NullRenderer);
+    QMutexLocker lock(&d.mutex);
+    Q_UNUSED(lock);
+    d.clock = clock;
+}
+
+AVClock* NullRenderer::clock() const
+{
+    return d_func().clock;
+}
+
+void NullRenderer::setMaxRecords(int value)
+{
+    DPTR_D(NullRenderer);
+    QMutexLocker lock(&d.mutex);
+    Q_UNUSED(lock);
+    d.max_records = qMax(0, value);
+    if (d.records.size() > d.max_records)
+        d.records.remove(0, d.records.size() - d.max_records);
+}
+
+int NullRenderer::maxRecords() const
+{
+    return d_func().max_records;
+}
+
+QVector<NullRenderer::FrameRecord> NullRenderer::takeRecords()
+{
+    DPTR_D(NullRenderer);
+    QMutexLocker lock(&d.mutex);
+    Q_UNUSED(lock);
+    QVector<FrameRecord> r;
+    r.swap(d.records);
+    return r;
+}
+
+qint64 NullRenderer::framesReceived() const
+{
+    DPTR_D(const NullRenderer);
+    QMutexLocker lock(&d.mutex);
+    Q_UNUSED(lock);
+    return d.received;
+}
+
+qint64 NullRenderer::framesDropped() const
+{
+    DPTR_D(const NullRenderer);
+    QMutexLocker lock(&d.mutex);
+    Q_UNUSED(lock);
+    if (d.dropped0 < 0)
+        return d.dropped();
+    return qMax<qint64>(0, d.dropped() - d.dropped0); // statistics is reset for a new media
+}
+
+void NullRenderer::reset()
+{
+    DPTR_D(NullRenderer);
+    QMutexLocker lock(&d.mutex);
+    Q_UNUSED(lock);
+    d.received = 0;
+    d.dropped0 = d.dropped();
+    d.timer.invalidate();
+    d.records.clear();
+}
+
+VideoFrame NullRenderer::currentFrame() const
+{
+    DPTR_D(const NullRenderer);
+    QMutexLocker lock(const_cast<QMutex*>(&d.img_mutex));
+    Q_UNUSED(lock);
+    return d.video_frame;
+}
+
+bool NullRenderer::receiveFrame(const VideoFrame &frame)
+{
+    DPTR_D(NullRenderer);
+    // img_mutex is locked
+    if (!d.copy) {
+        d.video_frame = frame;
+    } else if (frame.constBits(0)) {
+        d.video_frame = frame.clone();
+    } else {
+        d.video_frame = frame.to(frame.format());
+    }
+    if (!frame.isValid()) // clear
+        return true;
+    if (d.statistics)
+        d.statistics->video_only.frameDisplayed(frame.timestamp());
+    QMutexLocker lock(&d.mutex);
+    Q_UNUSED(lock);
+    if (!d.timer.isValid())
+        d.timer.start();
+    ++d.received;
+    if (d.max_records <= 0)
+        return true;
+    if (d.records.size() >= d.max_records) // discard a quarter to avoid moving records for every frame
+        d.records.remove(0, d.records.size() - d.max_records + qMax(1, d.max_records/4));
+    FrameRecord r;
+    r.timestamp = frame.timestamp();
+    r.arrival = d.timer.nsecsElapsed()/1000LL;
+    r.delay = d.clock ? d.clock->value() - frame.timestamp() : 0;
+    d.records.append(r);
+    return true;
+}
+
+void NullRenderer::drawFrame()
+{
+}
+
+void NullRenderer::updateUi()
+{
+}
+} //namespace QtAV
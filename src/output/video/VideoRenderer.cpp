@@ -27,6 +27,7 @@
 #include "QtAV/Statistics.h"
 #include "QtAV/private/factory.h"
 #include "QtAV/private/mkid.h"
+#include "utils/Trace.h"
 #include "utils/Logger.h"
 #include "LibAVFilter.h"
 #include "FilterContext.h"
@@ -34,6 +35,7 @@
 namespace QtAV {
 FACTORY_DEFINE(VideoRenderer)
 VideoRendererId VideoRendererId_OpenGLWindow = mkid::id32base36_6<'Q', 'O', 'G', 'L', 'W', 'w'>::value;
+VideoRendererId VideoRendererId_Null = mkid::id32base36_4<'N', 'u', 'l', 'l'>::value;
 
 VideoRenderer::VideoRenderer()
     :AVOutput(*new VideoRendererPrivate)
@@ -97,6 +99,7 @@ bool VideoRenderer::receive(VideoFrame &frame)
     }
     QMutexLocker locker(&d.img_mutex);
     Q_UNUSED(locker); //TODO: double buffer for display/dec frame to avoid mutex
+    QTAV_TRACE("renderer", "receiveFrame");
     return receiveFrame(frame);
 }
 
@@ -544,7 +547,9 @@ void VideoRenderer::handlePaintEvent()
          * NOTE: if data is not copyed in receiveFrame(), you should always call drawFrame()
          */
         if (d.video_frame.isValid()) {
+            QTAV_TRACE_VAR(trace_draw, "renderer", "drawFrame");
             drawFrame();
+            trace_draw.end();
             //qDebug("render elapsed: %lld", et.elapsed());
             if (d.statistics) {
                 d.statistics->video_only.frameDisplayed(d.video_frame.timestamp());
@@ -0,0 +1,118 @@
+/******************************************************************************
+    QtAV:  Multimedia framework based on Qt and FFmpeg
+    Copyright (C) 2012-2017 Wang Bin <wbsecg1@gmail.com>
+
+*   This file is part of QtAV (from 2017)
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+******************************************************************************/
+
+#include "BlendASS.h"
+#include <QtCore/qglobal.h>
+extern "C" {
+#include <libavutil/cpu.h>
+}
+// channels are loaded as bytes in memory order, so only little endian is supported
+#if (defined(__ARM_NEON__) || defined(__ARM_NEON)) && Q_BYTE_ORDER == Q_LITTLE_ENDIAN
+#include <arm_neon.h>
+#define QTAV_HAVE_NEON_INTRINSICS 1
+#endif
+
+namespace QtAV {
+
+// not cached, av_force_cpu_flags() can select the kernels
+static int cpuFlags()
+{
+    return av_get_cpu_flags();
+}
+
+#if QTAV_HAVE(SSE2)
+static bool has_sse2() { return !!(cpuFlags() & AV_CPU_FLAG_SSE2); }
+#endif
+#if QTAV_HAVE(AVX2)
+static bool has_avx2()
+{
+#ifdef AV_CPU_FLAG_AVX2
+    return !!(cpuFlags() & AV_CPU_FLAG_AVX2);
+#else
+    return false;
+#endif
+}
+#endif
+
+#if QTAV_HAVE(NEON_INTRINSICS)
+static bool has_neon()
+{
+#ifdef AV_CPU_FLAG_NEON
+    return !!(cpuFlags() & AV_CPU_FLAG_NEON);
+#else
+    return true;
+#endif
+}
+
+static inline uint16x8_t div255_neon(uint16x8_t x)
+{
+    const uint16x4_t m = vdup_n_u16(0x8081);
+    const uint16x4_t lo = vshrn_n_u32(vmull_u16(vget_low_u16(x), m), 16);
+    const uint16x4_t hi = vshrn_n_u32(vmull_u16(vget_high_u16(x), m), 16);
+    return vshrq_n_u16(vcombine_u16(lo, hi), 7);
+}
+
+// 8 channel values: C + trunc(k*(c - C)/255)
+static inline uint8x8_t blend_channel_neon(uint8x8_t d, uint8x8_t k, uint8x8_t c)
+{
+    const uint16x8_t q = div255_neon(vmull_u8(vabd_u8(c, d), k));
+    const uint8x8_t q8 = vmovn_u16(q);
+    return vbsl_u8(vcgt_u8(c, d), vadd_u8(d, q8), vsub_u8(d, q8));
+}
+
+// 8 pixels per loop. bytes of QRgb in memory: b, g, r, a
+static void blend_ass_row_neon(quint32 *dst, const quint8 *src, int w, quint32 color)
+{
+    const uint8x8_t a = vdup_n_u8(color >> 24);
+    uint8x8_t c[4];
+    for (int i = 0; i < 4; ++i)
+        c[i] = vdup_n_u8((color >> (8*i)) & 0xff);
+    int x = 0;
+    for (; x <= w - 8; x += 8) {
+        const uint8x8_t k = vmovn_u16(div255_neon(vmull_u8(vld1_u8(src + x), a)));
+        uint8x8x4_t d = vld4_u8((const uint8_t*)(dst + x));
+        const uint8x8_t z = vceq_u8(d.val[3], vdup_n_u8(0));
+        for (int i = 0; i < 3; ++i)
+            d.val[i] = vbsl_u8(z, c[i], blend_channel_neon(d.val[i], k, c[i]));
+        d.val[3] = vbsl_u8(z, k, blend_channel_neon(d.val[3], k, c[3]));
+        vst4_u8((uint8_t*)(dst + x), d);
+    }
+    blend_ass_row_c(dst + x, src + x, w - x, color);
+}
+#endif //QTAV_HAVE(NEON_INTRINSICS)
+
+blend_ass_row_func get_blend_ass_row()
+{
+#if QTAV_HAVE(AVX2)
+    if (has_avx2())
+        return blend_ass_row_avx2;
+#endif
+#if QTAV_HAVE(SSE2)
+    if (has_sse2())
+        return blend_ass_row_sse2;
+#endif
+#if QTAV_HAVE(NEON_INTRINSICS)
+    if (has_neon())
+        return blend_ass_row_neon;
+#endif
+    return blend_ass_row_c;
+}
+} //namespace QtAV
@@ -0,0 +1,78 @@
+/******************************************************************************
+    QtAV:  Multimedia framework based on Qt and FFmpeg
+    Copyright (C) 2012-2017 Wang Bin <wbsecg1@gmail.com>
+
+*   This file is part of QtAV (from 2017)
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+******************************************************************************/
+
+#ifndef QTAV_BLENDASS_H
+#define QTAV_BLENDASS_H
+
+#include <QtAV/QtAV_Global.h>
+
+namespace QtAV {
+/*!
+ * Blend a row of an ass bitmap (8 bit coverage per pixel) into w ARGB32 pixels (QRgb).
+ * color: QRgb of the bitmap, alpha is the opacity, i.e. 255 - alpha of ASS_Image.color.
+ * For coverage s, k = s*alpha/255. If dst alpha is 0, dst = (rgb, k),
+ * otherwise each channel C += trunc(k*(c - C)/255), c is the channel of color.
+ */
+typedef void (*blend_ass_row_func)(quint32 *dst, const quint8 *src, int w, quint32 color);
+
+/*!
+ * \brief get_blend_ass_row
+ * The best kernel for current cpu
+ */
+Q_AV_PRIVATE_EXPORT blend_ass_row_func get_blend_ass_row();
+
+// x/255 for 0 <= x <= 65535
+static inline unsigned div255(unsigned x) { return (x*0x8081U) >> 23; }
+
+static inline quint32 blend_ass_pixel(quint32 d, unsigned k, quint32 color)
+{
+    if (!(d >> 24))
+        return (color & 0xffffff) | (k << 24);
+    quint32 r = 0;
+    for (int s = 0; s < 32; s += 8) {
+        const int C = (d >> s) & 0xff;
+        const int diff = int((color >> s) & 0xff) - C;
+        const int q = div255(k*unsigned(diff < 0 ? -diff : diff));
+        r |= quint32(C + (diff < 0 ? -q : q)) << s;
+    }
+    return r;
+}
+
+// scalar kernel. SIMD kernels use it for the remaining pixels
+static inline void blend_ass_row_c(quint32 *dst, const quint8 *src, int w, quint32 color)
+{
+    const unsigned a = color >> 24;
+    for (int x = 0; x < w; ++x) {
+        const unsigned k = div255(src[x]*a);
+        if (k == 0 && (dst[x] >> 24)) // no change
+            continue;
+        dst[x] = blend_ass_pixel(dst[x], k, color);
+    }
+}
+
+#if QTAV_HAVE(SSE2)
+void blend_ass_row_sse2(quint32 *dst, const quint8 *src, int w, quint32 color);
+#endif //QTAV_HAVE(SSE2)
+#if QTAV_HAVE(AVX2)
+void blend_ass_row_avx2(quint32 *dst, const quint8 *src, int w, quint32 color);
+#endif //QTAV_HAVE(AVX2)
+} //namespace QtAV
+#endif //QTAV_BLENDASS_H
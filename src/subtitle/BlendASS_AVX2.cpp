@@ -0,0 +1,75 @@
+/******************************************************************************
+    QtAV:  Multimedia framework based on Qt and FFmpeg
+    Copyright (C) 2012-2017 Wang Bin <wbsecg1@gmail.com>
+
+*   This file is part of QtAV (from 2017)
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+******************************************************************************/
+
+#include "BlendASS.h"
+#if defined(__AVX2__)
+#include <immintrin.h>
+
+namespace QtAV {
+// unpack and pack are in 128 bit lanes. lo: pixels 0, 1, 4, 5. hi: pixels 2, 3, 6, 7
+
+static inline __m256i div255_epu16(__m256i x)
+{
+    return _mm256_srli_epi16(_mm256_mulhi_epu16(x, _mm256_set1_epi16((short)0x8081)), 7);
+}
+
+static inline __m256i blend4(__m256i d, __m256i k, __m256i c, __m256i amask, __m256i z)
+{
+    const __m256i diff = _mm256_sub_epi16(c, d);
+    const __m256i sign = _mm256_srai_epi16(diff, 15);
+    const __m256i q = div255_epu16(_mm256_mullo_epi16(_mm256_abs_epi16(diff), k));
+    const __m256i r = _mm256_add_epi16(d, _mm256_sub_epi16(_mm256_xor_si256(q, sign), sign));
+    const __m256i s = _mm256_blendv_epi8(c, k, amask);
+    return _mm256_blendv_epi8(r, s, z);
+}
+
+static inline __m256i combine(__m128i lo, __m128i hi)
+{
+    return _mm256_inserti128_si256(_mm256_castsi128_si256(lo), hi, 1);
+}
+
+void blend_ass_row_avx2(quint32 *dst, const quint8 *src, int w, quint32 color)
+{
+    const __m256i zero = _mm256_setzero_si256();
+    const __m128i a = _mm_set1_epi16((short)(color >> 24));
+    const __m256i c = _mm256_unpacklo_epi8(_mm256_set1_epi32((int)color), zero);
+    const __m256i alpha32 = _mm256_set1_epi32((int)0xff000000);
+    const __m256i amask = _mm256_unpacklo_epi8(alpha32, alpha32);
+    int x = 0;
+    for (; x <= w - 8; x += 8) {
+        const __m128i s = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)(src + x)), _mm_setzero_si128());
+        const __m128i k = _mm_srli_epi16(_mm_mulhi_epu16(_mm_mullo_epi16(s, a), _mm_set1_epi16((short)0x8081)), 7);
+        const __m128i k03 = _mm_unpacklo_epi16(k, k);
+        const __m128i k47 = _mm_unpackhi_epi16(k, k);
+        const __m256i k_lo = combine(_mm_unpacklo_epi32(k03, k03), _mm_unpacklo_epi32(k47, k47));
+        const __m256i k_hi = combine(_mm_unpackhi_epi32(k03, k03), _mm_unpackhi_epi32(k47, k47));
+        __m256i *p = (__m256i*)(dst + x);
+        const __m256i d = _mm256_loadu_si256(p);
+        const __m256i z = _mm256_cmpeq_epi32(_mm256_and_si256(d, alpha32), zero);
+        const __m256i lo = blend4(_mm256_unpacklo_epi8(d, zero), k_lo, c, amask, _mm256_unpacklo_epi8(z, z));
+        const __m256i hi = blend4(_mm256_unpackhi_epi8(d, zero), k_hi, c, amask, _mm256_unpackhi_epi8(z, z));
+        _mm256_storeu_si256(p, _mm256_packus_epi16(lo, hi));
+    }
+    blend_ass_row_c(dst + x, src + x, w - x, color);
+}
+
+} //namespace QtAV
+#endif //defined(__AVX2__)
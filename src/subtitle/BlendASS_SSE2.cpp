@@ -0,0 +1,77 @@
+/******************************************************************************
+    QtAV:  Multimedia framework based on Qt and FFmpeg
+    Copyright (C) 2012-2017 Wang Bin <wbsecg1@gmail.com>
+
+*   This file is part of QtAV (from 2017)
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+******************************************************************************/
+
+#include "BlendASS.h"
+#if defined(__SSE__) || defined(_M_IX86) || defined(_M_X64) // gcc, clang defines __SSE__, vc does not
+#include <emmintrin.h>
+
+namespace QtAV {
+
+// x/255 of u16 lanes
+static inline __m128i div255_epu16(__m128i x)
+{
+    return _mm_srli_epi16(_mm_mulhi_epu16(x, _mm_set1_epi16((short)0x8081)), 7);
+}
+
+/*
+ * 2 pixels as 8 u16 channels. k: coverage of each channel. c: color channels. amask: 0xffff in alpha channels.
+ * z: 0xffff in channels of pixels with 0 alpha.
+ */
+static inline __m128i blend2(__m128i d, __m128i k, __m128i c, __m128i amask, __m128i z)
+{
+    const __m128i diff = _mm_sub_epi16(c, d);
+    const __m128i sign = _mm_srai_epi16(diff, 15);
+    const __m128i absd = _mm_max_epi16(diff, _mm_sub_epi16(_mm_setzero_si128(), diff));
+    const __m128i q = div255_epu16(_mm_mullo_epi16(absd, k));
+    const __m128i r = _mm_add_epi16(d, _mm_sub_epi16(_mm_xor_si128(q, sign), sign));
+    // dst alpha is 0: (rgb, k)
+    const __m128i s = _mm_or_si128(_mm_andnot_si128(amask, c), _mm_and_si128(amask, k));
+    return _mm_or_si128(_mm_and_si128(z, s), _mm_andnot_si128(z, r));
+}
+
+void blend_ass_row_sse2(quint32 *dst, const quint8 *src, int w, quint32 color)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i a = _mm_set1_epi16((short)(color >> 24));
+    const __m128i c = _mm_unpacklo_epi8(_mm_set1_epi32((int)color), zero);
+    const __m128i alpha32 = _mm_set1_epi32((int)0xff000000);
+    const __m128i amask = _mm_unpacklo_epi8(alpha32, alpha32);
+    int x = 0;
+    for (; x <= w - 8; x += 8) {
+        const __m128i s = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)(src + x)), zero);
+        const __m128i k = div255_epu16(_mm_mullo_epi16(s, a));
+        const __m128i k03 = _mm_unpacklo_epi16(k, k);
+        const __m128i k47 = _mm_unpackhi_epi16(k, k);
+        for (int i = 0; i < 2; ++i) {
+            __m128i *p = (__m128i*)(dst + x + 4*i);
+            const __m128i kk = i == 0 ? k03 : k47;
+            const __m128i d = _mm_loadu_si128(p);
+            const __m128i z = _mm_cmpeq_epi32(_mm_and_si128(d, alpha32), zero);
+            const __m128i lo = blend2(_mm_unpacklo_epi8(d, zero), _mm_unpacklo_epi32(kk, kk), c, amask, _mm_unpacklo_epi8(z, z));
+            const __m128i hi = blend2(_mm_unpackhi_epi8(d, zero), _mm_unpackhi_epi32(kk, kk), c, amask, _mm_unpackhi_epi8(z, z));
+            _mm_storeu_si128(p, _mm_packus_epi16(lo, hi));
+        }
+    }
+    blend_ass_row_c(dst + x, src + x, w - x, color);
+}
+
+} //namespace QtAV
+#endif
@@ -21,13 +21,11 @@
 
 #include "QtAV/Subtitle.h"
 #include "QtAV/private/SubtitleProcessor.h"
-#include <algorithm>
 #include <QtCore/QBuffer>
 #include <QtCore/QDir>
 #include <QtCore/QFile>
 #include <QtCore/QFileInfo>
 #include <QtCore/QIODevice>
-#include <QtCore/QLinkedList>
 #include <QtCore/QRegExp>
 #include <QtCore/QRunnable>
 #include <QtCore/QThreadPool>
@@ -35,6 +33,7 @@
 #include <QtCore/QTextStream>
 #include <QtCore/QMutexLocker>
 #include "subtitle/CharsetDetector.h"
+#include "subtitle/SubtitleIndex.h"
 #include "utils/Logger.h"
 
 namespace QtAV {
@@ -53,7 +52,6 @@ public:
         , codec("AutoDetect")
         , t(0)
         , delay(0)
-        , current_count(0)
         , force_font_file(false)
     {}
     void reset() {
@@ -64,10 +62,8 @@ public:
         update_text = true;
         update_image = true;
         t = 0;
-        frame = SubtitleFrame();
         frames.clear();
-        itf = frames.begin();
-        current_count = 0;
+        current.clear();
     }
     // width/height == 0: do not create image
     // return true if both frame time and content(currently is text) changed
@@ -98,7 +94,7 @@ public:
     QList<SubtitleProcessor*> processors;
     QByteArray codec;
     QStringList engine_names;
-    QLinkedList<SubtitleFrame> frames;
+    SubtitleIndex frames;
     QUrl url;
     QByteArray raw_data;
     QString file_name;
@@ -109,16 +105,12 @@ public:
     // last time image
     qreal t;
     qreal delay;
-    SubtitleFrame frame;
     QString current_text;
     QImage current_image;
     QPoint current_pos;
     SubImageSet current_ass;
-    QLinkedList<SubtitleFrame>::iterator itf;
-    /* number of subtitle frames at current time.
-     * <0 means itf is the last. >0 means itf is the 1st
-     */
-    int current_count;
+    // indexes of subtitle frames at current time
+    QVector<int> current;
     QMutex mutex;
 
     bool force_font_file;
@@ -512,17 +504,14 @@ QString Subtitle::getText() const
     Q_UNUSED(lock);
     if (!isLoaded())
         return QString();
-    if (!priv->current_count)
+    if (priv->current.isEmpty())
         return QString();
     if (!priv->update_text)
         return priv->current_text;
     priv->update_text = false;
     priv->current_text.clear();
-    const int count = qAbs(priv->current_count);
-    QLinkedList<SubtitleFrame>::iterator it = priv->current_count > 0 ? priv->itf : priv->itf + (priv->current_count+1);
-    for (int i = 0; i < count; ++i) {
-        priv->current_text.append(it->text).append(QStringLiteral("\n"));
-        ++it;
+    foreach (int i, priv->current) {
+        priv->current_text.append(priv->frames.at(i).text).append(QStringLiteral("\n"));
     }
     priv->current_text = priv->current_text.trimmed();
     return priv->current_text;
@@ -534,12 +523,12 @@ QImage Subtitle::getImage(int width, int height, QRect* boundingRect)
     Q_UNUSED(lock);
     if (!isLoaded())
         return QImage();
-    if (!priv->current_count)
+    if (priv->current.isEmpty())
         return QImage();
     if (width == 0 || height == 0)
         return QImage();
 #if 0
-    if (!priv->current_count) //seems ok to use this code
+    if (priv->current.isEmpty()) //seems ok to use this code
         return QImage();
     // always render the image to support animations
     if (!priv->update_image
@@ -551,15 +540,13 @@ QImage Subtitle::getImage(int width, int height, QRect* boundingRect)
         return QImage();
 
     priv->current_image = QImage();
-    const int count = qAbs(priv->current_count);
-    QLinkedList<SubtitleFrame>::iterator it = priv->current_count > 0 ? priv->itf : priv->itf + (priv->current_count + 1);
-    for (int i = 0; i < count; ++i) {
-        if (!it->img.isNull()) {
-            priv->current_image = it->img;
-            priv->current_pos = it->pos;
+    foreach (int i, priv->current) {
+        const SubtitleFrame &f = priv->frames.at(i);
+        if (!f.img.isNull()) {
+            priv->current_image = f.img;
+            priv->current_pos = f.pos;
             break;
         }
-        ++it;
     }
     *boundingRect = QRect(priv->current_pos, priv->current_image.size());
 
@@ -625,92 +612,25 @@ bool Subtitle::processLine(const QByteArray &data, qreal pts, qreal duration)
     SubtitleFrame f = priv->processor->processLine(data, pts, duration);
     if (!f.isValid())
         return false; // TODO: if seek to previous position, an invalid frame is returned.
-    if (priv->frames.isEmpty() || priv->frames.last() < f) {
-        priv->frames.append(f);
-        priv->itf = priv->frames.begin();
-        return true;
+    QMutexLocker lock(&priv->mutex);
+    Q_UNUSED(lock);
+    // usually add to the end
+    const int i = priv->frames.insert(f);
+    for (int k = 0; k < priv->current.size(); ++k) {
+        if (priv->current[k] >= i)
+            priv->current[k]++;
     }
-    // usually add to the end. TODO: test
-    QLinkedList<SubtitleFrame>::iterator it = priv->frames.end();
-    if (it != priv->frames.begin())
-        --it;
-    while (it != priv->frames.begin() && f < (*it)) {--it;}
-    if (it != priv->frames.begin()) // found in middle, insert before next
-        ++it;
-    priv->frames.insert(it, f);
-    priv->itf = it;
     return true;
 }
 
-// DO NOT set frame's image to reduce memory usage
-// assume frame.text is already set
-// check previous text if now no subtitle
+// return true if subtitle frames at current time changed
 bool Subtitle::Private::prepareCurrentFrame()
 {
     if (frames.isEmpty())
         return false;
-    QLinkedList<SubtitleFrame>::iterator it = itf;
-    int found = 0;
-    const int old_current_count = current_count;
-    const qreal t = this->t - delay;
-    if (t < it->begin) {
-        while (it != frames.begin()) {
-            --it;
-            if (t > it->end) {
-                if (found > 0)
-                    break;
-                // no subtitle at that time. check previous text
-                if (old_current_count) {
-                    current_count = 0;
-                    return true;
-                }
-                return false;
-            }
-            if (t >= (*it).begin) {
-                if (found == 0)
-                    itf = it;
-                found++;
-            }
-        }
-        current_count = -found;
-        if (found > 0) {
-            frame = *it;
-            return true;
-        }
-        // no subtitle at that time. it == begin(). check previous text
-        if (old_current_count)
-            return true;
-        return false;
-    }
-    bool it_changed = false;
-    while (it != frames.end()) {
-        if (t > it->end) {
-            ++it;
-            it_changed = true;
-            continue;
-        }
-        if (t < it->begin) {
-            if (found > 0)
-                break;
-            // no subtitle at that time. check previous text
-            if (old_current_count) {
-                current_count = 0;
-                return true;
-            }
-            return false;
-        }
-        if (found == 0)
-            itf = it;
-        ++found;
-        ++it;
-    }
-    current_count = found;
-    if (found > 0)
-        return it_changed || current_count != old_current_count;
-    // no subtitle at that time, it == end(). check previous text
-    if (old_current_count)
-        return true;
-    return false;
+    const QVector<int> old(current);
+    frames.find(t - delay, &current);
+    return current != old;
 }
 
 QStringList Subtitle::Private::find()
@@ -820,6 +740,7 @@ bool Subtitle::Private::processRawData(const QByteArray &data)
 {
     processor = 0;
     frames.clear();
+    current.clear();
     if (data.size() > kMaxSubtitleSize)
         return false;
     foreach (SubtitleProcessor* sp, processors) {
@@ -833,12 +754,7 @@ bool Subtitle::Private::processRawData(const QByteArray &data)
     QList<SubtitleFrame> fs(processor->frames());
     if (fs.isEmpty())
         return false;
-    std::sort(fs.begin(), fs.end());
-    foreach (const SubtitleFrame& f, fs) {
-       frames.push_back(f);
-    }
-    itf = frames.begin();
-    frame = *itf;
+    frames.setFrames(fs);
     return true;
 }
 
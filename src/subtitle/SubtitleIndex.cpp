@@ -0,0 +1,122 @@
+/******************************************************************************
+    QtAV:  Multimedia framework based on Qt and FFmpeg
+    Copyright (C) 2012-2017 Wang Bin <wbsecg1@gmail.com>
+
+*   This file is part of QtAV (from 2017)
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+******************************************************************************/
+
+#include "SubtitleIndex.h"
+#include <algorithm>
+#include <limits>
+
+namespace QtAV {
+
+static const qreal kNoEnd = -std::numeric_limits<qreal>::max();
+
+static bool beginLessThan(const SubtitleFrame& f1, const SubtitleFrame& f2)
+{
+    return f1.begin < f2.begin;
+}
+
+static bool timeBeforeBegin(qreal t, const SubtitleFrame& f)
+{
+    return t < f.begin;
+}
+
+SubtitleIndex::SubtitleIndex()
+    : m_leaves(0)
+{}
+
+void SubtitleIndex::clear()
+{
+    m_frames.clear();
+    m_max_end.clear();
+    m_leaves = 0;
+}
+
+void SubtitleIndex::setFrames(const QList<SubtitleFrame> &frames)
+{
+    m_frames = frames.toVector();
+    std::stable_sort(m_frames.begin(), m_frames.end(), beginLessThan);
+    rebuild();
+}
+
+int SubtitleIndex::insert(const SubtitleFrame &f)
+{
+    const int i = std::upper_bound(m_frames.constBegin(), m_frames.constEnd(), f.begin, timeBeforeBegin) - m_frames.constBegin();
+    m_frames.insert(i, f);
+    // leaves after i are shifted, and the tree grows if full
+    if (i != m_frames.size() - 1 || m_frames.size() > m_leaves) {
+        rebuild();
+        return i;
+    }
+    int node = m_leaves + i;
+    m_max_end[node] = f.end;
+    for (node /= 2; node > 0 && m_max_end[node] < f.end; node /= 2)
+        m_max_end[node] = f.end;
+    return i;
+}
+
+void SubtitleIndex::rebuild()
+{
+    int leaves = qMax(m_leaves, 1);
+    while (leaves < m_frames.size())
+        leaves *= 2;
+    m_leaves = leaves;
+    m_max_end.fill(kNoEnd, 2*m_leaves);
+    for (int i = 0; i < m_frames.size(); ++i)
+        m_max_end[m_leaves + i] = m_frames.at(i).end;
+    for (int k = m_leaves - 1; k > 0; --k)
+        m_max_end[k] = qMax(m_max_end.at(2*k), m_max_end.at(2*k + 1));
+}
+
+// cues in [lo, lo+len) of subtree node, and index < hi
+void SubtitleIndex::collect(int node, int lo, int len, int hi, qreal t, QVector<int> *indexes) const
+{
+    if (lo >= hi || m_max_end.at(node) < t)
+        return;
+    if (len == 1) {
+        indexes->append(lo);
+        return;
+    }
+    len /= 2;
+    collect(2*node, lo, len, hi, t, indexes);
+    collect(2*node + 1, lo + len, len, hi, t, indexes);
+}
+
+int SubtitleIndex::find(qreal t, QVector<int> *indexes) const
+{
+    indexes->resize(0);
+    // cues in [0, hi) begin before t
+    const int hi = std::upper_bound(m_frames.constBegin(), m_frames.constEnd(), t, timeBeforeBegin) - m_frames.constBegin();
+    if (hi > 0)
+        collect(1, 0, m_leaves, hi, t, indexes);
+    return indexes->size();
+}
+
+QString SubtitleIndex::text(qreal t) const
+{
+    QVector<int> indexes;
+    if (!find(t, &indexes))
+        return QString();
+    QString text;
+    foreach (int i, indexes) {
+        text.append(m_frames.at(i).text).append(QLatin1Char('\n'));
+    }
+    return text.trimmed();
+}
+} //namespace QtAV
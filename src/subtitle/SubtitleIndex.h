@@ -0,0 +1,77 @@
+/******************************************************************************
+    QtAV:  Multimedia framework based on Qt and FFmpeg
+    Copyright (C) 2012-2017 Wang Bin <wbsecg1@gmail.com>
+
+*   This file is part of QtAV (from 2017)
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+******************************************************************************/
+
+#ifndef QTAV_SUBTITLEINDEX_H
+#define QTAV_SUBTITLEINDEX_H
+
+#include <QtCore/QVector>
+#include <QtAV/Subtitle.h>
+
+namespace QtAV {
+/*!
+ * \brief The SubtitleIndex class
+ * Subtitle cues sorted by begin time in a contiguous array, with an implicit binary tree of max end time.
+ * Cues can overlap. Finding the cues at a time is O(log n + k*log n) for k cues found.
+ * Appending a cue is O(log n) amortized, inserting a cue in the middle is O(n).
+ */
+class Q_AV_PRIVATE_EXPORT SubtitleIndex
+{
+public:
+    SubtitleIndex();
+    void clear();
+    bool isEmpty() const { return m_frames.isEmpty();}
+    int size() const { return m_frames.size();}
+    const SubtitleFrame& at(int i) const { return m_frames.at(i);}
+    const QVector<SubtitleFrame>& frames() const { return m_frames;}
+    /*!
+     * \brief setFrames
+     * Replace all cues. Frames in any order. O(n*log n)
+     */
+    void setFrames(const QList<SubtitleFrame>& frames);
+    /*!
+     * \brief insert
+     * Insert a cue after cues with the same begin time.
+     * \return index of the inserted cue. Indexes >= it of existing cues are increased by 1
+     */
+    int insert(const SubtitleFrame& f);
+    /*!
+     * \brief find
+     * Find cues with begin <= t <= end.
+     * \param indexes cleared and filled with indexes of the cues in ascending order
+     * \return number of cues found
+     */
+    int find(qreal t, QVector<int> *indexes) const;
+    /*!
+     * \brief text
+     * Text of cues at t, one cue per line.
+     */
+    QString text(qreal t) const;
+private:
+    void rebuild();
+    void collect(int node, int lo, int len, int hi, qreal t, QVector<int> *indexes) const;
+
+    QVector<SubtitleFrame> m_frames;
+    // m_max_end[1] is the root, children of node k are 2k and 2k+1, leaf of cue i is m_leaves + i
+    QVector<qreal> m_max_end;
+    int m_leaves;
+};
+} //namespace QtAV
+#endif //QTAV_SUBTITLEINDEX_H
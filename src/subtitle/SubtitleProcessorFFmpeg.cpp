@@ -26,6 +26,7 @@
 #include "QtAV/private/AVCompat.h"
 #include "utils/internal.h"
 #include "PlainText.h"
+#include "SubtitleIndex.h"
 #include "utils/Logger.h"
 #include "VideoFrame.h"
 
@@ -54,7 +55,7 @@ private:
     bool processSubtitle();
     AVCodecContext *codec_ctx;
     AVDemuxer m_reader;
-    QList<SubtitleFrame> m_frames;
+    SubtitleIndex m_frames;
     AVSubtitleType m_subType;
 };
 
@@ -234,21 +235,12 @@ error:
 
 QList<SubtitleFrame> SubtitleProcessorFFmpeg::frames() const
 {
-    return m_frames;
+    return m_frames.frames().toList();
 }
 
 QString SubtitleProcessorFFmpeg::getText(qreal pts) const
 {
-    QString text;
-    for (int i = 0; i < m_frames.size(); ++i) {
-        if (m_frames[i].begin <= pts && m_frames[i].end >= pts) {
-            text += m_frames[i].text + QStringLiteral("\n");
-            continue;
-        }
-        if (!text.isEmpty())
-            break;
-    }
-    return text.trimmed();
+    return m_frames.text(pts);
 }
 
 bool SubtitleProcessorFFmpeg::processHeader(const QByteArray &codec, const QByteArray &data)
@@ -477,7 +469,7 @@ bool SubtitleProcessorFFmpeg::processSubtitle()
             continue;
         SubtitleFrame frame = processLine(pkt.data, pkt.pts, pkt.duration);
         if (frame.isValid())
-            m_frames.append(frame);
+            m_frames.insert(frame);
     }
     avcodec_close(codec_ctx);
     codec_ctx = 0;
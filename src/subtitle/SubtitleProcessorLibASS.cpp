@@ -29,6 +29,7 @@
 #include "QtAV/Packet.h"
 #include "QtAV/private/factory.h"
 #include "PlainText.h"
+#include "SubtitleIndex.h"
 #include "utils/internal.h"
 #include "utils/Logger.h"
 
@@ -78,10 +79,12 @@ private:
     ASS_Library *m_ass;
     ASS_Renderer *m_renderer;
     ASS_Track *m_track;
-    QList<SubtitleFrame> m_frames;
+    SubtitleIndex m_frames;
     //cache the image for the last invocation. return this if image does not change
     QImage m_image;
     SubImageSet m_assimages;
+    // m_image, m_assimages are the result of the last ass_render_frame()
+    bool m_image_valid, m_assimages_valid;
     QRect m_bound;
     mutable QMutex m_mutex;
 };
@@ -130,6 +133,8 @@ SubtitleProcessorLibASS::SubtitleProcessorLibASS()
     , m_ass(0)
     , m_renderer(0)
     , m_track(0)
+    , m_image_valid(false)
+    , m_assimages_valid(false)
 {
     if (!ass::api::loaded())
         return;
@@ -179,7 +184,7 @@ QStringList SubtitleProcessorLibASS::supportedTypes() const
 
 QList<SubtitleFrame> SubtitleProcessorLibASS::frames() const
 {
-    return m_frames;
+    return m_frames.frames().toList();
 }
 
 bool SubtitleProcessorLibASS::process(QIODevice *dev)
@@ -290,16 +295,7 @@ QString SubtitleProcessorLibASS::getText(qreal pts) const
 {
     QMutexLocker lock(&m_mutex);
     Q_UNUSED(lock);
-    QString text;
-    for (int i = 0; i < m_frames.size(); ++i) {
-        if (m_frames[i].begin <= pts && m_frames[i].end >= pts) {
-            text += m_frames[i].text + QStringLiteral("\n");
-            continue;
-        }
-        if (!text.isEmpty())
-            break;
-    }
-    return text.trimmed();
+    return m_frames.text(pts);
 }
 
 void renderASS32(QImage *image, ASS_Image *img, int dstX, int dstY);
@@ -346,13 +342,20 @@ SubImageSet SubtitleProcessorLibASS::getSubImages(qreal pts, QRect *boundingRect
         return SubImageSet();
     int detect_change = 0;
     ASS_Image *img = ass_render_frame(m_renderer, m_track, (long long)(pts * 1000.0), &detect_change);
-    if (!detect_change && !m_assimages.isValid()) {
+    if (detect_change)
+        m_image_valid = m_assimages_valid = false;
+    // unchanged: nothing to copy or compose
+    if (qimg ? m_image_valid : m_assimages_valid) {
         if (boundingRect)
             *boundingRect = m_bound;
+        if (qimg)
+            *qimg = m_image;
         return m_assimages;
     }
     m_image = QImage();
+    m_image_valid = false;
     m_assimages.reset(frameWidth(), frameHeight(), SubImageSet::ASS);
+    m_assimages_valid = copy; // otherwise it references data of libass and can not be used after next ass_render_frame()
     QRect rect(0, 0, 0, 0);
     ASS_Image *i = img;
     while (i) {
@@ -386,6 +389,7 @@ SubImageSet SubtitleProcessorLibASS::getSubImages(qreal pts, QRect *boundingRect
     foreach (const SubImage& i, m_assimages.images) {
         RenderASS(qimg, i, i.x - rect.x(), i.y - rect.y());
     }
+    m_image_valid = qimg == &m_image;
     return m_assimages;
 }
 
@@ -655,14 +659,16 @@ void SubtitleProcessorLibASS::updateFontCacheAsync()
 void SubtitleProcessorLibASS::processTrack(ASS_Track *track)
 {
     // language, track type
-    m_frames.clear();
+    QList<SubtitleFrame> frames;
+    frames.reserve(track->n_events);
     for (int i = 0; i < track->n_events; ++i) {
         SubtitleFrame frame;
         const ASS_Event& ae = track->events[i];
         frame.text = PlainText::fromAss(ae.Text);
         frame.begin = qreal(ae.Start)/1000.0;
         frame.end = frame.begin + qreal(ae.Duration)/1000.0;
-        m_frames.append(frame);
+        frames.append(frame);
     }
+    m_frames.setFrames(frames);
 }
 } //namespace QtAV
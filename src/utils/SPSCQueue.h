@@ -0,0 +1,460 @@
+/******************************************************************************
+    QtAV:  Multimedia framework based on Qt and FFmpeg
+    Copyright (C) 2012-2017 Wang Bin <wbsecg1@gmail.com>
+
+*   This file is part of QtAV (from 2017)
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+******************************************************************************/
+
+#ifndef QTAV_SPSCQUEUE_H
+#define QTAV_SPSCQUEUE_H
+
+#include <limits.h>
+#include <QtCore/QAtomicInt>
+#include <QtCore/QAtomicPointer>
+#include <QtCore/QMutex>
+#include <QtCore/QScopedPointer>
+#include <QtCore/QWaitCondition>
+
+namespace QtAV {
+namespace spsc {
+// Qt4 has no loadAcquire()/storeRelease()
+inline int loadAcquire(QAtomicInt &v) {
+#if QT_VERSION >= QT_VERSION_CHECK(5, 0, 0)
+    return v.loadAcquire();
+#else
+    return v.fetchAndAddAcquire(0);
+#endif
+}
+inline int loadAcquire(const QAtomicInt &v) { return loadAcquire(const_cast<QAtomicInt&>(v));}
+inline void storeRelease(QAtomicInt &v, int value) {
+#if QT_VERSION >= QT_VERSION_CHECK(5, 0, 0)
+    v.storeRelease(value);
+#else
+    v.fetchAndStoreRelease(value);
+#endif
+}
+template<typename T>
+inline T* loadAcquire(QAtomicPointer<T> &p) {
+#if QT_VERSION >= QT_VERSION_CHECK(5, 0, 0)
+    return p.loadAcquire();
+#else
+    return p.fetchAndAddAcquire(0);
+#endif
+}
+template<typename T>
+inline void storeRelease(QAtomicPointer<T> &p, T* value) {
+#if QT_VERSION >= QT_VERSION_CHECK(5, 0, 0)
+    p.storeRelease(value);
+#else
+    p.fetchAndStoreRelease(value);
+#endif
+}
+} //namespace spsc
+
+/*!
+ * \brief The SPSCQueue class
+ * Wait-free single producer single consumer ring buffer. push() must be called in 1 thread and pop() in another (or the same) thread.
+ * When the ring is full, a ring of double size is chained after it instead of blocking, the consumer switches to it
+ * once the old ring is drained. So there is no allocation in steady state. The total number of items is limited by maxSize,
+ * push() fails if it is reached.
+ * Indices are int and increase monotonically. Overflow is fine because only differences are used.
+ */
+template <typename T>
+class SPSCQueue
+{
+public:
+    explicit SPSCQueue(int capacity = 256, int maxSize = INT_MAX);
+    ~SPSCQueue();
+    /// producer thread only. return false and t is not placed if maxSize() items are in queue
+    bool push(const T& t);
+    /// consumer thread only. return false if empty
+    bool pop(T* t);
+    /// number of items pushed but not popped. safe in any thread
+    int size() const { return spsc::loadAcquire(m_pushed) - spsc::loadAcquire(m_popped);}
+    bool isEmpty() const { return size() <= 0;}
+    /// total number of items pushed/popped so far. can be used as the index of the next item pushed/popped
+    int pushed() const { return spsc::loadAcquire(m_pushed);}
+    int popped() const { return spsc::loadAcquire(m_popped);}
+    /// producer thread only
+    void setMaxSize(int value) { m_max = qMax(1, value);}
+    int maxSize() const { return m_max;}
+private:
+    struct Ring {
+        Ring(int capacity) : data(new T[capacity]), mask(capacity - 1), head(0), tail(0), next(0) {}
+        ~Ring() { delete [] data;}
+        T *data;
+        int mask;
+        QAtomicInt head; // written by consumer
+        QAtomicInt tail; // written by producer
+        QAtomicPointer<Ring> next; // written by producer once
+    };
+    Ring* readRing();
+
+    Ring *m_write; // producer
+    Ring *m_read; // consumer
+    int m_max; // producer
+    QAtomicInt m_pushed, m_popped;
+    Q_DISABLE_COPY(SPSCQueue)
+};
+
+/*!
+ * \brief The BlockingSPSCQueue class
+ * The same api and blocking behavior as BlockingQueue, but put() and take() are lock free unless take() waits for data (empty edge)
+ * or put() waits for space (full edge). The 2 edges use their own wait conditions.
+ * put() must be called in the producer thread and take() in the consumer thread, others are thread safe.
+ * checkFull() and checkEnough() are called in put() and checkEmpty() in take(), so they can use data owned by that thread.
+ * clear() can be called in any thread. It pops the items itself and is the only thing that contends with take().
+ */
+template <typename T>
+class BlockingSPSCQueue
+{
+public:
+    BlockingSPSCQueue();
+    virtual ~BlockingSPSCQueue() {}
+
+    void setCapacity(int max); //enqueue is allowed if less than capacity
+    void setThreshold(int min); //wake up and enqueue
+    /*!
+     * \brief setMaxSize
+     * Hard limit of the number of items. Must be called in producer thread. Unlike capacity() or a full state, put() never exceeds it.
+     */
+    void setMaxSize(int value) { m_queue.setMaxSize(value);}
+    int maxSize() const { return m_queue.maxSize();}
+    /*!
+     * \sa BlockingQueue::put
+     * Note that even a 'full' queue will accept new items and t WILL be placed in the queue regardless of return value,
+     * unless maxSize() items are in queue. Then put() waits for space if blocking on full, or returns false and t is not placed.
+     */
+    bool put(const T& t, unsigned long wait_timeout_ms = ULONG_MAX);
+    /// \sa BlockingQueue::take
+    T take(unsigned long wait_timeout_ms = ULONG_MAX, bool *isValid = 0);
+    void setBlocking(bool block); //will wake if false. called when no more data can enqueue
+    void blockEmpty(bool block);
+    void blockFull(bool block);
+    void clear();
+    bool isEmpty() const { return m_queue.isEmpty();}
+    bool isEnough() const { return size() >= threshold();} //size > thres
+    bool isFull() const { return size() >= capacity();} //size >= cap
+    int size() const { return m_queue.size();}
+    int threshold() const { return spsc::loadAcquire(thres);}
+    int capacity() const { return spsc::loadAcquire(cap);}
+
+    class StateChangeCallback
+    {
+    public:
+        virtual ~StateChangeCallback(){}
+        virtual void call() = 0;
+    };
+    void setEmptyCallback(StateChangeCallback* call);
+    void setThresholdCallback(StateChangeCallback* call);
+    void setFullCallback(StateChangeCallback* call);
+
+protected:
+    /// called in producer thread
+    virtual bool checkFull() const;
+    /// called in consumer thread
+    virtual bool checkEmpty() const;
+    /// called in producer thread
+    virtual bool checkEnough() const;
+
+    /// called in producer thread after t is pushed
+    virtual void onPut(const T&) {}
+    /// called in consumer thread after t is popped, or in clear() with T() after all items are popped
+    virtual void onTake(const T&) {}
+
+    QAtomicInt block_empty, block_full;
+    QAtomicInt cap, thres;
+    SPSCQueue<T> m_queue;
+private:
+    QMutex take_lock; // take() vs clear()
+    QMutex empty_lock, full_lock;
+    QWaitCondition cond_full, cond_empty;
+    QAtomicInt wait_empty, wait_full; // a thread is waiting on the edge
+    QScopedPointer<StateChangeCallback> empty_callback, threshold_callback, full_callback;
+};
+
+template <typename T>
+SPSCQueue<T>::SPSCQueue(int capacity, int maxSize)
+    : m_max(qMax(1, maxSize))
+    , m_pushed(0)
+    , m_popped(0)
+{
+    int c = 2;
+    while (c < capacity)
+        c <<= 1;
+    m_write = m_read = new Ring(c);
+}
+
+template <typename T>
+SPSCQueue<T>::~SPSCQueue()
+{
+    while (m_read) {
+        Ring *r = m_read;
+        m_read = spsc::loadAcquire(r->next);
+        delete r;
+    }
+}
+
+template <typename T>
+bool SPSCQueue<T>::push(const T &t)
+{
+    if (size() >= m_max)
+        return false;
+    Ring *r = m_write;
+    const int tail = spsc::loadAcquire(r->tail); // only written by this thread
+    if (tail - spsc::loadAcquire(r->head) > r->mask) {
+        Ring *n = new Ring((r->mask + 1) << 1);
+        n->data[0] = t;
+        spsc::storeRelease(n->tail, 1);
+        m_write = n;
+        spsc::storeRelease(r->next, n); // r will never be written again
+    } else {
+        r->data[tail & r->mask] = t;
+        spsc::storeRelease(r->tail, tail + 1);
+    }
+    m_pushed.fetchAndAddOrdered(1);
+    return true;
+}
+
+template <typename T>
+typename SPSCQueue<T>::Ring* SPSCQueue<T>::readRing()
+{
+    Ring *r = m_read;
+    while (spsc::loadAcquire(r->head) == spsc::loadAcquire(r->tail)) {
+        Ring *n = spsc::loadAcquire(r->next);
+        if (!n)
+            return 0;
+        // r->tail is final if next is set. check again in case producer pushed the last items before switching
+        if (spsc::loadAcquire(r->head) != spsc::loadAcquire(r->tail))
+            break;
+        m_read = n;
+        delete r;
+        r = n;
+    }
+    return r;
+}
+
+template <typename T>
+bool SPSCQueue<T>::pop(T *t)
+{
+    Ring *r = readRing();
+    if (!r)
+        return false;
+    const int head = spsc::loadAcquire(r->head);
+    T &v = r->data[head & r->mask];
+    if (t)
+        *t = v;
+    v = T(); // release the resources now
+    spsc::storeRelease(r->head, head + 1);
+    m_popped.fetchAndAddOrdered(1);
+    return true;
+}
+
+/* cap - thres = 24, about 1s
+ * if fps is large, then larger capacity and threshold is preferred
+ */
+template <typename T>
+BlockingSPSCQueue<T>::BlockingSPSCQueue()
+    : block_empty(1), block_full(1), cap(48), thres(32)
+    , wait_empty(0)
+    , wait_full(0)
+    , empty_callback(0)
+    , threshold_callback(0)
+    , full_callback(0)
+{
+}
+
+template <typename T>
+void BlockingSPSCQueue<T>::setCapacity(int max)
+{
+    spsc::storeRelease(cap, max);
+    if (threshold() > max)
+        spsc::storeRelease(thres, max);
+}
+
+template <typename T>
+void BlockingSPSCQueue<T>::setThreshold(int min)
+{
+    if (min > capacity())
+        return;
+    spsc::storeRelease(thres, min);
+}
+
+template <typename T>
+bool BlockingSPSCQueue<T>::put(const T& t, unsigned long timeout_ms)
+{
+    bool ret = true;
+    if (checkFull()) {
+        ret = false;
+        if (full_callback) {
+            full_callback->call();
+        }
+        if (spsc::loadAcquire(block_full)) {
+            QMutexLocker locker(&full_lock);
+            Q_UNUSED(locker);
+            wait_full.fetchAndStoreOrdered(1);
+            // take() or blockFull(false) may happen before wait_full is set
+            if (checkFull() && spsc::loadAcquire(block_full))
+                ret = cond_full.wait(&full_lock, timeout_ms);
+            spsc::storeRelease(wait_full, 0);
+        }
+        // uncomment here to reject placing items into a full queue -- update API docs if you do this.
+        // if (!ret) return false;
+    }
+    while (!m_queue.push(t)) { // maxSize() reached
+        if (!spsc::loadAcquire(block_full))
+            return false;
+        QMutexLocker locker(&full_lock);
+        Q_UNUSED(locker);
+        wait_full.fetchAndStoreOrdered(1);
+        bool waked = true;
+        if (size() >= maxSize() && spsc::loadAcquire(block_full))
+            waked = cond_full.wait(&full_lock, timeout_ms);
+        spsc::storeRelease(wait_full, 0);
+        if (!waked)
+            return false;
+    }
+    onPut(t); // emit bufferProgressChanged here if buffering
+    // the ordered push above and the ordered store in take() ensure either we see wait_empty or take() sees the new item
+    if (spsc::loadAcquire(wait_empty) && checkEnough()) {
+        QMutexLocker locker(&empty_lock);
+        Q_UNUSED(locker);
+        cond_empty.wakeOne(); //emit buffering finished here
+    }
+    return ret;
+}
+
+template <typename T>
+T BlockingSPSCQueue<T>::take(unsigned long timeout_ms, bool *isValid)
+{
+    if (isValid) *isValid = false;
+    if (checkEmpty()) {
+        if (empty_callback) {
+            empty_callback->call();
+        }
+        if (spsc::loadAcquire(block_empty)) {
+            QMutexLocker locker(&empty_lock);
+            Q_UNUSED(locker);
+            wait_empty.fetchAndStoreOrdered(1);
+            if (checkEmpty() && spsc::loadAcquire(block_empty))
+                cond_empty.wait(&empty_lock, timeout_ms); //block when empty only
+            spsc::storeRelease(wait_empty, 0);
+        }
+    }
+    T t;
+    bool ok = false;
+    if (!checkEmpty()) {
+        QMutexLocker locker(&take_lock); // uncontended unless clear() is running
+        Q_UNUSED(locker);
+        ok = m_queue.pop(&t);
+    }
+    if (!ok) {
+        if (empty_callback) {
+            empty_callback->call();
+        }
+        return T();
+    }
+    if (isValid) *isValid = true;
+    if (spsc::loadAcquire(wait_full)) {
+        QMutexLocker locker(&full_lock);
+        Q_UNUSED(locker);
+        cond_full.wakeOne();
+    }
+    onTake(t); // emit start buffering here if empty
+    return t;
+}
+
+template <typename T>
+void BlockingSPSCQueue<T>::setBlocking(bool block)
+{
+    blockEmpty(block);
+    blockFull(block);
+}
+
+template <typename T>
+void BlockingSPSCQueue<T>::blockEmpty(bool block)
+{
+    spsc::storeRelease(block_empty, block);
+    if (!block) {
+        QMutexLocker locker(&empty_lock);
+        Q_UNUSED(locker);
+        cond_empty.wakeAll();
+    }
+}
+
+template <typename T>
+void BlockingSPSCQueue<T>::blockFull(bool block)
+{
+    spsc::storeRelease(block_full, block);
+    if (!block) {
+        QMutexLocker locker(&full_lock);
+        Q_UNUSED(locker);
+        cond_full.wakeAll();
+    }
+}
+
+template <typename T>
+void BlockingSPSCQueue<T>::clear()
+{
+    {
+        QMutexLocker locker(&take_lock);
+        Q_UNUSED(locker);
+        while (m_queue.pop(0)) {}
+        onTake(T());
+    }
+    QMutexLocker locker(&full_lock);
+    Q_UNUSED(locker);
+    cond_full.wakeAll();
+}
+
+template <typename T>
+void BlockingSPSCQueue<T>::setEmptyCallback(StateChangeCallback *call)
+{
+    empty_callback.reset(call);
+}
+
+template <typename T>
+void BlockingSPSCQueue<T>::setThresholdCallback(StateChangeCallback *call)
+{
+    threshold_callback.reset(call);
+}
+
+template <typename T>
+void BlockingSPSCQueue<T>::setFullCallback(StateChangeCallback *call)
+{
+    full_callback.reset(call);
+}
+
+template <typename T>
+bool BlockingSPSCQueue<T>::checkFull() const
+{
+    return size() >= capacity();
+}
+
+template <typename T>
+bool BlockingSPSCQueue<T>::checkEmpty() const
+{
+    return m_queue.isEmpty();
+}
+
+template <typename T>
+bool BlockingSPSCQueue<T>::checkEnough() const
+{
+    return size() >= threshold() && !checkEmpty();
+}
+} //namespace QtAV
+#endif // QTAV_SPSCQUEUE_H
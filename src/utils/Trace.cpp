@@ -0,0 +1,274 @@
+/******************************************************************************
+    QtAV:  Multimedia framework based on Qt and FFmpeg
+    Copyright (C) 2012-2017 Wang Bin <wbsecg1@gmail.com>
+
+*   This file is part of QtAV (from 2017)
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+******************************************************************************/
+
+
+#include "utils/Trace.h"
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QFile>
+#include <QtCore/QMutex>
+#include <QtCore/QThread>
+#include <QtCore/QThreadStorage>
+#include <QtCore/QVector>
+#include "utils/SPSCQueue.h"
+#include "utils/Logger.h"
+
+namespace QtAV {
+namespace Internal {
+
+QAtomicInt gTraceEnabled(0);
+
+namespace {
+enum {
+    kBufferSize = 1 << 15, // events per thread
+    kMaxFinishedBuffers = 16 // buffers of finished threads not dumped or cleared
+};
+
+struct TraceEventData
+{
+    const char* name;
+    const char* cat;
+    qint64 ts;
+    qint64 dur;
+};
+
+/*
+ * Written only by the owner thread. written is the total number of events, so the reader can
+ * detect the events overwritten while they are being copied, and ignore them.
+ */
+class TraceBuffer
+{
+public:
+    TraceBuffer(int id, const QByteArray& threadName)
+        : tid(id)
+        , name(threadName)
+        , events(kBufferSize)
+        , written(0)
+        , cleared(0)
+        , finished(0)
+    {}
+    void add(const TraceEventData& e) {
+        const int n = spsc::loadAcquire(written);
+        events[n & (kBufferSize - 1)] = e;
+        spsc::storeRelease(written, n + 1);
+    }
+    // events not cleared, in order
+    QVector<TraceEventData> snapshot() const {
+        const int end = spsc::loadAcquire(written);
+        int begin = qMax(spsc::loadAcquire(cleared), end - (int)kBufferSize);
+        QVector<TraceEventData> s;
+        s.reserve(end - begin);
+        for (int i = begin; i < end; ++i)
+            s.append(events[i & (kBufferSize - 1)]);
+        // overwritten by writer while copying. the slot of the next event may be being written
+        const int skip = spsc::loadAcquire(written) + 1 - (int)kBufferSize - begin;
+        if (skip > 0)
+            s.remove(0, qMin(skip, s.size()));
+        return s;
+    }
+    void clear() { spsc::storeRelease(cleared, spsc::loadAcquire(written));}
+    /// no more events will be added. the owner thread is finished
+    void finish() { spsc::storeRelease(finished, 1);}
+    bool isFinished() const { return spsc::loadAcquire(finished);}
+
+    const int tid;
+    const QByteArray name;
+private:
+    QVector<TraceEventData> events;
+    QAtomicInt written;
+    QAtomicInt cleared;
+    QAtomicInt finished;
+};
+
+/*
+ * Buffers of finished threads are kept until they are dumped or cleared, so events of finished threads can be dumped.
+ * At most kMaxFinishedBuffers are kept, the oldest are deleted.
+ */
+class TraceRegistry
+{
+public:
+    TraceRegistry() : next_tid(1) { timer.start();}
+    TraceBuffer* newBuffer(const QByteArray& threadName) {
+        QMutexLocker lock(&mutex);
+        Q_UNUSED(lock);
+        int nb_finished = 0;
+        for (int i = buffers.size() - 1; i >= 0; --i) {
+            if (!buffers.at(i)->isFinished())
+                continue;
+            if (++nb_finished > kMaxFinishedBuffers)
+                delete buffers.takeAt(i);
+        }
+        buffers.append(new TraceBuffer(next_tid++, threadName));
+        return buffers.last();
+    }
+    /// buffers are not deleted until unlockBuffers()
+    QList<TraceBuffer*> lockBuffers() {
+        mutex.lock();
+        return buffers;
+    }
+    /// delete the buffers of finished threads whose events are dumped or cleared
+    void unlockBuffers(const QList<TraceBuffer*>& finished) {
+        foreach (TraceBuffer *b, finished) {
+            buffers.removeOne(b);
+            delete b;
+        }
+        mutex.unlock();
+    }
+    QElapsedTimer timer;
+private:
+    QMutex mutex;
+    QList<TraceBuffer*> buffers;
+    int next_tid;
+};
+Q_GLOBAL_STATIC(TraceRegistry, traceRegistry)
+
+// deleted by QThreadStorage when the thread finishes. the buffer is kept in registry until dumped or cleared
+struct TraceThread
+{
+    TraceThread() : buffer(0) {}
+    ~TraceThread() {
+        if (buffer)
+            buffer->finish();
+    }
+    TraceBuffer *buffer;
+};
+static QThreadStorage<TraceThread*> traceThread;
+
+static TraceBuffer* currentBuffer()
+{
+    if (!traceThread.hasLocalData()) {
+        QThread *t = QThread::currentThread();
+        QByteArray name;
+        if (t) {
+            name = t->objectName().toUtf8();
+            if (name.isEmpty())
+                name = t->metaObject()->className();
+        }
+        TraceThread *tt = new TraceThread();
+        tt->buffer = traceRegistry()->newBuffer(name);
+        traceThread.setLocalData(tt);
+    }
+    return traceThread.localData()->buffer;
+}
+
+static void appendJsonString(QByteArray& out, const char* s)
+{
+    out.append('"');
+    for (; s && *s; ++s) {
+        const char c = *s;
+        if (c == '"' || c == '\\') {
+            out.append('\\').append(c);
+        } else if ((unsigned char)c < 0x20) {
+            char esc[8];
+            qsnprintf(esc, sizeof(esc), "\\u%04x", (unsigned char)c);
+            out.append(esc);
+        } else {
+            out.append(c);
+        }
+    }
+    out.append('"');
+}
+} //namespace
+
+qint64 traceTime()
+{
+    return traceRegistry()->timer.nsecsElapsed()/1000LL;
+}
+
+void traceEvent(const char *name, const char *category, qint64 begin, qint64 end)
+{
+    TraceEventData e;
+    e.name = name;
+    e.cat = category;
+    e.ts = begin;
+    e.dur = end - begin;
+    currentBuffer()->add(e);
+}
+} //namespace Internal
+
+void setTraceEnabled(bool value)
+{
+    if (value)
+        Internal::traceRegistry(); // start the timer
+    spsc::storeRelease(Internal::gTraceEnabled, value);
+}
+
+bool isTraceEnabled()
+{
+    return Internal::traceEnabled();
+}
+
+void clearTrace()
+{
+    Internal::TraceRegistry *r = Internal::traceRegistry();
+    QList<Internal::TraceBuffer*> finished;
+    foreach (Internal::TraceBuffer *b, r->lockBuffers()) {
+        if (b->isFinished())
+            finished.append(b);
+        else
+            b->clear();
+    }
+    r->unlockBuffers(finished);
+}
+
+QByteArray traceJson()
+{
+    QByteArray out("{\"traceEvents\":[");
+    bool first = true;
+    Internal::TraceRegistry *r = Internal::traceRegistry();
+    QList<Internal::TraceBuffer*> finished;
+    foreach (Internal::TraceBuffer *b, r->lockBuffers()) {
+        // no event will be added if finished before snapshot
+        if (b->isFinished())
+            finished.append(b);
+        const QByteArray tid(QByteArray::number(b->tid));
+        if (!first)
+            out.append(',');
+        first = false;
+        out.append("\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":").append(tid).append(",\"args\":{\"name\":");
+        Internal::appendJsonString(out, b->name.constData());
+        out.append("}}");
+        const QVector<Internal::TraceEventData> events(b->snapshot());
+        foreach (const Internal::TraceEventData& e, events) {
+            out.append(",\n{\"name\":");
+            Internal::appendJsonString(out, e.name);
+            out.append(",\"cat\":");
+            Internal::appendJsonString(out, e.cat);
+            out.append(",\"ph\":\"X\",\"ts\":").append(QByteArray::number(e.ts))
+               .append(",\"dur\":").append(QByteArray::number(e.dur))
+               .append(",\"pid\":1,\"tid\":").append(tid).append('}');
+        }
+    }
+    r->unlockBuffers(finished);
+    out.append("\n],\"displayTimeUnit\":\"ms\"}\n");
+    return out;
+}
+
+bool saveTrace(const QString &path)
+{
+    QFile f(path);
+    if (!f.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        qWarning("Failed to open trace file %s", qPrintable(path));
+        return false;
+    }
+    const QByteArray json(traceJson());
+    return f.write(json) == json.size();
+}
+} //namespace QtAV
@@ -0,0 +1,86 @@
+/******************************************************************************
+    QtAV:  Multimedia framework based on Qt and FFmpeg
+    Copyright (C) 2012-2017 Wang Bin <wbsecg1@gmail.com>
+
+*   This file is part of QtAV (from 2017)
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+******************************************************************************/
+
+
+#ifndef QTAV_TRACE_H
+#define QTAV_TRACE_H
+
+#include <QtAV/QtAV_Global.h>
+#include <QtCore/QAtomicInt>
+
+#ifndef Q_UNLIKELY
+#define Q_UNLIKELY(x) (x)
+#endif
+
+namespace QtAV {
+namespace Internal {
+/// enabled by setTraceEnabled(). relaxed read, so a disabled scope costs one branch
+extern Q_AV_PRIVATE_EXPORT QAtomicInt gTraceEnabled;
+inline bool traceEnabled() {
+#if QT_VERSION >= QT_VERSION_CHECK(5, 0, 0)
+    return gTraceEnabled.load();
+#else
+    return gTraceEnabled; // volatile read
+#endif
+}
+/// microseconds since tracing is enabled the first time
+Q_AV_PRIVATE_EXPORT qint64 traceTime();
+/*!
+ * \brief traceEvent
+ * Add a complete event to the ring buffer of current thread. Old events are overwritten if the buffer is full.
+ * name and category must be string literals (or other strings never freed).
+ */
+Q_AV_PRIVATE_EXPORT void traceEvent(const char* name, const char* category, qint64 begin, qint64 end);
+
+class TraceScope
+{
+public:
+    TraceScope(const char* name, const char* category) : m_name(0) {
+        if (Q_UNLIKELY(traceEnabled())) {
+            m_name = name;
+            m_cat = category;
+            m_begin = traceTime();
+        }
+    }
+    ~TraceScope() { end();}
+    /// end the event before the scope exits
+    void end() {
+        if (!m_name)
+            return;
+        traceEvent(m_name, m_cat, m_begin, traceTime());
+        m_name = 0;
+    }
+private:
+    const char* m_name;
+    const char* m_cat;
+    qint64 m_begin;
+};
+} //namespace Internal
+} //namespace QtAV
+
+#define QTAV_TRACE_CONCAT_(a, b) a##b
+#define QTAV_TRACE_CONCAT(a, b) QTAV_TRACE_CONCAT_(a, b)
+/// trace the rest of current scope
+#define QTAV_TRACE(category, name) QtAV::Internal::TraceScope QTAV_TRACE_CONCAT(qtav_trace_, __LINE__)(name, category)
+/// trace until var.end() or the end of current scope
+#define QTAV_TRACE_VAR(var, category, name) QtAV::Internal::TraceScope var(name, category)
+
+#endif //QTAV_TRACE_H
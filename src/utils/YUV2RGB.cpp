@@ -0,0 +1,192 @@
+/******************************************************************************
+    QtAV:  Multimedia framework based on Qt and FFmpeg
+    Copyright (C) 2012-2017 Wang Bin <wbsecg1@gmail.com>
+
+*   This file is part of QtAV (from 2017)
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+******************************************************************************/
+
+#include "YUV2RGB.h"
+extern "C" {
+#include <libavutil/cpu.h>
+}
+#if defined(__ARM_NEON__) || defined(__ARM_NEON)
+#include <arm_neon.h>
+#define QTAV_HAVE_NEON_INTRINSICS 1
+#endif
+
+namespace QtAV {
+
+// not cached, av_force_cpu_flags() can select the kernels
+static int cpuFlags()
+{
+    return av_get_cpu_flags();
+}
+
+#if QTAV_HAVE(SSE2)
+static bool has_sse2() { return !!(cpuFlags() & AV_CPU_FLAG_SSE2); }
+#endif
+#if QTAV_HAVE(AVX2)
+static bool has_avx2()
+{
+#ifdef AV_CPU_FLAG_AVX2
+    return !!(cpuFlags() & AV_CPU_FLAG_AVX2);
+#else
+    return false;
+#endif
+}
+#endif
+
+#if QTAV_HAVE(NEON_INTRINSICS)
+static bool has_neon()
+{
+#ifdef AV_CPU_FLAG_NEON
+    return !!(cpuFlags() & AV_CPU_FLAG_NEON);
+#else
+    return true;
+#endif
+}
+
+// 8 results of output byte i
+static inline uint8x8_t channel_neon(int16x8_t y, int16x8_t u, int16x8_t v, int i, const YUV2RGBCoeffs *c, int32x4_t shift)
+{
+    const int32x4_t off = vdupq_n_s32(c->offset[i]);
+    int32x4_t lo = vmlal_n_s16(off, vget_low_s16(y), c->ky[i]);
+    lo = vmlal_n_s16(lo, vget_low_s16(u), c->ku[i]);
+    lo = vmlal_n_s16(lo, vget_low_s16(v), c->kv[i]);
+    int32x4_t hi = vmlal_n_s16(off, vget_high_s16(y), c->ky[i]);
+    hi = vmlal_n_s16(hi, vget_high_s16(u), c->ku[i]);
+    hi = vmlal_n_s16(hi, vget_high_s16(v), c->kv[i]);
+    // shift is negative: arithmetic right shift
+    lo = vshlq_s32(lo, shift);
+    hi = vshlq_s32(hi, shift);
+    return vqmovun_s16(vcombine_s16(vqmovn_s32(lo), vqmovn_s32(hi)));
+}
+
+static inline void yuv2rgb8_neon(quint8 *dst, int16x8_t y, int16x8_t u, int16x8_t v, const YUV2RGBCoeffs *c, int32x4_t shift)
+{
+    uint8x8x4_t px;
+    px.val[0] = channel_neon(y, u, v, 0, c, shift);
+    px.val[1] = channel_neon(y, u, v, 1, c, shift);
+    px.val[2] = channel_neon(y, u, v, 2, c, shift);
+    px.val[3] = vdup_n_u8(0xff);
+    vst4_u8(dst, px);
+}
+
+static inline int16x8_t s16_u8(uint8x8_t x) { return vreinterpretq_s16_u16(vmovl_u8(x)); }
+
+// 16 pixels per loop
+static void yuv2rgb_row_planar8_neon(quint8 *dst, const quint8 *y, const quint8 *u, const quint8 *v, int width, const YUV2RGBCoeffs *c)
+{
+    const int32x4_t shift = vdupq_n_s32(-c->shift);
+    int i = 0;
+    for (; i <= width - 16; i += 16) {
+        const uint8x16_t y16 = vld1q_u8(y + i);
+        const uint8x8_t u8 = vld1_u8(u + i/2);
+        const uint8x8_t v8 = vld1_u8(v + i/2);
+        const uint8x8x2_t uu = vzip_u8(u8, u8);
+        const uint8x8x2_t vv = vzip_u8(v8, v8);
+        yuv2rgb8_neon(dst + 4*i, s16_u8(vget_low_u8(y16)), s16_u8(uu.val[0]), s16_u8(vv.val[0]), c, shift);
+        yuv2rgb8_neon(dst + 4*i + 32, s16_u8(vget_high_u8(y16)), s16_u8(uu.val[1]), s16_u8(vv.val[1]), c, shift);
+    }
+    yuv2rgb_row_planar8_c(dst + 4*i, y + i, u + i/2, v + i/2, width - i, c);
+}
+
+static void yuv2rgb_row_semiplanar8_neon(quint8 *dst, const quint8 *y, const quint8 *uv, const quint8 *, int width, const YUV2RGBCoeffs *c)
+{
+    const int32x4_t shift = vdupq_n_s32(-c->shift);
+    int i = 0;
+    for (; i <= width - 16; i += 16) {
+        const uint8x16_t y16 = vld1q_u8(y + i);
+        const uint8x8x2_t uv8 = vld2_u8(uv + i);
+        const uint8x8x2_t uu = vzip_u8(uv8.val[0], uv8.val[0]);
+        const uint8x8x2_t vv = vzip_u8(uv8.val[1], uv8.val[1]);
+        yuv2rgb8_neon(dst + 4*i, s16_u8(vget_low_u8(y16)), s16_u8(uu.val[0]), s16_u8(vv.val[0]), c, shift);
+        yuv2rgb8_neon(dst + 4*i + 32, s16_u8(vget_high_u8(y16)), s16_u8(uu.val[1]), s16_u8(vv.val[1]), c, shift);
+    }
+    yuv2rgb_row_semiplanar8_c(dst + 4*i, y + i, uv + i, 0, width - i, c);
+}
+
+// 8 pixels per loop
+static void yuv2rgb_row_semiplanar16_neon(quint8 *dst, const quint8 *y, const quint8 *uv, const quint8 *, int width, const YUV2RGBCoeffs *c)
+{
+    const int32x4_t shift = vdupq_n_s32(-c->shift);
+    const quint16 *y16 = (const quint16*)y;
+    const quint16 *uv16 = (const quint16*)uv;
+    int i = 0;
+    for (; i <= width - 8; i += 8) {
+        const uint16x8_t y8 = vshrq_n_u16(vld1q_u16(y16 + i), 6);
+        const uint16x4x2_t uv4 = vld2_u16(uv16 + i);
+        const uint16x4x2_t uu = vzip_u16(uv4.val[0], uv4.val[0]);
+        const uint16x4x2_t vv = vzip_u16(uv4.val[1], uv4.val[1]);
+        const uint16x8_t u8 = vshrq_n_u16(vcombine_u16(uu.val[0], uu.val[1]), 6);
+        const uint16x8_t v8 = vshrq_n_u16(vcombine_u16(vv.val[0], vv.val[1]), 6);
+        yuv2rgb8_neon(dst + 4*i, vreinterpretq_s16_u16(y8), vreinterpretq_s16_u16(u8), vreinterpretq_s16_u16(v8), c, shift);
+    }
+    yuv2rgb_row_semiplanar16_c(dst + 4*i, y + 2*i, uv + 2*i, 0, width - i, c);
+}
+#endif //QTAV_HAVE(NEON_INTRINSICS)
+
+yuv2rgb_row_func get_yuv2rgb_row(YUVLayout layout)
+{
+    switch (layout) {
+    case YUVLayout_Planar8:
+#if QTAV_HAVE(AVX2)
+        if (has_avx2())
+            return yuv2rgb_row_planar8_avx2;
+#endif
+#if QTAV_HAVE(SSE2)
+        if (has_sse2())
+            return yuv2rgb_row_planar8_sse2;
+#endif
+#if QTAV_HAVE(NEON_INTRINSICS)
+        if (has_neon())
+            return yuv2rgb_row_planar8_neon;
+#endif
+        return yuv2rgb_row_planar8_c;
+    case YUVLayout_SemiPlanar8:
+#if QTAV_HAVE(AVX2)
+        if (has_avx2())
+            return yuv2rgb_row_semiplanar8_avx2;
+#endif
+#if QTAV_HAVE(SSE2)
+        if (has_sse2())
+            return yuv2rgb_row_semiplanar8_sse2;
+#endif
+#if QTAV_HAVE(NEON_INTRINSICS)
+        if (has_neon())
+            return yuv2rgb_row_semiplanar8_neon;
+#endif
+        return yuv2rgb_row_semiplanar8_c;
+    case YUVLayout_SemiPlanar16:
+#if QTAV_HAVE(AVX2)
+        if (has_avx2())
+            return yuv2rgb_row_semiplanar16_avx2;
+#endif
+#if QTAV_HAVE(SSE2)
+        if (has_sse2())
+            return yuv2rgb_row_semiplanar16_sse2;
+#endif
+#if QTAV_HAVE(NEON_INTRINSICS)
+        if (has_neon())
+            return yuv2rgb_row_semiplanar16_neon;
+#endif
+        return yuv2rgb_row_semiplanar16_c;
+    default:
+        return 0;
+    }
+}
+} //namespace QtAV
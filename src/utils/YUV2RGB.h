@@ -0,0 +1,100 @@
+/******************************************************************************
+    QtAV:  Multimedia framework based on Qt and FFmpeg
+    Copyright (C) 2012-2017 Wang Bin <wbsecg1@gmail.com>
+
+*   This file is part of QtAV (from 2017)
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+******************************************************************************/
+
+#ifndef QTAV_YUV2RGB_H
+#define QTAV_YUV2RGB_H
+
+#include <QtAV/QtAV_Global.h>
+
+namespace QtAV {
+/*!
+ * Fixed point yuv to 32bpp rgb conversion.
+ * Byte i (i < 3) of an output pixel is clip((y*ky[i] + u*ku[i] + v*kv[i] + offset[i]) >> shift), byte 3 is 0xff.
+ * The order of output bytes (bgra, rgba) is decided by the order of coefficients.
+ */
+struct YUV2RGBCoeffs {
+    qint16 ky[3], ku[3], kv[3];
+    qint32 offset[3]; // including rounding
+    int shift;
+};
+
+enum YUVLayout {
+    YUVLayout_Planar8, ///< yuv420p, yuv422p: u and v planes of half width
+    YUVLayout_SemiPlanar8, ///< nv12: interleaved uv plane. nv21 is nv12 with swapped u, v coefficients
+    YUVLayout_SemiPlanar16 ///< p010le: interleaved uv plane, 16 bit little endian samples and the 10 msb are used
+};
+
+/*!
+ * Convert a row of width pixels. Chroma of a pixel is the nearest (left) sample.
+ * v is not used by semi planar layouts.
+ */
+typedef void (*yuv2rgb_row_func)(quint8 *dst, const quint8 *y, const quint8 *u, const quint8 *v, int width, const YUV2RGBCoeffs *c);
+
+/*!
+ * \brief get_yuv2rgb_row
+ * The best kernel for current cpu
+ */
+Q_AV_PRIVATE_EXPORT yuv2rgb_row_func get_yuv2rgb_row(YUVLayout layout);
+
+static inline quint8 clip_u8(int v) { return v < 0 ? 0 : (v > 255 ? 255 : v); }
+
+static inline void yuv2rgb_pixel(quint8 *d, int y, int u, int v, const YUV2RGBCoeffs *c)
+{
+    d[0] = clip_u8((y*c->ky[0] + u*c->ku[0] + v*c->kv[0] + c->offset[0]) >> c->shift);
+    d[1] = clip_u8((y*c->ky[1] + u*c->ku[1] + v*c->kv[1] + c->offset[1]) >> c->shift);
+    d[2] = clip_u8((y*c->ky[2] + u*c->ku[2] + v*c->kv[2] + c->offset[2]) >> c->shift);
+    d[3] = 0xff;
+}
+
+// scalar kernels. SIMD kernels use them to convert the remaining pixels
+static inline void yuv2rgb_row_planar8_c(quint8 *dst, const quint8 *y, const quint8 *u, const quint8 *v, int width, const YUV2RGBCoeffs *c)
+{
+    for (int i = 0; i < width; ++i)
+        yuv2rgb_pixel(dst + 4*i, y[i], u[i/2], v[i/2], c);
+}
+
+static inline void yuv2rgb_row_semiplanar8_c(quint8 *dst, const quint8 *y, const quint8 *uv, const quint8 *, int width, const YUV2RGBCoeffs *c)
+{
+    for (int i = 0; i < width; ++i)
+        yuv2rgb_pixel(dst + 4*i, y[i], uv[i/2*2], uv[i/2*2+1], c);
+}
+
+static inline void yuv2rgb_row_semiplanar16_c(quint8 *dst, const quint8 *y, const quint8 *uv, const quint8 *, int width, const YUV2RGBCoeffs *c)
+{
+    const quint16 *y16 = (const quint16*)y;
+    const quint16 *uv16 = (const quint16*)uv;
+    for (int i = 0; i < width; ++i)
+        yuv2rgb_pixel(dst + 4*i, y16[i] >> 6, uv16[i/2*2] >> 6, uv16[i/2*2+1] >> 6, c);
+}
+
+// SIMD kernels. x86 kernels are selected at runtime
+#if QTAV_HAVE(SSE2)
+void yuv2rgb_row_planar8_sse2(quint8 *dst, const quint8 *y, const quint8 *u, const quint8 *v, int width, const YUV2RGBCoeffs *c);
+void yuv2rgb_row_semiplanar8_sse2(quint8 *dst, const quint8 *y, const quint8 *uv, const quint8 *, int width, const YUV2RGBCoeffs *c);
+void yuv2rgb_row_semiplanar16_sse2(quint8 *dst, const quint8 *y, const quint8 *uv, const quint8 *, int width, const YUV2RGBCoeffs *c);
+#endif //QTAV_HAVE(SSE2)
+#if QTAV_HAVE(AVX2)
+void yuv2rgb_row_planar8_avx2(quint8 *dst, const quint8 *y, const quint8 *u, const quint8 *v, int width, const YUV2RGBCoeffs *c);
+void yuv2rgb_row_semiplanar8_avx2(quint8 *dst, const quint8 *y, const quint8 *uv, const quint8 *, int width, const YUV2RGBCoeffs *c);
+void yuv2rgb_row_semiplanar16_avx2(quint8 *dst, const quint8 *y, const quint8 *uv, const quint8 *, int width, const YUV2RGBCoeffs *c);
+#endif //QTAV_HAVE(AVX2)
+} //namespace QtAV
+#endif //QTAV_YUV2RGB_H
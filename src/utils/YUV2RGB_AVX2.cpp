@@ -0,0 +1,131 @@
+/******************************************************************************
+    QtAV:  Multimedia framework based on Qt and FFmpeg
+    Copyright (C) 2012-2017 Wang Bin <wbsecg1@gmail.com>
+
+*   This file is part of QtAV (from 2017)
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+******************************************************************************/
+
+#include "YUV2RGB.h"
+#if defined(__AVX2__)
+#include <immintrin.h>
+
+namespace QtAV {
+
+struct ChannelAVX2 {
+    __m256i kyu, kv, offset;
+};
+
+static inline void load_coeffs(ChannelAVX2 *k, const YUV2RGBCoeffs *c)
+{
+    for (int i = 0; i < 3; ++i) {
+        k[i].kyu = _mm256_set1_epi32((int)(((quint32)(quint16)c->ku[i] << 16) | (quint16)c->ky[i]));
+        k[i].kv = _mm256_set1_epi32((quint16)c->kv[i]);
+        k[i].offset = _mm256_set1_epi32(c->offset[i]);
+    }
+}
+
+// unpack and pack instructions work in 128 bit lanes, the result order is the same as input
+static inline __m256i channel(__m256i yu_lo, __m256i yu_hi, __m256i v_lo, __m256i v_hi, const ChannelAVX2 &k, __m128i shift)
+{
+    const __m256i lo = _mm256_add_epi32(_mm256_add_epi32(_mm256_madd_epi16(yu_lo, k.kyu), _mm256_madd_epi16(v_lo, k.kv)), k.offset);
+    const __m256i hi = _mm256_add_epi32(_mm256_add_epi32(_mm256_madd_epi16(yu_hi, k.kyu), _mm256_madd_epi16(v_hi, k.kv)), k.offset);
+    return _mm256_packs_epi32(_mm256_sra_epi32(lo, shift), _mm256_sra_epi32(hi, shift));
+}
+
+// y, u, v: 16 s16 samples, u and v are already upsampled. store 16 pixels
+static inline void yuv2rgb16(quint8 *dst, __m256i y, __m256i u, __m256i v, const ChannelAVX2 *k, __m128i shift)
+{
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i yu_lo = _mm256_unpacklo_epi16(y, u);
+    const __m256i yu_hi = _mm256_unpackhi_epi16(y, u);
+    const __m256i v_lo = _mm256_unpacklo_epi16(v, zero);
+    const __m256i v_hi = _mm256_unpackhi_epi16(v, zero);
+    const __m256i c0 = channel(yu_lo, yu_hi, v_lo, v_hi, k[0], shift);
+    const __m256i c1 = channel(yu_lo, yu_hi, v_lo, v_hi, k[1], shift);
+    const __m256i c2 = channel(yu_lo, yu_hi, v_lo, v_hi, k[2], shift);
+    const __m256i c02 = _mm256_packus_epi16(c0, c2);
+    const __m256i c1a = _mm256_packus_epi16(c1, _mm256_set1_epi16(0xff));
+    const __m256i c01 = _mm256_unpacklo_epi8(c02, c1a);
+    const __m256i c2a = _mm256_unpackhi_epi8(c02, c1a);
+    // lo: pixels 0~3, 8~11. hi: pixels 4~7, 12~15
+    const __m256i lo = _mm256_unpacklo_epi16(c01, c2a);
+    const __m256i hi = _mm256_unpackhi_epi16(c01, c2a);
+    _mm256_storeu_si256((__m256i*)dst, _mm256_permute2x128_si256(lo, hi, 0x20));
+    _mm256_storeu_si256((__m256i*)(dst + 32), _mm256_permute2x128_si256(lo, hi, 0x31));
+}
+
+// 8 u8 samples to 16 s16 samples u0 u0 u1 u1 ...
+static inline __m256i load_chroma8(const quint8 *p)
+{
+    const __m128i c = _mm_loadl_epi64((const __m128i*)p);
+    return _mm256_cvtepu8_epi16(_mm_unpacklo_epi8(c, c));
+}
+
+// uv: 8 pairs of s16 u, v. split and duplicate to 16 s16 samples
+static inline void split_uv(__m256i uv, __m256i *u, __m256i *v)
+{
+    const __m256i uu = _mm256_and_si256(uv, _mm256_set1_epi32(0xffff));
+    const __m256i vv = _mm256_srli_epi32(uv, 16);
+    *u = _mm256_or_si256(uu, _mm256_slli_epi32(uu, 16));
+    *v = _mm256_or_si256(vv, _mm256_slli_epi32(vv, 16));
+}
+
+void yuv2rgb_row_planar8_avx2(quint8 *dst, const quint8 *y, const quint8 *u, const quint8 *v, int width, const YUV2RGBCoeffs *c)
+{
+    ChannelAVX2 k[3];
+    load_coeffs(k, c);
+    const __m128i shift = _mm_cvtsi32_si128(c->shift);
+    int i = 0;
+    for (; i <= width - 16; i += 16) {
+        const __m256i y16 = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i*)(y + i)));
+        yuv2rgb16(dst + 4*i, y16, load_chroma8(u + i/2), load_chroma8(v + i/2), k, shift);
+    }
+    yuv2rgb_row_planar8_c(dst + 4*i, y + i, u + i/2, v + i/2, width - i, c);
+}
+
+void yuv2rgb_row_semiplanar8_avx2(quint8 *dst, const quint8 *y, const quint8 *uv, const quint8 *, int width, const YUV2RGBCoeffs *c)
+{
+    ChannelAVX2 k[3];
+    load_coeffs(k, c);
+    const __m128i shift = _mm_cvtsi32_si128(c->shift);
+    int i = 0;
+    for (; i <= width - 16; i += 16) {
+        const __m256i y16 = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i*)(y + i)));
+        __m256i u16, v16;
+        split_uv(_mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i*)(uv + i))), &u16, &v16);
+        yuv2rgb16(dst + 4*i, y16, u16, v16, k, shift);
+    }
+    yuv2rgb_row_semiplanar8_c(dst + 4*i, y + i, uv + i, 0, width - i, c);
+}
+
+void yuv2rgb_row_semiplanar16_avx2(quint8 *dst, const quint8 *y, const quint8 *uv, const quint8 *, int width, const YUV2RGBCoeffs *c)
+{
+    ChannelAVX2 k[3];
+    load_coeffs(k, c);
+    const __m128i shift = _mm_cvtsi32_si128(c->shift);
+    int i = 0;
+    for (; i <= width - 16; i += 16) {
+        const __m256i y16 = _mm256_srli_epi16(_mm256_loadu_si256((const __m256i*)(y + 2*i)), 6);
+        __m256i u16, v16;
+        split_uv(_mm256_srli_epi16(_mm256_loadu_si256((const __m256i*)(uv + 2*i)), 6), &u16, &v16);
+        yuv2rgb16(dst + 4*i, y16, u16, v16, k, shift);
+    }
+    yuv2rgb_row_semiplanar16_c(dst + 4*i, y + 2*i, uv + 2*i, 0, width - i, c);
+}
+
+} //namespace QtAV
+#endif //defined(__AVX2__)
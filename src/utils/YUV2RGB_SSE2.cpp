@@ -0,0 +1,138 @@
+/******************************************************************************
+    QtAV:  Multimedia framework based on Qt and FFmpeg
+    Copyright (C) 2012-2017 Wang Bin <wbsecg1@gmail.com>
+
+*   This file is part of QtAV (from 2017)
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+******************************************************************************/
+
+#include "YUV2RGB.h"
+#if defined(__SSE__) || defined(_M_IX86) || defined(_M_X64) // gcc, clang defines __SSE__, vc does not
+#include <string.h>
+#include <emmintrin.h>
+
+namespace QtAV {
+
+// coefficients of 1 output byte for _mm_madd_epi16: (ky, ku) pairs, (kv, 0) pairs and offset
+struct ChannelSSE2 {
+    __m128i kyu, kv, offset;
+};
+
+static inline void load_coeffs(ChannelSSE2 *k, const YUV2RGBCoeffs *c)
+{
+    for (int i = 0; i < 3; ++i) {
+        k[i].kyu = _mm_set1_epi32((int)(((quint32)(quint16)c->ku[i] << 16) | (quint16)c->ky[i]));
+        k[i].kv = _mm_set1_epi32((quint16)c->kv[i]);
+        k[i].offset = _mm_set1_epi32(c->offset[i]);
+    }
+}
+
+// 8 s16 results of 1 output byte
+static inline __m128i channel(__m128i yu_lo, __m128i yu_hi, __m128i v_lo, __m128i v_hi, const ChannelSSE2 &k, __m128i shift)
+{
+    const __m128i lo = _mm_add_epi32(_mm_add_epi32(_mm_madd_epi16(yu_lo, k.kyu), _mm_madd_epi16(v_lo, k.kv)), k.offset);
+    const __m128i hi = _mm_add_epi32(_mm_add_epi32(_mm_madd_epi16(yu_hi, k.kyu), _mm_madd_epi16(v_hi, k.kv)), k.offset);
+    return _mm_packs_epi32(_mm_sra_epi32(lo, shift), _mm_sra_epi32(hi, shift));
+}
+
+// y, u, v: 8 s16 samples, u and v are already upsampled. store 8 pixels
+static inline void yuv2rgb8(quint8 *dst, __m128i y, __m128i u, __m128i v, const ChannelSSE2 *k, __m128i shift)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i yu_lo = _mm_unpacklo_epi16(y, u);
+    const __m128i yu_hi = _mm_unpackhi_epi16(y, u);
+    const __m128i v_lo = _mm_unpacklo_epi16(v, zero);
+    const __m128i v_hi = _mm_unpackhi_epi16(v, zero);
+    const __m128i c0 = channel(yu_lo, yu_hi, v_lo, v_hi, k[0], shift);
+    const __m128i c1 = channel(yu_lo, yu_hi, v_lo, v_hi, k[1], shift);
+    const __m128i c2 = channel(yu_lo, yu_hi, v_lo, v_hi, k[2], shift);
+    const __m128i c02 = _mm_packus_epi16(c0, c2);
+    const __m128i c1a = _mm_packus_epi16(c1, _mm_set1_epi16(0xff));
+    const __m128i c01 = _mm_unpacklo_epi8(c02, c1a);
+    const __m128i c2a = _mm_unpackhi_epi8(c02, c1a);
+    _mm_storeu_si128((__m128i*)dst, _mm_unpacklo_epi16(c01, c2a));
+    _mm_storeu_si128((__m128i*)(dst + 16), _mm_unpackhi_epi16(c01, c2a));
+}
+
+// 4 u8 samples to 8 s16 samples u0 u0 u1 u1 ...
+static inline __m128i load_chroma4(const quint8 *p)
+{
+    int x;
+    memcpy(&x, p, sizeof(x));
+    const __m128i c = _mm_cvtsi32_si128(x);
+    return _mm_unpacklo_epi8(_mm_unpacklo_epi8(c, c), _mm_setzero_si128());
+}
+
+// uv: 4 pairs of s16 u, v. split and duplicate to 8 s16 samples
+static inline void split_uv(__m128i uv, __m128i *u, __m128i *v)
+{
+    const __m128i uu = _mm_and_si128(uv, _mm_set1_epi32(0xffff));
+    const __m128i vv = _mm_srli_epi32(uv, 16);
+    *u = _mm_or_si128(uu, _mm_slli_epi32(uu, 16));
+    *v = _mm_or_si128(vv, _mm_slli_epi32(vv, 16));
+}
+
+void yuv2rgb_row_planar8_sse2(quint8 *dst, const quint8 *y, const quint8 *u, const quint8 *v, int width, const YUV2RGBCoeffs *c)
+{
+    ChannelSSE2 k[3];
+    load_coeffs(k, c);
+    const __m128i shift = _mm_cvtsi32_si128(c->shift);
+    const __m128i zero = _mm_setzero_si128();
+    int i = 0;
+    for (; i <= width - 16; i += 16) {
+        const __m128i y16 = _mm_loadu_si128((const __m128i*)(y + i));
+        yuv2rgb8(dst + 4*i, _mm_unpacklo_epi8(y16, zero), load_chroma4(u + i/2), load_chroma4(v + i/2), k, shift);
+        yuv2rgb8(dst + 4*i + 32, _mm_unpackhi_epi8(y16, zero), load_chroma4(u + i/2 + 4), load_chroma4(v + i/2 + 4), k, shift);
+    }
+    yuv2rgb_row_planar8_c(dst + 4*i, y + i, u + i/2, v + i/2, width - i, c);
+}
+
+void yuv2rgb_row_semiplanar8_sse2(quint8 *dst, const quint8 *y, const quint8 *uv, const quint8 *, int width, const YUV2RGBCoeffs *c)
+{
+    ChannelSSE2 k[3];
+    load_coeffs(k, c);
+    const __m128i shift = _mm_cvtsi32_si128(c->shift);
+    const __m128i zero = _mm_setzero_si128();
+    int i = 0;
+    for (; i <= width - 16; i += 16) {
+        const __m128i y16 = _mm_loadu_si128((const __m128i*)(y + i));
+        const __m128i uv16 = _mm_loadu_si128((const __m128i*)(uv + i));
+        __m128i u8, v8;
+        split_uv(_mm_unpacklo_epi8(uv16, zero), &u8, &v8);
+        yuv2rgb8(dst + 4*i, _mm_unpacklo_epi8(y16, zero), u8, v8, k, shift);
+        split_uv(_mm_unpackhi_epi8(uv16, zero), &u8, &v8);
+        yuv2rgb8(dst + 4*i + 32, _mm_unpackhi_epi8(y16, zero), u8, v8, k, shift);
+    }
+    yuv2rgb_row_semiplanar8_c(dst + 4*i, y + i, uv + i, 0, width - i, c);
+}
+
+void yuv2rgb_row_semiplanar16_sse2(quint8 *dst, const quint8 *y, const quint8 *uv, const quint8 *, int width, const YUV2RGBCoeffs *c)
+{
+    ChannelSSE2 k[3];
+    load_coeffs(k, c);
+    const __m128i shift = _mm_cvtsi32_si128(c->shift);
+    int i = 0;
+    for (; i <= width - 8; i += 8) {
+        const __m128i y8 = _mm_srli_epi16(_mm_loadu_si128((const __m128i*)(y + 2*i)), 6);
+        __m128i u8, v8;
+        split_uv(_mm_srli_epi16(_mm_loadu_si128((const __m128i*)(uv + 2*i)), 6), &u8, &v8);
+        yuv2rgb8(dst + 4*i, y8, u8, v8, k, shift);
+    }
+    yuv2rgb_row_semiplanar16_c(dst + 4*i, y + 2*i, uv + 2*i, 0, width - i, c);
+}
+
+} //namespace QtAV
+#endif
@@ -134,7 +134,7 @@ void* SurfaceInteropVAAPI::mapToHost(const VideoFormat &format, void *handle, in
     VAWARN(vaDestroyImage(m_surface->vadisplay(), image.image_id));
     image.image_id = VA_INVALID_ID;
     VideoFrame *f = reinterpret_cast<VideoFrame*>(handle);
-    frame.setTimestamp(f->timestamp());
+    frame.setTimestampUs(f->timestampUs());
     *f = frame;
     return f;
 }
@@ -24,7 +24,10 @@
 #include <QtCore/QCoreApplication>
 #include <QtCore/QElapsedTimer>
 #include <QtCore/QStringList>
+#include <QtCore/QVector>
 #include <QtAV/AudioOutput.h>
+#include "output/audio/AudioScale.h"
+#include "AudioTimeStretch.h"
 #include <QtDebug>
 
 using namespace QtAV;
@@ -33,7 +36,107 @@ const int kFrames = 512;
 qint16 sin_table[kTableSize];
 
 void help() {
-    qDebug() << QLatin1String("parameters: [-ao ") << AudioOutput::backendsAvailable().join(QLatin1String("|")) << QLatin1String("]");
+    qDebug() << QLatin1String("parameters: [-ao ") << AudioOutput::backendsAvailable().join(QLatin1String("|")) << QLatin1String("] [-bench] [-stretch]");
+}
+
+// samples per second of kernel f
+static double benchScaler(scale_samples_func f, QByteArray& data, int nb_samples, int voli, float volf)
+{
+    const int kLoops = 2000;
+    QElapsedTimer timer;
+    timer.start();
+    for (int i = 0; i < kLoops; ++i)
+        f((quint8*)data.data(), (const quint8*)data.constData(), nb_samples, voli, volf);
+    return double(kLoops)*double(nb_samples)*1000.0/double(qMax<qint64>(1, timer.elapsed()));
+}
+
+static double benchConverter(convert_scale_func f, const QVector<const quint8*>& planes, QByteArray& out, int channels, int nb_samples, float volf)
+{
+    const int kLoops = 2000;
+    QElapsedTimer timer;
+    timer.start();
+    for (int i = 0; i < kLoops; ++i)
+        f((quint8*)out.data(), planes.constData(), channels, nb_samples, volf);
+    return double(kLoops)*double(nb_samples*channels)*1000.0/double(qMax<qint64>(1, timer.elapsed()));
+}
+
+// software volume kernels: the default (scalar) vs the kernel selected for current cpu
+void bench()
+{
+    const int kSamples = 4096*2;
+    const qreal vol = 0.7;
+    int voli = 0;
+    struct {
+        AudioFormat::SampleFormat fmt;
+        const char* name;
+        int bytes;
+        scale_samples_func scalar;
+    } formats[] = {
+        { AudioFormat::SampleFormat_Unsigned8, "u8", 1, scale_samples_u8_small },
+        { AudioFormat::SampleFormat_Signed16, "s16", 2, scale_samples_s16_small },
+        { AudioFormat::SampleFormat_Signed32, "s32", 4, scale_samples_s32 },
+        { AudioFormat::SampleFormat_Float, "flt", 4, scale_samples<float> },
+        { AudioFormat::SampleFormat_Double, "dbl", 8, scale_samples<double> },
+    };
+    for (size_t i = 0; i < sizeof(formats)/sizeof(formats[0]); ++i) {
+        QByteArray data(kSamples*formats[i].bytes, 0);
+        for (int k = 0; k < data.size(); ++k)
+            data[k] = char(sin_table[k % kTableSize]);
+        scale_samples_func f = get_scaler(formats[i].fmt, vol, &voli);
+        const double scalar = benchScaler(formats[i].scalar, data, kSamples, voli, vol);
+        const double best = benchScaler(f, data, kSamples, voli, vol);
+        qDebug("volume %s: scalar %.1f Msamples/s, best %.1f Msamples/s (x%.2f)", formats[i].name, scalar/1e6, best/1e6, best/scalar);
+    }
+    // planar float from decoder to packed output: fused conversion+volume vs conversion then volume
+    const int channels = 2;
+    const int nb_samples = kSamples/channels;
+    QVector<float> fltp(kSamples);
+    for (int k = 0; k < kSamples; ++k)
+        fltp[k] = float(sin_table[k % kTableSize])/32768.0f;
+    QVector<const quint8*> planes(channels);
+    for (int c = 0; c < channels; ++c)
+        planes[c] = (const quint8*)(fltp.constData() + c*nb_samples);
+    const AudioFormat::SampleFormat outs[] = { AudioFormat::SampleFormat_Signed16, AudioFormat::SampleFormat_Float };
+    const char* out_names[] = { "fltp=>s16", "fltp=>flt" };
+    for (int i = 0; i < 2; ++i) {
+        QByteArray out(kSamples*4, 0);
+        convert_scale_func fused = get_convert_scaler(AudioFormat::SampleFormat_FloatPlanar, outs[i]);
+        scale_samples_func f = get_scaler(outs[i], vol, &voli);
+        const double convert = benchConverter(fused, planes, out, channels, nb_samples, 1.0f);
+        const double scale = benchScaler(f, out, kSamples, voli, vol);
+        const double two_pass = 1.0/(1.0/convert + 1.0/scale);
+        const double one_pass = benchConverter(fused, planes, out, channels, nb_samples, vol);
+        qDebug("%s: convert then volume %.1f Msamples/s, fused %.1f Msamples/s (x%.2f)", out_names[i], two_pass/1e6, one_pass/1e6, one_pass/two_pass);
+    }
+}
+
+// time stretch 60s stereo 44.1kHz input. realtime factor: media duration/processing time
+void benchStretch()
+{
+    const int channels = 2;
+    const int rate = 44100;
+    const int seconds = 60;
+    QVector<float> in(kFrames*channels);
+    const qreal speeds[] = { 0.5, 1.5, 2.0, 4.0 };
+    for (size_t i = 0; i < sizeof(speeds)/sizeof(speeds[0]); ++i) {
+        AudioTimeStretch ts;
+        ts.setFormat(channels, rate);
+        ts.setSpeed(speeds[i]);
+        QVector<float> out;
+        qint64 nb_out = 0;
+        qint64 t = 0;
+        QElapsedTimer timer;
+        timer.start();
+        for (qint64 k = 0; k < qint64(rate)*seconds; k += kFrames) {
+            for (int j = 0; j < kFrames; ++j)
+                in[j*channels] = in[j*channels+1] = float(sin_table[(k+j) % kTableSize])/32768.0f;
+            ts.process(in.constData(), kFrames, t, &out);
+            nb_out += out.size()/channels;
+            t += qint64(kFrames)*1000000LL/rate;
+        }
+        const qint64 ms = qMax<qint64>(1, timer.elapsed());
+        qDebug("stretch x%.1f: output/input %.4f, realtime x%.0f", speeds[i], double(nb_out)/double(rate*seconds), double(seconds)*1000.0/double(ms));
+    }
 }
 
 int main(int argc, char** argv)
@@ -46,6 +149,14 @@ int main(int argc, char** argv)
     }
 
     QCoreApplication app(argc, argv); //only used qapp to get parameter easily
+    if (app.arguments().contains(QLatin1String("-bench"))) {
+        bench();
+        return 0;
+    }
+    if (app.arguments().contains(QLatin1String("-stretch"))) {
+        benchStretch();
+        return 0;
+    }
     AudioOutput ao;
     int idx = app.arguments().indexOf(QLatin1String("-ao"));
     if (idx > 0)
@@ -0,0 +1,12 @@
+CONFIG -= app_bundle
+CONFIG += console
+TEMPLATE = app
+TARGET = audioscale
+
+PROJECTROOT = $$PWD/../..
+include($$PROJECTROOT/src/libQtAV.pri)
+preparePaths($$OUT_PWD/../../out)
+# av_force_cpu_flags() to select the kernels
+LIBS *= -L$$[QT_INSTALL_LIBS] -lavutil
+
+SOURCES += main.cpp
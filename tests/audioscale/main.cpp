@@ -0,0 +1,288 @@
+/******************************************************************************
+    QtAV:  Multimedia framework based on Qt and FFmpeg
+    Copyright (C) 2012-2017 Wang Bin <wbsecg1@gmail.com>
+
+*   This file is part of QtAV (from 2017)
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+******************************************************************************/
+
+#include <stdio.h>
+#include <string.h>
+#include <QtCore/QByteArray>
+#include <QtCore/QCoreApplication>
+#include <QtCore/QScopedPointer>
+#include <QtCore/QVector>
+#include <QtAV/AudioFormat.h>
+#include <QtAV/AudioResampler.h>
+#include "output/audio/AudioScale.h"
+extern "C" {
+#include <libavutil/cpu.h>
+#include <libavutil/samplefmt.h>
+}
+#include <QtDebug>
+
+/*
+ * Check the SIMD audio kernels against the c version. Output must be identical for every format,
+ * and for lengths not a multiple of the vector size to run the tail loops.
+ * Kernels are selected by av_force_cpu_flags(): no flag for the c version, sse2 only, and all flags of the cpu (avx2, neon).
+ * The sample format converters used by AudioFrame::to() must also be identical to libswresample.
+ */
+using namespace QtAV;
+
+struct CpuLevel {
+    const char* name;
+    int flags;
+};
+
+static const AudioFormat::SampleFormat kFormats[] = {
+    AudioFormat::SampleFormat_Unsigned8,
+    AudioFormat::SampleFormat_Signed16,
+    AudioFormat::SampleFormat_Signed32,
+    AudioFormat::SampleFormat_Float,
+    AudioFormat::SampleFormat_Double,
+    AudioFormat::SampleFormat_Unsigned8Planar,
+    AudioFormat::SampleFormat_Signed16Planar,
+    AudioFormat::SampleFormat_Signed32Planar,
+    AudioFormat::SampleFormat_FloatPlanar,
+    AudioFormat::SampleFormat_DoublePlanar
+};
+static const int kNbFormats = sizeof(kFormats)/sizeof(kFormats[0]);
+static const int kLengths[] = { 0, 1, 3, 7, 8, 15, 16, 17, 31, 33, 63, 65, 1023 };
+static const int kNbLengths = sizeof(kLengths)/sizeof(kLengths[0]);
+
+static int nb_checked = 0;
+static int nb_failed = 0;
+
+static const char* name(AudioFormat::SampleFormat fmt)
+{
+    return av_get_sample_fmt_name((AVSampleFormat)AudioFormat::sampleFormatToFFmpeg(fmt));
+}
+
+static QVector<CpuLevel> simdLevels()
+{
+    av_force_cpu_flags(-1);
+    const int cpu = av_get_cpu_flags();
+    QVector<CpuLevel> levels;
+    if (cpu & AV_CPU_FLAG_SSE2) {
+        const CpuLevel sse2 = { "sse2", cpu & (AV_CPU_FLAG_MMX | AV_CPU_FLAG_SSE | AV_CPU_FLAG_SSE2) };
+        levels.append(sse2);
+    }
+    if (cpu) {
+        const CpuLevel all = { "cpu", cpu };
+        levels.append(all);
+    }
+    return levels;
+}
+
+static quint32 rand_state = 1;
+static quint32 random32()
+{
+    rand_state = rand_state*1664525u + 1013904223u;
+    return rand_state;
+}
+
+// integer samples use all bits to hit saturation. float samples are in [-1.25, 1.25) to hit clipping of integer output
+static QByteArray randomSamples(AudioFormat::SampleFormat fmt, int nb_samples)
+{
+    QByteArray data(nb_samples*RawSampleSize(fmt), 0);
+    if (fmt == AudioFormat::SampleFormat_Float || fmt == AudioFormat::SampleFormat_FloatPlanar) {
+        float *d = (float*)data.data();
+        for (int i = 0; i < nb_samples; ++i)
+            d[i] = (float(random32() >> 8)/float(1<<23) - 1.0f)*1.25f;
+    } else if (fmt == AudioFormat::SampleFormat_Double || fmt == AudioFormat::SampleFormat_DoublePlanar) {
+        double *d = (double*)data.data();
+        for (int i = 0; i < nb_samples; ++i)
+            d[i] = (double(random32())/double(1U<<31) - 1.0)*1.25;
+    } else {
+        quint8 *d = (quint8*)data.data();
+        for (int i = 0; i < data.size(); ++i)
+            d[i] = quint8(random32() >> 24);
+    }
+    return data;
+}
+
+static void compare(const char* what, const CpuLevel& level, const QByteArray& ref, const QByteArray& out, int channels, int nb_samples, qreal vol)
+{
+    nb_checked++;
+    if (ref == out)
+        return;
+    int i = 0;
+    while (i < ref.size() && i < out.size() && ref.at(i) == out.at(i))
+        ++i;
+    nb_failed++;
+    qWarning("%s %s: channels %d, samples %d, volume %.2f. differs from c at byte %d", level.name, what, channels, nb_samples, vol, i);
+}
+
+static void checkScaler(const CpuLevel& level, AudioFormat::SampleFormat fmt, qreal vol)
+{
+    int voli = 0;
+    av_force_cpu_flags(0);
+    scale_samples_func c = get_scaler(fmt, vol, &voli);
+    av_force_cpu_flags(level.flags);
+    scale_samples_func simd = get_scaler(fmt, vol, &voli);
+    if (!c || c == simd)
+        return;
+    for (int i = 0; i < kNbLengths; ++i) {
+        const int n = kLengths[i];
+        const QByteArray src(randomSamples(fmt, n));
+        QByteArray ref(src.size(), 0);
+        c((quint8*)ref.data(), (const quint8*)src.constData(), n, voli, float(vol));
+        QByteArray out(src.size(), 0);
+        simd((quint8*)out.data(), (const quint8*)src.constData(), n, voli, float(vol));
+        compare(name(fmt), level, ref, out, 1, n, vol);
+        // in place
+        out = src;
+        out.detach();
+        simd((quint8*)out.data(), (const quint8*)out.constData(), n, voli, float(vol));
+        compare(name(fmt), level, ref, out, 1, n, vol);
+    }
+}
+
+static void checkConvertScaler(const CpuLevel& level, AudioFormat::SampleFormat in, AudioFormat::SampleFormat out, float vol)
+{
+    av_force_cpu_flags(0);
+    convert_scale_func c = get_convert_scaler(in, out);
+    av_force_cpu_flags(level.flags);
+    convert_scale_func simd = get_convert_scaler(in, out);
+    if (!c || c == simd)
+        return;
+    const QByteArray what = QByteArray(name(in)) + "=>" + name(out);
+    static const int kChannels[] = { 1, 2, 3, 6 };
+    for (int ch = 0; ch < 4; ++ch) {
+        const int channels = kChannels[ch];
+        for (int i = 0; i < kNbLengths; ++i) {
+            const int n = kLengths[i];
+            const int nb_planes = IsPlanar(in) ? channels : 1;
+            QVector<QByteArray> planes(nb_planes);
+            QVector<const quint8*> src(nb_planes);
+            for (int p = 0; p < nb_planes; ++p) {
+                planes[p] = randomSamples(in, n*channels/nb_planes);
+                src[p] = (const quint8*)planes[p].constData();
+            }
+            QByteArray ref(n*channels*RawSampleSize(out), 0);
+            c((quint8*)ref.data(), src.constData(), channels, n, vol);
+            QByteArray dst(ref.size(), 0);
+            simd((quint8*)dst.data(), src.constData(), channels, n, vol);
+            compare(what.constData(), level, ref, dst, channels, n, vol);
+        }
+    }
+}
+
+// planes of n samples per channel to packed
+static QByteArray toPacked(const QVector<QByteArray>& planes, int channels, int n, int bytes_per_sample)
+{
+    if (planes.size() == 1)
+        return planes.at(0);
+    QByteArray packed(n*channels*bytes_per_sample, 0);
+    for (int i = 0; i < n; ++i) {
+        for (int c = 0; c < channels; ++c)
+            memcpy(packed.data() + (i*channels + c)*bytes_per_sample, planes.at(c).constData() + i*bytes_per_sample, bytes_per_sample);
+    }
+    return packed;
+}
+
+// output of a sample converter in packed layout
+static QByteArray convertSamples(convert_samples_func cvt, AudioFormat::SampleFormat out, const QVector<const quint8*>& src, int channels, int n)
+{
+    const int nb_planes = IsPlanar(out) ? channels : 1;
+    QVector<QByteArray> planes(nb_planes);
+    QVector<quint8*> dst(nb_planes);
+    for (int p = 0; p < nb_planes; ++p) {
+        planes[p] = QByteArray(n*channels/nb_planes*RawSampleSize(out), 0);
+        dst[p] = (quint8*)planes[p].data();
+    }
+    cvt(dst.constData(), src.constData(), channels, n);
+    return toPacked(planes, channels, n, RawSampleSize(out));
+}
+
+static void checkSampleConverter(const QVector<CpuLevel>& levels, AudioFormat::SampleFormat in, AudioFormat::SampleFormat out)
+{
+    av_force_cpu_flags(0);
+    convert_samples_func c = get_sample_converter(in, out);
+    if (!c)
+        return;
+    const QByteArray what = QByteArray(name(in)) + "=>" + name(out);
+    const CpuLevel swr = { "swresample", 0 };
+    static const int kChannels[] = { 1, 2, 6 };
+    for (int ch = 0; ch < 3; ++ch) {
+        const int channels = kChannels[ch];
+        for (int i = 1; i < kNbLengths; ++i) {
+            const int n = kLengths[i];
+            const int nb_planes = IsPlanar(in) ? channels : 1;
+            QVector<QByteArray> planes(nb_planes);
+            QVector<const quint8*> src(nb_planes);
+            for (int p = 0; p < nb_planes; ++p) {
+                planes[p] = randomSamples(in, n*channels/nb_planes);
+                src[p] = (const quint8*)planes[p].constData();
+            }
+            av_force_cpu_flags(0);
+            const QByteArray ref(convertSamples(c, out, src, channels, n));
+            foreach (const CpuLevel& level, levels) {
+                av_force_cpu_flags(level.flags);
+                convert_samples_func simd = get_sample_converter(in, out);
+                if (simd && simd != c)
+                    compare(what.constData(), level, ref, convertSamples(simd, out, src, channels, n), channels, n, 1.0);
+            }
+            av_force_cpu_flags(-1);
+            // AudioResamplerFF outputs only 1 plane, compare with packed output
+            AudioFormat fin;
+            fin.setSampleFormat(in);
+            fin.setChannels(channels);
+            fin.setSampleRate(44100);
+            AudioFormat fout(fin);
+            fout.setSampleFormat(ToPacked(out));
+            QScopedPointer<AudioResampler> r(AudioResampler::create(AudioResamplerId_FF));
+            if (!r)
+                return;
+            r->setInAudioFormat(fin);
+            r->setOutAudioFormat(fout);
+            r->setInSampesPerChannel(n);
+            if (!r->convert(src.data())) {
+                nb_failed++;
+                qWarning("%s: swresample failed", what.constData());
+                continue;
+            }
+            compare(what.constData(), swr, r->outData(), ref, channels, n, 1.0);
+        }
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication a(argc, argv);
+    const QVector<CpuLevel> levels(simdLevels());
+    // 100 is out of the fixed point range of the SIMD integer kernels
+    static const qreal kVolumes[] = { 0, 0.3, 1.0, 1.7, 100.0 };
+    foreach (const CpuLevel& level, levels) {
+        for (int f = 0; f < kNbFormats; ++f) {
+            for (int v = 0; v < 5; ++v)
+                checkScaler(level, kFormats[f], kVolumes[v]);
+            if (IsPlanar(kFormats[f]))
+                continue;
+            for (int in = 0; in < kNbFormats; ++in) {
+                for (int v = 1; v < 4; ++v)
+                    checkConvertScaler(level, kFormats[in], kFormats[f], float(kVolumes[v]));
+            }
+        }
+    }
+    for (int in = 0; in < kNbFormats; ++in) {
+        for (int out = 0; out < kNbFormats; ++out)
+            checkSampleConverter(levels, kFormats[in], kFormats[out]);
+    }
+    av_force_cpu_flags(-1);
+    printf("%d kernel outputs checked, %d differ\n", nb_checked, nb_failed);
+    return nb_failed ? 1 : 0;
+}
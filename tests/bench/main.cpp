@@ -0,0 +1,440 @@
+/******************************************************************************
+    QtAV:  Multimedia framework based on Qt and FFmpeg
+    Copyright (C) 2012-2017 Wang Bin <wbsecg1@gmail.com>
+
+*   This file is part of QtAV (from 2017)
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+******************************************************************************/
+
+#include <algorithm>
+#include <QtCore/qmath.h>
+#include <QtCore/QCoreApplication>
+#include <QtCore/QDir>
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QEventLoop>
+#include <QtCore/QFile>
+#include <QtCore/QStringList>
+#include <QtCore/QTimer>
+#include <QtCore/QVector>
+#include <QtAV/AVDemuxer.h>
+#include <QtAV/AVMuxer.h>
+#include <QtAV/AVPlayer.h>
+#include <QtAV/AVTranscoder.h>
+#include <QtAV/AudioEncoder.h>
+#include <QtAV/AudioOutput.h>
+#include <QtAV/Packet.h>
+#include <QtAV/VideoDecoder.h>
+#include <QtAV/VideoEncoder.h>
+#include <QtAV/NullRenderer.h>
+#include <QtDebug>
+
+using namespace QtAV;
+
+static QString jsonString(const QString& s)
+{
+    QString e(s);
+    e.replace(QLatin1Char('\\'), QLatin1String("\\\\")).replace(QLatin1Char('"'), QLatin1String("\\\""));
+    return QLatin1Char('"') + e + QLatin1Char('"');
+}
+
+// per frame time of a scenario
+class Stats
+{
+public:
+    Stats(const QString& name) : m_name(name), m_last(0), m_dropped(-1) {}
+    QString name() const { return m_name;}
+    void setError(const QString& e) { m_error = e;}
+    QString error() const { return m_error;}
+    int frames() const { return m_samples.size();}
+    void addDropped(qint64 value) { m_dropped = qMax<qint64>(0, m_dropped) + value;}
+    void add(qint64 ns) { m_samples.append(ns);}
+    void start() {
+        m_timer.start();
+        m_last = 0;
+    }
+    // a frame is done
+    void lap() {
+        const qint64 now = m_timer.nsecsElapsed();
+        m_samples.append(now - m_last);
+        m_last = now;
+    }
+    // interval between frames. the 1st tick starts timing
+    void tick() {
+        if (!m_timer.isValid()) {
+            start();
+            return;
+        }
+        lap();
+    }
+    // a new run of the same scenario. ticks of previous run are not connected
+    void restart() { m_timer.invalidate();}
+    QString toJson() const {
+        QString json = QString::fromLatin1("{\"scenario\": %1, \"frames\": %2").arg(jsonString(m_name)).arg(m_samples.size());
+        if (!m_error.isEmpty())
+            json += QString::fromLatin1(", \"error\": %1").arg(jsonString(m_error));
+        if (m_dropped >= 0)
+            json += QString::fromLatin1(", \"dropped\": %1").arg(m_dropped);
+        if (!m_samples.isEmpty()) {
+            QVector<qint64> s(m_samples);
+            std::sort(s.begin(), s.end());
+            qint64 total = 0;
+            foreach (qint64 t, s) {
+                total += t;
+            }
+            const double seconds = double(total)/1e9;
+            json += QString::fromLatin1(", \"seconds\": %1, \"fps\": %2")
+                    .arg(seconds, 0, 'f', 3).arg(double(s.size())/qMax(seconds, 1e-9), 0, 'f', 1);
+            json += QString::fromLatin1(", \"latency_ms\": {\"min\": %1, \"median\": %2, \"p99\": %3, \"max\": %4, \"mean\": %5}")
+                    .arg(ms(s.first())).arg(ms(percentile(s, 50))).arg(ms(percentile(s, 99))).arg(ms(s.last()))
+                    .arg(double(total)/1e6/double(s.size()), 0, 'f', 3);
+        }
+        return json + QLatin1String("}");
+    }
+private:
+    // nearest rank of sorted samples
+    static qint64 percentile(const QVector<qint64>& sorted, int p) {
+        const int rank = qCeil(double(p)*double(sorted.size())/100.0);
+        return sorted.at(qBound(0, rank - 1, sorted.size() - 1));
+    }
+    static QString ms(qint64 ns) { return QString::number(double(ns)/1e6, 'f', 3);}
+
+    QString m_name;
+    QString m_error;
+    QElapsedTimer m_timer;
+    qint64 m_last;
+    qint64 m_dropped;
+    QVector<qint64> m_samples;
+};
+
+class EncodeObserver : public QObject
+{
+    Q_OBJECT
+public:
+    EncodeObserver(Stats *stats) : QObject(0), m_stats(stats) {}
+public Q_SLOTS:
+    void onVideoFrameEncoded() { m_stats->tick();}
+private:
+    Stats *m_stats;
+};
+
+// moving gradient yuv420p video and a sine wave, encoded by built-in ffmpeg encoders
+static bool generateMedia(const QString& file, int w, int h, int frames, qreal fps)
+{
+    VideoEncoder *venc = VideoEncoder::create("FFmpeg");
+    venc->setCodecName(QString::fromLatin1("mpeg4"));
+    venc->setBitRate(4*1024*1024);
+    venc->setWidth(w);
+    venc->setHeight(h);
+    venc->setFrameRate(fps);
+    venc->setPixelFormat(VideoFormat::Format_YUV420P);
+    AudioEncoder *aenc = AudioEncoder::create("FFmpeg");
+    aenc->setCodecName(QString::fromLatin1("mp2"));
+    aenc->setBitRate(128000);
+    AudioFormat af;
+    af.setSampleRate(44100);
+    af.setSampleFormat(AudioFormat::SampleFormat_Signed16);
+    af.setChannelLayout(AudioFormat::ChannelLayout_Stereo);
+    aenc->setAudioFormat(af);
+    AVMuxer mux;
+    mux.setMedia(file);
+    bool ok = venc->open() && aenc->open();
+    if (ok) {
+        mux.copyProperties(venc);
+        mux.copyProperties(aenc);
+        ok = mux.open();
+    }
+    if (!ok) {
+        qWarning("failed to create synthetic media %s", qPrintable(file));
+        delete venc;
+        delete aenc;
+        return false;
+    }
+    const VideoFormat vf(VideoFormat::Format_YUV420P);
+    QByteArray yuv(w*h*3/2, 0);
+    const int nb_samples = aenc->frameSize();
+    QByteArray pcm(nb_samples*af.bytesPerFrame(), 0);
+    qint64 samples = 0;
+    for (int i = 0; i < frames; ++i) {
+        const qreal t = qreal(i)/fps;
+        uchar *y = (uchar*)yuv.data();
+        for (int j = 0; j < h; ++j) {
+            for (int k = 0; k < w; ++k)
+                y[j*w + k] = uchar(k + j + 4*i);
+        }
+        memset(y + w*h, 128 + (i & 63), w*h/4);
+        memset(y + w*h*5/4, 192 - (i & 63), w*h/4);
+        VideoFrame frame(w, h, vf, yuv);
+        frame.setBits(y, 0);
+        frame.setBits(y + w*h, 1);
+        frame.setBits(y + w*h*5/4, 2);
+        frame.setBytesPerLine(w, 0);
+        frame.setBytesPerLine(w/2, 1);
+        frame.setBytesPerLine(w/2, 2);
+        frame.setTimestamp(t);
+        if (venc->encode(frame))
+            mux.writeVideo(venc->encoded());
+        while (qreal(samples)/qreal(af.sampleRate()) <= t) {
+            qint16 *s = (qint16*)pcm.data();
+            for (int k = 0; k < nb_samples; ++k)
+                s[2*k] = s[2*k+1] = qint16(8192.0*qSin(2.0*M_PI*440.0*qreal(samples + k)/qreal(af.sampleRate())));
+            AudioFrame aframe(af, pcm);
+            aframe.setTimestamp(qreal(samples)/qreal(af.sampleRate()));
+            if (aenc->encode(aframe))
+                mux.writeAudio(aenc->encoded());
+            samples += nb_samples;
+        }
+    }
+    while (venc->encode())
+        mux.writeVideo(venc->encoded());
+    while (aenc->encode())
+        mux.writeAudio(aenc->encoded());
+    venc->close();
+    aenc->close();
+    mux.close();
+    delete venc;
+    delete aenc;
+    return true;
+}
+
+static void benchDemux(const QString& file, Stats *stats)
+{
+    AVDemuxer demux;
+    demux.setMedia(file);
+    if (!demux.load()) {
+        stats->setError(QString::fromLatin1("load error"));
+        return;
+    }
+    stats->start();
+    while (!demux.atEnd()) {
+        if (demux.readFrame())
+            stats->lap();
+    }
+}
+
+static QVector<Packet> readVideoPackets(const QString& file, AVDemuxer *demux)
+{
+    QVector<Packet> packets;
+    demux->setMedia(file);
+    if (!demux->load())
+        return packets;
+    const int vstream = demux->videoStream();
+    while (!demux->atEnd()) {
+        if (!demux->readFrame())
+            continue;
+        if (demux->stream() != vstream)
+            continue;
+        packets.append(demux->packet());
+    }
+    packets.append(Packet::createEOF()); // drain
+    return packets;
+}
+
+// demuxing is excluded. convert: decoded frames are converted to rgb32 if it's valid
+static void benchDecode(const QString& file, const QString& decoder, VideoFormat::PixelFormat convert, Stats *stats)
+{
+    AVDemuxer demux;
+    const QVector<Packet> packets(readVideoPackets(file, &demux));
+    if (packets.size() <= 1) {
+        stats->setError(QString::fromLatin1("no video packet"));
+        return;
+    }
+    VideoDecoder *dec = VideoDecoder::create(decoder.toLatin1().constData());
+    if (!dec) {
+        stats->setError(QString::fromLatin1("decoder not found"));
+        return;
+    }
+    dec->setCodecContext(demux.videoCodecContext());
+    if (!dec->open()) {
+        stats->setError(QString::fromLatin1("decoder open error"));
+        delete dec;
+        return;
+    }
+    stats->start();
+    foreach (const Packet& pkt, packets) {
+        if (!dec->sendPacket(pkt))
+            continue;
+        while (dec->receiveFrame()) {
+            VideoFrame frame = dec->frame();
+            if (convert != VideoFormat::Format_Invalid)
+                frame = frame.to(convert);
+            if (!frame.isValid())
+                continue;
+            stats->lap();
+        }
+    }
+    dec->close();
+    delete dec;
+}
+
+static const int kPlayTimeout = 5*60*1000;
+
+// frames are decoded as fast as possible and sent to a renderer drawing nothing
+static void benchPlayer(const QString& file, Stats *stats)
+{
+    AVPlayer player;
+    NullRenderer renderer;
+    renderer.setMaxRecords(1 << 24);
+    player.setRenderer(&renderer);
+    player.audio()->setBackends(QStringList() << QString::fromLatin1("null"));
+    player.setFrameRate(10000.0);
+    QEventLoop loop;
+    QObject::connect(&player, SIGNAL(stopped()), &loop, SLOT(quit()));
+    QObject::connect(&player, SIGNAL(error(QtAV::AVError)), &loop, SLOT(quit()));
+    QTimer::singleShot(kPlayTimeout, &loop, SLOT(quit()));
+    player.play(file);
+    loop.exec();
+    player.stop();
+    // intervals between frames
+    const QVector<NullRenderer::FrameRecord> records(renderer.takeRecords());
+    for (int i = 1; i < records.size(); ++i)
+        stats->add((records.at(i).arrival - records.at(i-1).arrival)*1000LL);
+    stats->addDropped(renderer.framesDropped());
+}
+
+static void benchTranscode(const QString& file, const QString& codec, Stats *stats)
+{
+    stats->restart();
+    AVPlayer player;
+    player.setFile(file);
+    player.setFrameRate(10000.0); // as fast as possible
+    player.audio()->setBackends(QStringList() << QString::fromLatin1("null"));
+    player.setAudioStream(-1);
+    AVTranscoder avt;
+    avt.setMediaSource(&player);
+    avt.setOutputMedia(QDir::temp().filePath(QString::fromLatin1("qtav-bench-transcode.mkv")));
+    if (!avt.createVideoEncoder()) {
+        stats->setError(QString::fromLatin1("failed to create video encoder"));
+        return;
+    }
+    avt.videoEncoder()->setCodecName(codec);
+    avt.videoEncoder()->setBitRate(4*1024*1024);
+    EncodeObserver observer(stats);
+    QObject::connect(&avt, SIGNAL(videoFrameEncoded(qreal)), &observer, SLOT(onVideoFrameEncoded()), Qt::DirectConnection);
+    QEventLoop loop;
+    QObject::connect(&avt, SIGNAL(stopped()), &loop, SLOT(quit()));
+    QObject::connect(&player, SIGNAL(error(QtAV::AVError)), &loop, SLOT(quit()));
+    QTimer::singleShot(kPlayTimeout, &loop, SLOT(quit()));
+    avt.start();
+    player.play();
+    loop.exec();
+    player.stop();
+    QFile::remove(avt.outputFile());
+}
+
+static QString argValue(const QStringList& args, const char* name, const QString& defaultValue)
+{
+    const int i = args.indexOf(QLatin1String(name));
+    if (i < 0 || i + 1 >= args.size())
+        return defaultValue;
+    return args.at(i + 1);
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication a(argc, argv);
+    const QStringList args(a.arguments());
+    if (args.contains(QLatin1String("-h"))) {
+        qDebug("./bench [-f file] [-size 640x360] [-frames 300] [-fps 25] [-runs 1] [-s demux,decode,convert,player,transcode] [-vd FFmpeg,...] [-c:v mpeg4] [-o result.json]");
+        qDebug("-f: media file to test. default is synthetic media generated at runtime (mpeg4 + mp2 in mkv)");
+        qDebug("-size, -frames, -fps: synthetic media parameters");
+        qDebug("-runs: run each scenario n times. per frame latencies of all runs are merged");
+        qDebug("-s: scenarios to run. default is all");
+        qDebug("-vd: video decoders for decode and convert scenarios");
+        qDebug("-c:v: video encoder codec for transcode scenario");
+        qDebug("-o: also write json result to the file");
+        qDebug("-trace: record pipeline events and save as chrome trace json to the file");
+        qDebug("json result is printed to stdout. time unit of latency is ms");
+        return 0;
+    }
+    QString file = argValue(args, "-f", QString());
+    const QStringList size(argValue(args, "-size", QString::fromLatin1("640x360")).split(QLatin1Char('x')));
+    const int w = size.first().toInt() & ~1;
+    const int h = size.last().toInt() & ~1;
+    const int frames = argValue(args, "-frames", QString::fromLatin1("300")).toInt();
+    const qreal fps = argValue(args, "-fps", QString::fromLatin1("25")).toDouble();
+    const int runs = qMax(1, argValue(args, "-runs", QString::fromLatin1("1")).toInt());
+    const QStringList scenarios(argValue(args, "-s", QString::fromLatin1("demux,decode,convert,player,transcode")).split(QLatin1Char(',')));
+    const QStringList decoders(argValue(args, "-vd", QString::fromLatin1("FFmpeg")).split(QLatin1Char(',')));
+    const QString codec(argValue(args, "-c:v", QString::fromLatin1("mpeg4")));
+    const QString out(argValue(args, "-o", QString()));
+    const QString trace(argValue(args, "-trace", QString()));
+    if (!trace.isEmpty())
+        setTraceEnabled(true);
+    const bool synthetic = file.isEmpty();
+    if (synthetic) {
+        file = QDir::temp().filePath(QString::fromLatin1("qtav-bench-%1.mkv").arg(QCoreApplication::applicationPid()));
+        if (!generateMedia(file, w, h, frames, fps))
+            return 1;
+    }
+    QList<Stats*> results;
+    if (scenarios.contains(QLatin1String("demux"))) {
+        results.append(new Stats(QString::fromLatin1("demux")));
+        for (int i = 0; i < runs; ++i)
+            benchDemux(file, results.last());
+    }
+    foreach (const QString& dec, decoders) {
+        if (scenarios.contains(QLatin1String("decode"))) {
+            results.append(new Stats(QString::fromLatin1("decode:%1").arg(dec)));
+            for (int i = 0; i < runs; ++i)
+                benchDecode(file, dec, VideoFormat::Format_Invalid, results.last());
+        }
+        if (scenarios.contains(QLatin1String("convert"))) {
+            results.append(new Stats(QString::fromLatin1("decode+convert:%1:rgb32").arg(dec)));
+            for (int i = 0; i < runs; ++i)
+                benchDecode(file, dec, VideoFormat::Format_RGB32, results.last());
+        }
+    }
+    if (scenarios.contains(QLatin1String("player"))) {
+        results.append(new Stats(QString::fromLatin1("player")));
+        for (int i = 0; i < runs; ++i)
+            benchPlayer(file, results.last());
+    }
+    if (scenarios.contains(QLatin1String("transcode"))) {
+        results.append(new Stats(QString::fromLatin1("transcode:%1").arg(codec)));
+        for (int i = 0; i < runs; ++i)
+            benchTranscode(file, codec, results.last());
+    }
+    if (synthetic)
+        QFile::remove(file);
+    if (!trace.isEmpty() && !saveTrace(trace))
+        qWarning("failed to write %s", qPrintable(trace));
+
+    QString json = QString::fromLatin1("{\n\"qtav\": %1,\n\"media\": {\"file\": %2, \"synthetic\": %3")
+            .arg(jsonString(QtAV_Version_String())).arg(jsonString(synthetic ? QString() : file)).arg(QLatin1String(synthetic ? "true" : "false"));
+    if (synthetic)
+        json += QString::fromLatin1(", \"width\": %1, \"height\": %2, \"frames\": %3, \"fps\": %4").arg(w).arg(h).arg(frames).arg(fps);
+    json += QString::fromLatin1("},\n\"runs\": %1,\n\"results\": [\n").arg(runs);
+    int failed = 0;
+    for (int i = 0; i < results.size(); ++i) {
+        json += results.at(i)->toJson() + QLatin1String(i + 1 < results.size() ? ",\n" : "\n");
+        if (!results.at(i)->error().isEmpty() || results.at(i)->frames() == 0)
+            ++failed;
+    }
+    json += QLatin1String("]\n}\n");
+    qDeleteAll(results);
+    printf("%s", json.toUtf8().constData());
+    fflush(stdout);
+    if (!out.isEmpty()) {
+        QFile f(out);
+        if (f.open(QIODevice::WriteOnly | QIODevice::Truncate))
+            f.write(json.toUtf8());
+        else
+            qWarning("failed to write %s", qPrintable(out));
+    }
+    return failed;
+}
+
+#include "main.moc"
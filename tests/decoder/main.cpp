@@ -59,13 +59,22 @@ int main(int argc, char *argv[])
     int vstream = demux.videoStream();
     QQueue<qint64> t;
     qint64 t0 = QDateTime::currentMSecsSinceEpoch();
-    while (!demux.atEnd()) {
-        if (!demux.readFrame())
-            continue;
-        if (demux.stream() != vstream)
+    bool eof = false;
+    while (!eof) {
+        Packet pkt;
+        if (demux.atEnd()) {
+            pkt = Packet::createEOF(); // drain
+            eof = true;
+        } else {
+            if (!demux.readFrame())
+                continue;
+            if (demux.stream() != vstream)
+                continue;
+            pkt = demux.packet();
+        }
+        if (!dec->sendPacket(pkt))
             continue;
-        const Packet pkt = demux.packet();
-        if (dec->decode(pkt)) {
+        while (dec->receiveFrame()) {
             VideoFrame frame = dec->frame(); // why is faster to call frame() for hwdec? no frame() is very slow for VDA
             Q_UNUSED(frame);
             count++;
@@ -77,5 +86,6 @@ int main(int argc, char *argv[])
                 t.dequeue();
         }
     }
+    qDebug() << "packet pool:" << demux.packetPoolStatistics();
     return 0;
 }
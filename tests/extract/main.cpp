@@ -19,11 +19,13 @@
 ******************************************************************************/
 
 #include <QtAV/VideoFrameExtractor.h>
+#include <QtAV/AVDemuxer.h>
 #include <QApplication>
 #include <QWidget>
 #include <QtAVWidgets>
 #include <QtDebug>
 #include <QtCore/QElapsedTimer>
+#include <QtCore/QThread>
 #include <QtCore/QTimer>
 
 using namespace QtAV;
@@ -86,12 +88,79 @@ private:
     QElapsedTimer timer;
 };
 
+class FrameCounter : public QObject
+{
+    Q_OBJECT
+public:
+    FrameCounter() : count(0) {}
+    int count;
+public Q_SLOTS:
+    void onFrameExtracted(const QtAV::VideoFrame& frame) {
+        if (frame.isValid())
+            ++count;
+    }
+};
+
+// n thumbnails evenly distributed in the video: extract() one by one vs extractBatch()
+int benchBatch(const QString& file, int n)
+{
+    AVDemuxer demuxer;
+    demuxer.setMedia(file);
+    if (!demuxer.load() || demuxer.duration() <= 0) {
+        qWarning("failed to load %s", qPrintable(file));
+        return -1;
+    }
+    const qint64 duration = demuxer.duration();
+    demuxer.unload();
+    QList<qint64> positions;
+    for (int i = 0; i < n; ++i)
+        positions.append(duration*i/n);
+    const QSize tile(160, 90);
+    QElapsedTimer timer;
+    {
+        VideoFrameExtractor extractor;
+        FrameCounter counter;
+        QObject::connect(&extractor, SIGNAL(frameExtracted(QtAV::VideoFrame)), &counter, SLOT(onFrameExtracted(QtAV::VideoFrame)));
+        extractor.setAsync(false);
+        extractor.setAutoExtract(false);
+        extractor.setSource(file);
+        timer.start();
+        foreach (qint64 t, positions) {
+            extractor.setPosition(t);
+            extractor.extract();
+        }
+        const qint64 ms = qMax<qint64>(1, timer.elapsed());
+        qDebug("extract() x%d: %d frames, %lldms, %.1f frames/s", n, counter.count, ms, qreal(counter.count)*1000.0/qreal(ms));
+    }
+    const char* names[] = { "keyframe", "fast", "exact" };
+    const int threads[] = { 1, QThread::idealThreadCount() };
+    VideoFrameExtractor extractor;
+    extractor.setSource(file);
+    for (int p = VideoFrameExtractor::KeyFramePrecision; p <= VideoFrameExtractor::ExactPrecision; ++p) {
+        for (int k = 0; k < 2; ++k) {
+            timer.restart();
+            const QList<VideoFrame> frames = extractor.extractBatch(positions, VideoFrameExtractor::BatchPrecision(p), tile, threads[k]);
+            const qint64 ms = qMax<qint64>(1, timer.elapsed());
+            int valid = 0;
+            foreach (const VideoFrame& f, frames) {
+                if (f.isValid())
+                    ++valid;
+            }
+            qDebug("extractBatch(%s, %d threads): %d frames, %lldms, %.1f frames/s", names[p], threads[k], valid, ms, qreal(valid)*1000.0/qreal(ms));
+            if (k == 1)
+                VideoFrameExtractor::spriteSheet(frames, 10, tile).save(QString::fromLatin1("sprite_%1.jpg").arg(QString::fromLatin1(names[p])));
+        }
+    }
+    return 0;
+}
+
 int main(int argc, char** argv)
 {
     QApplication a(argc, argv);
     int idx = a.arguments().indexOf(QLatin1String("-f"));
     if (idx < 0) {
         qDebug("-f file -t sec -n count -asyc");
+        qDebug("-f file -n count -batch: benchmark extracting count thumbnails");
         return -1;
     }
     QString file = a.arguments().at(idx+1);
@@ -104,6 +173,8 @@ int main(int argc, char** argv)
     if (idx > 0)
         n = a.arguments().at(idx+1).toInt();
     bool async = a.arguments().contains(QString::fromLatin1("-async"));
+    if (a.arguments().contains(QString::fromLatin1("-batch")))
+        return benchBatch(file, n > 1 ? n : 100);
 
 
     VideoFrameObserver obs;
@@ -0,0 +1,427 @@
+/******************************************************************************
+    QtAV:  Multimedia framework based on Qt and FFmpeg
+    Copyright (C) 2012-2017 Wang Bin <wbsecg1@gmail.com>
+
+*   This file is part of QtAV (from 2017)
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+******************************************************************************/
+
+#include <string.h>
+#include <QtCore/QCoreApplication>
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QStringList>
+#include <QtCore/QThread>
+#include <QtCore/QVector>
+#include <QtGui/QImage>
+#include <QtAV/VideoFormat.h>
+#include <QtAV/VideoFrame.h>
+#include "ImageConverter.h"
+#include "subtitle/BlendASS.h"
+extern "C" {
+#include <libavutil/cpu.h>
+}
+#include <QtDebug>
+
+using namespace QtAV;
+
+// frames per second of conversion from in to out
+static double bench(ImageConverter *conv, ImageConverter *src, int loops)
+{
+    const QVector<quint8*> planes(src->outPlanes());
+    const QVector<int> pitches(src->outLineSizes());
+    if (!conv->convert(planes.constData(), pitches.constData())) // warm up and allocate
+        return 0;
+    QElapsedTimer timer;
+    timer.start();
+    for (int i = 0; i < loops; ++i)
+        conv->convert(planes.constData(), pitches.constData());
+    return double(loops)*1000.0/double(qMax<qint64>(1, timer.elapsed()));
+}
+
+static void setup(ImageConverter *conv, VideoFormat::PixelFormat in, const QSize& inSize, VideoFormat::PixelFormat out, const QSize& outSize, ImageConverter::ScaleFilter filter)
+{
+    conv->setInFormat(in);
+    conv->setInSize(inSize.width(), inSize.height());
+    conv->setOutFormat(out);
+    conv->setOutSize(outSize.width(), outSize.height());
+    conv->setScaleFilter(filter);
+}
+
+// rows of all planes of the last converted frames are the same
+static bool sameOutput(ImageConverter *a, ImageConverter *b, VideoFormat::PixelFormat fmt, const QSize& size)
+{
+    const VideoFormat f(fmt);
+    for (int p = 0; p < f.planeCount(); ++p) {
+        const int bytes = f.bytesPerLine(size.width(), p);
+        for (int y = 0; y < f.height(size.height(), p); ++y) {
+            if (memcmp(a->outPlanes().at(p) + y*a->outLineSizes().at(p), b->outPlanes().at(p) + y*b->outLineSizes().at(p), bytes))
+                return false;
+        }
+    }
+    return true;
+}
+
+static QImage gradient(const QSize& size)
+{
+    QImage img(size, QImage::Format_RGB32);
+    for (int y = 0; y < img.height(); ++y) {
+        QRgb *line = (QRgb*)img.scanLine(y);
+        for (int x = 0; x < img.width(); ++x)
+            line[x] = qRgb(x & 0xff, y & 0xff, (x + y) & 0xff);
+    }
+    return img;
+}
+
+// ImageConverterYUV vs swscale: max difference of rgb values and fps
+static int testYUV(int loops)
+{
+    const char* ins[] = { "yuv420p", "yuv422p", "yuvj420p", "nv12", "nv21", "p010le" };
+    const char* outs[] = { "bgra", "rgba" };
+    const ColorSpace spaces[] = { ColorSpace_BT601, ColorSpace_BT709, ColorSpace_BT2020 };
+    const char* space_names[] = { "bt601", "bt709", "bt2020" };
+    const ColorRange ranges[] = { ColorRange_Limited, ColorRange_Full };
+    const char* range_names[] = { "limited", "full" };
+    // odd size and width not aligned to simd width for correctness
+    const QSize sizes[] = { QSize(637, 359), QSize(1920, 1080), QSize(3840, 2160) };
+    const int kMaxDiff = 3; // rounding and chroma center (127.5 in ColorTransform, 128 in swscale)
+    int failed = 0;
+    for (size_t s = 0; s < sizeof(sizes)/sizeof(sizes[0]); ++s) {
+        const QSize size(sizes[s]);
+        const QImage img(gradient(size));
+        const quint8 *bits[] = { img.constBits(), 0, 0, 0 };
+        const int pitches[] = { img.bytesPerLine(), 0, 0, 0 };
+        for (size_t i = 0; i < sizeof(ins)/sizeof(ins[0]); ++i) {
+            const VideoFormat in(QString::fromLatin1(ins[i]));
+            if (!in.isValid() || !ImageConverterYUV::isSupported(in.pixelFormatFFmpeg(), VideoFormat(QString::fromLatin1("bgra")).pixelFormatFFmpeg())) {
+                qDebug("%s is not supported", ins[i]);
+                continue;
+            }
+            ImageConverterFF src;
+            src.setInFormat(VideoFormat::Format_RGB32);
+            src.setInSize(size.width(), size.height());
+            src.setOutFormat(in.pixelFormatFFmpeg());
+            src.setOutSize(size.width(), size.height());
+            if (!src.convert(bits, pitches)) {
+                qWarning("failed to prepare input");
+                continue;
+            }
+            for (size_t o = 0; o < sizeof(outs)/sizeof(outs[0]); ++o) {
+                const VideoFormat out(QString::fromLatin1(outs[o]));
+                for (size_t c = 0; c < sizeof(spaces)/sizeof(spaces[0]); ++c) {
+                    for (size_t r = 0; r < sizeof(ranges)/sizeof(ranges[0]); ++r) {
+                        if (s > 0 && (o > 0 || c > 0 || r > 0)) // benchmark only
+                            continue;
+                        ImageConverterFF ff;
+                        ImageConverterYUV yuv;
+                        ImageConverter *convs[] = { &ff, &yuv };
+                        for (int k = 0; k < 2; ++k) {
+                            convs[k]->setInFormat(in.pixelFormatFFmpeg());
+                            convs[k]->setInSize(size.width(), size.height());
+                            convs[k]->setOutFormat(out.pixelFormatFFmpeg());
+                            convs[k]->setOutSize(size.width(), size.height());
+                            convs[k]->setInRange(ranges[r]);
+                            convs[k]->setInColorSpace(spaces[c]);
+                        }
+                        const double fps0 = bench(&ff, &src, s == 0 ? 1 : loops);
+                        const double fps1 = bench(&yuv, &src, s == 0 ? 1 : loops);
+                        int max_diff = 0;
+                        for (int y = 0; y < size.height(); ++y) {
+                            const quint8 *a = ff.outPlanes().at(0) + y*ff.outLineSizes().at(0);
+                            const quint8 *b = yuv.outPlanes().at(0) + y*yuv.outLineSizes().at(0);
+                            for (int x = 0; x < size.width()*4; ++x)
+                                max_diff = qMax(max_diff, qAbs(int(a[x]) - int(b[x])));
+                        }
+                        if (max_diff > kMaxDiff)
+                            ++failed;
+                        if (s == 0) {
+                            qDebug("%dx%d %s=>%s %s %s: max diff %d %s", size.width(), size.height(), ins[i], outs[o]
+                                   , space_names[c], range_names[r], max_diff, max_diff > kMaxDiff ? "FAIL" : "ok");
+                        } else {
+                            qDebug("%dx%d %s=>%s: FFmpeg %.1f fps, YUV %.1f fps (x%.2f). max diff %d %s", size.width(), size.height(), ins[i], outs[o]
+                                   , fps0, fps1, fps0 > 0 ? fps1/fps0 : 0.0, max_diff, max_diff > kMaxDiff ? "FAIL" : "ok");
+                        }
+                    }
+                }
+            }
+        }
+    }
+    qDebug("YUV converter: %d failed", failed);
+    return failed;
+}
+
+/*
+ * SIMD kernels must give the same output as the c version: yuv to rgb rows used by ImageConverterYUV, and ass blending.
+ * Kernels are selected by av_force_cpu_flags(): no flag for the c version, sse2 only, and all flags of the cpu (avx2, neon).
+ */
+struct CpuLevel {
+    const char* name;
+    int flags;
+};
+
+static QVector<CpuLevel> simdLevels()
+{
+    av_force_cpu_flags(-1);
+    const int cpu = av_get_cpu_flags();
+    QVector<CpuLevel> levels;
+    if (cpu & AV_CPU_FLAG_SSE2) {
+        const CpuLevel sse2 = { "sse2", cpu & (AV_CPU_FLAG_MMX | AV_CPU_FLAG_SSE | AV_CPU_FLAG_SSE2) };
+        levels.append(sse2);
+    }
+    if (cpu) {
+        const CpuLevel all = { "cpu", cpu };
+        levels.append(all);
+    }
+    return levels;
+}
+
+static quint32 rand_state = 1;
+static quint32 random32()
+{
+    rand_state = rand_state*1664525u + 1013904223u;
+    return rand_state;
+}
+
+static void setupYUV(ImageConverter *conv, const VideoFormat& in, const VideoFormat& out, const QSize& size, ColorSpace cs, ColorRange range)
+{
+    conv->setInFormat(in.pixelFormatFFmpeg());
+    conv->setInSize(size.width(), size.height());
+    conv->setOutFormat(out.pixelFormatFFmpeg());
+    conv->setOutSize(size.width(), size.height());
+    conv->setInRange(range);
+    conv->setInColorSpace(cs);
+}
+
+static int testSIMD()
+{
+    const QVector<CpuLevel> levels(simdLevels());
+    const char* ins[] = { "yuv420p", "yuv422p", "nv12", "nv21", "p010le" };
+    const char* outs[] = { "bgra", "rgba" };
+    const ColorSpace spaces[] = { ColorSpace_BT601, ColorSpace_BT709, ColorSpace_BT2020 };
+    const ColorRange ranges[] = { ColorRange_Limited, ColorRange_Full };
+    // width is not a multiple of simd width to run the tail loops
+    const QSize size(637, 359);
+    const QImage img(gradient(size));
+    const quint8 *bits[] = { img.constBits(), 0, 0, 0 };
+    const int pitches[] = { img.bytesPerLine(), 0, 0, 0 };
+    int checked = 0;
+    int failed = 0;
+    for (size_t i = 0; i < sizeof(ins)/sizeof(ins[0]); ++i) {
+        const VideoFormat in(QString::fromLatin1(ins[i]));
+        if (!in.isValid())
+            continue;
+        ImageConverterFF src;
+        setup(&src, VideoFormat::Format_RGB32, size, in.pixelFormat(), size, ImageConverter::ScaleFilter_Auto);
+        if (!src.convert(bits, pitches)) {
+            qWarning("failed to prepare input");
+            continue;
+        }
+        const QVector<quint8*> planes(src.outPlanes());
+        const QVector<int> lines(src.outLineSizes());
+        for (size_t o = 0; o < sizeof(outs)/sizeof(outs[0]); ++o) {
+            const VideoFormat out(QString::fromLatin1(outs[o]));
+            for (size_t c = 0; c < sizeof(spaces)/sizeof(spaces[0]); ++c) {
+                for (size_t r = 0; r < sizeof(ranges)/sizeof(ranges[0]); ++r) {
+                    // kernels are selected when the converter is prepared in convert()
+                    av_force_cpu_flags(0);
+                    ImageConverterYUV ref;
+                    setupYUV(&ref, in, out, size, spaces[c], ranges[r]);
+                    if (!ref.convert(planes.constData(), lines.constData()))
+                        continue;
+                    foreach (const CpuLevel& level, levels) {
+                        av_force_cpu_flags(level.flags);
+                        ImageConverterYUV yuv;
+                        setupYUV(&yuv, in, out, size, spaces[c], ranges[r]);
+                        checked++;
+                        if (yuv.convert(planes.constData(), lines.constData()) && sameOutput(&ref, &yuv, out.pixelFormat(), size))
+                            continue;
+                        failed++;
+                        qWarning("%s yuv2rgb %s=>%s %d %d: differs from c", level.name, ins[i], outs[o], spaces[c], ranges[r]);
+                    }
+                }
+            }
+        }
+    }
+    // dst alpha 0 and coverage 0, 255 are special cases
+    const quint32 colors[] = { 0xff00ff80, 0x80123456, 0x01fedcba, 0xffffffff };
+    for (int w = 1; w <= 67; ++w) {
+        QVector<quint8> src(w);
+        QVector<quint32> dst(w);
+        for (int x = 0; x < w; ++x) {
+            const quint32 v = random32();
+            src[x] = (v & 3) == 0 ? 0 : ((v & 3) == 1 ? 255 : quint8(v >> 24));
+            dst[x] = (v & 0x30) == 0 ? 0 : random32();
+        }
+        for (size_t c = 0; c < sizeof(colors)/sizeof(colors[0]); ++c) {
+            QVector<quint32> ref(dst);
+            blend_ass_row_c(ref.data(), src.constData(), w, colors[c]);
+            foreach (const CpuLevel& level, levels) {
+                av_force_cpu_flags(level.flags);
+                QVector<quint32> out(dst);
+                get_blend_ass_row()(out.data(), src.constData(), w, colors[c]);
+                checked++;
+                if (out == ref)
+                    continue;
+                failed++;
+                qWarning("%s blend ass: width %d, color %#x differs from c", level.name, w, colors[c]);
+            }
+        }
+    }
+    av_force_cpu_flags(-1);
+    qDebug("SIMD kernels: %d outputs checked, %d differ", checked, failed);
+    return failed;
+}
+
+// VideoFrame::to() with cached converters and pooled buffers: results must equal a new converter, and converters/buffers must be reused
+static int testCache(int loops)
+{
+    const QSize size(1920, 1080);
+    const VideoFrame src(VideoFrame(gradient(size)).to(VideoFormat::Format_YUV420P));
+    if (!src) {
+        qWarning("failed to prepare input");
+        return 1;
+    }
+    ImageConverterYUV conv;
+    setup(&conv, VideoFormat::Format_YUV420P, size, VideoFormat::Format_RGB32, size, ImageConverter::ScaleFilter_Auto);
+    conv.setInRange(src.colorRange());
+    conv.setInColorSpace(src.colorSpace());
+    QVector<const quint8*> planes(src.planeCount());
+    QVector<int> pitches(src.planeCount());
+    for (int i = 0; i < src.planeCount(); ++i) {
+        planes[i] = src.constBits(i);
+        pitches[i] = src.bytesPerLine(i);
+    }
+    QElapsedTimer timer;
+    timer.start();
+    for (int i = 0; i < loops; ++i)
+        conv.convert(planes.constData(), pitches.constData());
+    const double fps0 = double(loops)*1000.0/double(qMax<qint64>(1, timer.elapsed()));
+    const QVariantHash st0(VideoFrame::cacheStatistics());
+    int failed = 0;
+    timer.restart();
+    for (int i = 0; i < loops; ++i) {
+        const VideoFrame f(src.to(VideoFormat::Format_RGB32));
+        if (i > 0)
+            continue;
+        for (int y = 0; y < size.height(); ++y) {
+            if (memcmp(f.constBits(0) + y*f.bytesPerLine(0), conv.outPlanes().at(0) + y*conv.outLineSizes().at(0), size.width()*4)) {
+                ++failed;
+                break;
+            }
+        }
+    }
+    const double fps1 = double(loops)*1000.0/double(qMax<qint64>(1, timer.elapsed()));
+    const QVariantHash st(VideoFrame::cacheStatistics());
+    const qint64 converter_misses = st.value(QStringLiteral("converterMisses")).toLongLong() - st0.value(QStringLiteral("converterMisses")).toLongLong();
+    const qint64 buffer_misses = st.value(QStringLiteral("bufferMisses")).toLongLong() - st0.value(QStringLiteral("bufferMisses")).toLongLong();
+    if (converter_misses > 1 || buffer_misses > 1) // only the 1st conversion allocates
+        ++failed;
+    qDebug("%dx%d yuv420p=>bgra: converter %.1f fps, VideoFrame::to() %.1f fps. converter misses %lld, buffer misses %lld in %d loops %s"
+           , size.width(), size.height(), fps0, fps1, converter_misses, buffer_misses, loops, failed ? "FAIL" : "ok");
+    // clone() of a frame on external memory copies to a pooled buffer
+    const QImage img(gradient(size));
+    const VideoFrame ext(img);
+    for (int i = 0; i < loops; ++i) {
+        const VideoFrame c(ext.clone());
+        if (i == 0 && memcmp(c.constBits(0), img.constBits(), img.byteCount())) // same line sizes
+            ++failed;
+    }
+    const qint64 clone_misses = VideoFrame::cacheStatistics().value(QStringLiteral("bufferMisses")).toLongLong() - st.value(QStringLiteral("bufferMisses")).toLongLong();
+    if (clone_misses > 1)
+        ++failed;
+    // high-water mark: no free buffer is kept
+    const qint64 pool_size = frameBufferPoolSize();
+    setFrameBufferPoolSize(0);
+    const int free_buffers = VideoFrame::cacheStatistics().value(QStringLiteral("freeBuffers")).toInt();
+    setFrameBufferPoolSize(pool_size);
+    if (free_buffers > 0)
+        ++failed;
+    qDebug("clone: buffer misses %lld in %d loops. free buffers with pool size 0: %d %s", clone_misses, loops, free_buffers, failed ? "FAIL" : "ok");
+    qDebug() << "cache statistics:" << st;
+    return failed;
+}
+
+int main(int argc, char** argv)
+{
+    QCoreApplication app(argc, argv);
+    qDebug("parameters: [-loops n] [-threads n] [-yuv] [-cache]. Compare FFmpeg (1 thread) and FFmpegSlice converters, the output must be the same. -yuv: compare FFmpeg and YUV converters, and SIMD kernels with the c version. -cache: VideoFrame::to() with cached converters and buffers");
+    int loops = 20;
+    int idx = app.arguments().indexOf(QLatin1String("-loops"));
+    if (idx > 0)
+        loops = app.arguments().at(idx + 1).toInt();
+    if (app.arguments().contains(QLatin1String("-yuv")))
+        return testYUV(loops) + testSIMD() ? 1 : 0;
+    if (app.arguments().contains(QLatin1String("-cache")))
+        return testCache(loops) ? 1 : 0;
+    int threads = QThread::idealThreadCount();
+    idx = app.arguments().indexOf(QLatin1String("-threads"));
+    if (idx > 0)
+        threads = app.arguments().at(idx + 1).toInt();
+    const QSize sizes[] = { QSize(1920, 1080), QSize(3840, 2160), QSize(7680, 4320) };
+    struct {
+        VideoFormat::PixelFormat in, out;
+        int scale; // 0: no scale, 1: half size, 2: half width
+        ImageConverter::ScaleFilter filter;
+    } cases[] = {
+        { VideoFormat::Format_YUV420P, VideoFormat::Format_RGB32, 0, ImageConverter::ScaleFilter_Auto },
+        { VideoFormat::Format_NV12, VideoFormat::Format_RGB32, 0, ImageConverter::ScaleFilter_Auto },
+        { VideoFormat::Format_YUV422P, VideoFormat::Format_RGB32, 0, ImageConverter::ScaleFilter_Auto },
+        { VideoFormat::Format_RGB32, VideoFormat::Format_YUV420P, 0, ImageConverter::ScaleFilter_Auto },
+        { VideoFormat::Format_YUV420P, VideoFormat::Format_RGB32, 1, ImageConverter::ScaleFilter_FastBilinear },
+        { VideoFormat::Format_YUV420P, VideoFormat::Format_RGB32, 1, ImageConverter::ScaleFilter_Bicubic },
+        // chroma is interpolated vertically
+        { VideoFormat::Format_YUV420P, VideoFormat::Format_RGB32, 2, ImageConverter::ScaleFilter_Bicubic },
+        { VideoFormat::Format_YUV420P, VideoFormat::Format_YUV420P, 2, ImageConverter::ScaleFilter_Bicubic },
+        { VideoFormat::Format_YUV420P, VideoFormat::Format_YUV422P, 2, ImageConverter::ScaleFilter_Lanczos },
+    };
+    int failed = 0;
+    const char* filters[] = { "auto", "point", "fast_bilinear", "bilinear", "bicubic", "lanczos" };
+    for (size_t s = 0; s < sizeof(sizes)/sizeof(sizes[0]); ++s) {
+        const QSize size(sizes[s]);
+        // source image: a gradient converted to input format
+        const QImage img(gradient(size));
+        for (size_t c = 0; c < sizeof(cases)/sizeof(cases[0]); ++c) {
+            ImageConverterFF src;
+            setup(&src, VideoFormat::Format_RGB32, size, cases[c].in, size, ImageConverter::ScaleFilter_Auto);
+            const quint8 *bits[] = { img.constBits(), 0, 0, 0 };
+            const int pitches[] = { img.bytesPerLine(), 0, 0, 0 };
+            if (!src.convert(bits, pitches)) {
+                qWarning("failed to prepare input");
+                continue;
+            }
+            QSize out_size(size);
+            if (cases[c].scale > 0)
+                out_size.setWidth(size.width()/2);
+            if (cases[c].scale == 1)
+                out_size.setHeight(size.height()/2);
+            ImageConverterFF ff;
+            setup(&ff, cases[c].in, size, cases[c].out, out_size, cases[c].filter);
+            ImageConverterFFSlice slice;
+            setup(&slice, cases[c].in, size, cases[c].out, out_size, cases[c].filter);
+            slice.setThreads(threads);
+            const double fps0 = bench(&ff, &src, loops);
+            const double fps1 = bench(&slice, &src, loops);
+            const bool same = fps0 > 0 && fps1 > 0 && sameOutput(&ff, &slice, cases[c].out, out_size);
+            if (!same)
+                ++failed;
+            qDebug("%dx%d %s=>%s %dx%d %s: FFmpeg %.1f fps, FFmpegSlice(%d threads) %.1f fps (x%.2f). same output: %s"
+                   , size.width(), size.height(), VideoFormat(cases[c].in).name().toUtf8().constData()
+                   , VideoFormat(cases[c].out).name().toUtf8().constData(), out_size.width(), out_size.height()
+                   , filters[cases[c].filter], fps0, threads, fps1, fps0 > 0 ? fps1/fps0 : 0.0, same ? "ok" : "FAIL");
+        }
+    }
+    qDebug("FFmpegSlice converter: %d failed", failed);
+    return failed ? 1 : 0;
+}
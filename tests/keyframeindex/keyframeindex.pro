@@ -0,0 +1,10 @@
+CONFIG -= app_bundle
+CONFIG += console
+TEMPLATE = app
+TARGET = keyframeindex
+
+PROJECTROOT = $$PWD/../..
+include($$PROJECTROOT/src/libQtAV.pri)
+preparePaths($$OUT_PWD/../../out)
+
+SOURCES += main.cpp
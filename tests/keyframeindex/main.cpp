@@ -0,0 +1,166 @@
+/******************************************************************************
+    QtAV:  Multimedia framework based on Qt and FFmpeg
+    Copyright (C) 2012-2017 Wang Bin <wbsecg1@gmail.com>
+
+*   This file is part of QtAV (from 2017)
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+******************************************************************************/
+
+#include <stdio.h>
+#include <QtCore/QCoreApplication>
+#include <QtCore/QDir>
+#include <QtCore/QFile>
+#include "KeyFrameIndex.h"
+
+/*
+ * Check KeyFrameIndex: lookup in the current run and in covered ranges, merging runs read after seeking,
+ * and save/load round trip.
+ */
+using namespace QtAV;
+
+static const qint64 kS = 1000000LL; // 1s in us
+static int nb_failed = 0;
+
+static void check(bool ok, const char* what)
+{
+    if (ok)
+        return;
+    nb_failed++;
+    printf("FAILED: %s\n", what);
+    fflush(0);
+}
+
+// key frame pts found for pts. -1 if unknown
+static qint64 keyFrame(const KeyFrameIndex& index, qint64 pts)
+{
+    KeyFrameIndex::Entry e;
+    if (!index.find(pts, &e))
+        return -1;
+    return e.pts;
+}
+
+// packets at 1 per 0.5s in [from, to], a key frame every gop seconds
+static void readRun(KeyFrameIndex *index, int from, int to, int gop)
+{
+    for (qint64 t = from*kS; t <= to*kS; t += kS/2)
+        index->addPacket(t, t/1000LL, t % (gop*kS) == 0);
+}
+
+static void checkLookup()
+{
+    KeyFrameIndex index;
+    check(keyFrame(index, 0) < 0, "empty index");
+    readRun(&index, 0, 5, 2);
+    check(index.size() == 3, "key frames of a run");
+    check(index.maxGop() == 2*kS, "max gop");
+    check(keyFrame(index, 0) == 0, "lookup of a key frame");
+    check(keyFrame(index, 3*kS) == 2*kS, "lookup in the current run");
+    check(keyFrame(index, 5*kS) == 4*kS, "lookup at the end of the current run");
+    check(keyFrame(index, 6*kS) < 0, "lookup after the current run");
+    KeyFrameIndex::Entry e;
+    check(index.find(3*kS, &e) && e.pos == 2*kS/1000LL, "byte position of a key frame");
+    // a key frame read again without position keeps the known one
+    index.addPacket(2*kS, -1, true);
+    check(index.find(3*kS, &e) && e.pos == 2*kS/1000LL, "byte position is kept");
+    // the repeated key frame is not in presentation order, the run is broken
+    check(keyFrame(index, 5*kS) == 4*kS, "lookup in a finished run");
+}
+
+static void checkMerge()
+{
+    KeyFrameIndex index;
+    readRun(&index, 0, 5, 2);
+    index.discontinue(); // seek
+    readRun(&index, 10, 15, 2);
+    index.discontinue();
+    check(keyFrame(index, 3*kS) == 2*kS, "lookup in the 1st range");
+    check(keyFrame(index, 13*kS) == 12*kS, "lookup in the 2nd range");
+    check(keyFrame(index, 7*kS) < 0, "lookup between ranges");
+    check(keyFrame(index, 11*kS) == 10*kS, "lookup at the start of a range");
+    // fill the gap, the 3 ranges are merged into 1
+    readRun(&index, 4, 11, 2);
+    index.discontinue();
+    check(index.size() == 8, "key frames are not duplicated");
+    check(keyFrame(index, 7*kS) == 6*kS, "lookup in the filled gap");
+    check(keyFrame(index, 9*kS) == 8*kS, "lookup across merged runs");
+    check(keyFrame(index, 15*kS) == 14*kS, "lookup at the end of merged ranges");
+    check(keyFrame(index, 16*kS) < 0, "lookup after merged ranges");
+    // a range inside another one changes nothing
+    readRun(&index, 2, 3, 2);
+    index.discontinue();
+    check(keyFrame(index, 7*kS) == 6*kS, "lookup after merging a contained range");
+    // a run without packets after the key frame covers nothing
+    index.addPacket(20*kS, -1, true);
+    index.discontinue();
+    check(keyFrame(index, 20*kS) < 0, "empty run");
+    // negative timestamps are ignored
+    index.addPacket(-kS, -1, true);
+    check(index.size() == 9, "invalid timestamp");
+    index.clear();
+    check(index.isEmpty() && keyFrame(index, 3*kS) < 0 && index.maxGop() == 0, "clear");
+}
+
+static void checkSaveLoad()
+{
+    const QString file(QDir::temp().filePath(QString::fromLatin1("qtav_test_%1.kidx").arg(QCoreApplication::applicationPid())));
+    KeyFrameIndex index;
+    readRun(&index, 0, 5, 2);
+    index.discontinue();
+    readRun(&index, 10, 17, 3);
+    // the current run is saved too
+    check(index.isModified(), "modified after adding key frames");
+    check(index.save(file, 1), "save");
+    check(!index.isModified(), "not modified after save");
+    KeyFrameIndex loaded;
+    check(!loaded.load(file, 0), "load a different stream");
+    check(loaded.load(file, 1), "load");
+    check(!loaded.isModified(), "not modified after load");
+    check(loaded.size() == index.size() && loaded.maxGop() == index.maxGop(), "key frames and max gop are loaded");
+    bool same = true;
+    for (qint64 t = -kS; t <= 20*kS; t += kS/4) {
+        KeyFrameIndex::Entry a, b;
+        const bool found = index.find(t, &a);
+        same &= found == loaded.find(t, &b) && (!found || (a.pts == b.pts && a.pos == b.pos));
+    }
+    check(same, "lookup after load is the same as saved");
+    QFile f(file);
+    // corrupted key frame count after magic, version, stream and max gop
+    if (f.open(QIODevice::ReadWrite)) {
+        f.seek(20);
+        f.write("\xff\xff\xff\xff", 4);
+        f.close();
+    }
+    check(!loaded.load(file, 1) && loaded.isEmpty(), "load a file with a corrupted count");
+    check(index.save(file, 1), "save again");
+    // truncated file
+    if (f.open(QIODevice::ReadWrite)) {
+        f.resize(f.size() - 4);
+        f.close();
+    }
+    check(!loaded.load(file, 1) && loaded.isEmpty(), "load a truncated file");
+    QFile::remove(file);
+    check(!loaded.load(file, 1), "load a missing file");
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication a(argc, argv);
+    checkLookup();
+    checkMerge();
+    checkSaveLoad();
+    printf("key frame index check: %s\n", nb_failed ? "FAILED" : "ok");
+    return nb_failed ? 1 : 0;
+}
@@ -0,0 +1,171 @@
+/******************************************************************************
+    QtAV:  Multimedia framework based on Qt and FFmpeg
+    Copyright (C) 2012-2017 Wang Bin <wbsecg1@gmail.com>
+
+*   This file is part of QtAV (from 2017)
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+******************************************************************************/
+
+#include <QtCore/QCoreApplication>
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QQueue>
+#include <QtCore/QStringList>
+#include <QtCore/QThread>
+#include <QtAV/Packet.h>
+#include "utils/BlockingQueue.h"
+#include "utils/SPSCQueue.h"
+#include <QtDebug>
+
+/*
+ * Compare BlockingQueue and BlockingSPSCQueue with 1 producer and 1 consumer transfering Packets,
+ * and with N such pairs running at the same time like N players in 1 process.
+ * parameters: [-n packets] [-pairs N] [-cap capacity]
+ */
+using namespace QtAV;
+
+template<class Q>
+class Producer : public QThread
+{
+public:
+    Producer(Q *q, int n) : m_q(q), m_n(n) {}
+protected:
+    void run() {
+        Packet pkt;
+        pkt.data = QByteArray(1024, 0);
+        for (int i = 0; i < m_n; ++i) {
+            pkt.pts = qreal(i)/1000.0;
+            m_q->put(pkt);
+        }
+    }
+private:
+    Q *m_q;
+    int m_n;
+};
+
+template<class Q>
+class Consumer : public QThread
+{
+public:
+    Consumer(Q *q, int n) : m_q(q), m_n(n), errors(0) {}
+    int errors;
+protected:
+    void run() {
+        for (int i = 0; i < m_n;) {
+            bool valid = false;
+            const Packet pkt = m_q->take(ULONG_MAX, &valid);
+            if (!valid)
+                continue;
+            if (qRound(pkt.pts*1000.0) != i)
+                errors++;
+            ++i;
+        }
+    }
+private:
+    Q *m_q;
+    int m_n;
+};
+
+template<class Q>
+qint64 bench(const char* name, int pairs, int n, int cap)
+{
+    QList<Q*> queues;
+    QList<QThread*> threads;
+    QList<Consumer<Q>*> consumers;
+    for (int i = 0; i < pairs; ++i) {
+        Q *q = new Q();
+        q->setCapacity(cap);
+        q->setThreshold(cap/2);
+        queues.append(q);
+        Consumer<Q> *c = new Consumer<Q>(q, n);
+        consumers.append(c);
+        threads.append(c);
+        threads.append(new Producer<Q>(q, n));
+    }
+    QElapsedTimer timer;
+    timer.start();
+    foreach (QThread* t, threads) {
+        t->start();
+    }
+    foreach (QThread* t, threads) {
+        t->wait();
+    }
+    const qint64 ms = qMax<qint64>(1, timer.elapsed());
+    int errors = 0;
+    foreach (Consumer<Q>* c, consumers) {
+        errors += c->errors;
+    }
+    printf("%-18s pairs: %d, packets: %d, capacity: %d, elapsed: %lldms, %.0f packets/s, errors: %d\n"
+           , name, pairs, n, cap, ms, qreal(n)*qreal(pairs)*1000.0/qreal(ms), errors);
+    fflush(0);
+    qDeleteAll(threads);
+    qDeleteAll(queues);
+    return ms;
+}
+
+// the queue never grows beyond maxSize() even if the full state is ignored
+static bool checkMaxSize()
+{
+    BlockingSPSCQueue<Packet> q;
+    q.setCapacity(4);
+    q.setMaxSize(16);
+    q.blockFull(false);
+    Packet pkt;
+    int placed = 0;
+    for (int i = 0; i < 100; ++i) {
+        pkt.pts = qreal(placed)/1000.0;
+        if (q.put(pkt) || q.size() > placed)
+            ++placed;
+    }
+    bool ok = placed == 16 && q.size() == 16;
+    for (int i = 0; i < 16 && ok; ++i) {
+        bool valid = false;
+        ok = qRound(q.take(0, &valid).pts*1000.0) == i && valid;
+    }
+    ok &= q.put(pkt) || q.size() == 1;
+    printf("max size check: %s\n", ok ? "ok" : "FAILED");
+    fflush(0);
+    return ok;
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication a(argc, argv);
+    int n = 1000000;
+    int pairs = 1;
+    int cap = 48;
+    int idx = a.arguments().indexOf(QLatin1String("-n"));
+    if (idx > 0)
+        n = a.arguments().at(idx + 1).toInt();
+    idx = a.arguments().indexOf(QLatin1String("-pairs"));
+    if (idx > 0)
+        pairs = a.arguments().at(idx + 1).toInt();
+    idx = a.arguments().indexOf(QLatin1String("-cap"));
+    if (idx > 0)
+        cap = a.arguments().at(idx + 1).toInt();
+    if (!checkMaxSize())
+        return 1;
+    QList<int> all_pairs;
+    all_pairs << pairs;
+    if (pairs == 1)
+        all_pairs << 16 << 32;
+    foreach (int p, all_pairs) {
+        const int np = p == pairs ? n : n/p;
+        const qint64 t0 = bench<BlockingQueue<Packet> >("BlockingQueue", p, np, cap);
+        const qint64 t1 = bench<BlockingSPSCQueue<Packet> >("BlockingSPSCQueue", p, np, cap);
+        printf("speedup: %.2fx\n", qreal(t0)/qreal(t1));
+    }
+    return 0;
+}
@@ -3,7 +3,10 @@
 #include <QtCore/QStringList>
 #include <QtDebug>
 #include <QtCore/QTime>
+#include <QtCore/QVector>
 #include <QtAV/Subtitle.h>
+#include "subtitle/BlendASS.h"
+#include "subtitle/SubtitleIndex.h"
 
 using namespace QtAV;
 
@@ -20,6 +23,131 @@ private slots:
     }
 };
 
+// simd ass blending must be the same as scalar code. returns number of mismatches
+static int testBlend(int loops)
+{
+    blend_ass_row_func f = get_blend_ass_row();
+    qsrand(1);
+    const int widths[] = { 1, 7, 8, 15, 16, 17, 33, 255, 1920 };
+    int failed = 0;
+    for (size_t i = 0; i < sizeof(widths)/sizeof(widths[0]); ++i) {
+        const int w = widths[i];
+        QVector<quint8> src(w);
+        QVector<quint32> d0(w), d1(w);
+        for (int n = 0; n < 200; ++n) {
+            const quint32 color = (quint32)qrand() << 16 ^ (quint32)qrand();
+            for (int x = 0; x < w; ++x) {
+                // include transparent and opaque pixels, 0 and full coverage
+                const int r = qrand();
+                src[x] = (r & 3) == 0 ? 0 : ((r & 3) == 1 ? 255 : quint8(qrand()));
+                d0[x] = (quint32)qrand() << 16 ^ (quint32)qrand();
+                if ((r & 12) == 0)
+                    d0[x] &= 0xffffff;
+                else if ((r & 12) == 4)
+                    d0[x] |= 0xff000000;
+            }
+            d1 = d0;
+            blend_ass_row_c(d0.data(), src.constData(), w, color);
+            f(d1.data(), src.constData(), w, color);
+            if (d0 != d1) {
+                ++failed;
+                qWarning("blend mismatch. width: %d, color: %#x", w, color);
+            }
+        }
+    }
+    qDebug("blend exact match test: %d failed", failed);
+    // a 4k subtitle layer
+    const int w = 3840, h = 400;
+    QVector<quint8> src(w*h);
+    QVector<quint32> dst(w*h);
+    for (int k = 0; k < src.size(); ++k) {
+        src[k] = quint8(qrand());
+        dst[k] = (quint32)qrand() << 16 ^ (quint32)qrand();
+    }
+    blend_ass_row_func funcs[] = { blend_ass_row_c, f };
+    const char* names[] = { "scalar", "simd" };
+    for (int k = 0; k < 2; ++k) {
+        QElapsedTimer timer;
+        timer.start();
+        for (int n = 0; n < loops; ++n) {
+            for (int y = 0; y < h; ++y)
+                funcs[k](dst.data() + y*w, src.constData() + y*w, w, 0x80ff8040);
+        }
+        qDebug("%s blend: %.1f Mpixel/s", names[k], double(w)*double(h)*double(loops)/1000.0/double(qMax<qint64>(1, timer.elapsed())));
+    }
+    return failed;
+}
+
+static qreal randTime(qreal max)
+{
+    return max*qreal(qrand())/qreal(RAND_MAX);
+}
+
+// lookups must be the same as linear search. returns number of mismatches
+static int testIndex(int n)
+{
+    qsrand(1);
+    // captions every 2s with overlaps. 1% cues are inserted out of order, and a few cues are very long
+    QList<SubtitleFrame> cues;
+    for (int i = 0; i < n; ++i) {
+        SubtitleFrame f;
+        f.begin = qreal(i)*2.0 + randTime(1.0);
+        f.end = f.begin + (i % 1000 == 0 ? 600.0 : 0.5 + randTime(5.0));
+        f.text = QString::number(i);
+        cues.append(f);
+    }
+    for (int i = 0; i < n/100; ++i)
+        qSwap(cues[qrand() % n], cues[qrand() % n]);
+    SubtitleIndex index;
+    QElapsedTimer timer;
+    timer.start();
+    foreach (const SubtitleFrame& f, cues) {
+        index.insert(f);
+    }
+    qDebug("%d cues inserted one by one: %lldms", n, timer.elapsed());
+    timer.restart();
+    index.setFrames(cues);
+    qDebug("%d cues set: %lldms", n, timer.elapsed());
+    const qreal duration = qreal(n)*2.0 + 10.0;
+    int failed = 0;
+    QVector<int> found, expected;
+    for (int k = 0; k < 2000; ++k) {
+        const qreal t = randTime(duration);
+        index.find(t, &found);
+        expected.resize(0);
+        for (int i = 0; i < index.size(); ++i) {
+            if (index.at(i).begin <= t && index.at(i).end >= t)
+                expected.append(i);
+        }
+        if (found != expected) {
+            ++failed;
+            qWarning("index lookup mismatch at %f: %d cues, expect %d", t, found.size(), expected.size());
+        }
+    }
+    qDebug("index lookup test: %d failed", failed);
+    // random seeks
+    const int seeks = 1000000;
+    int cues_found = 0;
+    timer.restart();
+    for (int k = 0; k < seeks; ++k)
+        cues_found += index.find(randTime(duration), &found);
+    const qint64 elapsed = qMax<qint64>(1, timer.elapsed());
+    qDebug("index: %d seeks %lldms, %.1f ns/seek, %d cues found", seeks, elapsed, double(elapsed)*1e6/double(seeks), cues_found);
+    const int scans = 1000;
+    cues_found = 0;
+    timer.restart();
+    for (int k = 0; k < scans; ++k) {
+        const qreal t = randTime(duration);
+        for (int i = 0; i < cues.size(); ++i) {
+            if (cues.at(i).begin <= t && cues.at(i).end >= t)
+                ++cues_found;
+        }
+    }
+    const qint64 elapsed_scan = qMax<qint64>(1, timer.elapsed());
+    qDebug("linear scan: %d seeks %lldms, %.1f ns/seek, %d cues found", scans, elapsed_scan, double(elapsed_scan)*1e6/double(scans), cues_found);
+    return failed;
+}
+
 int main(int argc, char *argv[])
 {
     QCoreApplication a(argc, argv);
@@ -30,6 +158,12 @@ int main(int argc, char *argv[])
     qDebug() << "-count: set subtitle frame count from t to t1";
     qDebug() << "-engine: subtitle processing engine, can be 'ffmpeg' and 'libass'";
     qDebug() << "-dir: add subtitle search directories";
+    qDebug() << "-blend: test and benchmark ass blending kernels";
+    qDebug() << "-index: test and benchmark subtitle timeline index with 100k cues";
+    if (a.arguments().contains(QLatin1String("-blend")))
+        return testBlend(20) ? 1 : 0;
+    if (a.arguments().contains(QLatin1String("-index")))
+        return testIndex(100000) ? 1 : 0;
     QString file;
     bool fuzzy = false;
     int t = -1, t1 = -1, count = 1;
@@ -2,7 +2,12 @@ TEMPLATE = subdirs
 
 SUBDIRS += \
     ao \
+    audioscale \
+    bench \
     decoder \
+    imageconverter \
+    keyframeindex \
+    queue \
     subtitle \
     transcode
 
@@ -22,13 +22,160 @@
 #include <QtDebug>
 #include <QtCore/QDir>
 #include <QtCore/QElapsedTimer>
+#include <QtCore/QEventLoop>
+#include <QtCore/QFileInfo>
 #include <QtCore/QStringList>
+#include <QtCore/QTimer>
+#include <QtCore/qmath.h>
 #include <QtAV>
+#include <QtAV/AudioEncoder.h>
 #include <QtAV/VideoEncoder.h>
 #include <QtAV/AVMuxer.h>
+#include <QtAV/AVTranscoder.h>
 
 using namespace QtAV;
 
+// moving gradient video and 440Hz sine audio
+static bool generateSynthetic(const QString& file, int seconds)
+{
+    const int w = 320, h = 240;
+    const qreal fps = 25;
+    VideoEncoder *venc = VideoEncoder::create("FFmpeg");
+    venc->setCodecName(QStringLiteral("mpeg4"));
+    venc->setWidth(w);
+    venc->setHeight(h);
+    venc->setFrameRate(fps);
+    venc->setPixelFormat(VideoFormat::Format_YUV420P);
+    venc->setBitRate(1024*1024);
+    AudioEncoder *aenc = AudioEncoder::create("FFmpeg");
+    aenc->setCodecName(QStringLiteral("mp2"));
+    AudioFormat af;
+    af.setSampleFormat(AudioFormat::SampleFormat_Signed16);
+    af.setChannelLayout(AudioFormat::ChannelLayout_Stereo);
+    af.setSampleRate(44100);
+    aenc->setAudioFormat(af);
+    if (!venc->open() || !aenc->open()) {
+        qWarning("failed to open synthetic encoders");
+        return false;
+    }
+    AVMuxer mux;
+    mux.setMedia(file);
+    mux.copyProperties(venc);
+    mux.copyProperties(aenc);
+    if (!mux.open()) {
+        qWarning("failed to open synthetic muxer");
+        return false;
+    }
+    const int nb_frames = int(fps)*seconds;
+    const int samples = aenc->frameSize() > 0 ? aenc->frameSize() : 1152;
+    qint64 nb_samples = 0;
+    for (int i = 0; i < nb_frames; ++i) {
+        QByteArray yuv(w*h*3/2, 0);
+        uchar *y = (uchar*)yuv.data();
+        for (int r = 0; r < h; ++r) {
+            for (int c = 0; c < w; ++c)
+                y[r*w + c] = uchar(r + c + i*4);
+        }
+        memset(y + w*h, 128, w*h/2);
+        VideoFrame frame(w, h, VideoFormat::Format_YUV420P, yuv);
+        frame.setTimestamp(qreal(i)/fps);
+        if (venc->encode(frame))
+            mux.writeVideo(venc->encoded());
+        // audio until the end of current video frame
+        while (qreal(nb_samples)/qreal(af.sampleRate()) < qreal(i+1)/fps) {
+            QByteArray pcm(samples*af.channels()*af.bytesPerSample(), 0);
+            qint16 *s16 = (qint16*)pcm.data();
+            for (int k = 0; k < samples; ++k) {
+                const qint16 v = qint16(8000.0*qSin(2.0*M_PI*440.0*qreal(nb_samples + k)/qreal(af.sampleRate())));
+                s16[2*k] = s16[2*k+1] = v;
+            }
+            AudioFrame aframe(af, pcm);
+            aframe.setTimestamp(qreal(nb_samples)/qreal(af.sampleRate()));
+            nb_samples += samples;
+            if (aenc->encode(aframe))
+                mux.writeAudio(aenc->encoded());
+        }
+    }
+    while (venc->encode())
+        mux.writeVideo(venc->encoded());
+    while (aenc->encode())
+        mux.writeAudio(aenc->encoded());
+    venc->close();
+    aenc->close();
+    mux.close();
+    delete venc;
+    delete aenc;
+    qDebug("synthetic input: %s, %d frames", file.toUtf8().constData(), nb_frames);
+    return true;
+}
+
+/*!
+ * transcode with AVTranscoder file source: no player and no clock
+ * copy: remux without decoding and encoding. start, stop: ms
+ * return nonzero if no output is written or output duration is not close to the input range
+ */
+static int transcodeHeadless(QCoreApplication& a, const QString& file, const QString& outFile, const QString& fmt, const QString& cv, const QString& ca, bool copy, qint64 start, qint64 stop)
+{
+    AVTranscoder transcoder;
+    transcoder.setMediaSource(file);
+    transcoder.setOutputMedia(outFile);
+    if (!fmt.isEmpty())
+        transcoder.setOutputFormat(fmt);
+    transcoder.setStartTime(start);
+    transcoder.setStopTime(stop);
+    transcoder.setStreamCopy(copy);
+    if (!copy) {
+        if (!transcoder.createVideoEncoder()) {
+            qWarning("failed to create video encoder");
+            return 1;
+        }
+        VideoEncoder *venc = transcoder.videoEncoder();
+        venc->setCodecName(cv);
+        venc->setBitRate(1024*1024);
+        if (!ca.isEmpty() && transcoder.createAudioEncoder())
+            transcoder.audioEncoder()->setCodecName(ca);
+    }
+    QElapsedTimer timer;
+    timer.start();
+    transcoder.start();
+    if (!transcoder.isRunning()) {
+        qWarning("failed to start transcoder");
+        return 1;
+    }
+    while (transcoder.isRunning()) {
+        QEventLoop loop;
+        QObject::connect(&transcoder, SIGNAL(stopped()), &loop, SLOT(quit()));
+        QTimer::singleShot(200, &loop, SLOT(quit()));
+        loop.exec();
+        printf("progress: %.1f%%, speed: %.2fx, fps: %.2f, size: %lld\n", transcoder.progress()*100.0, transcoder.speed(), transcoder.encodeFrameRate(), transcoder.encodedSize());
+        fflush(0);
+    }
+    a.processEvents();
+    const qreal duration = transcoder.encodedDuration();
+    qDebug("headless transcode finished. time: %lldms, duration: %.3fs, size: %lld", timer.elapsed(), duration, transcoder.encodedSize());
+    if (transcoder.encodedSize() <= 0 || QFileInfo(outFile).size() <= 0) {
+        qWarning("FAILED: no output is written");
+        return 1;
+    }
+    AVDemuxer demuxer;
+    demuxer.setMedia(file);
+    if (!demuxer.load()) {
+        qWarning("FAILED: can not load input to check duration");
+        return 1;
+    }
+    qint64 end = demuxer.startTime() + demuxer.duration();
+    if (stop > 0)
+        end = qMin(end, stop);
+    const qreal expected = qreal(end - qMax(demuxer.startTime(), start))/1000.0;
+    // stream copy starts and stops at key frames, and the last frame duration is not counted
+    const qreal tolerance = qMax<qreal>(1.0, expected*0.05);
+    if (expected > 0 && qAbs(duration - expected) > tolerance) {
+        qWarning("FAILED: encoded duration %.3fs, expected %.3fs", duration, expected);
+        return 1;
+    }
+    return 0;
+}
+
 int main(int argc, char *argv[])
 {
     QCoreApplication a(argc, argv);
@@ -56,6 +203,33 @@ int main(int argc, char *argv[])
     if (idx > 0)
         fmt = a.arguments().at(idx + 1);
 
+    QString ca;
+    idx = a.arguments().indexOf(QLatin1String("-c:a"));
+    if (idx > 0)
+        ca = a.arguments().at(idx + 1);
+    // -synthetic [seconds]: generate the input file
+    idx = a.arguments().indexOf(QLatin1String("-synthetic"));
+    if (idx > 0) {
+        int seconds = 10;
+        if (idx + 1 < a.arguments().size() && a.arguments().at(idx + 1).toInt() > 0)
+            seconds = a.arguments().at(idx + 1).toInt();
+        file = QDir::tempPath() + QStringLiteral("/qtav_synthetic.mkv");
+        if (!generateSynthetic(file, seconds))
+            return 1;
+    }
+    // -ss ms, -to ms: time range of file source
+    qint64 start = 0, stop = 0;
+    idx = a.arguments().indexOf(QLatin1String("-ss"));
+    if (idx > 0)
+        start = a.arguments().at(idx + 1).toLongLong();
+    idx = a.arguments().indexOf(QLatin1String("-to"));
+    if (idx > 0)
+        stop = a.arguments().at(idx + 1).toLongLong();
+    // -copy: stream copy (remux)
+    const bool copy = a.arguments().contains(QLatin1String("-copy"));
+    if (copy || a.arguments().contains(QLatin1String("-headless")))
+        return transcodeHeadless(a, file, outFile, fmt, cv, ca, copy, start, stop);
+
 
     QString opt;
     QVariantHash decopt;